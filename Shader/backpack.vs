@@ -1,4 +1,4 @@
-#version 330 core
+#version 430 core
 layout(location=0)in vec3 aPos;
 layout(location=1)in vec3 aNormal;
 layout(location=2)in vec2 aTexCoords;
@@ -8,13 +8,12 @@ out vec3 Normal;
 out vec3 FragPos;
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+#include "frameData.glsl"
 
 void main()
 {
     TexCoords=aTexCoords;
     Normal=mat3(transpose(inverse(model)))*aNormal;
     FragPos=vec3(model*vec4(aPos,1.));
-    gl_Position=projection*view*model*vec4(aPos,1.);
+    gl_Position=projection_matrix*view_matrix*model*vec4(aPos,1.);
 }
\ No newline at end of file
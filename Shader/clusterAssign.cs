@@ -0,0 +1,113 @@
+#version 430 core
+// 分簇光照的GPU光源分配：每个簇一个工作组，组内的调用按步长分担所有光源的相交测试。
+// 第一遍测试所有光源，结果记在共享内存的位掩码中（每 GROUP_SIZE 个光源两个uint），并数出相交的光源数；
+// 由一个调用从全局计数器分配下标列表中的位置，第二遍按位掩码的前缀计数按光源顺序写入，
+// 列表内容和顺序与CPU路径相同，每帧结果一致。超出位掩码范围的光源在第二遍重新测试，用组内前缀和压缩。
+// 列表容量不够时照常计数，放不下的部分计入 dropped，CPU端读回后扩大容量
+#define GROUP_SIZE 64
+#define MASK_BATCHES 256//位掩码覆盖前 MASK_BATCHES*GROUP_SIZE 个光源（16384个，共2KB）
+layout(local_size_x=GROUP_SIZE,local_size_y=1,local_size_z=1)in;
+
+struct ClusterAABB{
+    vec4 minPoint;
+    vec4 maxPoint;
+};
+
+layout(std430,binding=1)writeonly buffer ClusterGrid{uvec2 clusterLightGrid[];};
+layout(std430,binding=2)writeonly buffer ClusterIndices{uint clusterIndices[];};
+layout(std430,binding=3)readonly buffer ClusterBounds{ClusterAABB clusterBounds[];};
+layout(std430,binding=5)readonly buffer ViewLights{vec4 viewLights[];};//视空间的位置和影响半径，CPU每帧变换一次
+layout(std430,binding=6)buffer ClusterCounters{
+    uint totalAssignments;//所有簇需要的下标总数（包括放不下的）
+    uint maxPerCluster;
+    uint dropped;//容量不足没有写入的配对数
+};
+
+uniform uint lightCount;
+uniform uint indexCapacity;
+
+shared uint hitMask[MASK_BATCHES*2];
+shared uint hitCount;
+shared uint listOffset;
+shared uint listCount;
+shared uint scan[GROUP_SIZE];
+
+bool touches(uint i,ClusterAABB box)
+{
+    vec4 l=viewLights[i];
+    vec3 d=l.xyz-clamp(l.xyz,box.minPoint.xyz,box.maxPoint.xyz);
+    return dot(d,d)<=l.w*l.w;
+}
+
+void main()
+{
+    uint cluster=gl_WorkGroupID.x+gl_NumWorkGroups.x*(gl_WorkGroupID.y+gl_NumWorkGroups.y*gl_WorkGroupID.z);
+    uint lane=gl_LocalInvocationID.x;
+    ClusterAABB box=clusterBounds[cluster];
+    uint batches=(lightCount+GROUP_SIZE-1)/GROUP_SIZE;
+    uint maskBatches=min(batches,uint(MASK_BATCHES));
+    for(uint i=lane;i<maskBatches*2u;i+=GROUP_SIZE)
+    hitMask[i]=0u;
+    if(lane==0u)
+    hitCount=0u;
+    barrier();
+
+    uint hits=0u;
+    for(uint i=lane;i<lightCount;i+=GROUP_SIZE){
+        if(touches(i,box)){
+            hits++;
+            uint batch=i/GROUP_SIZE;
+            if(batch<maskBatches)
+            atomicOr(hitMask[batch*2u+lane/32u],1u<<(lane%32u));
+        }
+    }
+    atomicAdd(hitCount,hits);
+    barrier();
+
+    if(lane==0u){
+        uint count=hitCount;
+        uint offset=atomicAdd(totalAssignments,count);
+        atomicMax(maxPerCluster,count);
+        uint written=offset<indexCapacity?min(count,indexCapacity-offset):0u;
+        if(written<count)
+        atomicAdd(dropped,count-written);
+        listOffset=offset;
+        listCount=written;
+        clusterLightGrid[cluster]=uvec2(offset,written);
+    }
+    barrier();
+
+    // 位掩码覆盖的光源：本批之前的命中数加上本批中编号更小的命中数就是写入位置
+    uint written=listCount;
+    uint base=0u;
+    uint below=lane<32u?(1u<<lane)-1u:0xFFFFFFFFu;
+    uint belowHigh=lane<32u?0u:(1u<<(lane-32u))-1u;
+    for(uint batch=0u;batch<maskBatches&&base<written;batch++){
+        uint low=hitMask[batch*2u];
+        uint high=hitMask[batch*2u+1u];
+        uint bit=lane<32u?(low>>lane)&1u:(high>>(lane-32u))&1u;
+        uint slot=base+uint(bitCount(low&below)+bitCount(high&belowHigh));
+        if(bit!=0u&&slot<written)
+        clusterIndices[listOffset+slot]=batch*GROUP_SIZE+lane;
+        base+=uint(bitCount(low)+bitCount(high));
+    }
+
+    // 其余的光源（超过16384个时）重新测试，每批用包含型前缀和得到写入位置
+    for(uint batch=maskBatches;batch<batches&&base<written;batch++){
+        uint i=batch*GROUP_SIZE+lane;
+        uint hit=(i<lightCount&&touches(i,box))?1u:0u;
+        scan[lane]=hit;
+        barrier();
+        for(uint stride=1u;stride<GROUP_SIZE;stride<<=1){
+            uint add=lane>=stride?scan[lane-stride]:0u;
+            barrier();
+            scan[lane]+=add;
+            barrier();
+        }
+        uint slot=base+scan[lane]-hit;
+        if(hit!=0u&&slot<written)
+        clusterIndices[listOffset+slot]=i;
+        base+=scan[GROUP_SIZE-1];
+        barrier();
+    }
+}
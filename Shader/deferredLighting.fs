@@ -0,0 +1,40 @@
+#version 430 core
+// 延迟渲染的光照阶段，与 screen.vs 配合画全屏四边形。
+// 灯光、分簇光源列表和光照函数与前向路径共用，见 lighting.glsl
+in vec2 TexCoords;
+out vec4 FragColor;
+
+#include "frameData.glsl"
+#include "lighting.glsl"
+#include "normalEncoding.glsl"
+
+uniform sampler2D gAlbedoSpecular;
+uniform sampler2D gNormal;
+uniform sampler2D gGloss;
+uniform sampler2D gDepth;
+
+void main()
+{
+    float depth=texture(gDepth,TexCoords).r;
+    if(depth>=1.)
+    discard;//没有几何体，保留清屏颜色
+    // 由深度重建世界空间位置
+    vec4 clip=vec4(TexCoords*2.-1.,depth*2.-1.,1.);
+    vec4 world=inverseViewProjection*clip;
+    vec3 FragPos=world.xyz/world.w;
+    vec3 Normal=OctDecode(texture(gNormal,TexCoords).xy);
+    vec4 albedoSpecular=texture(gAlbedoSpecular,TexCoords);
+    float shininess=exp2(texture(gGloss,TexCoords).r*10.);
+
+    vec3 viewDir=normalize(viewPos-FragPos);
+    vec3 lightdiff=vec3(0.);
+    vec3 lightspec=vec3(0.);
+    float viewDepth=-(view_matrix*vec4(FragPos,1.)).z;
+    CalcDirLight(dirLight,Normal,viewDir,shininess,CalcDirShadow(FragPos,Normal,viewDepth),lightdiff,lightspec);
+    CalcClusterPointLights(viewDepth,Normal,FragPos,viewDir,shininess,lightdiff,lightspec);
+    CalcSpotLight(spotLight,Normal,FragPos,viewDir,shininess,lightdiff,lightspec);
+
+    vec3 baseColor=albedoSpecular.rgb;
+    vec3 ambient=.1*baseColor;
+    FragColor=vec4(baseColor*lightdiff+ambient+albedoSpecular.a*lightspec,1.);
+}
@@ -0,0 +1,8 @@
+// 每帧的相机数据，从流式缓冲上传（与 main.cpp 中的 FrameUniforms 一致）。
+// GLSL 330 不能用 binding 布局，绑定点由 main.cpp 在链接后用 Shader::BindUniformBlock 指定
+layout(std140)uniform FrameData{
+    mat4 view_matrix;
+    mat4 projection_matrix;// 带TAA抖动
+    mat4 inverseViewProjection;
+    vec3 viewPos;
+};
@@ -0,0 +1,25 @@
+#version 330 core
+// 延迟渲染的几何阶段，与 userShader.vs 配合使用，只写材质属性，不计算光照
+in vec2 TexCoord;
+in vec3 Normal;
+in vec3 FragPos;
+layout(location=0)out vec4 gAlbedoSpecular;
+layout(location=1)out vec2 gNormal;
+layout(location=2)out float gGloss;
+
+//材质和颜色调整与前向路径共用，见 material.glsl
+#include "material.glsl"
+#include "normalEncoding.glsl"
+
+void main()
+{
+    vec4 texColor=texture(material.baseTexture,TexCoord);
+    // G-buffer不支持混合，半透明部分按alpha测试处理
+    if(texColor.a<.5)
+    discard;
+    vec3 baseColor=AdjustHSL(texColor.xyz,ourTime/ourColor.x,0.,0.);
+    // 材质颜色直接乘进反照率（前向路径中环境光不乘材质颜色，这里为了少一个附件做了近似）
+    gAlbedoSpecular=vec4(baseColor*material.baseColor,dot(material.specular,vec3(.2126,.7152,.0722)));
+    gNormal=OctEncode(normalize(Normal));
+    gGloss=log2(clamp(material.shininess,1.,1024.))/10.;
+}
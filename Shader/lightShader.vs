@@ -1,12 +1,11 @@
-#version 330 core
+#version 430 core
 layout(location=0)in vec3 aPos;//顶点位置为0的数据
 layout(location=1)in vec2 aTexCoord;
 
 out vec2 TexCoord;
 
 uniform mat4 model_matrix;
-uniform mat4 view_matrix;
-uniform mat4 projection_matrix;
+#include "frameData.glsl"
 
 void main()
 {
@@ -0,0 +1,206 @@
+// 光照：灯光定义、分簇点光源、级联阴影和阴影图集。
+// 前向(userShader.fs)和延迟(deferredLighting.fs)两条路径共用，光泽度由调用方传入。
+// 定义了 LEGACY_GL 时（GL 3.3，见 Shader.h）没有着色器存储缓冲，同样的数据从纹理缓冲中用 texelFetch 读取
+struct DirLight{
+    vec3 lightcolor;
+    vec3 specularcolor;
+    vec3 direction;
+};
+
+struct PointLight{
+    vec4 positionRadius;//xyz 位置 w 影响半径
+    vec4 lightcolor;
+    vec4 specularcolor;
+    vec4 attenuation;//衰减系数 常数项 一次项 二次项
+    vec4 shadow;//x 阴影图块起始下标(-1表示没有阴影)
+};
+
+struct SpotLight{
+    vec3 lightcolor;
+    vec3 specularcolor;
+    vec3 position;
+    vec3 direction;
+    float angle;
+    float smoothness;
+    vec3 attenuation;//衰减系数 常数项 一次项 二次项
+};
+
+//声明灯光
+uniform DirLight dirLight;
+uniform SpotLight spotLight;
+
+//分簇光照：点光源和每个簇的光源列表都在着色器存储缓冲中，见 ClusteredLighting.h
+#ifdef LEGACY_GL
+uniform samplerBuffer pointLightBuffer;//每个光源5个texel
+uniform usamplerBuffer clusterGridBuffer;
+uniform usamplerBuffer clusterIndexBuffer;
+PointLight LoadPointLight(uint index)
+{
+    int base=int(index)*5;
+    PointLight light;
+    light.positionRadius=texelFetch(pointLightBuffer,base);
+    light.lightcolor=texelFetch(pointLightBuffer,base+1);
+    light.specularcolor=texelFetch(pointLightBuffer,base+2);
+    light.attenuation=texelFetch(pointLightBuffer,base+3);
+    light.shadow=texelFetch(pointLightBuffer,base+4);
+    return light;
+}
+uvec2 LoadClusterRange(uint cluster){return texelFetch(clusterGridBuffer,int(cluster)).xy;}
+uint LoadClusterIndex(uint index){return texelFetch(clusterIndexBuffer,int(index)).x;}
+#else
+layout(std430,binding=0)readonly buffer PointLights{PointLight pointLights[];};
+layout(std430,binding=1)readonly buffer ClusterGrid{uvec2 clusterLightGrid[];};//每个簇的 偏移/数量
+layout(std430,binding=2)readonly buffer ClusterIndices{uint clusterIndices[];};
+PointLight LoadPointLight(uint index){return pointLights[index];}
+uvec2 LoadClusterRange(uint cluster){return clusterLightGrid[cluster];}
+uint LoadClusterIndex(uint index){return clusterIndices[index];}
+#endif
+uniform uvec3 clusterDims;
+uniform vec2 clusterScreenSize;
+uniform vec2 clusterDepthScaleBias;//深度切片 = log(视空间深度)*scale+bias
+
+//级联阴影，见 CascadedShadowMap.h
+uniform bool shadowsEnabled;
+uniform sampler2DArrayShadow shadowMap;
+uniform mat4 cascadeMatrices[4];
+uniform vec4 cascadeSplits;//每一级的最远视空间深度
+uniform vec4 cascadeTexelSizes;//每一级一个纹素对应的世界空间尺寸
+
+//点光源和聚光灯的阴影图集，见 ShadowAtlas.h
+struct ShadowTile{
+    mat4 viewProjection;
+    vec4 atlasRect;//xy 图块在图集中的uv偏移 zw uv尺寸
+};
+#ifdef LEGACY_GL
+uniform samplerBuffer shadowTileBuffer;//每个图块5个texel：矩阵的4列和uv矩形
+ShadowTile LoadShadowTile(int index)
+{
+    int base=index*5;
+    ShadowTile tile;
+    tile.viewProjection=mat4(texelFetch(shadowTileBuffer,base),texelFetch(shadowTileBuffer,base+1),texelFetch(shadowTileBuffer,base+2),texelFetch(shadowTileBuffer,base+3));
+    tile.atlasRect=texelFetch(shadowTileBuffer,base+4);
+    return tile;
+}
+#else
+layout(std430,binding=4)readonly buffer ShadowTiles{ShadowTile shadowTiles[];};
+ShadowTile LoadShadowTile(int index){return shadowTiles[index];}
+#endif
+uniform sampler2DShadow shadowAtlas;
+uniform int spotShadowTile;//-1表示聚光灯没有阴影
+
+// 方向光阴影：按视空间深度选择级联，沿法线偏移后做3x3 PCF
+float CalcDirShadow(vec3 fragPos,vec3 normal,float viewDepth)
+{
+    if(!shadowsEnabled||viewDepth>=cascadeSplits.w)
+    return 1.;
+    int cascade=3;
+    for(int i=0;i<4;i++){
+        if(viewDepth<cascadeSplits[i]){
+            cascade=i;
+            break;
+        }
+    }
+    vec3 offsetPos=fragPos+normal*cascadeTexelSizes[cascade]*1.5;
+    vec4 lightPos=cascadeMatrices[cascade]*vec4(offsetPos,1.);
+    vec3 coord=lightPos.xyz/lightPos.w*.5+.5;
+    if(coord.z>1.)
+    return 1.;
+    vec2 texel=1./vec2(textureSize(shadowMap,0).xy);
+    float lit=0.;
+    for(int x=-1;x<=1;x++){
+        for(int y=-1;y<=1;y++){
+            lit+=texture(shadowMap,vec4(coord.xy+vec2(x,y)*texel,float(cascade),coord.z));
+        }
+    }
+    return lit/9.;
+}
+
+// 在阴影图集的一个图块中采样，坐标限制在图块内部，避免滤波时读到相邻图块
+float SampleShadowTile(int tile,vec3 fragPos,vec3 normal)
+{
+    ShadowTile t=LoadShadowTile(tile);
+    vec4 lightPos=t.viewProjection*vec4(fragPos+normal*.02,1.);
+    vec3 coord=lightPos.xyz/lightPos.w*.5+.5;
+    if(coord.z>1.)
+    return 1.;
+    vec2 halfTexel=.5/vec2(textureSize(shadowAtlas,0));
+    vec2 uv=clamp(t.atlasRect.xy+coord.xy*t.atlasRect.zw,t.atlasRect.xy+halfTexel,t.atlasRect.xy+t.atlasRect.zw-halfTexel);
+    return texture(shadowAtlas,vec3(uv,coord.z));
+}
+
+// 点光源阴影：按主轴方向选择立方体的面（+X -X +Y -Y +Z -Z）
+float CalcPointShadow(PointLight light,vec3 fragPos,vec3 normal)
+{
+    if(light.shadow.x<0.)
+    return 1.;
+    vec3 d=fragPos-light.positionRadius.xyz;
+    vec3 a=abs(d);
+    int face=(a.x>=a.y&&a.x>=a.z)?(d.x>0.?0:1):(a.y>=a.z?(d.y>0.?2:3):(d.z>0.?4:5));
+    return SampleShadowTile(int(light.shadow.x)+face,fragPos,normal);
+}
+
+// calculates the color when using a directional light.
+void CalcDirLight(DirLight light,vec3 normal,vec3 viewDir,float shininess,float shadow,inout vec3 diffusecolor,inout vec3 specularcolor)
+{
+    vec3 lightDir=normalize(-light.direction);
+    // diffuse shading
+    float diff=max(dot(normal,lightDir),0.);
+    // specular shading
+    vec3 reflectDir=reflect(-lightDir,normal);
+    float spec=pow(max(dot(viewDir,reflectDir),0.),shininess);
+    diffusecolor+=light.lightcolor*diff*shadow;
+    specularcolor+=light.specularcolor*spec*shadow;
+}
+
+// calculates the color when using a point light.
+void CalcPointLight(PointLight light,vec3 normal,vec3 fragPos,vec3 viewDir,float shininess,inout vec3 diffusecolor,inout vec3 specularcolor)
+{
+    vec3 lightDir=normalize(light.positionRadius.xyz-fragPos);
+    // diffuse shading
+    float diff=max(dot(normal,lightDir),0.);
+    // specular shading
+    vec3 reflectDir=reflect(-lightDir,normal);
+    float spec=pow(max(dot(viewDir,reflectDir),0.),shininess);
+    // attenuation
+    float distance=length(light.positionRadius.xyz-fragPos);
+    float attenuation=1./(light.attenuation.x+light.attenuation.y*distance+light.attenuation.z*(distance*distance));
+    attenuation*=CalcPointShadow(light,fragPos,normalize(normal));
+    // combine results
+    diffusecolor+=light.lightcolor.rgb*diff*attenuation;
+    specularcolor+=light.specularcolor.rgb*spec*attenuation;
+}
+
+// calculates the color when using a spot light.
+void CalcSpotLight(SpotLight light,vec3 normal,vec3 fragPos,vec3 viewDir,float shininess,inout vec3 diffusecolor,inout vec3 specularcolor)
+{
+    vec3 lightDir=normalize(light.position-fragPos);
+    // diffuse shading
+    float diff=max(dot(normal,lightDir),0.);
+    // specular shading
+    vec3 reflectDir=reflect(-lightDir,normal);
+    float spec=pow(max(dot(viewDir,reflectDir),0.),shininess);
+    // attenuation
+    float distance=length(light.position-fragPos);
+    float attenuation=1./(light.attenuation.x+light.attenuation.y*distance+light.attenuation.z*(distance*distance));
+    if(spotShadowTile>=0)
+    attenuation*=SampleShadowTile(spotShadowTile,fragPos,normalize(normal));
+
+    // spotlight intensity
+    float theta=dot(lightDir,normalize(-light.direction));
+    float intensity=smoothstep(cos(light.angle+light.smoothness),cos(light.angle-light.smoothness),theta);
+    // combine results
+    diffusecolor+=light.lightcolor*diff*attenuation*intensity;
+    specularcolor+=light.specularcolor*spec*attenuation*intensity;
+}
+
+// 点光源：只遍历片元所在簇的光源
+void CalcClusterPointLights(float viewDepth,vec3 normal,vec3 fragPos,vec3 viewDir,float shininess,inout vec3 diffusecolor,inout vec3 specularcolor)
+{
+    uvec3 clusterCoord;
+    clusterCoord.xy=uvec2(clamp(gl_FragCoord.xy/clusterScreenSize,0.,.9999)*vec2(clusterDims.xy));
+    clusterCoord.z=uint(clamp(log(max(viewDepth,1e-4))*clusterDepthScaleBias.x+clusterDepthScaleBias.y,0.,float(clusterDims.z)-1.));
+    uvec2 lightRange=LoadClusterRange(clusterCoord.x+clusterDims.x*(clusterCoord.y+clusterDims.y*clusterCoord.z));
+    for(uint i=0u;i<lightRange.y;i++){
+        CalcPointLight(LoadPointLight(LoadClusterIndex(lightRange.x+i)),normal,fragPos,viewDir,shininess,diffusecolor,specularcolor);
+    }
+}
@@ -0,0 +1,18 @@
+// 八面体编码：把单位向量投影到八面体上再展开到[-1,1]^2，G-buffer的写入(gbuffer.fs)和读取(deferredLighting.fs)共用
+vec2 SignNotZero(vec2 v)
+{
+    return vec2(v.x>=0.?1.:-1.,v.y>=0.?1.:-1.);
+}
+
+vec2 OctEncode(vec3 n)
+{
+    n/=abs(n.x)+abs(n.y)+abs(n.z);
+    return n.z>=0.?n.xy:(1.-abs(n.yx))*SignNotZero(n.xy);
+}
+
+vec3 OctDecode(vec2 e)
+{
+    vec3 n=vec3(e.xy,1.-abs(e.x)-abs(e.y));
+    if(n.z<0.)n.xy=(1.-abs(n.yx))*SignNotZero(n.xy);
+    return normalize(n);
+}
@@ -0,0 +1,7 @@
+#version 330 core
+out vec4 FragColor;
+
+void main()
+{
+    FragColor=vec4(1.);//颜色写入已关闭，只用于遮挡查询
+}
\ No newline at end of file
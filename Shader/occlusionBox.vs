@@ -0,0 +1,11 @@
+#version 330 core
+layout(location=0)in vec3 aPos;//单位立方体 -0.5~0.5
+
+uniform mat4 viewProjection;
+uniform vec3 boxCenter;
+uniform vec3 boxExtents;//半边长
+
+void main()
+{
+    gl_Position=viewProjection*vec4(boxCenter+aPos*2.*boxExtents,1.);
+}
\ No newline at end of file
@@ -4,9 +4,59 @@ out vec4 FragColor;
 in vec2 TexCoords;
 
 uniform sampler2D screenTexture;
+uniform vec2 sourceSize;// 场景颜色纹理的像素尺寸（动态分辨率下可能小于窗口）
+uniform float sharpness;// 放大后的锐化强度，0为不锐化
+
+// Catmull-Rom双三次插值放大，利用双线性过滤把16次采样合并为9次
+vec3 SampleCatmullRom(vec2 uv)
+{
+    vec2 samplePos=uv*sourceSize;
+    vec2 texPos1=floor(samplePos-.5)+.5;
+    vec2 f=samplePos-texPos1;
+
+    vec2 w0=f*(-.5+f*(1.-.5*f));
+    vec2 w1=1.+f*f*(-2.5+1.5*f);
+    vec2 w2=f*(.5+f*(2.-1.5*f));
+    vec2 w3=f*f*(-.5+.5*f);
+
+    vec2 w12=w1+w2;
+    vec2 offset12=w2/w12;
+
+    vec2 texPos0=(texPos1-1.)/sourceSize;
+    vec2 texPos3=(texPos1+2.)/sourceSize;
+    vec2 texPos12=(texPos1+offset12)/sourceSize;
+
+    vec3 result=vec3(0.);
+    result+=texture(screenTexture,vec2(texPos0.x,texPos0.y)).rgb*w0.x*w0.y;
+    result+=texture(screenTexture,vec2(texPos12.x,texPos0.y)).rgb*w12.x*w0.y;
+    result+=texture(screenTexture,vec2(texPos3.x,texPos0.y)).rgb*w3.x*w0.y;
+
+    result+=texture(screenTexture,vec2(texPos0.x,texPos12.y)).rgb*w0.x*w12.y;
+    result+=texture(screenTexture,vec2(texPos12.x,texPos12.y)).rgb*w12.x*w12.y;
+    result+=texture(screenTexture,vec2(texPos3.x,texPos12.y)).rgb*w3.x*w12.y;
+
+    result+=texture(screenTexture,vec2(texPos0.x,texPos3.y)).rgb*w0.x*w3.y;
+    result+=texture(screenTexture,vec2(texPos12.x,texPos3.y)).rgb*w12.x*w3.y;
+    result+=texture(screenTexture,vec2(texPos3.x,texPos3.y)).rgb*w3.x*w3.y;
+    return max(result,vec3(0.));
+}
 
 void main()
 {
-    vec3 col=texture(screenTexture,TexCoords).rgb;
+    vec3 col=SampleCatmullRom(TexCoords);
+    if(sharpness>0.)
+    {
+        // 对比度自适应锐化：用十字邻域估计局部细节，并把结果限制在邻域范围内，避免出现光晕
+        vec2 texel=1./sourceSize;
+        vec3 n=texture(screenTexture,TexCoords+vec2(0.,texel.y)).rgb;
+        vec3 s=texture(screenTexture,TexCoords-vec2(0.,texel.y)).rgb;
+        vec3 e=texture(screenTexture,TexCoords+vec2(texel.x,0.)).rgb;
+        vec3 w=texture(screenTexture,TexCoords-vec2(texel.x,0.)).rgb;
+        vec3 minColor=min(min(min(n,s),min(e,w)),col);
+        vec3 maxColor=max(max(max(n,s),max(e,w)),col);
+        // 局部对比度越高锐化越弱
+        vec3 amount=sharpness*clamp(min(minColor,1.-maxColor)/max(maxColor,vec3(1e-4)),0.,1.);
+        col=clamp(col+(col*4.-(n+s+e+w))*.25*amount,minColor,maxColor);
+    }
     FragColor=vec4(col,1.);
-}
\ No newline at end of file
+}
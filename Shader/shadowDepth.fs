@@ -0,0 +1,5 @@
+#version 330 core
+// 没有颜色输出，深度由光栅化自动写入
+void main()
+{
+}
@@ -0,0 +1,11 @@
+#version 330 core
+// 只写深度的阴影投射体着色器
+layout(location=0)in vec3 aPos;
+
+uniform mat4 lightViewProjection;
+uniform mat4 model;
+
+void main()
+{
+    gl_Position=lightViewProjection*model*vec4(aPos,1.);
+}
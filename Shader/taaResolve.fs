@@ -0,0 +1,128 @@
+#version 330 core
+// 时间抗锯齿与时间上采样：把本帧（带抖动、可能是较低分辨率）的场景颜色累积到窗口分辨率的历史中
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+uniform sampler2D sceneColor;
+uniform sampler2D sceneDepth;
+uniform sampler2D velocityBuffer;
+uniform sampler2D historyColor;// 上一帧的输出，窗口分辨率
+uniform vec2 sceneSize;
+uniform vec2 outputSize;
+uniform vec2 jitterUV;
+uniform float feedback;// 本帧颜色的混合权重
+uniform bool historyValid;
+
+vec3 RGBToYCoCg(vec3 c)
+{
+    return vec3(dot(c,vec3(.25,.5,.25)),dot(c,vec3(.5,0.,-.5)),dot(c,vec3(-.25,.5,-.25)));
+}
+
+vec3 YCoCgToRGB(vec3 c)
+{
+    return vec3(c.x+c.y-c.z,c.x+c.z,c.x-c.y-c.z);
+}
+
+float Luminance(vec3 c)
+{
+    return dot(c,vec3(.2126,.7152,.0722));
+}
+
+// Catmull-Rom采样历史，比双线性更少模糊（与 screen.fs 的放大相同）
+vec3 SampleHistory(vec2 uv)
+{
+    vec2 samplePos=uv*outputSize;
+    vec2 texPos1=floor(samplePos-.5)+.5;
+    vec2 f=samplePos-texPos1;
+
+    vec2 w0=f*(-.5+f*(1.-.5*f));
+    vec2 w1=1.+f*f*(-2.5+1.5*f);
+    vec2 w2=f*(.5+f*(2.-1.5*f));
+    vec2 w3=f*f*(-.5+.5*f);
+
+    vec2 w12=w1+w2;
+    vec2 offset12=w2/w12;
+
+    vec2 texPos0=(texPos1-1.)/outputSize;
+    vec2 texPos3=(texPos1+2.)/outputSize;
+    vec2 texPos12=(texPos1+offset12)/outputSize;
+
+    vec3 result=vec3(0.);
+    result+=texture(historyColor,vec2(texPos0.x,texPos0.y)).rgb*w0.x*w0.y;
+    result+=texture(historyColor,vec2(texPos12.x,texPos0.y)).rgb*w12.x*w0.y;
+    result+=texture(historyColor,vec2(texPos3.x,texPos0.y)).rgb*w3.x*w0.y;
+
+    result+=texture(historyColor,vec2(texPos0.x,texPos12.y)).rgb*w0.x*w12.y;
+    result+=texture(historyColor,vec2(texPos12.x,texPos12.y)).rgb*w12.x*w12.y;
+    result+=texture(historyColor,vec2(texPos3.x,texPos12.y)).rgb*w3.x*w12.y;
+
+    result+=texture(historyColor,vec2(texPos0.x,texPos3.y)).rgb*w0.x*w3.y;
+    result+=texture(historyColor,vec2(texPos12.x,texPos3.y)).rgb*w12.x*w3.y;
+    result+=texture(historyColor,vec2(texPos3.x,texPos3.y)).rgb*w3.x*w3.y;
+    return max(result,vec3(0.));
+}
+
+// 把历史颜色沿着指向包围盒中心的方向裁剪到包围盒内（比直接clamp保留更多色相）
+vec3 ClipAABB(vec3 aabbMin,vec3 aabbMax,vec3 history)
+{
+    vec3 center=.5*(aabbMax+aabbMin);
+    vec3 extents=.5*(aabbMax-aabbMin)+vec3(1e-4);
+    vec3 v=history-center;
+    vec3 a=abs(v/extents);
+    float m=max(a.x,max(a.y,a.z));
+    return m>1.?center+v/m:history;
+}
+
+void main()
+{
+    // 本帧画面整体平移了抖动量，加上它才是这个输出像素在场景目标中对应的位置
+    vec2 uv=TexCoords+jitterUV;
+    vec3 current=texture(sceneColor,uv).rgb;
+    if(!historyValid)
+    {
+        FragColor=vec4(current,1.);
+        return;
+    }
+
+    // 3x3邻域：颜色的均值和方差（YCoCg空间）用于约束历史，最近的深度用于取速度（边缘处取前景的运动）
+    ivec2 maxPos=ivec2(sceneSize)-1;
+    ivec2 center=clamp(ivec2(uv*sceneSize),ivec2(0),maxPos);
+    vec3 m1=vec3(0.);
+    vec3 m2=vec3(0.);
+    float closestDepth=1.;
+    ivec2 closestPos=center;
+    for(int y=-1;y<=1;y++)
+    {
+        for(int x=-1;x<=1;x++)
+        {
+            ivec2 p=clamp(center+ivec2(x,y),ivec2(0),maxPos);
+            vec3 c=RGBToYCoCg(texelFetch(sceneColor,p,0).rgb);
+            m1+=c;
+            m2+=c*c;
+            float depth=texelFetch(sceneDepth,p,0).r;
+            if(depth<closestDepth)
+            {
+                closestDepth=depth;
+                closestPos=p;
+            }
+        }
+    }
+    vec3 mean=m1/9.;
+    vec3 sigma=sqrt(max(m2/9.-mean*mean,vec3(0.)));
+
+    vec2 velocity=texelFetch(velocityBuffer,closestPos,0).xy;
+    vec2 previousUV=TexCoords-velocity;
+    if(any(lessThan(previousUV,vec2(0.)))||any(greaterThan(previousUV,vec2(1.))))
+    {
+        FragColor=vec4(current,1.);
+        return;
+    }
+    vec3 history=SampleHistory(previousUV);
+    history=YCoCgToRGB(ClipAABB(mean-sigma,mean+sigma,RGBToYCoCg(history)));
+
+    // 按亮度反比加权混合，抑制高亮像素的闪烁
+    float currentWeight=feedback/(1.+Luminance(current));
+    float historyWeight=(1.-feedback)/(1.+Luminance(history));
+    FragColor=vec4((current*currentWeight+history*historyWeight)/(currentWeight+historyWeight),1.);
+}
@@ -0,0 +1,22 @@
+#version 330 core
+// 速度缓冲：由场景深度和前后两帧（不带抖动）的视图投影矩阵计算每个像素的屏幕空间运动，单位为UV
+out vec2 Velocity;
+
+in vec2 TexCoords;
+
+uniform sampler2D sceneDepth;
+uniform mat4 inverseViewProjection;// 本帧，不带抖动
+uniform mat4 previousViewProjection;// 上一帧，不带抖动
+uniform vec2 jitterUV;// 本帧的抖动（UV单位）
+
+void main()
+{
+    float depth=texture(sceneDepth,TexCoords).r;
+    // 画面整体平移了抖动量，去掉它得到这个像素在不抖动时的位置
+    vec2 uv=TexCoords-jitterUV;
+    vec4 worldPos=inverseViewProjection*vec4(uv*2.-1.,depth*2.-1.,1.);
+    worldPos/=worldPos.w;
+    vec4 previous=previousViewProjection*worldPos;
+    vec2 previousUV=previous.xy/previous.w*.5+.5;
+    Velocity=uv-previousUV;
+}
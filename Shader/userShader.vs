@@ -1,20 +1,21 @@
-#version 330 core
+#version 430 core
 layout(location=0)in vec3 aPos;//顶点位置为0的数据
 layout(location=1)in vec2 aTexCoord;
 layout(location=2)in vec3 aNormal;
+layout(location=7)in mat4 aInstanceModel;//实例的模型矩阵 占用7~10
+layout(location=11)in mat3 aInstanceNormal;//实例的法线矩阵 在CPU上预先计算好 占用11~13
 out vec2 TexCoord;
 out vec3 Normal;
 out vec3 FragPos;
 
 uniform mat4 transform;
-uniform mat4 model_matrix;
-uniform mat4 view_matrix;
-uniform mat4 projection_matrix;
+#include "frameData.glsl"
 
 void main()
 {
-   gl_Position=projection_matrix*view_matrix*model_matrix*vec4(aPos.x,aPos.y,aPos.z,1.);
+   vec4 worldPos=aInstanceModel*vec4(aPos.x,aPos.y,aPos.z,1.);
+   gl_Position=projection_matrix*view_matrix*worldPos;
    TexCoord=aTexCoord;
-   Normal=mat3(transpose(inverse(model_matrix)))*aNormal;//转为世界空间法向量并修复不等比缩放法向量错误 法线矩阵 取反再转置
-   FragPos=vec3(model_matrix*vec4(aPos.x,aPos.y,aPos.z,1.));//世界空间位置
+   Normal=aInstanceNormal*aNormal;//转为世界空间法向量 法线矩阵已经修复了不等比缩放的错误
+   FragPos=vec3(worldPos);//世界空间位置
 }
\ No newline at end of file
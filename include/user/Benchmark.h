@@ -0,0 +1,440 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <user/CameraPath.h>
+#include <user/CpuProfiler.h>
+#include <user/GpuProfiler.h>
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <vector>
+#include <map>
+#include <set>
+#include <string>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <cctype>
+#include <cstdint>
+#include <algorithm>
+using namespace std;
+
+// 基准测试模式：沿相机路径（录制的文件或内置的环绕路径）按固定步长回放，场景时间与实际耗时无关，
+// 每次运行画面和工作量完全一样。先跑若干预热帧（着色器编译、纹理池、遮挡查询的历史稳定下来），
+// 再逐帧记录：帧时间、GPU帧时间、主线程每个CPU区间（含帧图每个通道）、每个GPU通道、绘制数和三角形数。
+// 结束时输出 JSON（均值、p50/p95/p99、最大值）。Compare 对比两份结果，超过阈值的变慢项记为回归。
+class Benchmark
+{
+public:
+    struct Options
+    {
+        bool enabled = false;
+        string pathFile;                    // 空为内置环绕路径
+        int warmupFrames = 60;
+        string outputPath = "benchmark.json";
+        // --compare 基线 当前：只对比两份结果，不渲染
+        string compareBaseline;
+        string compareCurrent;
+        float threshold = 0.05f;            // 变慢超过这个比例算回归
+    };
+
+    // 识别一个命令行参数，返回消耗的参数个数，不认识时返回0
+    static int ParseArg(int argc, char** argv, int i, Options& options)
+    {
+        string arg = argv[i];
+        bool hasValue = i + 1 < argc && argv[i + 1][0] != '-';
+        if (arg == "--benchmark")
+        {
+            options.enabled = true;
+            if (hasValue)
+            {
+                options.pathFile = argv[i + 1];
+                return 2;
+            }
+            return 1;
+        }
+        if (arg == "--warmup" && hasValue)
+        {
+            options.warmupFrames = std::max(0, atoi(argv[i + 1]));
+            return 2;
+        }
+        if (arg == "--benchmark-output" && hasValue)
+        {
+            options.outputPath = argv[i + 1];
+            return 2;
+        }
+        if (arg == "--threshold" && hasValue)
+        {
+            options.threshold = (float)atof(argv[i + 1]) / 100.0f;
+            return 2;
+        }
+        if (arg == "--compare" && i + 2 < argc)
+        {
+            options.compareBaseline = argv[i + 1];
+            options.compareCurrent = argv[i + 2];
+            return 3;
+        }
+        return 0;
+    }
+
+    static const char* Usage()
+    {
+        return "  --benchmark [路径文件]      沿相机路径回放并输出基准结果（省略文件时用内置环绕路径）\n"
+            "  --warmup N                  预热帧数（默认60）\n"
+            "  --benchmark-output 文件     结果JSON（默认 benchmark.json）\n"
+            "  --compare 基线 当前         对比两份结果，有回归时返回1\n"
+            "  --threshold 百分比          回归阈值（默认5）\n";
+    }
+
+    // 每帧的计数，由主循环在帧结束时填入
+    struct FrameCounters
+    {
+        unsigned int draws;
+        unsigned int triangles;
+    };
+
+    Benchmark(const Options& options, const CameraPath& path, float fixedDelta) : options(options), path(path), fixedDelta(fixedDelta)
+    {
+        measuredFrames = std::max(1, (int)ceilf(path.Duration() / fixedDelta) + 1);
+        std::cout << "基准测试: " << (options.pathFile.empty() ? string("内置环绕路径") : options.pathFile) << "  预热 " << options.warmupFrames
+            << " 帧 + 测量 " << measuredFrames << " 帧 (步长 " << fixedDelta * 1000.0f << " ms)" << std::endl;
+    }
+
+    int TotalFrames() const { return options.warmupFrames + measuredFrames; }
+    bool Finished() const { return frame >= TotalFrames(); }
+    bool Measuring() const { return frame >= options.warmupFrames; }
+
+    // 预热阶段停在路径起点
+    float SceneTime() const
+    {
+        return Measuring() ? (frame - options.warmupFrames) * fixedDelta : 0.0f;
+    }
+
+    void ApplyCamera(Camera& camera) const
+    {
+        path.Apply(SceneTime(), camera);
+    }
+
+    // 在 CpuProfiler::FrameMark 之后调用（上一帧的CPU记录此时才完整），GL线程上调用
+    void EndFrame(const FrameCounters& counters, CpuProfiler& cpu, const GpuProfiler& gpu)
+    {
+        collectGpu(gpu);
+        if (Measuring())
+        {
+            frameMs.push_back(cpu.LastFrameMs());
+            draws.push_back((float)counters.draws);
+            triangles.push_back((float)counters.triangles);
+            measuredGpuFrames.insert(gpu.FrameIndex() - 1);
+            // 只统计主线程的区间，工作线程上的区间是并行的，加起来没有意义
+            uint32_t mainThread = cpu.CurrentThread();
+            map<string, float> zones;
+            for (const CpuProfiler::Record& r : cpu.LastFrame())
+            {
+                if (r.thread == mainThread)
+                    zones[r.event.name] += (r.event.endNs - r.event.beginNs) / 1.0e6f;
+            }
+            for (const auto& zone : zones)
+                cpuZones[zone.first].push_back(zone.second);
+        }
+        frame++;
+    }
+
+    // 所有帧结束后调用：读回剩下的GPU计时，写出JSON并打印汇总
+    bool Finish(GpuProfiler& gpu, const string& renderer, int width, int height)
+    {
+        gpu.Flush();
+        collectGpu(gpu);
+        ofstream file(options.outputPath);
+        if (!file)
+        {
+            std::cout << "基准测试: 无法写入 " << options.outputPath << std::endl;
+            return false;
+        }
+        file << "{\n";
+        file << "  \"benchmark\": \"" << escape(options.pathFile.empty() ? string("orbit") : options.pathFile) << "\",\n";
+        file << "  \"renderer\": \"" << escape(renderer) << "\",\n";
+        file << "  \"width\": " << width << ",\n  \"height\": " << height << ",\n";
+        file << "  \"dt\": " << fixedDelta << ",\n";
+        file << "  \"warmup_frames\": " << options.warmupFrames << ",\n  \"frames\": " << frameMs.size() << ",\n";
+        file << "  \"frame_ms\": " << summary(frameMs) << ",\n";
+        file << "  \"gpu_frame_ms\": " << summary(gpuFrameMs) << ",\n";
+        file << "  \"draws\": " << summary(draws) << ",\n";
+        file << "  \"triangles\": " << summary(triangles) << ",\n";
+        file << "  \"cpu_zones_ms\": " << summaryMap(cpuZones) << ",\n";
+        file << "  \"gpu_passes_ms\": " << summaryMap(gpuPasses) << "\n";
+        file << "}\n";
+
+        // 输出格式只在这里临时修改，结束后恢复调用方的设置
+        ios::fmtflags flags = std::cout.flags();
+        streamsize precision = std::cout.precision();
+        std::cout << fixed << setprecision(3);
+        std::cout << "基准测试: " << frameMs.size() << " 帧，结果已写入 " << options.outputPath << std::endl;
+        printLine("帧时间", frameMs);
+        printLine("GPU帧时间", gpuFrameMs);
+        std::cout.flags(flags);
+        std::cout.precision(precision);
+        return file.good();
+    }
+
+    // 对比两份结果。返回值：0 没有回归，1 有回归，2 文件无法读取
+    static int Compare(const string& baselinePath, const string& currentPath, float threshold)
+    {
+        map<string, double> baseline, current;
+        map<string, string> baselineText, currentText;
+        if (!loadJson(baselinePath, baseline, baselineText) || !loadJson(currentPath, current, currentText))
+        {
+            std::cout << "对比: 无法读取 " << baselinePath << " 或 " << currentPath << std::endl;
+            return 2;
+        }
+        if (baselineText["renderer"] != currentText["renderer"] || baseline["width"] != current["width"] || baseline["height"] != current["height"] || baseline["dt"] != current["dt"] || baselineText["benchmark"] != currentText["benchmark"])
+            std::cout << "警告: 两次运行的渲染器、分辨率、步长或路径不同，结果可能不可比" << std::endl;
+
+        int regressions = 0;
+        ios::fmtflags flags = std::cout.flags();
+        streamsize precision = std::cout.precision();
+        std::cout << fixed << setprecision(3);
+        std::cout << left << setw(44) << "指标" << right << setw(12) << "基线" << setw(12) << "当前" << setw(10) << "变化" << std::endl;
+        for (const auto& entry : baseline)
+        {
+            const string& key = entry.first;
+            if (!isCompared(key))
+                continue;
+            auto found = current.find(key);
+            if (found == current.end())
+            {
+                std::cout << left << setw(44) << key << right << "  当前结果中没有" << std::endl;
+                continue;
+            }
+            double base = entry.second;
+            double now = found->second;
+            double change = base > 0.0 ? now / base - 1.0 : (now > 0.0 ? 1.0 : 0.0);
+            // 计时有噪声，低于0.05ms的差异不算；计数是确定的，只看比例
+            bool timing = key.find("_ms") != string::npos;
+            double floor = timing ? 0.05 : 0.0;
+            bool regressed = change > threshold && now - base > floor;
+            bool improved = change < -threshold && base - now > floor;
+            if (regressed)
+                regressions++;
+            std::cout << left << setw(44) << key << right << setw(12) << base << setw(12) << now << setw(9) << showpos << change * 100.0 << noshowpos << "%"
+                << (regressed ? "  回归" : (improved ? "  改善" : "")) << std::endl;
+        }
+        std::cout.flags(flags);
+        std::cout.precision(precision);
+        std::cout << (regressions > 0 ? "发现 " + to_string(regressions) + " 项回归（阈值 " + to_string((int)roundf(threshold * 100.0f)) + "%）" : string("没有回归")) << std::endl;
+        return regressions > 0 ? 1 : 0;
+    }
+
+private:
+    Options options;
+    CameraPath path;
+    float fixedDelta;
+    int measuredFrames = 0;
+    int frame = 0;
+
+    vector<float> frameMs;
+    vector<float> gpuFrameMs;
+    vector<float> draws;
+    vector<float> triangles;
+    map<string, vector<float>> cpuZones;
+    map<string, vector<float>> gpuPasses;
+    set<uint64_t> measuredGpuFrames;    // 测量阶段各帧在GPU分析器中的帧号
+    uint64_t nextGpuFrame = 0;          // 之前的GPU结果已经收集过
+
+    // GPU结果晚几帧才读回，按帧号收集属于测量阶段的帧
+    void collectGpu(const GpuProfiler& gpu)
+    {
+        for (const GpuProfiler::FrameResult& result : gpu.History())
+        {
+            if (result.frame < nextGpuFrame)
+                continue;
+            nextGpuFrame = result.frame + 1;
+            if (!measuredGpuFrames.count(result.frame))
+                continue;
+            gpuFrameMs.push_back(result.totalMs);
+            map<string, float> passes;
+            for (const GpuProfiler::ZoneResult& zone : result.zones)
+                passes[zone.name] += zone.durationMs;
+            for (const auto& pass : passes)
+                gpuPasses[pass.first].push_back(pass.second);
+        }
+    }
+
+    // 最近秩法取百分位
+    static float percentile(const vector<float>& sorted, float p)
+    {
+        if (sorted.empty())
+            return 0.0f;
+        size_t rank = (size_t)ceilf(p * sorted.size());
+        return sorted[std::min(sorted.size() - 1, rank > 0 ? rank - 1 : 0)];
+    }
+
+    static string summary(vector<float> values)
+    {
+        std::sort(values.begin(), values.end());
+        double sum = 0.0;
+        for (float v : values)
+            sum += v;
+        ostringstream out;
+        out << "{ \"mean\": " << (values.empty() ? 0.0 : sum / values.size()) << ", \"p50\": " << percentile(values, 0.50f)
+            << ", \"p95\": " << percentile(values, 0.95f) << ", \"p99\": " << percentile(values, 0.99f)
+            << ", \"max\": " << (values.empty() ? 0.0f : values.back()) << ", \"samples\": " << values.size() << " }";
+        return out.str();
+    }
+
+    static string summaryMap(const map<string, vector<float>>& groups)
+    {
+        ostringstream out;
+        out << "{";
+        bool first = true;
+        for (const auto& group : groups)
+        {
+            out << (first ? "\n" : ",\n") << "    \"" << escape(group.first) << "\": " << summary(group.second);
+            first = false;
+        }
+        out << (groups.empty() ? "}" : "\n  }");
+        return out.str();
+    }
+
+    static void printLine(const char* label, vector<float> values)
+    {
+        if (values.empty())
+            return;
+        std::sort(values.begin(), values.end());
+        std::cout << "  " << label << ": p50 " << percentile(values, 0.50f) << " ms  p95 " << percentile(values, 0.95f)
+            << " ms  p99 " << percentile(values, 0.99f) << " ms  最大 " << values.back() << " ms" << std::endl;
+    }
+
+    // 参与对比的指标：各组的均值和百分位（样本数、最大值噪声太大）
+    static bool isCompared(const string& key)
+    {
+        static const char* suffixes[] = { ".mean", ".p50", ".p95", ".p99" };
+        for (const char* suffix : suffixes)
+        {
+            size_t n = strlen(suffix);
+            if (key.size() > n && key.compare(key.size() - n, n, suffix) == 0)
+                return true;
+        }
+        return false;
+    }
+
+    static string escape(const string& text)
+    {
+        string result;
+        for (char c : text)
+        {
+            if (c == '"' || c == '\\')
+                result += '\\';
+            result += c;
+        }
+        return result;
+    }
+
+    // 只够读回自己写出的JSON：对象展开成 "a.b.c" -> 数值 / 字符串
+    static bool loadJson(const string& path, map<string, double>& numbers, map<string, string>& texts)
+    {
+        ifstream file(path);
+        if (!file)
+            return false;
+        stringstream buffer;
+        buffer << file.rdbuf();
+        string text = buffer.str();
+        size_t pos = 0;
+        return parseValue(text, pos, "", numbers, texts);
+    }
+
+    static void skipSpace(const string& text, size_t& pos)
+    {
+        while (pos < text.size() && isspace((unsigned char)text[pos]))
+            pos++;
+    }
+
+    static bool parseString(const string& text, size_t& pos, string& out)
+    {
+        if (pos >= text.size() || text[pos] != '"')
+            return false;
+        pos++;
+        out.clear();
+        while (pos < text.size() && text[pos] != '"')
+        {
+            if (text[pos] == '\\' && pos + 1 < text.size())
+                pos++;
+            out += text[pos++];
+        }
+        if (pos >= text.size())
+            return false;
+        pos++;
+        return true;
+    }
+
+    static bool parseValue(const string& text, size_t& pos, const string& key, map<string, double>& numbers, map<string, string>& texts)
+    {
+        skipSpace(text, pos);
+        if (pos >= text.size())
+            return false;
+        char c = text[pos];
+        if (c == '{' || c == '[')
+        {
+            char close = c == '{' ? '}' : ']';
+            pos++;
+            int index = 0;
+            skipSpace(text, pos);
+            if (pos < text.size() && text[pos] == close)
+            {
+                pos++;
+                return true;
+            }
+            for (;;)
+            {
+                string name = to_string(index++);
+                if (c == '{')
+                {
+                    skipSpace(text, pos);
+                    if (!parseString(text, pos, name))
+                        return false;
+                    skipSpace(text, pos);
+                    if (pos >= text.size() || text[pos] != ':')
+                        return false;
+                    pos++;
+                }
+                if (!parseValue(text, pos, key.empty() ? name : key + "." + name, numbers, texts))
+                    return false;
+                skipSpace(text, pos);
+                if (pos < text.size() && text[pos] == ',')
+                {
+                    pos++;
+                    continue;
+                }
+                if (pos < text.size() && text[pos] == close)
+                {
+                    pos++;
+                    return true;
+                }
+                return false;
+            }
+        }
+        if (c == '"')
+        {
+            string value;
+            if (!parseString(text, pos, value))
+                return false;
+            texts[key] = value;
+            return true;
+        }
+        const char* begin = text.c_str() + pos;
+        char* end = nullptr;
+        double value = strtod(begin, &end);
+        if (end == begin)
+        {
+            // true / false / null
+            while (pos < text.size() && isalpha((unsigned char)text[pos]))
+                pos++;
+            return end != nullptr;
+        }
+        numbers[key] = value;
+        pos += end - begin;
+        return true;
+    }
+};
+#endif
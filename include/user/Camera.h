@@ -42,9 +42,12 @@ public:
     float MovementSpeed;    // 移动速度
     float MouseSensitivity; // 鼠标灵敏度
     float Zoom;             // 缩放
+    // 时间抗锯齿用的子像素抖动，单位为渲染目标的像素，范围[-0.5, 0.5]
+    glm::vec2 Jitter;
+    unsigned int JitterIndex;
 
     // 使用向量的构造函数
-    Camera(glm::vec3 position = glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3 up = glm::vec3(0.0f, 1.0f, 0.0f), float yaw = YAW, float pitch = PITCH) : Front(glm::vec3(0.0f, 0.0f, -1.0f)), MovementSpeed(SPEED), MouseSensitivity(SENSITIVITY), Zoom(ZOOM)
+    Camera(glm::vec3 position = glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3 up = glm::vec3(0.0f, 1.0f, 0.0f), float yaw = YAW, float pitch = PITCH) : Front(glm::vec3(0.0f, 0.0f, -1.0f)), MovementSpeed(SPEED), MouseSensitivity(SENSITIVITY), Zoom(ZOOM), Jitter(0.0f), JitterIndex(0)
     {
         Position = position;
         WorldUp = up;
@@ -53,7 +56,7 @@ public:
         updateCameraVectors();
     }
     // 使用标量值的构造函数
-    Camera(float posX, float posY, float posZ, float upX, float upY, float upZ, float yaw, float pitch) : Front(glm::vec3(0.0f, 0.0f, -1.0f)), MovementSpeed(SPEED), MouseSensitivity(SENSITIVITY), Zoom(ZOOM)
+    Camera(float posX, float posY, float posZ, float upX, float upY, float upZ, float yaw, float pitch) : Front(glm::vec3(0.0f, 0.0f, -1.0f)), MovementSpeed(SPEED), MouseSensitivity(SENSITIVITY), Zoom(ZOOM), Jitter(0.0f), JitterIndex(0)
     {
         Position = glm::vec3(posX, posY, posZ);
         WorldUp = glm::vec3(upX, upY, upZ);
@@ -68,6 +71,42 @@ public:
         return glm::lookAt(Position, Position + Front, Up);
     }
 
+    // 不带抖动的透视投影矩阵，用于剔除、光源分簇等不应随抖动变化的计算
+    glm::mat4 GetProjectionMatrix(float aspect, float nearPlane, float farPlane) const
+    {
+        return glm::perspective(glm::radians(Zoom), aspect, nearPlane, farPlane);
+    }
+
+    // 把当前抖动叠加到投影矩阵上：在NDC中平移 2*Jitter/尺寸，整幅画面移动Jitter个像素
+    glm::mat4 ApplyJitter(const glm::mat4& projection, int width, int height) const
+    {
+        glm::mat4 offset = glm::translate(glm::mat4(1.0f), glm::vec3(2.0f * Jitter.x / width, 2.0f * Jitter.y / height, 0.0f));
+        return offset * projection;
+    }
+
+    // 每帧调用一次，按Halton(2,3)序列取下一个抖动位置。渲染分辨率越低需要的相位越多才能覆盖输出像素
+    void AdvanceJitter(unsigned int phaseCount)
+    {
+        JitterIndex = (JitterIndex + 1) % phaseCount;
+        Jitter = glm::vec2(halton(JitterIndex + 1, 2) - 0.5f, halton(JitterIndex + 1, 3) - 0.5f);
+    }
+
+    void ClearJitter()
+    {
+        Jitter = glm::vec2(0.0f);
+        JitterIndex = 0;
+    }
+
+    // 直接设置位置、朝向和视场角（回放相机路径时使用）
+    void SetPose(glm::vec3 position, float yaw, float pitch, float zoom)
+    {
+        Position = position;
+        Yaw = yaw;
+        Pitch = glm::clamp(pitch, -89.0f, 89.0f);
+        Zoom = glm::clamp(zoom, 1.0f, 120.0f);
+        updateCameraVectors();
+    }
+
     // 处理来自任何键盘类输入系统的输入。接受以相机定义的枚举形式的输入参数（将其从窗口系统中抽象出来）
     void ProcessKeyboard(Camera_Movement direction, float deltaTime)
     {
@@ -120,6 +159,19 @@ public:
     }
 
 private:
+    static float halton(unsigned int index, unsigned int base)
+    {
+        float result = 0.0f;
+        float f = 1.0f;
+        while (index > 0)
+        {
+            f /= base;
+            result += f * (index % base);
+            index /= base;
+        }
+        return result;
+    }
+
     // 从相机的（更新后的）欧拉角计算前向量
     void updateCameraVectors()
     {
@@ -0,0 +1,162 @@
+#ifndef CAMERA_PATH_H
+#define CAMERA_PATH_H
+
+#include <glm/glm.hpp>
+
+#include <user/Camera.h>
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <cmath>
+#include <algorithm>
+using namespace std;
+
+// 相机路径：按时间排列的关键帧（位置、偏航、俯仰、视场角），关键帧之间用 Catmull-Rom 样条插值，
+// 曲线经过每个关键帧且一阶导数连续。可以在交互模式下录制，也可以手写文本文件，每行一个关键帧：
+//   时间 x y z 偏航 俯仰 视场角      （# 开头的行是注释）
+class CameraPath
+{
+public:
+    struct Key
+    {
+        float time;
+        glm::vec3 position;
+        float yaw;
+        float pitch;
+        float zoom;
+    };
+
+    vector<Key> keys;
+
+    bool Empty() const { return keys.empty(); }
+    float Duration() const { return keys.empty() ? 0.0f : keys.back().time; }
+
+    void Clear()
+    {
+        keys.clear();
+    }
+
+    // 追加关键帧，时间必须递增；偏航角展开成连续的值，避免在±180度处绕远路
+    void Add(float time, const Camera& camera)
+    {
+        Key key = { time, camera.Position, camera.Yaw, camera.Pitch, camera.Zoom };
+        if (!keys.empty())
+        {
+            if (time <= keys.back().time)
+                return;
+            key.yaw = keys.back().yaw + wrapDegrees(key.yaw - keys.back().yaw);
+        }
+        keys.push_back(key);
+    }
+
+    // 按时间取样（超出范围时取首尾关键帧）并设置到相机上
+    void Apply(float time, Camera& camera) const
+    {
+        if (keys.empty())
+            return;
+        Key k = Evaluate(time);
+        camera.SetPose(k.position, k.yaw, k.pitch, k.zoom);
+    }
+
+    Key Evaluate(float time) const
+    {
+        if (keys.size() == 1 || time <= keys.front().time)
+            return keys.front();
+        if (time >= keys.back().time)
+            return keys.back();
+        size_t i = 0;
+        while (i + 2 < keys.size() && keys[i + 1].time <= time)
+            i++;
+        const Key& k0 = keys[i > 0 ? i - 1 : i];
+        const Key& k1 = keys[i];
+        const Key& k2 = keys[i + 1];
+        const Key& k3 = keys[std::min(i + 2, keys.size() - 1)];
+        float t = (time - k1.time) / (k2.time - k1.time);
+        Key result;
+        result.time = time;
+        result.position = catmullRom(k0.position, k1.position, k2.position, k3.position, t);
+        result.yaw = catmullRom(k0.yaw, k1.yaw, k2.yaw, k3.yaw, t);
+        result.pitch = catmullRom(k0.pitch, k1.pitch, k2.pitch, k3.pitch, t);
+        result.zoom = catmullRom(k0.zoom, k1.zoom, k2.zoom, k3.zoom, t);
+        return result;
+    }
+
+    bool Load(const string& path)
+    {
+        ifstream file(path);
+        if (!file)
+            return false;
+        keys.clear();
+        string line;
+        while (getline(file, line))
+        {
+            if (line.empty() || line[0] == '#')
+                continue;
+            istringstream in(line);
+            Key k;
+            if (in >> k.time >> k.position.x >> k.position.y >> k.position.z >> k.yaw >> k.pitch >> k.zoom)
+            {
+                if (keys.empty())
+                    keys.push_back(k);
+                else if (k.time > keys.back().time)
+                {
+                    k.yaw = keys.back().yaw + wrapDegrees(k.yaw - keys.back().yaw);
+                    keys.push_back(k);
+                }
+            }
+        }
+        return !keys.empty();
+    }
+
+    bool Save(const string& path) const
+    {
+        ofstream file(path);
+        if (!file)
+            return false;
+        file << "# time x y z yaw pitch zoom\n";
+        for (const Key& k : keys)
+            file << k.time << " " << k.position.x << " " << k.position.y << " " << k.position.z << " " << k.yaw << " " << k.pitch << " " << k.zoom << "\n";
+        return file.good();
+    }
+
+    // 内置路径：绕 center 转一圈，高度和半径缓慢起伏，始终看向中心
+    static CameraPath Orbit(glm::vec3 center, float radius, float height, float duration, int keyCount = 16)
+    {
+        CameraPath path;
+        for (int i = 0; i <= keyCount; i++)
+        {
+            float u = (float)i / keyCount;
+            float angle = u * 6.2831853f;
+            float r = radius * (1.0f + 0.25f * sinf(angle * 2.0f));
+            glm::vec3 position = center + glm::vec3(sinf(angle) * r, height * (0.5f + 0.5f * cosf(angle * 3.0f)), cosf(angle) * r);
+            glm::vec3 dir = glm::normalize(center - position);
+            Key k;
+            k.time = u * duration;
+            k.position = position;
+            k.yaw = glm::degrees(atan2f(dir.z, dir.x));
+            k.pitch = glm::degrees(asinf(dir.y));
+            k.zoom = ZOOM;
+            if (!path.keys.empty())
+                k.yaw = path.keys.back().yaw + wrapDegrees(k.yaw - path.keys.back().yaw);
+            path.keys.push_back(k);
+        }
+        return path;
+    }
+
+private:
+    static float wrapDegrees(float angle)
+    {
+        return angle - 360.0f * floorf((angle + 180.0f) / 360.0f);
+    }
+
+    template <typename T>
+    static T catmullRom(const T& p0, const T& p1, const T& p2, const T& p3, float t)
+    {
+        float t2 = t * t;
+        float t3 = t2 * t;
+        return 0.5f * ((2.0f * p1) + (p2 - p0) * t + (2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3) * t2 + (3.0f * p1 - p0 - 3.0f * p2 + p3) * t3);
+    }
+};
+#endif
@@ -0,0 +1,259 @@
+#ifndef CASCADED_SHADOW_MAP_H
+#define CASCADED_SHADOW_MAP_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <functional>
+#include <cmath>
+#include <algorithm>
+#include <cstdint>
+using namespace std;
+
+#include <user/Shader.h>
+#include <user/GLCompat.h>
+
+// 阴影贴图所用的纹理单元，材质从0号单元开始使用，这里取一个不会冲突的单元
+#define SHADOW_MAP_TEXTURE_UNIT 8
+
+// 方向光的级联阴影贴图。
+// 稳定拟合：每一级用包围视锥切片的球来拟合（半径只与切片深度和视场角有关，不随相机旋转变化），
+// 并且投影中心对齐到阴影贴图的纹素网格，相机移动时阴影边缘不会闪烁。
+// 静态缓存：每一级把静态投射体单独渲染到缓存层，切片没有移出缓存范围（半径留有余量）且静态物体没有变化时直接复用；
+// 每帧只把缓存层复制到实际使用的层上再叠加动态投射体。静态层每帧最多重绘 maxStaticUpdatesPerFrame 级，保证固定的开销上限。
+class CascadedShadowMap
+{
+public:
+    static const int CASCADE_COUNT = 4;
+
+    int resolution;
+    float shadowDistance = 40.0f;       // 阴影覆盖的最远视空间深度
+    float splitLambda = 0.75f;          // 对数分割与均匀分割的混合比例
+    float padding = 0.2f;               // 缓存范围比切片球大的比例，越大缓存命中越高，精度越低
+    float casterDistance = 30.0f;       // 沿光照方向向后延伸，包含切片球之外的投射体
+    int maxStaticUpdatesPerFrame = 2;   // 每帧最多重绘的静态层数
+    int farDynamicInterval = 2;         // 后两级的动态投射体每隔几帧更新一次
+    bool enabled = true;
+
+    struct Stats
+    {
+        unsigned int staticPasses;      // 本帧重绘的静态层数
+        unsigned int dynamicPasses;     // 本帧更新的动态层数
+    };
+    Stats stats = {};
+
+    CascadedShadowMap(int resolution = 1024) : resolution(resolution), depthShader("Shader/shadowDepth.vs", "Shader/shadowDepth.fs")
+    {
+        lightViewProjectionLocation = glGetUniformLocation(depthShader.ID, "lightViewProjection");
+        shadowMap = createArray(true);
+        staticMap = createArray(false);
+        glGenFramebuffers(1, &FBO);
+        glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+        glDrawBuffer(GL_NONE);
+        glReadBuffer(GL_NONE);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
+    ~CascadedShadowMap()
+    {
+        glDeleteTextures(1, &shadowMap);
+        glDeleteTextures(1, &staticMap);
+        glDeleteFramebuffers(1, &FBO);
+    }
+
+    CascadedShadowMap(const CascadedShadowMap&) = delete;
+    CascadedShadowMap& operator=(const CascadedShadowMap&) = delete;
+
+    // 静态投射体发生变化（移动、增删）时调用，所有静态层会按预算重新绘制
+    void InvalidateStatic()
+    {
+        for (Cascade& c : cascades)
+            c.staticValid = false;
+    }
+
+    // 丢弃所有缓存：下一次 Update 重新拟合每一级并重绘静态层和动态层，不受静态层预算限制
+    void Reset()
+    {
+        for (Cascade& c : cascades)
+        {
+            c.staticValid = false;
+            c.dynamicFrame = 0;
+            c.splitNear = c.splitFar = 0.0f;
+        }
+    }
+
+    // 每帧调用。drawStatic/drawDynamic 使用传入的深度着色器绘制投射体，只需要设置 "model" 并发出绘制
+    void Update(const glm::mat4& view, float fovY, float aspect, float nearPlane, const glm::vec3& lightDirection,
+                const function<void(Shader&)>& drawStatic, const function<void(Shader&)>& drawDynamic)
+    {
+        stats = {};
+        frame++;
+        if (!enabled)
+            return;
+        glm::vec3 dir = glm::normalize(lightDirection);
+        if (dir != lastDirection)
+        {
+            lastDirection = dir;
+            InvalidateStatic();
+        }
+
+        // 分割：对数分割与均匀分割混合
+        float farPlane = shadowDistance;
+        float splitNear = nearPlane;
+        glm::mat4 inverseView = glm::inverse(view);
+        // 视锥切片对角线的斜率
+        float k = sqrtf(1.0f + aspect * aspect) * tanf(fovY * 0.5f);
+        GLint previousFBO, viewport[4];
+        glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousFBO);
+        glGetIntegerv(GL_VIEWPORT, viewport);
+        glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+        glViewport(0, 0, resolution, resolution);
+        glEnable(GL_DEPTH_TEST);
+        glEnable(GL_POLYGON_OFFSET_FILL);
+        glPolygonOffset(1.5f, 2.0f);
+        int staticBudget = maxStaticUpdatesPerFrame;
+
+        for (int i = 0; i < CASCADE_COUNT; i++)
+        {
+            float p = (float)(i + 1) / CASCADE_COUNT;
+            float logSplit = nearPlane * powf(farPlane / nearPlane, p);
+            float uniformSplit = nearPlane + (farPlane - nearPlane) * p;
+            float splitFar = splitLambda * logSplit + (1.0f - splitLambda) * uniformSplit;
+            Cascade& c = cascades[i];
+
+            // 切片的最小包围球：球心在视线轴上
+            float n = splitNear, f = splitFar;
+            float z = std::min(f, 0.5f * (f + n) * (1.0f + k * k));
+            float radius = sqrtf((z - n) * (z - n) + n * n * k * k);
+            radius = ceilf(radius * 16.0f) / 16.0f;
+            glm::vec3 center = glm::vec3(inverseView * glm::vec4(0.0f, 0.0f, -z, 1.0f));
+            splitNear = splitFar;
+
+            // 切片仍然在缓存范围内且静态物体没有变化时复用。
+            // 分割位置和矩阵必须成对更新：分割变化（调整了阴影距离或混合比例）的级联不受预算限制，
+            // 超出预算而推迟的级联继续使用上次的分割和矩阵
+            bool contained = c.radius >= radius && glm::length(center - c.center) + radius <= c.radius;
+            bool staticDirty = !c.staticValid || !contained;
+            bool splitChanged = c.splitNear != n || c.splitFar != f;
+            if (splitChanged || (staticDirty && staticBudget > 0))
+            {
+                staticBudget = std::max(0, staticBudget - 1);
+                fit(c, center, radius * (1.0f + padding), dir);
+                c.splitNear = n;
+                c.splitFar = f;
+                renderLayer(staticMap, i, c.lightViewProjection, drawStatic);
+                c.staticValid = true;
+                c.dynamicFrame = 0;
+                stats.staticPasses++;
+            }
+
+            // 动态层：复制静态缓存，再叠加动态投射体。远处的级联降低更新频率
+            int interval = i >= CASCADE_COUNT - 2 ? std::max(1, farDynamicInterval) : 1;
+            if (c.dynamicFrame == 0 || (frame + i) % interval == 0)
+            {
+                GLCompat::CopyDepth(staticMap, shadowMap, GL_TEXTURE_2D_ARRAY, i, resolution, resolution);
+                renderLayer(shadowMap, i, c.lightViewProjection, drawDynamic, false);
+                c.dynamicFrame = frame;
+                stats.dynamicPasses++;
+            }
+        }
+
+        glDisable(GL_POLYGON_OFFSET_FILL);
+        glBindFramebuffer(GL_FRAMEBUFFER, previousFBO);
+        glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+    }
+
+    // 设置接收阴影的着色器的uniform并绑定阴影贴图，调用前着色器必须已经激活
+    void Bind(unsigned int program) const
+    {
+        glm::mat4 matrices[CASCADE_COUNT];
+        glm::vec4 splits, texelSizes;
+        for (int i = 0; i < CASCADE_COUNT; i++)
+        {
+            matrices[i] = cascades[i].lightViewProjection;
+            splits[i] = cascades[i].splitFar;
+            texelSizes[i] = 2.0f * cascades[i].radius / resolution;
+        }
+        glUniform1i(glGetUniformLocation(program, "shadowsEnabled"), enabled ? 1 : 0);
+        glUniformMatrix4fv(glGetUniformLocation(program, "cascadeMatrices"), CASCADE_COUNT, GL_FALSE, glm::value_ptr(matrices[0]));
+        glUniform4fv(glGetUniformLocation(program, "cascadeSplits"), 1, glm::value_ptr(splits));
+        glUniform4fv(glGetUniformLocation(program, "cascadeTexelSizes"), 1, glm::value_ptr(texelSizes));
+        glUniform1i(glGetUniformLocation(program, "shadowMap"), SHADOW_MAP_TEXTURE_UNIT);
+        glActiveTexture(GL_TEXTURE0 + SHADOW_MAP_TEXTURE_UNIT);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, shadowMap);
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+private:
+    struct Cascade
+    {
+        glm::mat4 lightViewProjection = glm::mat4(1.0f);
+        glm::vec3 center = glm::vec3(0.0f);
+        float radius = 0.0f;            // 缓存覆盖范围（含余量）
+        float splitNear = 0.0f;         // 当前矩阵拟合时的切片范围，着色器按它选择级联
+        float splitFar = 0.0f;
+        bool staticValid = false;
+        uint64_t dynamicFrame = 0;      // 动态层最后更新的帧，0表示需要立即更新
+    };
+
+    Shader depthShader;
+    GLint lightViewProjectionLocation;
+    unsigned int shadowMap, staticMap, FBO;
+    Cascade cascades[CASCADE_COUNT];
+    glm::vec3 lastDirection = glm::vec3(0.0f);
+    uint64_t frame = 0;
+
+    unsigned int createArray(bool compare)
+    {
+        unsigned int texture;
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+        GLCompat::TexStorage3D(GL_TEXTURE_2D_ARRAY, GL_DEPTH_COMPONENT24, resolution, resolution, CASCADE_COUNT);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, compare ? GL_LINEAR : GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, compare ? GL_LINEAR : GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        if (compare)
+        {
+            // 硬件比较，采样器为 sampler2DArrayShadow
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+        }
+        glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+        return texture;
+    }
+
+    // 以球心和半径拟合正交投影，球心在光照空间中对齐到纹素
+    void fit(Cascade& c, const glm::vec3& center, float radius, const glm::vec3& dir)
+    {
+        glm::vec3 up = fabsf(dir.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+        glm::mat4 lightRotation = glm::lookAt(glm::vec3(0.0f), dir, up);
+        float texel = 2.0f * radius / resolution;
+        glm::vec3 lightSpaceCenter = glm::vec3(lightRotation * glm::vec4(center, 1.0f));
+        lightSpaceCenter.x = floorf(lightSpaceCenter.x / texel) * texel;
+        lightSpaceCenter.y = floorf(lightSpaceCenter.y / texel) * texel;
+        glm::vec3 snapped = glm::vec3(glm::inverse(lightRotation) * glm::vec4(lightSpaceCenter, 1.0f));
+
+        float back = radius + casterDistance;
+        glm::mat4 lightView = glm::lookAt(snapped - dir * back, snapped, up);
+        glm::mat4 lightProjection = glm::ortho(-radius, radius, -radius, radius, 0.0f, back + radius);
+        c.lightViewProjection = lightProjection * lightView;
+        c.center = snapped;
+        c.radius = radius;
+    }
+
+    void renderLayer(unsigned int texture, int layer, const glm::mat4& lightViewProjection, const function<void(Shader&)>& draw, bool clear = true)
+    {
+        glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, texture, 0, layer);
+        if (clear)
+            glClear(GL_DEPTH_BUFFER_BIT);
+        if (!draw)
+            return;
+        depthShader.use();
+        glUniformMatrix4fv(lightViewProjectionLocation, 1, GL_FALSE, glm::value_ptr(lightViewProjection));
+        draw(depthShader);
+    }
+};
+#endif
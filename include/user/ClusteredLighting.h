@@ -0,0 +1,462 @@
+#ifndef CLUSTERED_LIGHTING_H
+#define CLUSTERED_LIGHTING_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <vector>
+#include <cmath>
+#include <cfloat>
+#include <algorithm>
+#include <string>
+#include <iostream>
+using namespace std;
+
+#include <user/ThreadPool.h>
+#include <user/CpuProfiler.h>
+#include <user/Shader.h>
+#include <user/GLCompat.h>
+#include <user/StreamBuffer.h>
+
+// 着色器存储缓冲的绑定点，与 userShader.fs / clusterAssign.cs 中的 binding 一致
+#define CLUSTER_LIGHT_BINDING 0
+#define CLUSTER_GRID_BINDING 1
+#define CLUSTER_INDEX_BINDING 2
+#define CLUSTER_AABB_BINDING 3
+#define CLUSTER_VIEW_LIGHT_BINDING 5
+#define CLUSTER_COUNTER_BINDING 6
+// 没有着色器存储缓冲时（GL 3.3）光源、簇和下标放在纹理缓冲中，占用的纹理单元（与 lighting.glsl 的 LEGACY_GL 分支一致）
+#define CLUSTER_LIGHT_TEXTURE_UNIT 10
+#define CLUSTER_GRID_TEXTURE_UNIT 11
+#define CLUSTER_INDEX_TEXTURE_UNIT 12
+
+// 点光源（世界空间），与着色器中的std430布局一致
+struct ClusterPointLight
+{
+    glm::vec4 positionRadius;   // xyz 位置，w 影响半径
+    glm::vec4 lightcolor;       // rgb
+    glm::vec4 specularcolor;    // rgb
+    glm::vec4 attenuation;      // 衰减系数 常数项 一次项 二次项
+    glm::vec4 shadow;           // x 阴影图块的起始下标(-1表示没有阴影)，y 是否投射阴影，由 ShadowAtlas 填写
+};
+
+// 分簇前向光照：把视锥按屏幕分块和指数深度切片划分成三维的簇(froxel)，
+// 每帧把所有点光源分配到与其影响范围相交的簇中，片元着色器只遍历自己所在簇的光源列表。
+// 光源分配默认在CPU上用线程池按深度切片并行完成，也可以切换为计算着色器（需要 GL 4.3）。
+class ClusteredLighting
+{
+public:
+    static const unsigned int GRID_X = 16;
+    static const unsigned int GRID_Y = 9;
+    static const unsigned int GRID_Z = 24;
+    static const unsigned int CLUSTER_COUNT = GRID_X * GRID_Y * GRID_Z;
+    static const unsigned int INITIAL_INDEX_CAPACITY = CLUSTER_COUNT * 32; // 计算着色器路径下标列表的初始容量，不够时按读回的需求扩大
+    static const unsigned int COUNTER_RING = 3;                 // 计算着色器计数器的读回环，结果晚几帧到达，不等待GPU
+
+    vector<ClusterPointLight> lights;   // 本帧的所有点光源
+    bool useComputeShader = false;      // true时在GPU上分配光源，计算着色器不可用时忽略
+    StreamBuffer* stream = nullptr;     // 设置后光源和CPU路径的分配结果从流式缓冲中上传
+
+    struct Stats
+    {
+        unsigned int lights;
+        unsigned int assignments;       // 光源-簇 配对总数
+        unsigned int maxPerCluster;
+        unsigned int dropped;           // 计算着色器路径中下标列表放不下而丢弃的配对数，之后的帧会扩大容量
+    };
+    // 计算着色器路径的统计来自几帧之前的读回，CPU路径每帧直接统计
+    Stats stats = {};
+
+    ClusteredLighting()
+    {
+        glGenBuffers(1, &lightSSBO);
+        glGenBuffers(1, &gridSSBO);
+        glGenBuffers(1, &indexSSBO);
+        glGenBuffers(1, &aabbSSBO);
+        glGenBuffers(1, &viewLightSSBO);
+        if (GLCompat::StorageBuffers())
+        {
+            computeProgram = loadComputeShader("Shader/clusterAssign.cs");
+            GLint maxBlockSize = 0;
+            glGetIntegerv(GL_MAX_SHADER_STORAGE_BLOCK_SIZE, &maxBlockSize);
+            maxIndexCapacity = std::max(INITIAL_INDEX_CAPACITY, (unsigned int)(maxBlockSize / sizeof(unsigned int)));
+        }
+        for (CounterSlot& slot : counterSlots)
+            glGenBuffers(1, &slot.buffer);
+    }
+
+    bool ComputeAvailable() const { return computeProgram != 0; }
+
+    ~ClusteredLighting()
+    {
+        glDeleteBuffers(1, &lightSSBO);
+        glDeleteBuffers(1, &gridSSBO);
+        glDeleteBuffers(1, &indexSSBO);
+        glDeleteBuffers(1, &aabbSSBO);
+        glDeleteBuffers(1, &viewLightSSBO);
+        for (CounterSlot& slot : counterSlots)
+        {
+            if (slot.fence)
+                glDeleteSync(slot.fence);
+            glDeleteBuffers(1, &slot.buffer);
+        }
+        if (computeProgram)
+            glDeleteProgram(computeProgram);
+    }
+
+    ClusteredLighting(const ClusteredLighting&) = delete;
+    ClusteredLighting& operator=(const ClusteredLighting&) = delete;
+
+    // 根据衰减系数计算光源的影响半径：衰减后的亮度低于 1/256 的距离
+    static float LightRadius(const glm::vec3& color, const glm::vec3& attenuation)
+    {
+        float maxIntensity = std::max(color.r, std::max(color.g, color.b));
+        float target = maxIntensity * 256.0f;
+        float kc = attenuation.x, kl = attenuation.y, kq = attenuation.z;
+        if (kq <= 0.0f)
+            return kl > 0.0f ? std::max(0.0f, (target - kc) / kl) : 1e6f;
+        return (-kl + sqrtf(kl * kl - 4.0f * kq * (kc - target))) / (2.0f * kq);
+    }
+
+    void AddPointLight(const glm::vec3& position, const glm::vec3& color, const glm::vec3& specular, const glm::vec3& attenuation, bool castShadows = false)
+    {
+        lights.push_back(MakePointLight(position, color, specular, attenuation, castShadows));
+    }
+
+    // 只生成光源数据，不需要GL对象（软件光栅化也使用这个格式）
+    static ClusterPointLight MakePointLight(const glm::vec3& position, const glm::vec3& color, const glm::vec3& specular, const glm::vec3& attenuation, bool castShadows = false)
+    {
+        ClusterPointLight light;
+        light.positionRadius = glm::vec4(position, LightRadius(glm::max(color, specular), attenuation));
+        light.lightcolor = glm::vec4(color, 0.0f);
+        light.specularcolor = glm::vec4(specular, 0.0f);
+        light.attenuation = glm::vec4(attenuation, 0.0f);
+        light.shadow = glm::vec4(-1.0f, castShadows ? 1.0f : 0.0f, 0.0f, 0.0f);
+        return light;
+    }
+
+    // 每帧调用：上传光源、分配到簇，并绑定着色器存储缓冲
+    void Update(const glm::mat4& view, const glm::mat4& projection, float nearPlane, float farPlane, ThreadPool* pool = nullptr)
+    {
+        if (projection != lastProjection || nearPlane != zNear || farPlane != zFar)
+        {
+            zNear = nearPlane;
+            zFar = farPlane;
+            lastProjection = projection;
+            buildClusterBounds(projection);
+        }
+
+        stats = {};
+        stats.lights = (unsigned int)lights.size();
+        uploadStorage(CLUSTER_LIGHT_BINDING, lightSSBO, lightTexture, lights.data(), lights.size() * sizeof(ClusterPointLight));
+
+        // 两条分配路径都使用视空间的光源，每帧只变换一次
+        viewLights.resize(lights.size());
+        for (size_t i = 0; i < lights.size(); i++)
+        {
+            glm::vec4 p = view * glm::vec4(glm::vec3(lights[i].positionRadius), 1.0f);
+            viewLights[i] = glm::vec4(glm::vec3(p), lights[i].positionRadius.w);
+        }
+        if (useComputeShader && computeProgram)
+            assignOnGpu();
+        else
+            assignOnCpu(pool);
+        if (GLCompat::StorageBuffers())
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    }
+
+    // 设置片元着色器查找簇所需的uniform，调用前着色器必须已经激活
+    void SetUniforms(unsigned int program, float screenWidth, float screenHeight) const
+    {
+        glUniform3ui(glGetUniformLocation(program, "clusterDims"), GRID_X, GRID_Y, GRID_Z);
+        glUniform2f(glGetUniformLocation(program, "clusterScreenSize"), screenWidth, screenHeight);
+        // 深度切片 slice = log(-viewZ) * scale + bias
+        float scale = GRID_Z / logf(zFar / zNear);
+        float bias = -GRID_Z * logf(zNear) / logf(zFar / zNear);
+        glUniform2f(glGetUniformLocation(program, "clusterDepthScaleBias"), scale, bias);
+        if (!GLCompat::StorageBuffers())
+        {
+            glUniform1i(glGetUniformLocation(program, "pointLightBuffer"), CLUSTER_LIGHT_TEXTURE_UNIT);
+            glUniform1i(glGetUniformLocation(program, "clusterGridBuffer"), CLUSTER_GRID_TEXTURE_UNIT);
+            glUniform1i(glGetUniformLocation(program, "clusterIndexBuffer"), CLUSTER_INDEX_TEXTURE_UNIT);
+            lightTexture.Bind(CLUSTER_LIGHT_TEXTURE_UNIT);
+            gridTexture.Bind(CLUSTER_GRID_TEXTURE_UNIT);
+            indexTexture.Bind(CLUSTER_INDEX_TEXTURE_UNIT);
+        }
+    }
+
+private:
+    struct ClusterAABB
+    {
+        glm::vec4 min;
+        glm::vec4 max;
+    };
+    unsigned int lightSSBO, gridSSBO, indexSSBO, aabbSSBO, viewLightSSBO;
+    unsigned int computeProgram = 0;
+    TextureBuffer lightTexture{ GL_RGBA32F };   // 每个光源5个texel
+    TextureBuffer gridTexture{ GL_RG32UI };
+    TextureBuffer indexTexture{ GL_R32UI };
+    float zNear = 0.0f, zFar = 0.0f;
+    glm::mat4 lastProjection = glm::mat4(0.0f);
+    vector<ClusterAABB> clusterBounds;          // 视空间中每个簇的包围盒
+    vector<glm::vec4> viewLights;               // 视空间中的光源位置和半径
+    vector<vector<unsigned int>> sliceIndices;  // 每个深度切片的光源下标列表
+    vector<glm::uvec2> sliceGrid;               // 每个簇在所属切片列表中的 偏移/数量
+    vector<glm::uvec2> grid;                    // 合并后每个簇的 偏移/数量
+    vector<unsigned int> indices;               // 合并后的光源下标列表
+
+    // 计算着色器的计数器（与 clusterAssign.cs 的 ClusterCounters 一致），每帧用环中的一个，栅栏触发后再读
+    struct GpuCounters
+    {
+        GLuint totalAssignments;
+        GLuint maxPerCluster;
+        GLuint dropped;
+        GLuint padding;
+    };
+    struct CounterSlot
+    {
+        unsigned int buffer = 0;
+        GLsync fence = nullptr;
+        uint64_t frame = 0;
+    };
+    CounterSlot counterSlots[COUNTER_RING];
+    GpuCounters gpuCounters = {};               // 最近一次读回的结果
+    uint64_t gpuCountersFrame = 0;
+    uint64_t gpuFrame = 0;
+    unsigned int indexCapacity = INITIAL_INDEX_CAPACITY;
+    unsigned int maxIndexCapacity = INITIAL_INDEX_CAPACITY;  // 着色器存储块的大小上限
+
+    static unsigned int clusterIndex(unsigned int x, unsigned int y, unsigned int z)
+    {
+        return x + GRID_X * (y + GRID_Y * z);
+    }
+
+    // 投影矩阵变化时重新计算每个簇在视空间中的包围盒
+    void buildClusterBounds(const glm::mat4& projection)
+    {
+        clusterBounds.resize(CLUSTER_COUNT);
+        glm::mat4 inverseProjection = glm::inverse(projection);
+        // 把NDC中的xy反投影到近平面上，再按深度缩放
+        auto unprojectAtDepth = [&](float ndcX, float ndcY, float depth)
+        {
+            glm::vec4 p = inverseProjection * glm::vec4(ndcX, ndcY, -1.0f, 1.0f);
+            glm::vec3 v = glm::vec3(p) / p.w;
+            return v * (depth / -v.z);
+        };
+        for (unsigned int z = 0; z < GRID_Z; z++)
+        {
+            float sliceNear = zNear * powf(zFar / zNear, (float)z / GRID_Z);
+            float sliceFar = zNear * powf(zFar / zNear, (float)(z + 1) / GRID_Z);
+            for (unsigned int y = 0; y < GRID_Y; y++)
+            {
+                for (unsigned int x = 0; x < GRID_X; x++)
+                {
+                    float nx0 = -1.0f + 2.0f * x / GRID_X, nx1 = -1.0f + 2.0f * (x + 1) / GRID_X;
+                    float ny0 = -1.0f + 2.0f * y / GRID_Y, ny1 = -1.0f + 2.0f * (y + 1) / GRID_Y;
+                    glm::vec3 mn(FLT_MAX), mx(-FLT_MAX);
+                    float depths[2] = { sliceNear, sliceFar };
+                    for (float d : depths)
+                    {
+                        glm::vec3 corners[4] = { unprojectAtDepth(nx0, ny0, d), unprojectAtDepth(nx1, ny0, d), unprojectAtDepth(nx0, ny1, d), unprojectAtDepth(nx1, ny1, d) };
+                        for (const glm::vec3& c : corners)
+                        {
+                            mn = glm::min(mn, c);
+                            mx = glm::max(mx, c);
+                        }
+                    }
+                    clusterBounds[clusterIndex(x, y, z)] = { glm::vec4(mn, 0.0f), glm::vec4(mx, 0.0f) };
+                }
+            }
+        }
+        if (!computeProgram)
+            return;
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, aabbSSBO);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, clusterBounds.size() * sizeof(ClusterAABB), clusterBounds.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    }
+
+    static bool sphereIntersectsAABB(const glm::vec4& sphere, const ClusterAABB& box)
+    {
+        glm::vec3 c = glm::vec3(sphere);
+        glm::vec3 closest = glm::clamp(c, glm::vec3(box.min), glm::vec3(box.max));
+        glm::vec3 d = c - closest;
+        return glm::dot(d, d) <= sphere.w * sphere.w;
+    }
+
+    // CPU分配：每个深度切片由一个任务处理，切片之间没有共享写入
+    void assignOnCpu(ThreadPool* pool)
+    {
+        sliceIndices.resize(GRID_Z);
+        sliceGrid.resize(CLUSTER_COUNT);
+
+        auto assignSlices = [this](size_t begin, size_t end, unsigned int)
+        {
+            for (size_t z = begin; z < end; z++)
+            {
+                vector<unsigned int>& list = sliceIndices[z];
+                list.clear();
+                const ClusterAABB& first = clusterBounds[clusterIndex(0, 0, (unsigned int)z)];
+                for (unsigned int y = 0; y < GRID_Y; y++)
+                {
+                    for (unsigned int x = 0; x < GRID_X; x++)
+                    {
+                        unsigned int c = clusterIndex(x, y, (unsigned int)z);
+                        const ClusterAABB& box = clusterBounds[c];
+                        unsigned int offset = (unsigned int)list.size();
+                        for (unsigned int i = 0; i < viewLights.size(); i++)
+                        {
+                            const glm::vec4& l = viewLights[i];
+                            // 先用切片的深度范围快速排除
+                            if (l.z - l.w > first.max.z || l.z + l.w < first.min.z)
+                                continue;
+                            if (sphereIntersectsAABB(l, box))
+                                list.push_back(i);
+                        }
+                        sliceGrid[c] = glm::uvec2(offset, (unsigned int)list.size() - offset);
+                    }
+                }
+            }
+        };
+        if (pool)
+            pool->ParallelFor(GRID_Z, 1, assignSlices);
+        else
+            assignSlices(0, GRID_Z, 0);
+
+        // 合并各切片的列表
+        indices.clear();
+        grid.resize(CLUSTER_COUNT);
+        for (unsigned int z = 0; z < GRID_Z; z++)
+        {
+            unsigned int base = (unsigned int)indices.size();
+            indices.insert(indices.end(), sliceIndices[z].begin(), sliceIndices[z].end());
+            for (unsigned int c = clusterIndex(0, 0, z); c < clusterIndex(0, 0, z + 1); c++)
+            {
+                grid[c] = glm::uvec2(base + sliceGrid[c].x, sliceGrid[c].y);
+                stats.maxPerCluster = std::max(stats.maxPerCluster, sliceGrid[c].y);
+            }
+        }
+        stats.assignments = (unsigned int)indices.size();
+
+        uploadStorage(CLUSTER_GRID_BINDING, gridSSBO, gridTexture, grid.data(), grid.size() * sizeof(glm::uvec2));
+        uploadStorage(CLUSTER_INDEX_BINDING, indexSSBO, indexTexture, indices.data(), indices.size() * sizeof(unsigned int));
+    }
+
+    // 上传一块着色器存储数据并绑定：优先从流式缓冲分配，否则重新指定自己的缓冲；没有SSBO时上传到纹理缓冲
+    void uploadStorage(unsigned int binding, unsigned int fallback, TextureBuffer& legacy, const void* data, size_t bytes)
+    {
+        if (!GLCompat::StorageBuffers())
+        {
+            legacy.Upload(data, bytes);
+            return;
+        }
+        bindStorage(binding, fallback, data, bytes);
+    }
+
+    void bindStorage(unsigned int binding, unsigned int fallback, const void* data, size_t bytes)
+    {
+        if (stream && stream->BindStorage(binding, data, bytes))
+            return;
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, fallback);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, std::max<size_t>(16, bytes), bytes > 0 ? data : NULL, GL_STREAM_DRAW);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding, fallback);
+    }
+
+    // GPU分配：每个簇一个工作组（见 clusterAssign.cs），列表按读回的需求扩大容量
+    void assignOnGpu()
+    {
+        readCounters();
+        stats.assignments = gpuCounters.totalAssignments;
+        stats.maxPerCluster = gpuCounters.maxPerCluster;
+        stats.dropped = gpuCounters.dropped;
+
+        bindStorage(CLUSTER_VIEW_LIGHT_BINDING, viewLightSSBO, viewLights.data(), viewLights.size() * sizeof(glm::vec4));
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, gridSSBO);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, CLUSTER_COUNT * sizeof(glm::uvec2), NULL, GL_STREAM_DRAW);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, indexSSBO);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, (GLsizeiptr)indexCapacity * sizeof(unsigned int), NULL, GL_STREAM_DRAW);
+
+        // 环中还没读到的旧结果直接丢弃，重新指定存储（孤立旧的存储）不会等待GPU
+        CounterSlot& slot = counterSlots[gpuFrame % COUNTER_RING];
+        if (slot.fence)
+        {
+            glDeleteSync(slot.fence);
+            slot.fence = nullptr;
+        }
+        GpuCounters zero = {};
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, slot.buffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(GpuCounters), &zero, GL_STREAM_READ);
+
+        glUseProgram(computeProgram);
+        glUniform1ui(glGetUniformLocation(computeProgram, "lightCount"), (GLuint)lights.size());
+        glUniform1ui(glGetUniformLocation(computeProgram, "indexCapacity"), indexCapacity);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CLUSTER_GRID_BINDING, gridSSBO);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CLUSTER_INDEX_BINDING, indexSSBO);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CLUSTER_AABB_BINDING, aabbSSBO);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CLUSTER_COUNTER_BINDING, slot.buffer);
+        glDispatchCompute(GRID_X, GRID_Y, GRID_Z);
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+        glUseProgram(0);
+        slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        slot.frame = ++gpuFrame;
+    }
+
+    // 取出已经完成的最新一帧的计数器，需要的下标数超过容量时扩大到它的1.25倍（取2的幂）
+    void readCounters()
+    {
+        for (CounterSlot& slot : counterSlots)
+        {
+            if (!slot.fence)
+                continue;
+            GLenum result = glClientWaitSync(slot.fence, 0, 0);
+            if (result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED)
+                continue;
+            glDeleteSync(slot.fence);
+            slot.fence = nullptr;
+            if (slot.frame < gpuCountersFrame)
+                continue;
+            gpuCountersFrame = slot.frame;
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, slot.buffer);
+            glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(GpuCounters), &gpuCounters);
+        }
+        uint64_t required = (uint64_t)gpuCounters.totalAssignments + gpuCounters.totalAssignments / 4;
+        while (indexCapacity < required && indexCapacity < maxIndexCapacity)
+            indexCapacity = std::min(indexCapacity * 2, maxIndexCapacity);
+    }
+
+    static unsigned int loadComputeShader(const char* path)
+    {
+        CPU_ZONE("ComputeShader::Compile");
+        std::string code;
+        if (!Shader::LoadSource(path, code))
+            return 0;
+        const char* source = code.c_str();
+        unsigned int shader = glCreateShader(GL_COMPUTE_SHADER);
+        glShaderSource(shader, 1, &source, NULL);
+        glCompileShader(shader);
+        int success;
+        char infoLog[1024];
+        glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+        if (!success)
+        {
+            glGetShaderInfoLog(shader, 1024, NULL, infoLog);
+            std::cout << "ERROR::着色器编译错误 of type: COMPUTE\n" << infoLog << std::endl;
+            glDeleteShader(shader);
+            return 0;
+        }
+        unsigned int program = glCreateProgram();
+        glAttachShader(program, shader);
+        glLinkProgram(program);
+        glDeleteShader(shader);
+        glGetProgramiv(program, GL_LINK_STATUS, &success);
+        if (!success)
+        {
+            glGetProgramInfoLog(program, 1024, NULL, infoLog);
+            std::cout << "ERROR::程序链接错误 of type: COMPUTE\n" << infoLog << std::endl;
+            glDeleteProgram(program);
+            return 0;
+        }
+        return program;
+    }
+};
+#endif
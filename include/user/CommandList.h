@@ -0,0 +1,154 @@
+#ifndef COMMAND_LIST_H
+#define COMMAND_LIST_H
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <cstdint>
+#include <cstring>
+using namespace std;
+
+class Material;
+
+// 命令类型
+enum CommandType : uint32_t
+{
+    CMD_USE_PROGRAM,
+    CMD_BIND_MATERIAL,
+    CMD_BIND_VERTEX_ARRAY,
+    CMD_SET_BLEND,
+    CMD_UNIFORM_MAT4,
+    CMD_UNIFORM_VEC3,
+    CMD_UNIFORM_FLOAT,
+    CMD_UNIFORM_INT,
+    CMD_DRAW_INDEXED,
+    CMD_DRAW_ARRAYS
+};
+
+// 与后端无关的命令列表。录制时不调用任何图形API，因此可以在任意线程上录制，
+// 之后由持有图形上下文的线程按顺序回放（见GLCommandBackend.h）。
+// 命令以 [头部][参数] 的形式紧密排列在一块连续内存中，Reset后内存保留复用。
+class CommandList
+{
+public:
+    struct Header
+    {
+        CommandType type;
+        uint32_t size;      // 参数字节数
+    };
+    struct UseProgram { uint32_t program; };
+    struct BindMaterial { Material* material; uint32_t program; };
+    struct BindVertexArray { uint32_t vao; };
+    struct SetBlend { uint32_t enabled; };
+    struct UniformMat4 { int32_t location; glm::mat4 value; };
+    struct UniformVec3 { int32_t location; glm::vec3 value; };
+    struct UniformFloat { int32_t location; float value; };
+    struct UniformInt { int32_t location; int32_t value; };
+    struct DrawIndexed { uint32_t mode; int32_t count; uint32_t instances; };
+    struct DrawArrays { uint32_t mode; int32_t first; int32_t count; uint32_t instances; };
+
+    // 清空命令，保留已分配的内存
+    void Reset()
+    {
+        data.clear();
+        commandCount = 0;
+    }
+
+    bool Empty() const
+    {
+        return commandCount == 0;
+    }
+
+    size_t CommandCount() const
+    {
+        return commandCount;
+    }
+
+    // 录制接口
+    // ------------------------------------------------------------------------
+    void CmdUseProgram(uint32_t program)
+    {
+        push(CMD_USE_PROGRAM, UseProgram{ program });
+    }
+    void CmdBindMaterial(Material* material, uint32_t program)
+    {
+        push(CMD_BIND_MATERIAL, BindMaterial{ material, program });
+    }
+    void CmdBindVertexArray(uint32_t vao)
+    {
+        push(CMD_BIND_VERTEX_ARRAY, BindVertexArray{ vao });
+    }
+    void CmdSetBlend(bool enabled)
+    {
+        push(CMD_SET_BLEND, SetBlend{ enabled ? 1u : 0u });
+    }
+    void CmdUniformMat4(int32_t location, const glm::mat4& value)
+    {
+        push(CMD_UNIFORM_MAT4, UniformMat4{ location, value });
+    }
+    void CmdUniformVec3(int32_t location, const glm::vec3& value)
+    {
+        push(CMD_UNIFORM_VEC3, UniformVec3{ location, value });
+    }
+    void CmdUniformFloat(int32_t location, float value)
+    {
+        push(CMD_UNIFORM_FLOAT, UniformFloat{ location, value });
+    }
+    void CmdUniformInt(int32_t location, int32_t value)
+    {
+        push(CMD_UNIFORM_INT, UniformInt{ location, value });
+    }
+    void CmdDrawIndexed(uint32_t mode, int32_t count, uint32_t instances = 1)
+    {
+        push(CMD_DRAW_INDEXED, DrawIndexed{ mode, count, instances });
+    }
+    void CmdDrawArrays(uint32_t mode, int32_t first, int32_t count, uint32_t instances = 1)
+    {
+        push(CMD_DRAW_ARRAYS, DrawArrays{ mode, first, count, instances });
+    }
+
+    // 遍历所有命令，visitor(header, 参数指针)
+    template <typename Visitor>
+    void ForEach(Visitor&& visitor) const
+    {
+        size_t offset = 0;
+        while (offset < data.size())
+        {
+            Header header;
+            memcpy(&header, &data[offset], sizeof(Header));
+            offset += sizeof(Header);
+            visitor(header, &data[offset]);
+            offset += align(header.size);
+        }
+    }
+
+    // 从参数指针读出具体的命令结构体
+    template <typename T>
+    static T Read(const uint8_t* payload)
+    {
+        T value;
+        memcpy(&value, payload, sizeof(T));
+        return value;
+    }
+
+private:
+    vector<uint8_t> data;
+    size_t commandCount = 0;
+
+    static size_t align(size_t size)
+    {
+        return (size + 7) & ~(size_t)7;
+    }
+
+    template <typename T>
+    void push(CommandType type, const T& payload)
+    {
+        Header header = { type, (uint32_t)sizeof(T) };
+        size_t offset = data.size();
+        data.resize(offset + sizeof(Header) + align(sizeof(T)));
+        memcpy(&data[offset], &header, sizeof(Header));
+        memcpy(&data[offset + sizeof(Header)], &payload, sizeof(T));
+        commandCount++;
+    }
+};
+#endif
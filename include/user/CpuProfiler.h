@@ -0,0 +1,345 @@
+#ifndef CPU_PROFILER_H
+#define CPU_PROFILER_H
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <memory>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <unordered_set>
+#include <algorithm>
+#include <cstdint>
+using namespace std;
+
+// CPU作用域分析器。每个线程第一次记录时注册一个自己独享的环形缓冲：
+// 只有所属线程写入（单生产者，无锁），区间结束时写入一个槽位并发布写位置；
+// 每个槽位带有序号，读者（主线程的界面和导出）按序号确认槽位里是要读的那条记录且读取期间没有被改写，否则丢弃。
+// 时间用 steady_clock（纳秒），在各个平台上都单调且与CPU频率无关。界面见 CpuProfilerWindow.h。
+struct CpuProfileEvent
+{
+    const char* name;   // 必须是静态字符串
+    int64_t beginNs;
+    int64_t endNs;
+    uint32_t depth;
+};
+
+class CpuProfileRing
+{
+public:
+    static const uint32_t CAPACITY = 16384;
+    static const uint32_t MAX_DEPTH = 64;
+
+    uint32_t threadIndex = 0;
+    string threadName;
+    atomic<uint64_t> head{ 0 };
+
+    // 只由所属线程调用
+    void Begin(const char* name, int64_t now)
+    {
+        if (depth < MAX_DEPTH)
+            stack[depth] = { name, now };
+        depth++;
+    }
+
+    void End(int64_t now)
+    {
+        if (depth == 0)
+            return;
+        depth--;
+        if (depth >= MAX_DEPTH)
+            return;
+        uint64_t h = head.load(memory_order_relaxed);
+        Slot& slot = slots[h % CAPACITY];
+        // 序号：2h+1 表示第h条正在写，2h+2 表示第h条已经写完
+        slot.sequence.store(2 * h + 1, memory_order_relaxed);
+        atomic_thread_fence(memory_order_release);
+        slot.name.store(stack[depth].name, memory_order_relaxed);
+        slot.beginNs.store(stack[depth].beginNs, memory_order_relaxed);
+        slot.endNs.store(now, memory_order_relaxed);
+        slot.depth.store(depth, memory_order_relaxed);
+        slot.sequence.store(2 * h + 2, memory_order_release);
+        head.store(h + 1, memory_order_release);
+    }
+
+    // 取出写位置 >= since 的记录（任意线程调用），返回读到的位置，下次从这里继续。
+    // 读取期间被写者绕回覆盖的槽位序号对不上，直接跳过
+    uint64_t Read(uint64_t since, vector<CpuProfileEvent>& out) const
+    {
+        uint64_t end = head.load(memory_order_acquire);
+        uint64_t begin = std::max(since, end > CAPACITY ? end - CAPACITY : 0);
+        for (uint64_t i = begin; i < end; i++)
+        {
+            const Slot& slot = slots[i % CAPACITY];
+            uint64_t expected = 2 * i + 2;
+            if (slot.sequence.load(memory_order_acquire) != expected)
+                continue;
+            CpuProfileEvent e;
+            e.name = slot.name.load(memory_order_relaxed);
+            e.beginNs = slot.beginNs.load(memory_order_relaxed);
+            e.endNs = slot.endNs.load(memory_order_relaxed);
+            e.depth = slot.depth.load(memory_order_relaxed);
+            atomic_thread_fence(memory_order_acquire);
+            if (slot.sequence.load(memory_order_relaxed) == expected)
+                out.push_back(e);
+        }
+        return end;
+    }
+
+private:
+    struct Open
+    {
+        const char* name;
+        int64_t beginNs;
+    };
+    // 记录的各个字段分别是原子变量（relaxed读写），读者和写者同时访问一个槽位时不构成数据竞争
+    struct Slot
+    {
+        atomic<uint64_t> sequence{ 0 };
+        atomic<const char*> name{ nullptr };
+        atomic<int64_t> beginNs{ 0 };
+        atomic<int64_t> endNs{ 0 };
+        atomic<uint32_t> depth{ 0 };
+    };
+    Open stack[MAX_DEPTH];
+    uint32_t depth = 0;
+    Slot slots[CAPACITY];
+};
+
+class CpuProfiler
+{
+public:
+    struct Record
+    {
+        uint32_t thread;
+        CpuProfileEvent event;
+    };
+
+    atomic<bool> enabled{ true };
+    float hitchThresholdMs = 33.0f;     // 超过这个时间的帧会被完整保存下来
+
+    static CpuProfiler& Instance()
+    {
+        static CpuProfiler profiler;
+        return profiler;
+    }
+
+    static int64_t Now()
+    {
+        return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    // 当前线程的缓冲，第一次调用时注册
+    CpuProfileRing& ThreadRing()
+    {
+        thread_local CpuProfileRing* ring = nullptr;
+        if (!ring)
+        {
+            lock_guard<mutex> lock(ringsMutex);
+            rings.emplace_back(new CpuProfileRing());
+            ring = rings.back().get();
+            ring->threadIndex = (uint32_t)rings.size() - 1;
+            ring->threadName = "Thread " + to_string(ring->threadIndex);
+        }
+        return *ring;
+    }
+
+    void SetThreadName(const string& name)
+    {
+        CpuProfileRing& ring = ThreadRing();
+        lock_guard<mutex> lock(ringsMutex);
+        ring.threadName = name;
+    }
+
+    void BeginZone(const char* name)
+    {
+        if (enabled.load(memory_order_relaxed))
+            ThreadRing().Begin(name, Now());
+    }
+
+    // 不检查enabled：开始时已经记录的区间在中途关闭后也要正确结束
+    void EndZone()
+    {
+        ThreadRing().End(Now());
+    }
+
+    // 主线程每帧结束时调用一次。第一次调用前的记录（启动过程）单独保存，之后不会被环形缓冲覆盖；
+    // 超过阈值的帧保存所有线程在这一帧内的记录，卡顿可以事后归因
+    void FrameMark()
+    {
+        int64_t now = Now();
+        if (frameStarts.empty())
+        {
+            collect(0, now, startup, true);
+            startupEndNs = now;
+        }
+        else
+        {
+            int64_t previous = frameStarts.back();
+            lastFrameMs = (now - previous) / 1.0e6f;
+            lastFrame.clear();
+            collect(previous, now, lastFrame, true);
+            if (lastFrameMs > hitchThresholdMs)
+            {
+                hitch = lastFrame;
+                hitchMs = lastFrameMs;
+                hitchFrame = frameStarts.size();
+            }
+        }
+        frameStarts.push_back(now);
+        if (frameStarts.size() > 1024)
+            frameStarts.erase(frameStarts.begin(), frameStarts.begin() + 512);
+    }
+
+    // 导出Chrome trace格式（chrome://tracing 或 Perfetto 打开）：启动过程 + 环形缓冲中仍保留的记录
+    bool ExportChromeTrace(const string& path)
+    {
+        vector<Record> records = startup;
+        collect(startupEndNs, Now(), records, false);
+        ofstream file(path);
+        if (!file)
+            return false;
+        int64_t origin = records.empty() ? 0 : records.front().event.beginNs;
+        for (const Record& r : records)
+            origin = std::min(origin, r.event.beginNs);
+        file << "{\"traceEvents\":[\n";
+        bool first = true;
+        {
+            lock_guard<mutex> lock(ringsMutex);
+            for (const unique_ptr<CpuProfileRing>& ring : rings)
+            {
+                file << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << ring->threadIndex
+                    << ",\"args\":{\"name\":\"" << escape(ring->threadName) << "\"}}";
+                first = false;
+            }
+        }
+        for (const Record& r : records)
+        {
+            file << (first ? "" : ",\n") << "{\"name\":\"" << escape(r.event.name) << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << r.thread
+                << ",\"ts\":" << (r.event.beginNs - origin) / 1000.0 << ",\"dur\":" << (r.event.endNs - r.event.beginNs) / 1000.0 << "}";
+            first = false;
+        }
+        file << "\n]}\n";
+        return file.good();
+    }
+
+    // 把运行时生成的名字（如帧图通道名）转成可以长期保存的静态字符串
+    const char* Intern(const string& name)
+    {
+        lock_guard<mutex> lock(internMutex);
+        return interned.insert(name).first->c_str();
+    }
+
+    // 上一帧（两次 FrameMark 之间）所有线程的记录，按线程、开始时间排序
+    const vector<Record>& LastFrame() const { return lastFrame; }
+    float LastFrameMs() const { return lastFrameMs; }
+    // 调用线程在记录中的线程号
+    uint32_t CurrentThread() { return ThreadRing().threadIndex; }
+    // 启动过程（第一次 FrameMark 之前）的记录和耗时
+    const vector<Record>& Startup() const { return startup; }
+    float StartupMs() const { return startup.empty() ? 0.0f : (startupEndNs - startup.front().event.beginNs) / 1.0e6f; }
+    // 最近一次超过阈值的帧，没有时为空
+    const vector<Record>& Hitch() const { return hitch; }
+    float HitchMs() const { return hitchMs; }
+    size_t HitchFrame() const { return hitchFrame; }
+
+    string ThreadName(uint32_t thread)
+    {
+        lock_guard<mutex> lock(ringsMutex);
+        return thread < rings.size() ? rings[thread]->threadName : string();
+    }
+
+private:
+    mutex ringsMutex;
+    vector<unique_ptr<CpuProfileRing>> rings;
+    // 以下只由主线程访问
+    vector<int64_t> frameStarts;
+    vector<Record> startup;
+    int64_t startupEndNs = 0;
+    vector<Record> lastFrame;
+    float lastFrameMs = 0.0f;
+    vector<Record> hitch;
+    float hitchMs = 0.0f;
+    size_t hitchFrame = 0;
+    vector<CpuProfileEvent> scratch;
+    vector<uint64_t> cursors;           // 每帧增量读取时各线程缓冲的读位置
+    vector<Record> pending;             // 增量读取时已经读出、但结束于本次范围之后的记录，留到下一次
+    mutex internMutex;
+    unordered_set<string> interned;     // 节点不会移动，c_str() 一直有效
+
+    CpuProfiler() = default;
+
+    // 收集所有线程中结束于[from, to)的记录，按线程、开始时间排序。按结束时间划分，跨过帧边界的区间算在它结束的那一帧。
+    // incremental 为真时只读上次增量读取之后写入的记录（每帧调用，避免每次复制整个缓冲），每条记录只读出一次：
+    // 新读到的记录都归入这一次，只有结束时间在 to 之后的（取时间之后才结束的区间）暂存起来，下次再归入
+    void collect(int64_t from, int64_t to, vector<Record>& out, bool incremental)
+    {
+        lock_guard<mutex> lock(ringsMutex);
+        cursors.resize(rings.size(), 0);
+        if (incremental)
+        {
+            size_t kept = 0;
+            for (const Record& r : pending)
+            {
+                if (r.event.endNs < to)
+                    out.push_back(r);
+                else
+                    pending[kept++] = r;
+            }
+            pending.resize(kept);
+        }
+        for (const unique_ptr<CpuProfileRing>& ring : rings)
+        {
+            scratch.clear();
+            uint64_t end = ring->Read(incremental ? cursors[ring->threadIndex] : 0, scratch);
+            if (incremental)
+                cursors[ring->threadIndex] = end;
+            for (const CpuProfileEvent& e : scratch)
+            {
+                if (incremental && e.endNs >= to)
+                    pending.push_back({ ring->threadIndex, e });
+                else if (incremental || (e.endNs >= from && e.endNs < to))
+                    out.push_back({ ring->threadIndex, e });
+            }
+        }
+        std::sort(out.begin(), out.end(), [](const Record& a, const Record& b)
+        {
+            if (a.thread != b.thread)
+                return a.thread < b.thread;
+            if (a.event.beginNs != b.event.beginNs)
+                return a.event.beginNs < b.event.beginNs;
+            return a.event.depth < b.event.depth;
+        });
+    }
+
+    static string escape(const string& text)
+    {
+        string result;
+        for (char c : text)
+        {
+            if (c == '"' || c == '\\')
+                result += '\\';
+            result += c;
+        }
+        return result;
+    }
+};
+
+// 作用域CPU区间，name必须是静态字符串
+struct CpuZone
+{
+    CpuZone(const char* name)
+    {
+        CpuProfiler::Instance().BeginZone(name);
+    }
+    ~CpuZone()
+    {
+        CpuProfiler::Instance().EndZone();
+    }
+};
+
+#define CPU_ZONE_CONCAT_INNER(a, b) a##b
+#define CPU_ZONE_CONCAT(a, b) CPU_ZONE_CONCAT_INNER(a, b)
+#define CPU_ZONE(name) CpuZone CPU_ZONE_CONCAT(cpuZone, __LINE__)(name)
+#endif
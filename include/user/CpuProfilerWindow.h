@@ -0,0 +1,65 @@
+#ifndef CPU_PROFILER_WINDOW_H
+#define CPU_PROFILER_WINDOW_H
+
+#include "imgui/imgui.h"
+
+#include <vector>
+#include <string>
+#include <cstdint>
+using namespace std;
+
+#include <user/CpuProfiler.h>
+
+// CPU分析器的界面，单独放在这里，记录区间的模块（Shader、ThreadPool等）不需要依赖ImGui
+class CpuProfilerWindow
+{
+public:
+    // 分析窗口：上一帧和最近一次卡顿帧的区间树（按线程分组），以及启动耗时
+    void Draw(CpuProfiler& profiler, const char* tracePath = "cpu_trace.json")
+    {
+        ImGui::Begin("CPU Profiler");
+        bool on = profiler.enabled.load();
+        if (ImGui::Checkbox("启用", &on))
+            profiler.enabled.store(on);
+        ImGui::SameLine();
+        if (ImGui::Button("导出Chrome trace"))
+            exportStatus = profiler.ExportChromeTrace(tracePath) ? string("已导出 ") + tracePath : string("导出失败");
+        if (!exportStatus.empty())
+        {
+            ImGui::SameLine();
+            ImGui::TextUnformatted(exportStatus.c_str());
+        }
+        ImGui::SliderFloat("卡顿阈值 (ms)", &profiler.hitchThresholdMs, 5.0f, 200.0f);
+        if (!profiler.Startup().empty())
+            ImGui::Text("启动: %.1f ms  (%u 个区间)", profiler.StartupMs(), (unsigned int)profiler.Startup().size());
+        if (ImGui::CollapsingHeader("上一帧", ImGuiTreeNodeFlags_DefaultOpen))
+        {
+            ImGui::Text("%.3f ms", profiler.LastFrameMs());
+            drawRecords(profiler, profiler.LastFrame());
+        }
+        if (!profiler.Hitch().empty() && ImGui::CollapsingHeader("最近的卡顿帧"))
+        {
+            ImGui::Text("第 %u 帧  %.3f ms", (unsigned int)profiler.HitchFrame(), profiler.HitchMs());
+            drawRecords(profiler, profiler.Hitch());
+        }
+        ImGui::End();
+    }
+
+private:
+    string exportStatus;
+
+    static void drawRecords(CpuProfiler& profiler, const vector<CpuProfiler::Record>& records)
+    {
+        uint32_t thread = UINT32_MAX;
+        for (const CpuProfiler::Record& r : records)
+        {
+            if (r.thread != thread)
+            {
+                thread = r.thread;
+                ImGui::TextDisabled("%s", profiler.ThreadName(thread).c_str());
+            }
+            ImGui::Text("%*s%-24s %8.3f ms", (int)r.event.depth * 2 + 2, "", r.event.name, (r.event.endNs - r.event.beginNs) / 1.0e6f);
+        }
+    }
+};
+#endif
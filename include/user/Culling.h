@@ -0,0 +1,295 @@
+#ifndef CULLING_H
+#define CULLING_H
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <cstdint>
+#include <cfloat>
+#include <cmath>
+using namespace std;
+
+#include <user/ThreadPool.h>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define CULLING_USE_SSE 1
+#include <xmmintrin.h>
+#endif
+#if defined(__AVX__)
+#define CULLING_USE_AVX 1
+#include <immintrin.h>
+#endif
+
+// 轴对齐包围盒
+struct AABB
+{
+    glm::vec3 min = glm::vec3(FLT_MAX);
+    glm::vec3 max = glm::vec3(-FLT_MAX);
+
+    void Expand(const glm::vec3& p)
+    {
+        min = glm::min(min, p);
+        max = glm::max(max, p);
+    }
+
+    bool Valid() const
+    {
+        return min.x <= max.x && min.y <= max.y && min.z <= max.z;
+    }
+
+    glm::vec3 Center() const
+    {
+        return (min + max) * 0.5f;
+    }
+
+    // 半边长
+    glm::vec3 Extents() const
+    {
+        return (max - min) * 0.5f;
+    }
+
+    // 变换后的包围盒（Arvo方法：中心直接变换，半边长乘以矩阵元素的绝对值）
+    AABB Transform(const glm::mat4& m) const
+    {
+        glm::vec3 c = glm::vec3(m * glm::vec4(Center(), 1.0f));
+        glm::vec3 e = Extents();
+        glm::vec3 r;
+        for (int i = 0; i < 3; i++)
+            r[i] = fabsf(m[0][i]) * e.x + fabsf(m[1][i]) * e.y + fabsf(m[2][i]) * e.z;
+        AABB result;
+        result.min = c - r;
+        result.max = c + r;
+        return result;
+    }
+};
+
+// 包围球
+struct BoundingSphere
+{
+    glm::vec3 center = glm::vec3(0.0f);
+    float radius = 0.0f;
+};
+
+// 视锥体：6个平面，法线指向内部，平面方程 dot(n, p) + d >= 0 表示在内侧
+struct Frustum
+{
+    enum { LEFT, RIGHT, BOTTOM, TOP, NEAR_PLANE, FAR_PLANE };
+    glm::vec4 planes[6];
+
+    // 从 投影矩阵*视图矩阵 中提取视锥平面（Gribb-Hartmann方法）
+    static Frustum FromMatrix(const glm::mat4& viewProjection)
+    {
+        const glm::mat4& m = viewProjection;
+        glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+        glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+        glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+        glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+        Frustum f;
+        f.planes[LEFT] = row3 + row0;
+        f.planes[RIGHT] = row3 - row0;
+        f.planes[BOTTOM] = row3 + row1;
+        f.planes[TOP] = row3 - row1;
+        f.planes[NEAR_PLANE] = row3 + row2;
+        f.planes[FAR_PLANE] = row3 - row2;
+        for (int i = 0; i < 6; i++)
+            f.planes[i] /= glm::length(glm::vec3(f.planes[i]));
+        return f;
+    }
+
+    bool Intersects(const AABB& box) const
+    {
+        glm::vec3 c = box.Center();
+        glm::vec3 e = box.Extents();
+        for (int i = 0; i < 6; i++)
+        {
+            glm::vec3 n = glm::vec3(planes[i]);
+            float dist = glm::dot(n, c) + planes[i].w;
+            float radius = glm::dot(glm::abs(n), e);
+            if (dist + radius < 0.0f)
+                return false;
+        }
+        return true;
+    }
+
+    bool Intersects(const BoundingSphere& sphere) const
+    {
+        for (int i = 0; i < 6; i++)
+        {
+            if (glm::dot(glm::vec3(planes[i]), sphere.center) + planes[i].w < -sphere.radius)
+                return false;
+        }
+        return true;
+    }
+};
+
+// 结构数组(SoA)形式的包围盒批次，便于SIMD一次测试多个包围盒
+class AABBBatch
+{
+public:
+    vector<float> centerX, centerY, centerZ;
+    vector<float> extentX, extentY, extentZ;
+
+    void Clear()
+    {
+        centerX.clear(); centerY.clear(); centerZ.clear();
+        extentX.clear(); extentY.clear(); extentZ.clear();
+    }
+
+    size_t Size() const
+    {
+        return centerX.size();
+    }
+
+    // 调整为n个包围盒，之后可以用Set并行填充
+    void Resize(size_t n)
+    {
+        centerX.resize(n); centerY.resize(n); centerZ.resize(n);
+        extentX.resize(n); extentY.resize(n); extentZ.resize(n);
+    }
+
+    void Set(size_t i, const AABB& box)
+    {
+        glm::vec3 c = box.Center();
+        glm::vec3 e = box.Extents();
+        centerX[i] = c.x; centerY[i] = c.y; centerZ[i] = c.z;
+        extentX[i] = e.x; extentY[i] = e.y; extentZ[i] = e.z;
+    }
+
+    // 添加一个世界空间包围盒，返回其下标
+    size_t Add(const AABB& box)
+    {
+        glm::vec3 c = box.Center();
+        glm::vec3 e = box.Extents();
+        centerX.push_back(c.x); centerY.push_back(c.y); centerZ.push_back(c.z);
+        extentX.push_back(e.x); extentY.push_back(e.y); extentZ.push_back(e.z);
+        return centerX.size() - 1;
+    }
+};
+
+// 剔除统计
+struct CullStats
+{
+    unsigned int tested;
+    unsigned int visible;
+};
+
+// 批量剔除内核：测试batch中[begin, end)范围的包围盒，visible[i]为1表示与视锥相交
+inline void CullAABBs(const Frustum& frustum, const AABBBatch& batch, size_t begin, size_t end, uint8_t* visible)
+{
+    const float* cx = batch.centerX.data();
+    const float* cy = batch.centerY.data();
+    const float* cz = batch.centerZ.data();
+    const float* ex = batch.extentX.data();
+    const float* ey = batch.extentY.data();
+    const float* ez = batch.extentZ.data();
+    size_t i = begin;
+#if CULLING_USE_AVX
+    // 一次测试8个包围盒
+    for (; i + 8 <= end; i += 8)
+    {
+        __m256 vcx = _mm256_loadu_ps(cx + i), vcy = _mm256_loadu_ps(cy + i), vcz = _mm256_loadu_ps(cz + i);
+        __m256 vex = _mm256_loadu_ps(ex + i), vey = _mm256_loadu_ps(ey + i), vez = _mm256_loadu_ps(ez + i);
+        __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        for (int p = 0; p < 6; p++)
+        {
+            const glm::vec4& plane = frustum.planes[p];
+            __m256 dist = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(plane.x), vcx), _mm256_mul_ps(_mm256_set1_ps(plane.y), vcy)),
+                                        _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(plane.z), vcz), _mm256_set1_ps(plane.w)));
+            __m256 radius = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(fabsf(plane.x)), vex), _mm256_mul_ps(_mm256_set1_ps(fabsf(plane.y)), vey)),
+                                          _mm256_mul_ps(_mm256_set1_ps(fabsf(plane.z)), vez));
+            inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_add_ps(dist, radius), _mm256_setzero_ps(), _CMP_GE_OQ));
+        }
+        int mask = _mm256_movemask_ps(inside);
+        for (int k = 0; k < 8; k++)
+            visible[i + k] = (uint8_t)((mask >> k) & 1);
+    }
+#endif
+#if CULLING_USE_SSE
+    // 一次测试4个包围盒
+    for (; i + 4 <= end; i += 4)
+    {
+        __m128 vcx = _mm_loadu_ps(cx + i), vcy = _mm_loadu_ps(cy + i), vcz = _mm_loadu_ps(cz + i);
+        __m128 vex = _mm_loadu_ps(ex + i), vey = _mm_loadu_ps(ey + i), vez = _mm_loadu_ps(ez + i);
+        __m128 inside = _mm_cmpeq_ps(_mm_setzero_ps(), _mm_setzero_ps());
+        for (int p = 0; p < 6; p++)
+        {
+            const glm::vec4& plane = frustum.planes[p];
+            __m128 dist = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.x), vcx), _mm_mul_ps(_mm_set1_ps(plane.y), vcy)),
+                                     _mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.z), vcz), _mm_set1_ps(plane.w)));
+            __m128 radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(fabsf(plane.x)), vex), _mm_mul_ps(_mm_set1_ps(fabsf(plane.y)), vey)),
+                                       _mm_mul_ps(_mm_set1_ps(fabsf(plane.z)), vez));
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(dist, radius), _mm_setzero_ps()));
+        }
+        int mask = _mm_movemask_ps(inside);
+        visible[i + 0] = (uint8_t)(mask & 1);
+        visible[i + 1] = (uint8_t)((mask >> 1) & 1);
+        visible[i + 2] = (uint8_t)((mask >> 2) & 1);
+        visible[i + 3] = (uint8_t)((mask >> 3) & 1);
+    }
+#endif
+    // 剩余部分（或没有SIMD时）逐个测试
+    for (; i < end; i++)
+    {
+        bool inside = true;
+        for (int p = 0; p < 6 && inside; p++)
+        {
+            const glm::vec4& plane = frustum.planes[p];
+            float dist = plane.x * cx[i] + plane.y * cy[i] + plane.z * cz[i] + plane.w;
+            float radius = fabsf(plane.x) * ex[i] + fabsf(plane.y) * ey[i] + fabsf(plane.z) * ez[i];
+            inside = dist + radius >= 0.0f;
+        }
+        visible[i] = inside ? 1 : 0;
+    }
+}
+
+// 视锥剔除：把整批包围盒切片后在线程池上并行测试，并累计统计
+class FrustumCuller
+{
+public:
+    CullStats stats = {};       // 本帧累计的统计
+    CullStats lastStats = {};   // 上一帧的统计，供UI显示
+    size_t grain = 4096;        // 每个切片的最少包围盒数
+
+    // 每帧开始时调用
+    void BeginFrame()
+    {
+        lastStats = stats;
+        stats = {};
+    }
+
+    // 测试整批包围盒，visible被调整为batch.Size()大小
+    void Cull(const Frustum& frustum, const AABBBatch& batch, vector<uint8_t>& visible, ThreadPool* pool = nullptr)
+    {
+        size_t n = batch.Size();
+        visible.resize(n);
+        uint8_t* out = visible.data();
+        if (pool)
+            pool->ParallelFor(n, grain, [&](size_t begin, size_t end, unsigned int) { CullAABBs(frustum, batch, begin, end, out); });
+        else
+            CullAABBs(frustum, batch, 0, n, out);
+        stats.tested += (unsigned int)n;
+        for (size_t i = 0; i < n; i++)
+            stats.visible += out[i];
+    }
+
+    // 调用者自己用 CullAABBs 分段测试时记录统计
+    void AddStats(unsigned int tested, unsigned int visible)
+    {
+        stats.tested += tested;
+        stats.visible += visible;
+    }
+};
+
+class OcclusionCuller;
+class GpuOcclusionCuller;
+
+// 一次提交所使用的剔除设置
+struct CullContext
+{
+    Frustum frustum;
+    FrustumCuller* frustumCuller = nullptr;
+    ThreadPool* pool = nullptr;
+    OcclusionCuller* occlusion = nullptr;       // CPU软件遮挡剔除，可以为空
+    GpuOcclusionCuller* gpuOcclusion = nullptr; // GPU遮挡查询，可以为空
+};
+#endif
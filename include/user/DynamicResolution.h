@@ -0,0 +1,113 @@
+#ifndef DYNAMIC_RESOLUTION_H
+#define DYNAMIC_RESOLUTION_H
+
+#include <glad/glad.h>
+
+#include <cmath>
+#include <algorithm>
+using namespace std;
+
+// 动态分辨率：用GPU计时查询测量场景通道的耗时，自动调整场景目标的渲染比例以维持目标帧时间。
+// 查询结果放在环形缓冲里，延迟几帧非阻塞地读回；比例按固定步长量化并限制调整频率，
+// 避免每帧都换尺寸（每个尺寸的目标都要从帧图的纹理池中重新分配）。
+class DynamicResolution
+{
+public:
+    bool enabled = true;
+    float targetMs = 16.0f;         // 场景通道的目标GPU耗时
+    float minScale = 0.5f;
+    float maxScale = 1.0f;
+    float step = 0.05f;             // 比例的量化步长
+    int adjustInterval = 8;         // 至少间隔多少帧才调整一次
+    float scale = 1.0f;             // 当前渲染比例（每个方向）
+    float gpuMs = 0.0f;             // 平滑后的GPU耗时
+
+    DynamicResolution()
+    {
+        glGenQueries(QUERY_RING, queries);
+    }
+
+    ~DynamicResolution()
+    {
+        glDeleteQueries(QUERY_RING, queries);
+    }
+
+    DynamicResolution(const DynamicResolution&) = delete;
+    DynamicResolution& operator=(const DynamicResolution&) = delete;
+
+    // 在场景通道之前调用
+    void BeginGpuTimer()
+    {
+        if (inFlight >= QUERY_RING)
+        {
+            timing = false; // 结果还没读回，本帧不计时
+            return;
+        }
+        glBeginQuery(GL_TIME_ELAPSED, queries[(oldest + inFlight) % QUERY_RING]);
+        timing = true;
+    }
+
+    // 在场景通道之后调用
+    void EndGpuTimer()
+    {
+        if (!timing)
+            return;
+        glEndQuery(GL_TIME_ELAPSED);
+        inFlight++;
+        timing = false;
+    }
+
+    // 每帧开始时调用：读回已经完成的计时并调整比例
+    void Update()
+    {
+        while (inFlight > 0)
+        {
+            GLuint available = 0;
+            glGetQueryObjectuiv(queries[oldest], GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available)
+                break;
+            GLuint64 elapsed = 0;
+            glGetQueryObjectui64v(queries[oldest], GL_QUERY_RESULT, &elapsed);
+            oldest = (oldest + 1) % QUERY_RING;
+            inFlight--;
+            float ms = elapsed / 1.0e6f;
+            gpuMs = gpuMs == 0.0f ? ms : gpuMs * 0.9f + ms * 0.1f;
+        }
+        framesSinceAdjust++;
+        if (!enabled)
+        {
+            scale = maxScale;
+            return;
+        }
+        if (gpuMs <= 0.0f || framesSinceAdjust < adjustInterval)
+            return;
+        // 耗时与像素数（比例的平方）近似成正比
+        float ideal = scale * sqrtf(targetMs / gpuMs);
+        // 在目标附近留出死区，避免来回抖动
+        if (fabsf(ideal - scale) < step)
+            return;
+        float next = roundf(ideal / step) * step;
+        next = std::min(maxScale, std::max(minScale, next));
+        if (next != scale)
+        {
+            scale = next;
+            framesSinceAdjust = 0;
+        }
+    }
+
+    // 按当前比例计算场景目标的尺寸
+    void SceneSize(int outputWidth, int outputHeight, int& width, int& height) const
+    {
+        width = std::max(1, (int)(outputWidth * scale + 0.5f));
+        height = std::max(1, (int)(outputHeight * scale + 0.5f));
+    }
+
+private:
+    static const int QUERY_RING = 4;
+    unsigned int queries[QUERY_RING];
+    int oldest = 0;
+    int inFlight = 0;
+    bool timing = false;
+    int framesSinceAdjust = 0;
+};
+#endif
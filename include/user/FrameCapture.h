@@ -0,0 +1,410 @@
+#ifndef FRAME_CAPTURE_H
+#define FRAME_CAPTURE_H
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <user/ImageIO.h>
+#include <user/ThreadPool.h>
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+using namespace std;
+
+// 异步截图和录屏。glReadPixels 读到客户内存时驱动必须等GPU画完这一帧，CPU和GPU的并行被打断，
+// 每帧都读的话帧率直接减半。这里改为读到像素缓冲（PBO）：glReadPixels 只是排入一条拷贝命令立即返回，
+// 随后插入栅栏，几帧之后栅栏已经触发时再映射PBO取数据，整个过程不等待GPU。
+// RING_SIZE 个PBO轮换使用，只有连续截图快到环里的PBO都还没读完时才会等待（计入 readbackStalls）。
+// 取回的像素交给自己的编码线程（不占用渲染用的线程池）：截图写成PNG，录屏转成 I420(YUV420P) 追加到一个原始视频文件，
+// 可以用 ffmpeg -f rawvideo -pix_fmt yuv420p -s WxH -r 60 -i 文件.yuv 输出.mp4 转码。
+// 所有GL调用都在主线程。
+class FrameCapture
+{
+public:
+    static const int RING_SIZE = 4;
+    static const int MAX_PENDING_ENCODES = 8;   // 编码跟不上时主线程最多领先的帧数，避免内存无限增长
+
+    // 读取的来源：帧缓冲（0为默认帧缓冲）或颜色纹理
+    struct Source
+    {
+        unsigned int framebuffer;
+        unsigned int texture;
+        int width;
+        int height;
+
+        static Source Framebuffer(unsigned int framebuffer, int width, int height) { return { framebuffer, 0, width, height }; }
+        static Source Texture(unsigned int texture, int width, int height) { return { 0, texture, width, height }; }
+    };
+
+    struct Stats
+    {
+        unsigned int screenshots;       // 已写出的截图
+        unsigned int videoFrames;       // 已写入视频文件的帧
+        unsigned int failed;            // 写文件失败
+        unsigned int droppedFrames;     // 尺寸与视频不符而丢弃的帧
+        unsigned int readbackStalls;    // 等待PBO读回的次数
+        unsigned int encodeStalls;      // 等待编码线程的次数
+        float encodeMs;                 // 最近一次编码耗时
+    };
+
+    explicit FrameCapture(unsigned int encoderThreads = 2) : encoders(encoderThreads)
+    {
+        glGenFramebuffers(1, &readFramebuffer);
+        for (Slot& slot : slots)
+            glGenBuffers(1, &slot.buffer);
+    }
+
+    ~FrameCapture()
+    {
+        Flush();
+        EndVideo();
+        for (Slot& slot : slots)
+        {
+            if (slot.fence)
+                glDeleteSync(slot.fence);
+            glDeleteBuffers(1, &slot.buffer);
+        }
+        glDeleteFramebuffers(1, &readFramebuffer);
+    }
+
+    FrameCapture(const FrameCapture&) = delete;
+    FrameCapture& operator=(const FrameCapture&) = delete;
+
+    // 在本帧渲染完成之后调用（交换缓冲之前），PNG在几帧后写出
+    void Screenshot(const Source& source, const string& path)
+    {
+        Request request;
+        request.video = false;
+        request.path = path;
+        request.width = source.width;
+        request.height = source.height;
+        readback(source, request);
+    }
+
+    // 开始录屏。I420 的色度是2x2下采样，宽高向下取偶数
+    bool BeginVideo(const string& path, int width, int height)
+    {
+        EndVideo();
+        std::lock_guard<std::mutex> lock(videoMutex);
+        videoFile.open(path, ios::binary | ios::trunc);
+        if (!videoFile)
+        {
+            std::cout << "录屏: 无法创建 " << path << std::endl;
+            return false;
+        }
+        videoPath = path;
+        videoWidth = width & ~1;
+        videoHeight = height & ~1;
+        videoSubmitted = 0;
+        videoWritten = 0;
+        recording = true;
+        return true;
+    }
+
+    // 每帧调用一次，来源小于视频尺寸时丢弃该帧（多出的部分从右上裁掉）
+    void VideoFrame(const Source& source)
+    {
+        if (!recording)
+            return;
+        if (source.width < videoWidth || source.height < videoHeight)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stats.droppedFrames++;
+            return;
+        }
+        Request request;
+        request.video = true;
+        request.width = videoWidth;
+        request.height = videoHeight;
+        request.sequence = videoSubmitted++;
+        readback(source, request);
+    }
+
+    // 等待已提交的帧全部写入后关闭视频文件
+    void EndVideo()
+    {
+        if (!recording)
+            return;
+        Flush();
+        std::lock_guard<std::mutex> lock(videoMutex);
+        videoFile.close();
+        recording = false;
+        std::cout << "录屏: " << videoWritten << " 帧 " << videoWidth << "x" << videoHeight << " 已写入 " << videoPath << std::endl;
+    }
+
+    bool Recording() const { return recording; }
+    int VideoWidth() const { return videoWidth; }
+    int VideoHeight() const { return videoHeight; }
+
+    // 每帧调用：取回栅栏已经触发的PBO交给编码线程，不等待
+    void Poll()
+    {
+        for (int i = 0; i < RING_SIZE; i++)
+        {
+            // 从最早提交的开始，视频帧按顺序进入编码
+            Slot& slot = slots[(next + i) % RING_SIZE];
+            if (!slot.fence)
+                continue;
+            GLenum result = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+            if (result == GL_TIMEOUT_EXPIRED || result == GL_WAIT_FAILED)
+                break;
+            complete(slot);
+        }
+    }
+
+    // 等待所有读回和编码完成（退出、结束录屏、需要立即使用文件时）
+    void Flush()
+    {
+        for (int i = 0; i < RING_SIZE; i++)
+        {
+            Slot& slot = slots[(next + i) % RING_SIZE];
+            if (slot.fence)
+            {
+                waitFence(slot.fence);
+                complete(slot);
+            }
+        }
+        std::unique_lock<std::mutex> lock(mutex);
+        encodeDone.wait(lock, [this]() { return pendingEncodes == 0; });
+    }
+
+    Stats GetStats()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return stats;
+    }
+
+    // RGBA -> I420（BT.601 有限范围）。输入按 glReadPixels 的顺序第一行在底部，输出第一行在顶部，宽高必须是偶数
+    static void ToI420(const uint8_t* rgba, int width, int height, vector<uint8_t>& yuv)
+    {
+        size_t lumaSize = (size_t)width * height;
+        yuv.resize(lumaSize * 3 / 2);
+        uint8_t* yPlane = yuv.data();
+        uint8_t* uPlane = yPlane + lumaSize;
+        uint8_t* vPlane = uPlane + lumaSize / 4;
+        int chromaWidth = width / 2;
+        for (int y = 0; y < height; y += 2)
+        {
+            const uint8_t* rows[2] = {
+                rgba + (size_t)(height - 1 - y) * width * 4,
+                rgba + (size_t)(height - 2 - y) * width * 4
+            };
+            for (int x = 0; x < width; x += 2)
+            {
+                int r = 0, g = 0, b = 0;
+                for (int dy = 0; dy < 2; dy++)
+                {
+                    for (int dx = 0; dx < 2; dx++)
+                    {
+                        const uint8_t* p = rows[dy] + (x + dx) * 4;
+                        yPlane[(size_t)(y + dy) * width + x + dx] = (uint8_t)((66 * p[0] + 129 * p[1] + 25 * p[2] + 128) / 256 + 16);
+                        r += p[0];
+                        g += p[1];
+                        b += p[2];
+                    }
+                }
+                // 2x2 平均后再算色度（四舍五入）
+                r = (r + 2) / 4;
+                g = (g + 2) / 4;
+                b = (b + 2) / 4;
+                size_t c = (size_t)(y / 2) * chromaWidth + x / 2;
+                uPlane[c] = (uint8_t)((-38 * r - 74 * g + 112 * b + 128 + 128 * 256) / 256);
+                vPlane[c] = (uint8_t)((112 * r - 94 * g - 18 * b + 128 + 128 * 256) / 256);
+            }
+        }
+    }
+
+private:
+    struct Request
+    {
+        bool video;
+        string path;
+        int width;
+        int height;
+        uint64_t sequence = 0;
+    };
+
+    struct Slot
+    {
+        unsigned int buffer = 0;
+        size_t capacity = 0;
+        GLsync fence = nullptr;
+        Request request;
+    };
+
+    Slot slots[RING_SIZE];
+    int next = 0;
+    unsigned int readFramebuffer = 0;
+
+    // 编码线程和主线程共享
+    std::mutex mutex;
+    std::condition_variable encodeDone;
+    int pendingEncodes = 0;
+    vector<vector<uint8_t>> freeBuffers;    // 复用的像素内存
+    Stats stats = {};
+
+    // 视频文件只由编码线程按帧序写入
+    std::mutex videoMutex;
+    ofstream videoFile;
+    string videoPath;
+    map<uint64_t, vector<uint8_t>> readyFrames;  // 已编码但前面还有帧没写的
+    uint64_t videoWritten = 0;
+    uint64_t videoSubmitted = 0;                 // 只在主线程访问
+    int videoWidth = 0;
+    int videoHeight = 0;
+    bool recording = false;
+
+    // 线程池放在最后：最先析构，此时队列中的编码任务已经全部完成
+    ThreadPool encoders;
+
+    void readback(const Source& source, const Request& request)
+    {
+        Slot& slot = slots[next];
+        next = (next + 1) % RING_SIZE;
+        if (slot.fence)
+        {
+            // 环里的PBO都还在等GPU：截图太快，只能等最早的一个
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stats.readbackStalls++;
+            }
+            waitFence(slot.fence);
+            complete(slot);
+        }
+        size_t bytes = (size_t)request.width * request.height * 4;
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+        if (slot.capacity < bytes)
+        {
+            glBufferData(GL_PIXEL_PACK_BUFFER, bytes, NULL, GL_STREAM_READ);
+            slot.capacity = bytes;
+        }
+        if (source.texture)
+        {
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, readFramebuffer);
+            glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, source.texture, 0);
+        }
+        else
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, source.framebuffer);
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        // 目标是PBO时最后一个参数是缓冲内的偏移，调用立即返回
+        glReadPixels(0, 0, request.width, request.height, GL_RGBA, GL_UNSIGNED_BYTE, (void*)0);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        slot.request = request;
+    }
+
+    static void waitFence(GLsync fence)
+    {
+        while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED)
+        {
+        }
+    }
+
+    // 栅栏已触发：把PBO的内容拷出来交给编码线程
+    void complete(Slot& slot)
+    {
+        glDeleteSync(slot.fence);
+        slot.fence = nullptr;
+        size_t bytes = (size_t)slot.request.width * slot.request.height * 4;
+        vector<uint8_t> pixels;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            if (pendingEncodes >= MAX_PENDING_ENCODES)
+            {
+                stats.encodeStalls++;
+                encodeDone.wait(lock, [this]() { return pendingEncodes < MAX_PENDING_ENCODES; });
+            }
+            pendingEncodes++;
+            if (!freeBuffers.empty())
+            {
+                pixels = std::move(freeBuffers.back());
+                freeBuffers.pop_back();
+            }
+        }
+        pixels.resize(bytes);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+        const void* mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, bytes, GL_MAP_READ_BIT);
+        bool valid = mapped != nullptr;
+        if (valid)
+        {
+            memcpy(pixels.data(), mapped, bytes);
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        Request request = slot.request;
+        // std::function 要求可拷贝，像素内存用 shared_ptr 转交
+        auto data = make_shared<vector<uint8_t>>(std::move(pixels));
+        encoders.Enqueue([this, request, data, valid]()
+        {
+            encode(request, *data, valid);
+        });
+    }
+
+    // 编码线程：像素为RGBA，第一行在底部
+    void encode(const Request& request, vector<uint8_t>& pixels, bool valid)
+    {
+        double start = glfwGetTime();
+        bool written = false;
+        if (request.video)
+        {
+            vector<uint8_t> yuv;
+            if (valid)
+                ToI420(pixels.data(), request.width, request.height, yuv);
+            else
+                yuv.assign((size_t)request.width * request.height * 3 / 2, 0);// 保持帧数和时间轴不变
+            written = writeVideoFrame(request.sequence, std::move(yuv));
+        }
+        else if (valid)
+        {
+            // 原地压缩成RGB（场景颜色的alpha没有意义），写文件时上下翻转
+            size_t count = (size_t)request.width * request.height;
+            for (size_t i = 0; i < count; i++)
+            {
+                pixels[i * 3] = pixels[i * 4];
+                pixels[i * 3 + 1] = pixels[i * 4 + 1];
+                pixels[i * 3 + 2] = pixels[i * 4 + 2];
+            }
+            written = ImageIO::WritePng(request.path, request.width, request.height, 3, pixels.data(), true);
+            if (!written)
+                std::cout << "截图: 写入 " << request.path << " 失败" << std::endl;
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!written)
+            stats.failed++;
+        else if (request.video)
+            stats.videoFrames++;
+        else
+            stats.screenshots++;
+        stats.encodeMs = (float)((glfwGetTime() - start) * 1000.0);
+        freeBuffers.push_back(std::move(pixels));
+        pendingEncodes--;
+        encodeDone.notify_all();
+    }
+
+    // 编码线程完成的先后不确定，先完成的后面的帧暂存，轮到时再写
+    bool writeVideoFrame(uint64_t sequence, vector<uint8_t> yuv)
+    {
+        std::lock_guard<std::mutex> lock(videoMutex);
+        readyFrames[sequence] = std::move(yuv);
+        bool good = true;
+        for (auto it = readyFrames.find(videoWritten); it != readyFrames.end(); it = readyFrames.find(videoWritten))
+        {
+            videoFile.write((const char*)it->second.data(), it->second.size());
+            good = good && videoFile.good();
+            readyFrames.erase(it);
+            videoWritten++;
+        }
+        return good;
+    }
+};
+#endif
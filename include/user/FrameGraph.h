@@ -0,0 +1,502 @@
+#ifndef FRAME_GRAPH_H
+#define FRAME_GRAPH_H
+
+#include <glad/glad.h>
+
+#include <vector>
+#include <string>
+#include <map>
+#include <functional>
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+using namespace std;
+
+#include <user/GLCompat.h>
+
+// 渲染目标的描述，尺寸和格式相同的纹理可以互相复用（过滤方式在借用时重新设置）
+struct FrameGraphTextureDesc
+{
+    int width = 0;
+    int height = 0;
+    GLenum format = GL_RGBA8;       // 内部格式
+    GLenum filter = GL_LINEAR;
+
+    bool operator==(const FrameGraphTextureDesc& other) const
+    {
+        return width == other.width && height == other.height && format == other.format && filter == other.filter;
+    }
+};
+
+// 跨帧保留的渲染目标池。帧图按生命周期向它借用和归还纹理，一帧之内生命周期不重叠的临时资源共用同一张纹理；
+// 连续 keepFrames 帧没有被借用的纹理会被释放（例如窗口尺寸改变后旧尺寸的纹理）
+class RenderTargetPool
+{
+public:
+    int keepFrames = 3;
+
+    ~RenderTargetPool()
+    {
+        for (Entry& e : entries)
+            glDeleteTextures(1, &e.texture);
+    }
+
+    unsigned int Acquire(const FrameGraphTextureDesc& desc, uint64_t frame)
+    {
+        for (Entry& e : entries)
+        {
+            if (!e.inUse && e.desc.width == desc.width && e.desc.height == desc.height && e.desc.format == desc.format)
+            {
+                if (e.desc.filter != desc.filter)
+                {
+                    glBindTexture(GL_TEXTURE_2D, e.texture);
+                    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, desc.filter);
+                    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, desc.filter);
+                    glBindTexture(GL_TEXTURE_2D, 0);
+                    e.desc.filter = desc.filter;
+                }
+                e.inUse = true;
+                e.lastUsed = frame;
+                return e.texture;
+            }
+        }
+        Entry e;
+        e.desc = desc;
+        e.texture = create(desc);
+        e.inUse = true;
+        e.lastUsed = frame;
+        entries.push_back(e);
+        return e.texture;
+    }
+
+    void Release(unsigned int texture)
+    {
+        for (Entry& e : entries)
+        {
+            if (e.texture == texture)
+                e.inUse = false;
+        }
+    }
+
+    // 释放长时间没有使用的纹理，返回被删除的纹理，调用者需要丢弃引用它们的帧缓冲
+    vector<unsigned int> Trim(uint64_t frame)
+    {
+        vector<unsigned int> removed;
+        for (size_t i = 0; i < entries.size();)
+        {
+            if (!entries[i].inUse && frame - entries[i].lastUsed > (uint64_t)keepFrames)
+            {
+                removed.push_back(entries[i].texture);
+                glDeleteTextures(1, &entries[i].texture);
+                entries.erase(entries.begin() + i);
+            }
+            else
+            {
+                i++;
+            }
+        }
+        return removed;
+    }
+
+    size_t Count() const
+    {
+        return entries.size();
+    }
+
+    // 池中所有纹理占用的显存（估算）
+    size_t Bytes() const
+    {
+        size_t total = 0;
+        for (const Entry& e : entries)
+            total += (size_t)e.desc.width * e.desc.height * BytesPerPixel(e.desc.format);
+        return total;
+    }
+
+    static bool IsDepthFormat(GLenum format)
+    {
+        return format == GL_DEPTH_COMPONENT16 || format == GL_DEPTH_COMPONENT24 || format == GL_DEPTH_COMPONENT32F || IsDepthStencilFormat(format);
+    }
+
+    static bool IsDepthStencilFormat(GLenum format)
+    {
+        return format == GL_DEPTH24_STENCIL8 || format == GL_DEPTH32F_STENCIL8;
+    }
+
+    static size_t BytesPerPixel(GLenum format)
+    {
+        switch (format)
+        {
+        case GL_R8: return 1;
+        case GL_RG8: case GL_R16F: case GL_DEPTH_COMPONENT16: return 2;
+        case GL_RGB8: return 3;
+        case GL_RGBA16F: case GL_RG32F: case GL_DEPTH32F_STENCIL8: return 8;
+        case GL_RGBA32F: return 16;
+        default: return 4;
+        }
+    }
+
+private:
+    struct Entry
+    {
+        FrameGraphTextureDesc desc;
+        unsigned int texture = 0;
+        bool inUse = false;
+        uint64_t lastUsed = 0;
+    };
+    vector<Entry> entries;
+
+    static unsigned int create(const FrameGraphTextureDesc& desc)
+    {
+        unsigned int texture;
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        GLCompat::TexStorage2D(GL_TEXTURE_2D, desc.format, desc.width, desc.height);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, desc.filter);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, desc.filter);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        return texture;
+    }
+};
+
+// 帧图：每帧重新声明所有渲染通道以及它们读写的资源，然后编译、执行。
+// 编译时从没有被读取的资源反向剔除无用的通道（有副作用的通道和写入导入资源的通道除外），
+// 再根据保留下来的通道计算每个临时资源的生命周期（第一次和最后一次使用的通道）。
+// 执行时在资源第一次使用前从 RenderTargetPool 借用纹理，最后一次使用后立即归还，
+// 因此生命周期不重叠、描述相同的临时资源共享同一块显存。
+class FrameGraph
+{
+public:
+    typedef int Resource;
+    static const Resource INVALID = -1;
+
+    struct Stats
+    {
+        unsigned int passes;            // 声明的通道数
+        unsigned int culledPasses;      // 被剔除的通道数
+        unsigned int transientTextures; // 声明的临时纹理数
+        unsigned int physicalTextures;  // 本帧实际借用的不同纹理数
+        unsigned int pooledTextures;    // 池中的纹理总数
+        size_t pooledBytes;
+    };
+    Stats stats = {};
+
+    // 可选：每个通道执行前后的回调（例如性能分析的计时区间）
+    function<void(const string&)> onPassBegin;
+    function<void(const string&)> onPassEnd;
+
+    class Builder
+    {
+    public:
+        // 声明一个临时纹理，本通道写入它
+        Resource Create(const string& name, const FrameGraphTextureDesc& desc)
+        {
+            Resource r = graph.addResource(name, desc, 0, false);
+            return Write(r);
+        }
+        Resource Read(Resource r)
+        {
+            graph.passes[pass].reads.push_back(r);
+            return r;
+        }
+        Resource Write(Resource r)
+        {
+            graph.passes[pass].writes.push_back(r);
+            return r;
+        }
+        // 标记通道有图之外的副作用（例如更新阴影贴图、发出查询），不会被剔除
+        void SideEffect()
+        {
+            graph.passes[pass].sideEffect = true;
+        }
+
+    private:
+        friend class FrameGraph;
+        Builder(FrameGraph& graph, int pass) : graph(graph), pass(pass) {}
+        FrameGraph& graph;
+        int pass;
+    };
+
+    ~FrameGraph()
+    {
+        for (auto& it : framebuffers)
+            glDeleteFramebuffers(1, &it.second);
+    }
+
+    // 每帧开始时清空上一帧的声明
+    void Reset()
+    {
+        passes.clear();
+        resources.clear();
+        frame++;
+    }
+
+    // 导入图外部的纹理。texture为0表示默认帧缓冲（窗口），写入它的通道总是保留
+    Resource Import(const string& name, unsigned int texture, const FrameGraphTextureDesc& desc)
+    {
+        return addResource(name, desc, texture, true);
+    }
+
+    // 导入的纹理在外部删除之前调用，丢掉缓存中引用它的帧缓冲（纹理名可能被之后新建的纹理复用）
+    void ForgetTexture(unsigned int texture)
+    {
+        dropFramebuffers(texture);
+    }
+
+    // 添加通道：setup 中声明读写，execute 在执行阶段调用，此时写入的资源已经绑定为当前帧缓冲
+    void AddPass(const string& name, const function<void(Builder&)>& setup, const function<void()>& execute)
+    {
+        Pass p;
+        p.name = name;
+        p.execute = execute;
+        passes.push_back(p);
+        Builder builder(*this, (int)passes.size() - 1);
+        setup(builder);
+    }
+
+    // 执行阶段取得资源对应的纹理
+    unsigned int Texture(Resource r) const
+    {
+        return resources[r].texture;
+    }
+
+    const FrameGraphTextureDesc& Desc(Resource r) const
+    {
+        return resources[r].desc;
+    }
+
+    void Compile()
+    {
+        // 1. 引用计数：通道被多少有效输出引用，资源被多少通道读取
+        for (Pass& p : passes)
+        {
+            p.refCount = (int)p.writes.size();
+            p.culled = false;
+            for (Resource r : p.reads)
+                resources[r].refCount++;
+        }
+        for (Pass& p : passes)
+        {
+            for (Resource r : p.writes)
+            {
+                resources[r].writers.push_back((int)(&p - &passes[0]));
+                if (resources[r].imported)
+                    p.sideEffect = true;
+            }
+        }
+        // 2. 从没有读者的资源出发反向剔除
+        vector<Resource> unused;
+        for (size_t r = 0; r < resources.size(); r++)
+        {
+            if (resources[r].refCount == 0)
+                unused.push_back((Resource)r);
+        }
+        while (!unused.empty())
+        {
+            Resource r = unused.back();
+            unused.pop_back();
+            for (int writer : resources[r].writers)
+            {
+                Pass& p = passes[writer];
+                if (p.sideEffect || p.culled || --p.refCount > 0)
+                    continue;
+                p.culled = true;
+                for (Resource read : p.reads)
+                {
+                    if (--resources[read].refCount == 0)
+                        unused.push_back(read);
+                }
+            }
+        }
+        // 3. 生命周期
+        for (size_t i = 0; i < passes.size(); i++)
+        {
+            if (passes[i].culled)
+                continue;
+            auto touch = [&](Resource r)
+            {
+                Entry& e = resources[r];
+                if (e.firstPass < 0)
+                    e.firstPass = (int)i;
+                e.lastPass = (int)i;
+            };
+            for (Resource r : passes[i].reads)
+                touch(r);
+            for (Resource r : passes[i].writes)
+                touch(r);
+        }
+
+        stats = {};
+        stats.passes = (unsigned int)passes.size();
+        for (const Pass& p : passes)
+            stats.culledPasses += p.culled ? 1 : 0;
+        for (const Entry& e : resources)
+            stats.transientTextures += e.imported ? 0 : 1;
+    }
+
+    void Execute()
+    {
+        vector<unsigned int> used;
+        for (size_t i = 0; i < passes.size(); i++)
+        {
+            Pass& p = passes[i];
+            if (p.culled)
+                continue;
+            // 借用本通道开始使用的临时纹理
+            for (Entry& e : resources)
+            {
+                if (!e.imported && e.firstPass == (int)i && e.texture == 0)
+                {
+                    e.texture = pool.Acquire(e.desc, frame);
+                    if (std::find(used.begin(), used.end(), e.texture) == used.end())
+                        used.push_back(e.texture);
+                }
+            }
+            if (onPassBegin)
+                onPassBegin(p.name);
+            if (!p.writes.empty())
+                bindTargets(p);
+            p.execute();
+            if (onPassEnd)
+                onPassEnd(p.name);
+            // 归还最后一次使用的临时纹理，后面的通道可以复用
+            for (Entry& e : resources)
+            {
+                if (!e.imported && e.lastPass == (int)i && e.texture != 0)
+                    pool.Release(e.texture);
+            }
+        }
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        for (unsigned int texture : pool.Trim(frame))
+            dropFramebuffers(texture);
+        stats.physicalTextures = (unsigned int)used.size();
+        stats.pooledTextures = (unsigned int)pool.Count();
+        stats.pooledBytes = pool.Bytes();
+    }
+
+    // 输出每个通道的状态和资源的生命周期，便于调试
+    void Dump(ostream& out) const
+    {
+        for (const Pass& p : passes)
+        {
+            out << (p.culled ? "  [culled] " : "  ") << p.name << " reads:";
+            for (Resource r : p.reads)
+                out << " " << resources[r].name;
+            out << " writes:";
+            for (Resource r : p.writes)
+                out << " " << resources[r].name;
+            out << "\n";
+        }
+        for (const Entry& e : resources)
+            out << "  " << e.name << " [" << e.firstPass << ", " << e.lastPass << "]" << (e.imported ? " imported" : "") << "\n";
+    }
+
+private:
+    struct Pass
+    {
+        string name;
+        function<void()> execute;
+        vector<Resource> reads;
+        vector<Resource> writes;
+        bool sideEffect = false;
+        bool culled = false;
+        int refCount = 0;
+    };
+    struct Entry
+    {
+        string name;
+        FrameGraphTextureDesc desc;
+        unsigned int texture = 0;
+        bool imported = false;
+        int refCount = 0;
+        int firstPass = -1;
+        int lastPass = -1;
+        vector<int> writers;
+    };
+
+    vector<Pass> passes;
+    vector<Entry> resources;
+    RenderTargetPool pool;
+    map<vector<unsigned int>, unsigned int> framebuffers;   // 附件组合 -> 帧缓冲
+    uint64_t frame = 0;
+
+    Resource addResource(const string& name, const FrameGraphTextureDesc& desc, unsigned int texture, bool imported)
+    {
+        Entry e;
+        e.name = name;
+        e.desc = desc;
+        e.texture = texture;
+        e.imported = imported;
+        resources.push_back(e);
+        return (Resource)resources.size() - 1;
+    }
+
+    // 把通道写入的资源绑定为当前帧缓冲（颜色附件按声明顺序），并设置视口
+    void bindTargets(const Pass& p)
+    {
+        const FrameGraphTextureDesc& size = resources[p.writes[0]].desc;
+        if (resources[p.writes[0]].imported && resources[p.writes[0]].texture == 0)
+        {
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            glViewport(0, 0, size.width, size.height);
+            return;
+        }
+        vector<unsigned int> key;
+        for (Resource r : p.writes)
+            key.push_back(resources[r].texture);
+        auto found = framebuffers.find(key);
+        if (found != framebuffers.end())
+        {
+            glBindFramebuffer(GL_FRAMEBUFFER, found->second);
+        }
+        else
+        {
+            unsigned int fbo;
+            glGenFramebuffers(1, &fbo);
+            glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+            vector<GLenum> drawBuffers;
+            for (Resource r : p.writes)
+            {
+                const Entry& e = resources[r];
+                GLenum attachment;
+                if (RenderTargetPool::IsDepthStencilFormat(e.desc.format))
+                    attachment = GL_DEPTH_STENCIL_ATTACHMENT;
+                else if (RenderTargetPool::IsDepthFormat(e.desc.format))
+                    attachment = GL_DEPTH_ATTACHMENT;
+                else
+                {
+                    attachment = GL_COLOR_ATTACHMENT0 + (GLenum)drawBuffers.size();
+                    drawBuffers.push_back(attachment);
+                }
+                glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, e.texture, 0);
+            }
+            if (drawBuffers.empty())
+                glDrawBuffer(GL_NONE);
+            else
+                glDrawBuffers((GLsizei)drawBuffers.size(), drawBuffers.data());
+            if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+                cout << "ERROR::FRAMEBUFFER:: Frame graph pass " << p.name << " framebuffer is not complete!" << endl;
+            framebuffers[key] = fbo;
+        }
+        glViewport(0, 0, size.width, size.height);
+    }
+
+    // 纹理被释放后，删除所有引用它的帧缓冲
+    void dropFramebuffers(unsigned int texture)
+    {
+        for (auto it = framebuffers.begin(); it != framebuffers.end();)
+        {
+            if (std::find(it->first.begin(), it->first.end(), texture) != it->first.end())
+            {
+                glDeleteFramebuffers(1, &it->second);
+                it = framebuffers.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+    }
+};
+#endif
@@ -0,0 +1,177 @@
+#ifndef FRAME_PACER_H
+#define FRAME_PACER_H
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <deque>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+#include <cstdint>
+using namespace std;
+
+// 帧节奏控制，目标是降低输入到显示的延迟：
+//   1. 用栅栏限制在途帧数：CPU最多领先GPU maxFramesInFlight 帧，驱动里不会排起长队
+//   2. 可选的帧率限制（先粗略睡眠，最后一小段自旋，保证间隔稳定）
+//   3. 垂直同步模式（关 / 开 / 自适应，自适应需要驱动支持 swap_control_tear）
+// 每帧在交换之后插入栅栏和时间戳查询；GPU完成后把时间戳换算成CPU时间，
+// 与这一帧采样输入的时刻相减，再加上显示的等待，得到输入到显示的延迟估计。
+class FramePacer
+{
+public:
+    enum VsyncMode
+    {
+        VSYNC_OFF = 0,
+        VSYNC_ON = 1,
+        VSYNC_ADAPTIVE = 2
+    };
+
+    struct Stats
+    {
+        float fenceWaitMs;      // 等待在途帧的时间
+        float limiterWaitMs;    // 帧率限制的等待时间
+        float inputToSubmitMs;  // 输入采样到提交交换
+        float gpuDoneMs;        // 输入采样到GPU完成这一帧
+        float latencyMs;        // 输入到显示的估计（平滑）
+    };
+    Stats stats = {};
+
+    int vsyncMode = VSYNC_ON;
+    float targetFps = 0.0f;         // 0为不限制
+    int maxFramesInFlight = 2;
+
+    FramePacer()
+    {
+        // GPU时间戳与CPU时钟的对应关系，用于把GPU完成的时刻换算到CPU时间
+        calibrate();
+    }
+
+    ~FramePacer()
+    {
+        for (InFlight& f : inFlight)
+        {
+            glDeleteSync(f.fence);
+            glDeleteQueries(1, &f.query);
+        }
+    }
+
+    FramePacer(const FramePacer&) = delete;
+    FramePacer& operator=(const FramePacer&) = delete;
+
+    // 帧开始时调用：应用垂直同步设置，等待在途帧数降到上限以下，然后按目标帧率等待
+    void BeginFrame()
+    {
+        if (vsyncMode != appliedVsync)
+        {
+            int interval = vsyncMode == VSYNC_OFF ? 0 : 1;
+            if (vsyncMode == VSYNC_ADAPTIVE && (glfwExtensionSupported("WGL_EXT_swap_control_tear") || glfwExtensionSupported("GLX_EXT_swap_control_tear")))
+                interval = -1;
+            glfwSwapInterval(interval);
+            appliedVsync = vsyncMode;
+        }
+
+        double start = glfwGetTime();
+        collect(false);
+        while ((int)inFlight.size() >= std::max(1, maxFramesInFlight))
+            collect(true);
+        double afterFence = glfwGetTime();
+        stats.fenceWaitMs = (float)((afterFence - start) * 1000.0);
+
+        if (targetFps > 0.0f)
+        {
+            double interval = 1.0 / targetFps;
+            if (nextDeadline == 0.0 || afterFence - nextDeadline > interval)
+                nextDeadline = afterFence;  // 落后太多时不追赶，重新对齐
+            double remaining = nextDeadline - glfwGetTime();
+            if (remaining > 0.002)
+                std::this_thread::sleep_for(std::chrono::duration<double>(remaining - 0.0015));
+            while (glfwGetTime() < nextDeadline)
+                std::this_thread::yield();
+            nextDeadline += interval;
+        }
+        else
+        {
+            nextDeadline = 0.0;
+        }
+        stats.limiterWaitMs = (float)((glfwGetTime() - afterFence) * 1000.0);
+    }
+
+    // 采样输入（轮询事件、更新相机）的时刻，尽量靠近计算视图矩阵的地方调用
+    void MarkInputSampled()
+    {
+        inputTime = glfwGetTime();
+    }
+
+    // 交换缓冲之后调用：记录这一帧的栅栏和GPU完成时间戳
+    void EndFrame()
+    {
+        InFlight f;
+        f.inputTime = inputTime;
+        glGenQueries(1, &f.query);
+        glQueryCounter(f.query, GL_TIMESTAMP);
+        f.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        inFlight.push_back(f);
+        stats.inputToSubmitMs = (float)((glfwGetTime() - inputTime) * 1000.0);
+        // 时钟会缓慢漂移，定期重新校准
+        if (++framesSinceCalibration >= 600)
+            calibrate();
+    }
+
+    // 显示器刷新间隔（秒），用于估计扫描输出的等待
+    static double RefreshInterval()
+    {
+        GLFWmonitor* monitor = glfwGetPrimaryMonitor();
+        const GLFWvidmode* mode = monitor ? glfwGetVideoMode(monitor) : nullptr;
+        return mode && mode->refreshRate > 0 ? 1.0 / mode->refreshRate : 1.0 / 60.0;
+    }
+
+private:
+    struct InFlight
+    {
+        GLsync fence;
+        unsigned int query;
+        double inputTime;
+    };
+
+    deque<InFlight> inFlight;
+    int appliedVsync = -1;
+    double nextDeadline = 0.0;
+    double inputTime = 0.0;
+    double gpuToCpuOffset = 0.0;    // CPU时间 = GPU时间戳 + offset（秒）
+    int framesSinceCalibration = 0;
+
+    void calibrate()
+    {
+        GLint64 gpuNow = 0;
+        glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+        gpuToCpuOffset = glfwGetTime() - gpuNow / 1.0e9;
+        framesSinceCalibration = 0;
+    }
+
+    // 处理已经完成的帧；wait为真时阻塞等待最旧的一帧
+    void collect(bool wait)
+    {
+        while (!inFlight.empty())
+        {
+            InFlight& f = inFlight.front();
+            GLenum result = glClientWaitSync(f.fence, wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, wait ? 100000000 : 0);
+            if (result == GL_TIMEOUT_EXPIRED)
+                return;
+            wait = false;
+            GLuint64 gpuDone = 0;
+            glGetQueryObjectui64v(f.query, GL_QUERY_RESULT, &gpuDone);
+            double doneTime = gpuDone / 1.0e9 + gpuToCpuOffset;
+            stats.gpuDoneMs = (float)((doneTime - f.inputTime) * 1000.0);
+            // 画面在GPU完成后的下一次刷新开始扫描输出：开垂直同步时平均再等一个刷新间隔，
+            // 不开时平均在画面中间被扫描到，约半个刷新间隔
+            double display = RefreshInterval() * (appliedVsync == VSYNC_OFF ? 0.5 : 1.0);
+            float latency = (float)((doneTime - f.inputTime + display) * 1000.0);
+            stats.latencyMs = stats.latencyMs == 0.0f ? latency : stats.latencyMs * 0.9f + latency * 0.1f;
+            glDeleteSync(f.fence);
+            glDeleteQueries(1, &f.query);
+            inFlight.pop_front();
+        }
+    }
+};
+#endif
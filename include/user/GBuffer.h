@@ -0,0 +1,60 @@
+#ifndef GBUFFER_H
+#define GBUFFER_H
+
+#include <glad/glad.h>
+
+#include <user/FrameGraph.h>
+#include <user/GLCompat.h>
+
+// 延迟渲染的几何缓冲（尽量紧凑，每像素 4+4+1+4 字节），作为帧图中的临时资源：
+//   albedoSpecular RGBA8       反照率rgb + 镜面强度
+//   normal         RG16_SNORM  八面体编码的世界空间法线
+//   gloss          R8          光泽度（shininess的对数编码，见 gbuffer.fs）
+//   depth          DEPTH24_STENCIL8，光照阶段用它重建世界空间位置
+// 光照阶段结束后这些资源的生命周期就结束了，后面的通道可以复用它们的显存
+struct GBuffer
+{
+    FrameGraph::Resource albedoSpecular = FrameGraph::INVALID;
+    FrameGraph::Resource normal = FrameGraph::INVALID;
+    FrameGraph::Resource gloss = FrameGraph::INVALID;
+    FrameGraph::Resource depth = FrameGraph::INVALID;
+
+    // 在几何通道中声明四个目标（颜色附件的顺序与 gbuffer.fs 的输出位置一致）
+    static GBuffer Create(FrameGraph::Builder& builder, int width, int height)
+    {
+        GBuffer g;
+        g.albedoSpecular = builder.Create("GBufferAlbedoSpecular", { width, height, GL_RGBA8, GL_NEAREST });
+        g.normal = builder.Create("GBufferNormal", { width, height, GL_RG16_SNORM, GL_NEAREST });
+        g.gloss = builder.Create("GBufferGloss", { width, height, GL_R8, GL_NEAREST });
+        g.depth = builder.Create("GBufferDepth", { width, height, GL_DEPTH24_STENCIL8, GL_NEAREST });
+        return g;
+    }
+
+    void Read(FrameGraph::Builder& builder) const
+    {
+        builder.Read(albedoSpecular);
+        builder.Read(normal);
+        builder.Read(gloss);
+        builder.Read(depth);
+    }
+
+    // 把几何缓冲绑定到纹理单元 [firstUnit, firstUnit+4)：反照率、法线、光泽度、深度
+    void BindTextures(const FrameGraph& graph, unsigned int firstUnit) const
+    {
+        FrameGraph::Resource targets[4] = { albedoSpecular, normal, gloss, depth };
+        for (unsigned int i = 0; i < 4; i++)
+        {
+            glActiveTexture(GL_TEXTURE0 + firstUnit + i);
+            glBindTexture(GL_TEXTURE_2D, graph.Texture(targets[i]));
+        }
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+    // 把深度复制到另一个同尺寸的深度目标，之后的前向物体（半透明、无光照）可以继续正确地做深度测试
+    void CopyDepthTo(const FrameGraph& graph, FrameGraph::Resource target) const
+    {
+        const FrameGraphTextureDesc& desc = graph.Desc(depth);
+        GLCompat::CopyDepth(graph.Texture(depth), graph.Texture(target), GL_TEXTURE_2D, 0, desc.width, desc.height);
+    }
+};
+#endif
@@ -0,0 +1,95 @@
+#ifndef GL_COMMAND_BACKEND_H
+#define GL_COMMAND_BACKEND_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <vector>
+using namespace std;
+
+#include <user/CommandList.h>
+#include <user/Material.h>
+
+// OpenGL后端：在持有GL上下文的线程上按顺序回放命令列表
+class GLCommandBackend
+{
+public:
+    static void Execute(const CommandList& list)
+    {
+        list.ForEach([](const CommandList::Header& header, const uint8_t* payload)
+        {
+            switch (header.type)
+            {
+            case CMD_USE_PROGRAM:
+                glUseProgram(CommandList::Read<CommandList::UseProgram>(payload).program);
+                break;
+            case CMD_BIND_MATERIAL:
+            {
+                CommandList::BindMaterial cmd = CommandList::Read<CommandList::BindMaterial>(payload);
+                cmd.material->Bind(cmd.program);
+                break;
+            }
+            case CMD_BIND_VERTEX_ARRAY:
+                glBindVertexArray(CommandList::Read<CommandList::BindVertexArray>(payload).vao);
+                break;
+            case CMD_SET_BLEND:
+                if (CommandList::Read<CommandList::SetBlend>(payload).enabled)
+                    glEnable(GL_BLEND);
+                else
+                    glDisable(GL_BLEND);
+                break;
+            case CMD_UNIFORM_MAT4:
+            {
+                CommandList::UniformMat4 cmd = CommandList::Read<CommandList::UniformMat4>(payload);
+                glUniformMatrix4fv(cmd.location, 1, GL_FALSE, glm::value_ptr(cmd.value));
+                break;
+            }
+            case CMD_UNIFORM_VEC3:
+            {
+                CommandList::UniformVec3 cmd = CommandList::Read<CommandList::UniformVec3>(payload);
+                glUniform3fv(cmd.location, 1, glm::value_ptr(cmd.value));
+                break;
+            }
+            case CMD_UNIFORM_FLOAT:
+            {
+                CommandList::UniformFloat cmd = CommandList::Read<CommandList::UniformFloat>(payload);
+                glUniform1f(cmd.location, cmd.value);
+                break;
+            }
+            case CMD_UNIFORM_INT:
+            {
+                CommandList::UniformInt cmd = CommandList::Read<CommandList::UniformInt>(payload);
+                glUniform1i(cmd.location, cmd.value);
+                break;
+            }
+            case CMD_DRAW_INDEXED:
+            {
+                CommandList::DrawIndexed cmd = CommandList::Read<CommandList::DrawIndexed>(payload);
+                if (cmd.instances == 1)
+                    glDrawElements(cmd.mode, cmd.count, GL_UNSIGNED_INT, 0);
+                else
+                    glDrawElementsInstanced(cmd.mode, cmd.count, GL_UNSIGNED_INT, 0, cmd.instances);
+                break;
+            }
+            case CMD_DRAW_ARRAYS:
+            {
+                CommandList::DrawArrays cmd = CommandList::Read<CommandList::DrawArrays>(payload);
+                if (cmd.instances == 1)
+                    glDrawArrays(cmd.mode, cmd.first, cmd.count);
+                else
+                    glDrawArraysInstanced(cmd.mode, cmd.first, cmd.count, cmd.instances);
+                break;
+            }
+            }
+        });
+    }
+
+    // 按顺序回放多个命令列表
+    static void Execute(const vector<CommandList>& lists)
+    {
+        for (const CommandList& list : lists)
+            Execute(list);
+    }
+};
+#endif
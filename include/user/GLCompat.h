@@ -0,0 +1,175 @@
+#ifndef GL_COMPAT_H
+#define GL_COMPAT_H
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <algorithm>
+using namespace std;
+
+// 低版本上下文的退路。main.cpp 依次尝试创建 4.5、4.3、3.3 的上下文，
+// 各模块在加载GL函数之后用 GLAD_GL_VERSION_x_y 判断实际可用的功能：
+//   4.2 glTexStorage                        -> glTexImage（单层）
+//   4.3 着色器存储缓冲 / 计算着色器          -> 纹理缓冲 / 只用CPU分配光源
+//       glCopyImageSubData                  -> 帧缓冲 blit
+//       顶点属性绑定 / 保守遮挡查询          -> glVertexAttribPointer / 关闭GPU遮挡查询
+//   4.4 glBufferStorage                     -> 关闭流式缓冲，各处退回普通上传
+//   4.5 直接状态访问                         -> 先绑定再修改
+class GLCompat
+{
+public:
+    // 着色器存储缓冲可用时光源和阴影图块直接放在SSBO中，否则放在纹理缓冲中（着色器定义 LEGACY_GL）
+    static bool StorageBuffers() { return GLAD_GL_VERSION_4_3 != 0; }
+
+    // 为当前绑定的纹理分配单层存储
+    static void TexStorage2D(GLenum target, GLenum internalFormat, int width, int height)
+    {
+        if (GLAD_GL_VERSION_4_2)
+        {
+            glTexStorage2D(target, 1, internalFormat, width, height);
+            return;
+        }
+        GLenum format, type;
+        pixelFormat(internalFormat, format, type);
+        glTexParameteri(target, GL_TEXTURE_MAX_LEVEL, 0);
+        glTexImage2D(target, 0, internalFormat, width, height, 0, format, type, NULL);
+    }
+
+    static void TexStorage3D(GLenum target, GLenum internalFormat, int width, int height, int depth)
+    {
+        if (GLAD_GL_VERSION_4_2)
+        {
+            glTexStorage3D(target, 1, internalFormat, width, height, depth);
+            return;
+        }
+        GLenum format, type;
+        pixelFormat(internalFormat, format, type);
+        glTexParameteri(target, GL_TEXTURE_MAX_LEVEL, 0);
+        glTexImage3D(target, 0, internalFormat, width, height, depth, 0, format, type, NULL);
+    }
+
+    // 复制两张同格式深度纹理的第0级（数组纹理复制第 layer 层）。
+    // 没有 glCopyImageSubData 时挂到两个临时帧缓冲上用 glBlitFramebuffer 复制，之前绑定的帧缓冲和裁剪测试会恢复
+    static void CopyDepth(unsigned int source, unsigned int destination, GLenum target, int layer, int width, int height)
+    {
+        if (GLAD_GL_VERSION_4_3)
+        {
+            glCopyImageSubData(source, target, 0, 0, 0, layer, destination, target, 0, 0, 0, layer, width, height, 1);
+            return;
+        }
+        static unsigned int framebuffers[2] = { 0, 0 };// 随上下文一起销毁
+        if (framebuffers[0] == 0)
+            glGenFramebuffers(2, framebuffers);
+        GLint previousRead, previousDraw;
+        glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &previousRead);
+        glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousDraw);
+        GLboolean scissor = glIsEnabled(GL_SCISSOR_TEST);
+        glDisable(GL_SCISSOR_TEST);
+
+        GLenum bindings[2] = { GL_READ_FRAMEBUFFER, GL_DRAW_FRAMEBUFFER };
+        unsigned int textures[2] = { source, destination };
+        for (int i = 0; i < 2; i++)
+        {
+            glBindFramebuffer(bindings[i], framebuffers[i]);
+            if (target == GL_TEXTURE_2D_ARRAY)
+                glFramebufferTextureLayer(bindings[i], GL_DEPTH_ATTACHMENT, textures[i], 0, layer);
+            else
+                glFramebufferTexture2D(bindings[i], GL_DEPTH_ATTACHMENT, target, textures[i], 0);
+        }
+        glReadBuffer(GL_NONE);
+        glDrawBuffer(GL_NONE);
+        glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, previousRead);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, previousDraw);
+        if (scissor)
+            glEnable(GL_SCISSOR_TEST);
+    }
+
+private:
+    // glTexImage 即使不上传数据，格式和类型也要与内部格式匹配（深度、深度模板必须对应）
+    static void pixelFormat(GLenum internalFormat, GLenum& format, GLenum& type)
+    {
+        switch (internalFormat)
+        {
+        case GL_DEPTH_COMPONENT16:
+        case GL_DEPTH_COMPONENT24:
+            format = GL_DEPTH_COMPONENT;
+            type = GL_UNSIGNED_INT;
+            break;
+        case GL_DEPTH_COMPONENT32F:
+            format = GL_DEPTH_COMPONENT;
+            type = GL_FLOAT;
+            break;
+        case GL_DEPTH24_STENCIL8:
+            format = GL_DEPTH_STENCIL;
+            type = GL_UNSIGNED_INT_24_8;
+            break;
+        case GL_DEPTH32F_STENCIL8:
+            format = GL_DEPTH_STENCIL;
+            type = GL_FLOAT_32_UNSIGNED_INT_24_8_REV;
+            break;
+        default:
+            format = GL_RGBA;
+            type = GL_UNSIGNED_BYTE;
+            break;
+        }
+    }
+};
+
+// 纹理缓冲：GL 3.3 中代替只读的着色器存储缓冲，着色器用 texelFetch 按下标读取。
+// GL对象在第一次上传时才创建，支持SSBO的上下文中不占用任何资源
+class TextureBuffer
+{
+public:
+    explicit TextureBuffer(GLenum format) : format(format)
+    {
+    }
+
+    ~TextureBuffer()
+    {
+        if (texture)
+        {
+            glDeleteTextures(1, &texture);
+            glDeleteBuffers(1, &buffer);
+        }
+    }
+
+    TextureBuffer(const TextureBuffer&) = delete;
+    TextureBuffer& operator=(const TextureBuffer&) = delete;
+
+    // 重新指定整块存储（孤立旧的存储），空数据时也分配最小的一块
+    void Upload(const void* data, size_t bytes)
+    {
+        if (!texture)
+        {
+            glGenBuffers(1, &buffer);
+            glGenTextures(1, &texture);
+        }
+        glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+        glBufferData(GL_TEXTURE_BUFFER, std::max<size_t>(16, bytes), bytes > 0 ? data : NULL, GL_STREAM_DRAW);
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+        if (!attached)
+        {
+            glBindTexture(GL_TEXTURE_BUFFER, texture);
+            glTexBuffer(GL_TEXTURE_BUFFER, format, buffer);
+            glBindTexture(GL_TEXTURE_BUFFER, 0);
+            attached = true;
+        }
+    }
+
+    // 绑定到纹理单元，着色器中对应的 samplerBuffer 需要设置为同一个单元
+    void Bind(unsigned int unit) const
+    {
+        glActiveTexture(GL_TEXTURE0 + unit);
+        glBindTexture(GL_TEXTURE_BUFFER, texture);
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+private:
+    GLenum format;
+    unsigned int buffer = 0;
+    unsigned int texture = 0;
+    bool attached = false;
+};
+#endif
@@ -0,0 +1,240 @@
+#ifndef GPU_OCCLUSION_CULLER_H
+#define GPU_OCCLUSION_CULLER_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+using namespace std;
+
+#include <user/Shader.h>
+#include <user/Culling.h>
+
+// GPU硬件遮挡查询（作为视锥剔除的补充，可选）。
+// 每个物体用一个稳定的编号标识。场景绘制完成后，对本帧请求的物体画出包围盒并记录
+// GL_ANY_SAMPLES_PASSED_CONSERVATIVE 查询；结果在之后的帧里非阻塞地读回（未就绪就继续用旧结果）。
+// 上一帧被遮挡的物体只画包围盒不画本体；可见的物体需要连续多帧查询为不可见才会被隐藏（迟滞），避免闪烁。
+// 物体被重置为可见时代数加一，之前发出、还在途中的查询带着旧的代数，读回后直接丢弃。
+class GpuOcclusionCuller
+{
+public:
+    struct Stats
+    {
+        unsigned int queriesIssued;     // 本帧发出的查询数
+        unsigned int drawsSaved;        // 本帧因被遮挡而跳过的绘制数
+    };
+    Stats stats = {};
+    Stats lastStats = {};
+
+    int hiddenFramesToCull = 3;         // 连续多少次查询为不可见后才隐藏
+    int visibleQueryInterval = 4;       // 可见物体每隔多少帧重新查询一次（被遮挡的物体每帧都查询）
+
+    GpuOcclusionCuller() : boxShader("Shader/occlusionBox.vs", "Shader/occlusionBox.fs")
+    {
+        // 4.3以上使用保守查询，更便宜；否则退回普通的ANY_SAMPLES_PASSED
+        target = GLAD_GL_VERSION_4_3 ? GL_ANY_SAMPLES_PASSED_CONSERVATIVE : GL_ANY_SAMPLES_PASSED;
+        viewProjectionLocation = glGetUniformLocation(boxShader.ID, "viewProjection");
+        centerLocation = glGetUniformLocation(boxShader.ID, "boxCenter");
+        extentsLocation = glGetUniformLocation(boxShader.ID, "boxExtents");
+
+        // 单位立方体
+        float positions[] = {
+            -0.5f, -0.5f, -0.5f,   0.5f, -0.5f, -0.5f,   0.5f, 0.5f, -0.5f,   -0.5f, 0.5f, -0.5f,
+            -0.5f, -0.5f,  0.5f,   0.5f, -0.5f,  0.5f,   0.5f, 0.5f,  0.5f,   -0.5f, 0.5f,  0.5f
+        };
+        unsigned int indices[] = {
+            0, 1, 2, 2, 3, 0,   4, 5, 6, 6, 7, 4,   0, 4, 7, 7, 3, 0,
+            1, 5, 6, 6, 2, 1,   3, 2, 6, 6, 7, 3,   0, 1, 5, 5, 4, 0
+        };
+        glGenVertexArrays(1, &VAO);
+        glGenBuffers(1, &VBO);
+        glGenBuffers(1, &EBO);
+        glBindVertexArray(VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(positions), positions, GL_STATIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+        glBindVertexArray(0);
+    }
+
+    ~GpuOcclusionCuller()
+    {
+        for (auto& it : objects)
+            glDeleteQueries(QUERY_RING, it.second.queries);
+        glDeleteVertexArrays(1, &VAO);
+        glDeleteBuffers(1, &VBO);
+        glDeleteBuffers(1, &EBO);
+    }
+
+    GpuOcclusionCuller(const GpuOcclusionCuller&) = delete;
+    GpuOcclusionCuller& operator=(const GpuOcclusionCuller&) = delete;
+
+    // 每帧开始时调用：非阻塞地收集已经就绪的查询结果并更新可见性
+    void BeginFrame()
+    {
+        lastStats = stats;
+        stats = {};
+        frame++;
+        pending.clear();
+        for (auto& it : objects)
+        {
+            Object& o = it.second;
+            // 按发出顺序读取，遇到第一个未就绪的就停下，保证结果按时间顺序生效
+            while (o.inFlight > 0)
+            {
+                unsigned int q = o.queries[o.oldest];
+                GLuint available = 0;
+                glGetQueryObjectuiv(q, GL_QUERY_RESULT_AVAILABLE, &available);
+                if (!available)
+                    break;
+                GLuint anySamples = 0;
+                glGetQueryObjectuiv(q, GL_QUERY_RESULT, &anySamples);
+                uint32_t generation = o.generations[o.oldest];
+                o.oldest = (o.oldest + 1) % QUERY_RING;
+                o.inFlight--;
+                if (generation != o.generation)
+                    continue;// 重置之前发出的查询，结果已经过时
+                if (anySamples)
+                {
+                    o.visible = true;
+                    o.hiddenCount = 0;
+                }
+                else if (++o.hiddenCount >= hiddenFramesToCull)
+                {
+                    o.visible = false;
+                }
+            }
+        }
+    }
+
+    // 所有物体重新视为可见，丢弃还在途中的查询结果（画面跳变时调用，例如回归测试切换用例）
+    void Reset()
+    {
+        for (auto& it : objects)
+            reset(it.second);
+    }
+
+    // 与 IsVisible 的结果相同，但不修改任何状态也不计入统计，可以在多个线程上同时调用
+    // （前提是同时没有线程调用 IsVisible/Request）
+    bool PeekVisible(uint32_t id) const
+    {
+        auto found = objects.find(id);
+        if (found == objects.end())
+            return true;
+        const Object& o = found->second;
+        return o.visible || o.lastRequestFrame + 1 < frame;
+    }
+
+    // 查询物体当前是否应该绘制。新物体或很久没有被请求过的物体（例如刚回到视锥里）一律视为可见
+    bool IsVisible(uint32_t id)
+    {
+        auto found = objects.find(id);
+        if (found == objects.end())
+            return true;
+        Object& o = found->second;
+        if (o.lastRequestFrame + 1 < frame)
+            reset(o);
+        if (!o.visible)
+            stats.drawsSaved++;
+        return o.visible;
+    }
+
+    // 请求本帧对物体做包围盒查询（只对通过视锥测试的物体调用）
+    void Request(uint32_t id, const AABB& worldBox)
+    {
+        Object& o = objects[id];
+        if (o.queries[0] == 0)
+            glGenQueries(QUERY_RING, o.queries);
+        o.lastRequestFrame = frame;
+        // 时间一致性：可见的物体不需要每帧都查询，按编号错开分摊到多帧
+        if (o.visible && (frame + id) % (uint64_t)visibleQueryInterval != 0)
+            return;
+        if (o.inFlight >= QUERY_RING)
+            return; // 结果还没读回，不再追加
+        pending.push_back({ id, worldBox.Center(), worldBox.Extents() });
+    }
+
+    // 场景（至少是不透明部分）画完之后调用：关闭颜色和深度写入，画出所有请求的包围盒并记录查询
+    void IssueQueries(const glm::mat4& viewProjection)
+    {
+        if (pending.empty())
+            return;
+        GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+        GLboolean cullFace = glIsEnabled(GL_CULL_FACE);
+        GLboolean depthMask, colorMask[4];
+        glGetBooleanv(GL_DEPTH_WRITEMASK, &depthMask);
+        glGetBooleanv(GL_COLOR_WRITEMASK, colorMask);
+        glEnable(GL_DEPTH_TEST);
+        glDisable(GL_CULL_FACE); // 相机在包围盒内时也要能通过
+        glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+        glDepthMask(GL_FALSE);
+
+        boxShader.use();
+        glUniformMatrix4fv(viewProjectionLocation, 1, GL_FALSE, glm::value_ptr(viewProjection));
+        glBindVertexArray(VAO);
+        for (const PendingQuery& p : pending)
+        {
+            Object& o = objects[p.id];
+            unsigned int slot = (o.oldest + o.inFlight) % QUERY_RING;
+            glUniform3fv(centerLocation, 1, glm::value_ptr(p.center));
+            glUniform3fv(extentsLocation, 1, glm::value_ptr(p.extents));
+            o.generations[slot] = o.generation;
+            glBeginQuery(target, o.queries[slot]);
+            glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
+            glEndQuery(target);
+            o.inFlight++;
+            stats.queriesIssued++;
+        }
+        glBindVertexArray(0);
+        pending.clear();
+
+        glColorMask(colorMask[0], colorMask[1], colorMask[2], colorMask[3]);
+        glDepthMask(depthMask);
+        if (!depthTest)
+            glDisable(GL_DEPTH_TEST);
+        if (cullFace)
+            glEnable(GL_CULL_FACE);
+    }
+
+private:
+    static const unsigned int QUERY_RING = 4;   // 每个物体最多同时在途的查询数
+    struct Object
+    {
+        unsigned int queries[QUERY_RING] = {};
+        uint32_t generations[QUERY_RING] = {};  // 每个查询发出时物体的代数
+        uint32_t generation = 0;
+        unsigned int oldest = 0;                // 最早发出的在途查询
+        unsigned int inFlight = 0;
+        bool visible = true;
+        int hiddenCount = 0;
+        uint64_t lastRequestFrame = 0;
+    };
+    struct PendingQuery
+    {
+        uint32_t id;
+        glm::vec3 center;
+        glm::vec3 extents;
+    };
+
+    // 重新视为可见，丢弃还在途中的查询结果
+    static void reset(Object& o)
+    {
+        o.visible = true;
+        o.hiddenCount = 0;
+        o.generation++;
+    }
+
+    Shader boxShader;
+    GLenum target;
+    GLint viewProjectionLocation, centerLocation, extentsLocation;
+    unsigned int VAO, VBO, EBO;
+    uint64_t frame = 0;
+    unordered_map<uint32_t, Object> objects;
+    vector<PendingQuery> pending;
+};
+#endif
@@ -0,0 +1,278 @@
+#ifndef GPU_PROFILER_H
+#define GPU_PROFILER_H
+
+#include <glad/glad.h>
+
+#include "imgui/imgui.h"
+
+#include <vector>
+#include <deque>
+#include <string>
+#include <fstream>
+#include <algorithm>
+#include <cstdint>
+using namespace std;
+
+// GPU计时分析器：每个区间在开始和结束处各记录一个 GL_TIMESTAMP 查询。
+// 查询按帧放在环形缓冲里，FRAME_LATENCY 帧之后才读回，结果未就绪时丢弃该帧而不是等待，读回永远不会阻塞。
+// 区间可以嵌套（depth 记录层级）。读回的结果保存最近 HISTORY_FRAMES 帧，用于ImGui曲线和CSV导出。
+class GpuProfiler
+{
+public:
+    static const int FRAME_LATENCY = 4;
+    static const int HISTORY_FRAMES = 240;
+
+    struct ZoneResult
+    {
+        string name;
+        int depth;
+        float startMs;          // 相对于帧开始
+        float durationMs;
+    };
+    struct FrameResult
+    {
+        uint64_t frame;
+        float totalMs;
+        vector<ZoneResult> zones;
+    };
+
+    bool enabled = true;
+    unsigned int droppedFrames = 0;     // 结果没能及时就绪而丢弃的帧数
+
+    GpuProfiler() = default;
+
+    ~GpuProfiler()
+    {
+        for (FrameSlot& slot : slots)
+        {
+            if (!slot.queries.empty())
+                glDeleteQueries((GLsizei)slot.queries.size(), slot.queries.data());
+        }
+    }
+
+    GpuProfiler(const GpuProfiler&) = delete;
+    GpuProfiler& operator=(const GpuProfiler&) = delete;
+
+    // 每帧开始时调用：先读回即将复用的那一帧，再记录帧开始的时间戳
+    void BeginFrame()
+    {
+        FrameSlot& slot = slots[frame % FRAME_LATENCY];
+        if (slot.pending)
+            resolve(slot);
+        slot.zones.clear();
+        slot.used = 0;
+        open.clear();
+        depth = 0;
+        slot.pending = false;
+        slot.frame = frame;
+        active = enabled;
+        if (active)
+            slot.frameBegin = timestamp(slot);
+    }
+
+    void EndFrame()
+    {
+        if (active)
+        {
+            FrameSlot& slot = slots[frame % FRAME_LATENCY];
+            slot.frameEnd = timestamp(slot);
+            slot.pending = true;
+        }
+        active = false;
+        frame++;
+    }
+
+    void BeginZone(const string& name)
+    {
+        if (!active)
+            return;
+        FrameSlot& slot = slots[frame % FRAME_LATENCY];
+        Zone zone;
+        zone.name = name;
+        zone.depth = depth++;
+        zone.begin = timestamp(slot);
+        zone.end = -1;
+        open.push_back((int)slot.zones.size());
+        slot.zones.push_back(zone);
+    }
+
+    void EndZone()
+    {
+        if (!active || open.empty())
+            return;
+        FrameSlot& slot = slots[frame % FRAME_LATENCY];
+        slot.zones[open.back()].end = timestamp(slot);
+        open.pop_back();
+        depth--;
+    }
+
+    // 等待GPU完成并读回所有还未读回的帧（退出前或需要完整结果时调用，会阻塞）
+    void Flush()
+    {
+        glFinish();
+        for (int i = 0; i < FRAME_LATENCY; i++)
+        {
+            FrameSlot& slot = slots[(frame + i) % FRAME_LATENCY];
+            if (slot.pending)
+                resolve(slot);
+            slot.pending = false;
+        }
+    }
+
+    // 下一帧的帧号（FrameResult::frame 与之对应）
+    uint64_t FrameIndex() const
+    {
+        return frame;
+    }
+
+    const deque<FrameResult>& History() const
+    {
+        return history;
+    }
+
+    // 以CSV格式导出保存的历史：frame,zone,depth,start_ms,duration_ms（帧总时间的zone为"Frame"）
+    bool ExportCsv(const string& path) const
+    {
+        ofstream file(path);
+        if (!file)
+            return false;
+        file << "frame,zone,depth,start_ms,duration_ms\n";
+        for (const FrameResult& f : history)
+        {
+            file << f.frame << ",Frame,-1,0," << f.totalMs << "\n";
+            for (const ZoneResult& z : f.zones)
+                file << f.frame << "," << z.name << "," << z.depth << "," << z.startMs << "," << z.durationMs << "\n";
+        }
+        return file.good();
+    }
+
+    // 分析窗口：每个区间最近一帧、平均和最大耗时，以及滚动曲线
+    void DrawWindow(const char* csvPath = "gpu_profile.csv")
+    {
+        ImGui::Begin("GPU Profiler");
+        ImGui::Checkbox("启用", &enabled);
+        ImGui::SameLine();
+        if (ImGui::Button("导出CSV"))
+            exportStatus = ExportCsv(csvPath) ? string("已导出 ") + csvPath : string("导出失败");
+        if (!exportStatus.empty())
+        {
+            ImGui::SameLine();
+            ImGui::TextUnformatted(exportStatus.c_str());
+        }
+        if (history.empty())
+        {
+            ImGui::Text("等待结果...");
+            ImGui::End();
+            return;
+        }
+        ImGui::Text("GPU帧时间: %.3f ms  丢弃: %u", history.back().totalMs, droppedFrames);
+        // 按最近一帧的区间顺序列出，曲线从历史中按名字收集
+        vector<float> samples;
+        for (const ZoneResult& zone : history.back().zones)
+        {
+            samples.clear();
+            float sum = 0.0f, maxMs = 0.0f;
+            for (const FrameResult& f : history)
+            {
+                float ms = 0.0f;
+                for (const ZoneResult& z : f.zones)
+                {
+                    if (z.depth == zone.depth && z.name == zone.name)
+                        ms += z.durationMs;
+                }
+                samples.push_back(ms);
+                sum += ms;
+                maxMs = std::max(maxMs, ms);
+            }
+            string label = string(zone.depth * 2, ' ') + zone.name;
+            ImGui::PushID(&zone);
+            ImGui::PlotLines("", samples.data(), (int)samples.size(), 0, nullptr, 0.0f, maxMs * 1.2f + 0.001f, ImVec2(120, 20));
+            ImGui::SameLine();
+            ImGui::Text("%-22s %7.3f ms  平均 %7.3f  最大 %7.3f", label.c_str(), zone.durationMs, sum / samples.size(), maxMs);
+            ImGui::PopID();
+        }
+        ImGui::End();
+    }
+
+private:
+    struct Zone
+    {
+        string name;
+        int depth;
+        int begin;      // 查询下标
+        int end;
+    };
+    struct FrameSlot
+    {
+        vector<unsigned int> queries;   // 只增不减，按需扩充
+        int used = 0;
+        vector<Zone> zones;
+        int frameBegin = -1;
+        int frameEnd = -1;
+        bool pending = false;
+        uint64_t frame = 0;
+    };
+
+    FrameSlot slots[FRAME_LATENCY];
+    deque<FrameResult> history;
+    vector<int> open;
+    int depth = 0;
+    bool active = false;
+    uint64_t frame = 0;
+    string exportStatus;
+
+    int timestamp(FrameSlot& slot)
+    {
+        if (slot.used == (int)slot.queries.size())
+        {
+            unsigned int query;
+            glGenQueries(1, &query);
+            slot.queries.push_back(query);
+        }
+        glQueryCounter(slot.queries[slot.used], GL_TIMESTAMP);
+        return slot.used++;
+    }
+
+    // 查询按提交顺序完成，只要最后一个就绪，整帧的结果都可以读取
+    void resolve(const FrameSlot& slot)
+    {
+        GLuint available = 0;
+        glGetQueryObjectuiv(slot.queries[slot.frameEnd], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+        {
+            droppedFrames++;
+            return;
+        }
+        vector<GLuint64> times(slot.used);
+        for (int i = 0; i < slot.used; i++)
+            glGetQueryObjectui64v(slot.queries[i], GL_QUERY_RESULT, &times[i]);
+        auto ms = [&](int from, int to) { return (float)((double)(times[to] - times[from]) / 1.0e6); };
+        FrameResult result;
+        result.frame = slot.frame;
+        result.totalMs = ms(slot.frameBegin, slot.frameEnd);
+        for (const Zone& zone : slot.zones)
+        {
+            if (zone.end < 0)
+                continue;
+            result.zones.push_back({ zone.name, zone.depth, ms(slot.frameBegin, zone.begin), ms(zone.begin, zone.end) });
+        }
+        history.push_back(result);
+        if (history.size() > HISTORY_FRAMES)
+            history.pop_front();
+    }
+};
+
+// 作用域GPU区间
+struct GpuZone
+{
+    GpuProfiler& profiler;
+    GpuZone(GpuProfiler& profiler, const string& name) : profiler(profiler)
+    {
+        profiler.BeginZone(name);
+    }
+    ~GpuZone()
+    {
+        profiler.EndZone();
+    }
+};
+#endif
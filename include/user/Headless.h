@@ -0,0 +1,307 @@
+#ifndef HEADLESS_H
+#define HEADLESS_H
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <user/ImageIO.h>
+#include <user/GpuProfiler.h>
+#include <user/FrameCapture.h>
+#include <user/GLCompat.h>
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <filesystem>
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <algorithm>
+using namespace std;
+
+// 无头模式：不需要显示器和GPU，用于服务器上批量渲染缩略图和回归图像。
+// 上下文用 GLFW 3.4 的空平台创建：优先 EGL（Mesa 的 EGL_MESA_platform_surfaceless），不行再用 OSMesa，
+// 两者在没有GPU的机器上都由 llvmpipe 软件渲染。没有默认帧缓冲，帧图的 Backbuffer 导入的是这里的离屏颜色纹理，
+// 每帧结束后按需读回并写成PNG（设置了 FrameCapture 时异步读回，不打断GPU），同时记录每帧的CPU/GPU耗时。
+// 场景时间按固定步长推进，和实际耗时无关，同样的参数每次渲染出同样的图像。
+class Headless
+{
+public:
+    struct Options
+    {
+        bool enabled = false;
+        bool software = false;              // 不用OpenGL，由CPU软件光栅化渲染（见 SoftwareRasterizer.h）
+        int frames = 60;
+        int width = 800;
+        int height = 600;
+        float fixedDelta = 1.0f / 60.0f;    // 每帧推进的场景时间（秒）
+        int captureEvery = 0;               // 每隔多少帧写一张图，0为只写最后一帧
+        bool video = false;                 // 每帧都写入 输出目录/frames.yuv（I420原始视频）
+        string outputDir = "headless";
+    };
+
+    // 识别一个命令行参数，返回消耗的参数个数，不认识时返回0
+    static int ParseArg(int argc, char** argv, int i, Options& options)
+    {
+        string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--headless")
+        {
+            options.enabled = true;
+            return 1;
+        }
+        if (arg == "--software")
+        {
+            options.software = true;
+            return 1;
+        }
+        if (arg == "--video")
+        {
+            options.video = true;
+            return 1;
+        }
+        if (!hasValue)
+            return 0;
+        if (arg == "--frames")
+            options.frames = std::max(1, atoi(argv[i + 1]));
+        else if (arg == "--size")
+        {
+            if (sscanf(argv[i + 1], "%dx%d", &options.width, &options.height) != 2 || options.width <= 0 || options.height <= 0)
+                return 0;
+        }
+        else if (arg == "--dt")
+            options.fixedDelta = (float)atof(argv[i + 1]);
+        else if (arg == "--capture-every")
+            options.captureEvery = std::max(0, atoi(argv[i + 1]));
+        else if (arg == "--output")
+            options.outputDir = argv[i + 1];
+        else
+            return 0;
+        return 2;
+    }
+
+    static const char* Usage()
+    {
+        return "  --headless                  不创建窗口，离屏渲染后写出图像和耗时\n"
+            "  --software                  不使用GPU，用CPU软件光栅化渲染，输出与无头模式相同\n"
+            "  --frames N                  无头模式渲染的帧数（默认60）\n"
+            "  --size WxH                  无头模式的输出尺寸\n"
+            "  --dt 秒                     无头模式和基准测试的固定步长（默认1/60）\n"
+            "  --capture-every N           每隔N帧写一张图（默认只写最后一帧）\n"
+            "  --video                     每帧写入 输出目录/frames.yuv（yuv420p 原始视频，可用 ffmpeg 转码）\n"
+            "  --output 目录               无头模式的输出目录（默认 headless）\n";
+    }
+
+    // 代替 glfwInit + glfwCreateWindow：选择空平台并创建不可见的窗口（只承载上下文）
+    static GLFWwindow* CreateContext(int width, int height, int major, int minor)
+    {
+        glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+        if (!glfwInit())
+        {
+            std::cout << "无头模式: 初始化GLFW空平台失败" << std::endl;
+            return nullptr;
+        }
+        const int apis[] = { GLFW_EGL_CONTEXT_API, GLFW_OSMESA_CONTEXT_API };
+        for (int api : apis)
+        {
+            glfwDefaultWindowHints();
+            glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, major);
+            glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, minor);
+            glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+            glfwWindowHint(GLFW_CONTEXT_CREATION_API, api);
+            glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+            GLFWwindow* window = glfwCreateWindow(width, height, "LearnOpenGL (headless)", NULL, NULL);
+            if (window)
+            {
+                std::cout << "无头模式: 使用 " << (api == GLFW_EGL_CONTEXT_API ? "EGL" : "OSMesa") << " 上下文" << std::endl;
+                return window;
+            }
+        }
+        std::cout << "无头模式: 创建 OpenGL " << major << "." << minor << " 上下文失败" << std::endl;
+        glfwTerminate();
+        return nullptr;
+    }
+
+    // 以下在上下文创建并加载GL函数之后使用
+    explicit Headless(const Options& options) : options(options)
+    {
+        glGenTextures(1, &colorTexture);
+        glBindTexture(GL_TEXTURE_2D, colorTexture);
+        GLCompat::TexStorage2D(GL_TEXTURE_2D, GL_RGBA8, options.width, options.height);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glGenFramebuffers(1, &readFramebuffer);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, readFramebuffer);
+        glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, colorTexture, 0);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+
+        std::error_code error;
+        std::filesystem::create_directories(options.outputDir, error);
+        if (error)
+            std::cout << "无头模式: 无法创建输出目录 " << options.outputDir << ": " << error.message() << std::endl;
+        std::cout << "无头模式: " << glGetString(GL_RENDERER) << " / " << glGetString(GL_VERSION) << std::endl;
+    }
+
+    ~Headless()
+    {
+        glDeleteFramebuffers(1, &readFramebuffer);
+        glDeleteTextures(1, &colorTexture);
+    }
+
+    Headless(const Headless&) = delete;
+    Headless& operator=(const Headless&) = delete;
+
+    // 代替窗口的颜色目标，导入帧图作为 Backbuffer
+    unsigned int ColorTexture() const { return colorTexture; }
+
+    bool Finished() const { return frame >= options.frames; }
+    int Frame() const { return frame; }
+    // 当前帧的场景时间
+    float SceneTime() const { return frame * options.fixedDelta; }
+
+    // 使用异步读回（PBO + 编码线程）代替同步 glReadPixels，frameCapture 必须比这里活得久
+    void SetFrameCapture(FrameCapture* capture)
+    {
+        frameCapture = capture;
+        if (frameCapture && options.video)
+            frameCapture->BeginVideo(options.outputDir + "/frames.yuv", options.width, options.height);
+    }
+
+    // 帧图执行之后调用：记录CPU耗时，需要时读回离屏目标写成图片，然后进入下一帧
+    void EndFrame(float cpuMs)
+    {
+        cpuTimes.push_back(cpuMs);
+        bool last = frame + 1 == options.frames;
+        if (last || (options.captureEvery > 0 && frame % options.captureEvery == 0))
+            capture(FramePath(frame));
+        if (frameCapture)
+        {
+            frameCapture->VideoFrame(FrameCapture::Source::Texture(colorTexture, options.width, options.height));
+            frameCapture->Poll();
+        }
+        frame++;
+    }
+
+    // 收集GPU分析器读回的帧时间（帧号与这里的帧号一致，结果会晚几帧到达）
+    void CollectGpuTimes(const GpuProfiler& profiler)
+    {
+        for (const GpuProfiler::FrameResult& result : profiler.History())
+        {
+            if (result.frame < gpuTimes.size())
+                gpuTimes[result.frame] = result.totalMs;
+            else if (result.frame < (uint64_t)options.frames)
+            {
+                gpuTimes.resize(result.frame + 1, -1.0f);
+                gpuTimes[result.frame] = result.totalMs;
+            }
+        }
+    }
+
+    // 写出每帧耗时（timing.csv）并打印汇总，同时等待异步读回的图像全部写完
+    bool WriteTiming()
+    {
+        if (frameCapture)
+        {
+            frameCapture->EndVideo();
+            frameCapture->Flush();
+        }
+        string path = options.outputDir + "/timing.csv";
+        ofstream file(path);
+        if (!file)
+            return false;
+        file << "frame,cpu_ms,gpu_ms\n";
+        for (size_t i = 0; i < cpuTimes.size(); i++)
+        {
+            file << i << "," << cpuTimes[i] << ",";
+            if (i < gpuTimes.size() && gpuTimes[i] >= 0.0f)
+                file << gpuTimes[i];
+            file << "\n";
+        }
+        std::cout << "无头模式: 渲染 " << cpuTimes.size() << " 帧 (" << options.width << "x" << options.height << ")，已写入 " << options.outputDir << std::endl;
+        printSummary("CPU", cpuTimes);
+        printSummary("GPU", gpuTimes);
+        return file.good();
+    }
+
+    string FramePath(int index) const
+    {
+        return FramePath(options.outputDir, index);
+    }
+
+    static string FramePath(const string& outputDir, int index)
+    {
+        ostringstream name;
+        name << outputDir << "/frame_" << setw(4) << setfill('0') << index << ".png";
+        return name.str();
+    }
+
+    const Options& GetOptions() const { return options; }
+
+    // 同步读回离屏目标：RGB，第一行在顶部（场景颜色的alpha没有意义）
+    void ReadPixels(vector<uint8_t>& rgb)
+    {
+        pixels.resize((size_t)options.width * options.height * 4);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, readFramebuffer);
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glReadPixels(0, 0, options.width, options.height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+        // OpenGL的第一行在底部
+        rgb.resize((size_t)options.width * options.height * 3);
+        for (int y = 0; y < options.height; y++)
+        {
+            const uint8_t* source = &pixels[(size_t)(options.height - 1 - y) * options.width * 4];
+            uint8_t* target = &rgb[(size_t)y * options.width * 3];
+            for (int x = 0; x < options.width; x++)
+            {
+                target[x * 3] = source[x * 4];
+                target[x * 3 + 1] = source[x * 4 + 1];
+                target[x * 3 + 2] = source[x * 4 + 2];
+            }
+        }
+    }
+
+private:
+    Options options;
+    unsigned int colorTexture = 0;
+    unsigned int readFramebuffer = 0;
+    int frame = 0;
+    vector<float> cpuTimes;
+    vector<float> gpuTimes;         // 未读回的帧为-1
+    vector<uint8_t> pixels;
+    FrameCapture* frameCapture = nullptr;
+
+    void capture(const string& path)
+    {
+        if (frameCapture)
+        {
+            frameCapture->Screenshot(FrameCapture::Source::Texture(colorTexture, options.width, options.height), path);
+            return;
+        }
+        vector<uint8_t> rgb;
+        ReadPixels(rgb);
+        if (!ImageIO::WritePng(path, options.width, options.height, 3, rgb.data()))
+            std::cout << "无头模式: 写入 " << path << " 失败" << std::endl;
+    }
+
+    static void printSummary(const char* label, const vector<float>& times)
+    {
+        vector<float> valid;
+        for (float t : times)
+        {
+            if (t >= 0.0f)
+                valid.push_back(t);
+        }
+        if (valid.empty())
+            return;
+        float sum = 0.0f;
+        for (float t : valid)
+            sum += t;
+        std::sort(valid.begin(), valid.end());
+        std::cout << "  " << label << ": 平均 " << sum / valid.size() << " ms  最小 " << valid.front() << " ms  最大 " << valid.back() << " ms  (" << valid.size() << " 帧)" << std::endl;
+    }
+};
+#endif
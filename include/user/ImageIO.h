@@ -0,0 +1,156 @@
+#ifndef IMAGE_IO_H
+#define IMAGE_IO_H
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+using namespace std;
+
+// 截图写文件。像素按行从上到下、每像素 channels 个字节（3为RGB，4为RGBA）。
+// PNG 不依赖 zlib：deflate 只用不压缩的存储块，体积约等于原始像素，但任何看图工具和 stb_image 都能读。
+// PPM(P6) 最简单，只支持RGB。
+class ImageIO
+{
+public:
+    // flipVertically 用于 glReadPixels 读回的数据（OpenGL 的第一行在底部）
+    static bool WritePng(const string& path, int width, int height, int channels, const uint8_t* pixels, bool flipVertically = false)
+    {
+        if (width <= 0 || height <= 0 || (channels != 3 && channels != 4))
+            return false;
+        // 每行前面加一个过滤类型字节（0：不过滤）
+        size_t stride = (size_t)width * channels;
+        vector<uint8_t> raw((stride + 1) * height);
+        for (int y = 0; y < height; y++)
+        {
+            int source = flipVertically ? height - 1 - y : y;
+            raw[(stride + 1) * y] = 0;
+            memcpy(&raw[(stride + 1) * y + 1], pixels + stride * source, stride);
+        }
+
+        // zlib 流：头部 + 存储块（每块最多65535字节）+ adler32
+        vector<uint8_t> zlib;
+        zlib.reserve(raw.size() + raw.size() / 65535 * 5 + 16);
+        zlib.push_back(0x78);
+        zlib.push_back(0x01);
+        size_t offset = 0;
+        do
+        {
+            size_t length = std::min<size_t>(65535, raw.size() - offset);
+            bool last = offset + length == raw.size();
+            zlib.push_back(last ? 1 : 0);
+            zlib.push_back((uint8_t)(length & 0xFF));
+            zlib.push_back((uint8_t)(length >> 8));
+            zlib.push_back((uint8_t)(~length & 0xFF));
+            zlib.push_back((uint8_t)((~length >> 8) & 0xFF));
+            zlib.insert(zlib.end(), raw.begin() + offset, raw.begin() + offset + length);
+            offset += length;
+        } while (offset < raw.size());
+        putBigEndian(zlib, adler32(raw.data(), raw.size()));
+
+        vector<uint8_t> header;
+        putBigEndian(header, (uint32_t)width);
+        putBigEndian(header, (uint32_t)height);
+        header.push_back(8);                        // 位深
+        header.push_back(channels == 4 ? 6 : 2);    // 颜色类型：RGBA / RGB
+        header.push_back(0);                        // 压缩方法
+        header.push_back(0);                        // 过滤方法
+        header.push_back(0);                        // 不隔行
+
+        ofstream file(path, ios::binary);
+        if (!file)
+            return false;
+        static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+        file.write((const char*)signature, 8);
+        writeChunk(file, "IHDR", header.data(), header.size());
+        writeChunk(file, "IDAT", zlib.data(), zlib.size());
+        writeChunk(file, "IEND", nullptr, 0);
+        return file.good();
+    }
+
+    static bool WritePpm(const string& path, int width, int height, int channels, const uint8_t* pixels, bool flipVertically = false)
+    {
+        if (width <= 0 || height <= 0 || channels < 3)
+            return false;
+        ofstream file(path, ios::binary);
+        if (!file)
+            return false;
+        file << "P6\n" << width << " " << height << "\n255\n";
+        vector<uint8_t> row((size_t)width * 3);
+        for (int y = 0; y < height; y++)
+        {
+            const uint8_t* source = pixels + (size_t)width * channels * (flipVertically ? height - 1 - y : y);
+            for (int x = 0; x < width; x++)
+                memcpy(&row[x * 3], source + x * channels, 3);
+            file.write((const char*)row.data(), row.size());
+        }
+        return file.good();
+    }
+
+private:
+    static void putBigEndian(vector<uint8_t>& out, uint32_t value)
+    {
+        out.push_back((uint8_t)(value >> 24));
+        out.push_back((uint8_t)(value >> 16));
+        out.push_back((uint8_t)(value >> 8));
+        out.push_back((uint8_t)value);
+    }
+
+    static uint32_t adler32(const uint8_t* data, size_t size)
+    {
+        uint32_t a = 1, b = 0;
+        while (size > 0)
+        {
+            // 5552 是保证 b 不溢出的最大分块
+            size_t block = std::min<size_t>(size, 5552);
+            size -= block;
+            while (block--)
+            {
+                a += *data++;
+                b += a;
+            }
+            a %= 65521;
+            b %= 65521;
+        }
+        return (b << 16) | a;
+    }
+
+    static uint32_t crc32(uint32_t crc, const uint8_t* data, size_t size)
+    {
+        // 局部静态变量的初始化是线程安全的，编码可以在工作线程中进行
+        static const vector<uint32_t> table = []()
+        {
+            vector<uint32_t> t(256);
+            for (uint32_t i = 0; i < 256; i++)
+            {
+                uint32_t c = i;
+                for (int k = 0; k < 8; k++)
+                    c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                t[i] = c;
+            }
+            return t;
+        }();
+        crc = ~crc;
+        for (size_t i = 0; i < size; i++)
+            crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+        return ~crc;
+    }
+
+    static void writeChunk(ofstream& file, const char* type, const uint8_t* data, size_t size)
+    {
+        vector<uint8_t> length;
+        putBigEndian(length, (uint32_t)size);
+        file.write((const char*)length.data(), 4);
+        file.write(type, 4);
+        if (size > 0)
+            file.write((const char*)data, size);
+        uint32_t crc = crc32(0, (const uint8_t*)type, 4);
+        crc = crc32(crc, data, size);
+        vector<uint8_t> tail;
+        putBigEndian(tail, crc);
+        file.write((const char*)tail.data(), 4);
+    }
+};
+#endif
@@ -0,0 +1,174 @@
+#ifndef INSTANCE_BUFFER_H
+#define INSTANCE_BUFFER_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <algorithm>
+#include <cstddef>
+using namespace std;
+
+#include <user/StreamBuffer.h>
+
+// 实例属性在顶点着色器中的位置约定（Mesh占用0~6）
+// layout(location=7)  in mat4 aInstanceModel;   占用7~10
+// layout(location=11) in mat3 aInstanceNormal;  占用11~13
+#define INSTANCE_MODEL_LOCATION 7
+#define INSTANCE_NORMAL_LOCATION 11
+// 实例属性共用的顶点缓冲绑定点（与第一个实例属性的默认绑定相同，不会和Mesh的属性冲突）
+#define INSTANCE_BINDING 7
+
+// 每个实例的数据：模型矩阵和预先计算好的法线矩阵，着色器里就不需要逐顶点inverse()
+struct InstanceData
+{
+    glm::mat4 model;
+    glm::mat3 normal;
+};
+
+// 实例缓冲：每帧把所有实例的变换流式上传，通过属性除数(divisor)供实例化绘制使用。
+// 设置了 stream 时直接写进持久映射的流式缓冲，只需改一下各VAO的顶点缓冲绑定偏移；
+// 否则（或流式缓冲空间不足时）退回到自己的VBO，每帧孤立旧存储后上传。
+// 属性绑定需要 4.3，直接修改VAO需要 4.5；更低的版本先绑定VAO再修改，3.3 中用 glVertexAttribPointer 重新指定属性
+class InstanceBuffer
+{
+public:
+    unsigned int VBO = 0;
+    GLsizei count = 0;          // 当前实例数量
+    StreamBuffer* stream = nullptr;
+
+    InstanceBuffer()
+    {
+        glGenBuffers(1, &VBO);
+    }
+
+    ~InstanceBuffer()
+    {
+        glDeleteBuffers(1, &VBO);
+    }
+
+    InstanceBuffer(const InstanceBuffer&) = delete;
+    InstanceBuffer& operator=(const InstanceBuffer&) = delete;
+
+    // 由模型矩阵计算法线矩阵并上传
+    void Update(const vector<glm::mat4>& models)
+    {
+        instances.resize(models.size());
+        for (size_t i = 0; i < models.size(); i++)
+        {
+            instances[i].model = models[i];
+            instances[i].normal = glm::mat3(glm::transpose(glm::inverse(models[i])));//法线矩阵 取反再转置，每个实例只算一次
+        }
+        Upload(instances.data(), instances.size());
+    }
+
+    // 直接上传已经准备好的实例数据
+    void Upload(const InstanceData* data, size_t instanceCount)
+    {
+        count = (GLsizei)instanceCount;
+        if (stream && instanceCount > 0)
+        {
+            StreamBuffer::Allocation a = stream->Write(data, instanceCount * sizeof(InstanceData));
+            if (a)
+            {
+                bind(stream->Buffer(), a.offset);
+                return;
+            }
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        if (instanceCount > capacity)
+            capacity = std::max(instanceCount, capacity * 2);
+        // 每次都重新指定存储（孤立旧的存储），避免等待GPU读完上一帧的数据
+        glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(InstanceData), NULL, GL_STREAM_DRAW);
+        if (instanceCount > 0)
+            glBufferSubData(GL_ARRAY_BUFFER, 0, instanceCount * sizeof(InstanceData), data);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        bind(VBO, 0);
+    }
+
+    // 把实例属性挂到给定的VAO上，每个VAO只需要做一次
+    void AttachTo(unsigned int vao)
+    {
+        if (std::find(attached.begin(), attached.end(), vao) != attached.end())
+            return;
+        attached.push_back(vao);
+
+        glBindVertexArray(vao);
+        if (!GLAD_GL_VERSION_4_3)
+        {
+            unsigned int locations[7] = { INSTANCE_MODEL_LOCATION, INSTANCE_MODEL_LOCATION + 1, INSTANCE_MODEL_LOCATION + 2, INSTANCE_MODEL_LOCATION + 3,
+                INSTANCE_NORMAL_LOCATION, INSTANCE_NORMAL_LOCATION + 1, INSTANCE_NORMAL_LOCATION + 2 };
+            for (unsigned int location : locations)
+            {
+                glEnableVertexAttribArray(location);
+                glVertexAttribDivisor(location, 1);//每个实例前进一次
+            }
+            pointAttributes(boundBuffer ? boundBuffer : VBO, boundOffset);
+            glBindVertexArray(0);
+            return;
+        }
+        // 属性格式和缓冲绑定分开指定，之后每帧换缓冲或偏移只需要改绑定
+        // mat4占用4个连续的属性位置，每个是一列vec4
+        for (unsigned int i = 0; i < 4; i++)
+        {
+            glEnableVertexAttribArray(INSTANCE_MODEL_LOCATION + i);
+            glVertexAttribFormat(INSTANCE_MODEL_LOCATION + i, 4, GL_FLOAT, GL_FALSE, (GLuint)(offsetof(InstanceData, model) + i * sizeof(glm::vec4)));
+            glVertexAttribBinding(INSTANCE_MODEL_LOCATION + i, INSTANCE_BINDING);
+        }
+        // mat3占用3个连续的属性位置
+        for (unsigned int i = 0; i < 3; i++)
+        {
+            glEnableVertexAttribArray(INSTANCE_NORMAL_LOCATION + i);
+            glVertexAttribFormat(INSTANCE_NORMAL_LOCATION + i, 3, GL_FLOAT, GL_FALSE, (GLuint)(offsetof(InstanceData, normal) + i * sizeof(glm::vec3)));
+            glVertexAttribBinding(INSTANCE_NORMAL_LOCATION + i, INSTANCE_BINDING);
+        }
+        glVertexBindingDivisor(INSTANCE_BINDING, 1);//每个实例前进一次
+        glBindVertexBuffer(INSTANCE_BINDING, boundBuffer ? boundBuffer : VBO, boundOffset, sizeof(InstanceData));
+        glBindVertexArray(0);
+    }
+
+private:
+    size_t capacity = 0;
+    unsigned int boundBuffer = 0;   // 当前实例数据所在的缓冲和偏移
+    GLintptr boundOffset = 0;
+    vector<InstanceData> instances;
+    vector<unsigned int> attached;  // 已经挂接过的VAO
+
+    // 把所有挂接的VAO的实例绑定点指向新的数据位置
+    void bind(unsigned int buffer, GLintptr offset)
+    {
+        if (buffer == boundBuffer && offset == boundOffset)
+            return;
+        boundBuffer = buffer;
+        boundOffset = offset;
+        if (GLAD_GL_VERSION_4_5)
+        {
+            for (unsigned int vao : attached)
+                glVertexArrayVertexBuffer(vao, INSTANCE_BINDING, buffer, offset, sizeof(InstanceData));
+            return;
+        }
+        GLint previousVAO;
+        glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &previousVAO);
+        for (unsigned int vao : attached)
+        {
+            glBindVertexArray(vao);
+            if (GLAD_GL_VERSION_4_3)
+                glBindVertexBuffer(INSTANCE_BINDING, buffer, offset, sizeof(InstanceData));
+            else
+                pointAttributes(buffer, offset);
+        }
+        glBindVertexArray(previousVAO);
+    }
+
+    // 3.3：把当前VAO的实例属性指向缓冲中的偏移
+    static void pointAttributes(unsigned int buffer, GLintptr offset)
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, buffer);
+        for (unsigned int i = 0; i < 4; i++)
+            glVertexAttribPointer(INSTANCE_MODEL_LOCATION + i, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void*)(offset + offsetof(InstanceData, model) + i * sizeof(glm::vec4)));
+        for (unsigned int i = 0; i < 3; i++)
+            glVertexAttribPointer(INSTANCE_NORMAL_LOCATION + i, 3, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void*)(offset + offsetof(InstanceData, normal) + i * sizeof(glm::vec3)));
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+};
+#endif
@@ -0,0 +1,212 @@
+#ifndef MATERIAL_H
+#define MATERIAL_H
+
+#include <glad/glad.h> // 包含所有OpenGL类型声明
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <string>
+#include <map>
+using namespace std;
+
+struct Texture
+{
+    unsigned int id;
+    string type;
+    string path;
+};
+
+// 材质：在导入时创建，保存着色器程序、已解析的采样器位置、纹理单元以及常量参数。
+// 绘制时只需要遍历预先烘焙好的绑定表，不做任何字符串拼接和内存分配。
+// 使用同一个材质的网格共享同一个Material对象（通过shared_ptr）。
+// 同一个材质会被多个着色器程序使用（深度、前向、G-Buffer），每个程序保存一份绑定表，程序交替时不重新解析。
+// 采样器的纹理单元按名称在每个程序内固定分配，只在第一次用这个程序绑定时设置一次。
+class Material
+{
+public:
+    // 已解析的采样器绑定
+    struct SamplerBinding
+    {
+        GLint location;     // 采样器uniform位置
+        GLint unit;         // 纹理单元
+        GLuint texture;     // 纹理对象
+    };
+    // 已解析的常量参数（最多4个float分量）
+    struct ParamBinding
+    {
+        GLint location;
+        GLint components;
+        float value[4];
+    };
+
+    string name;
+    vector<Texture> textures;           // 材质引用的所有纹理
+    unsigned int sortId;                // 渲染队列排序键中使用的材质编号
+
+    Material(const vector<Texture>& textures, const string& name = "") : name(name), textures(textures)
+    {
+        static unsigned int nextSortId = 1;
+        sortId = nextSortId++;
+        // 按照 texture_diffuseN / texture_specularN / texture_normalN / texture_heightN 的约定生成采样器名称，只在导入时做一次
+        unsigned int diffuseNr = 1;
+        unsigned int specularNr = 1;
+        unsigned int normalNr = 1;
+        unsigned int heightNr = 1;
+        for (unsigned int i = 0; i < textures.size(); i++)
+        {
+            string number;
+            const string& type = textures[i].type;
+            if (type == "texture_diffuse")
+                number = std::to_string(diffuseNr++);
+            else if (type == "texture_specular")
+                number = std::to_string(specularNr++);
+            else if (type == "texture_normal")
+                number = std::to_string(normalNr++);
+            else if (type == "texture_height")
+                number = std::to_string(heightNr++);
+            samplerNames.push_back(type + number);
+        }
+    }
+
+    // 设置常量参数，重新解析后生效
+    void SetFloat(const string& paramName, float value)
+    {
+        setParam(paramName, 1, &value);
+    }
+    void SetVec3(const string& paramName, glm::vec3 value)
+    {
+        setParam(paramName, 3, &value.x);
+    }
+    void SetVec4(const string& paramName, glm::vec4 value)
+    {
+        setParam(paramName, 4, &value.x);
+    }
+
+    // 针对给定着色器程序解析所有uniform位置。导入时预先调用，或者第一次用这个程序绑定时自动调用
+    void Resolve(unsigned int shaderProgram)
+    {
+        ProgramBindings* existing = find(shaderProgram);
+        if (!existing)
+        {
+            bindings.push_back(ProgramBindings());
+            existing = &bindings.back();
+        }
+        ProgramBindings& b = *existing;
+        b.program = shaderProgram;
+        b.unitsApplied = false;
+        b.samplers.clear();
+        b.params.clear();
+        for (unsigned int i = 0; i < textures.size(); i++)
+        {
+            GLint location = glGetUniformLocation(shaderProgram, samplerNames[i].c_str());
+            if (location < 0)
+                continue; // 着色器没有使用这个采样器，直接丢弃
+            SamplerBinding binding;
+            binding.location = location;
+            binding.unit = samplerUnit(shaderProgram, samplerNames[i]);
+            binding.texture = textures[i].id;
+            b.samplers.push_back(binding);
+        }
+        for (unsigned int i = 0; i < paramValues.size(); i++)
+        {
+            ParamBinding binding = paramValues[i];
+            binding.location = glGetUniformLocation(shaderProgram, paramNames[i].c_str());
+            if (binding.location < 0)
+                continue;
+            b.params.push_back(binding);
+        }
+    }
+
+    // 绑定材质：调用前着色器程序必须已经激活。紧凑循环，无分配
+    void Bind(unsigned int shaderProgram)
+    {
+        ProgramBindings* b = find(shaderProgram);
+        if (!b)
+        {
+            Resolve(shaderProgram); // 第一次遇到这个程序才解析
+            b = &bindings.back();
+        }
+        if (!b->unitsApplied)
+        {
+            // 采样器的纹理单元是程序的状态，设置一次就一直有效
+            for (const SamplerBinding& s : b->samplers)
+                glUniform1i(s.location, s.unit);
+            b->unitsApplied = true;
+        }
+        for (const SamplerBinding& s : b->samplers)
+        {
+            glActiveTexture(GL_TEXTURE0 + s.unit); // 在绑定之前激活正确的纹理单元
+            glBindTexture(GL_TEXTURE_2D, s.texture);
+        }
+        for (const ParamBinding& p : b->params)
+        {
+            switch (p.components)
+            {
+            case 1: glUniform1fv(p.location, 1, p.value); break;
+            case 2: glUniform2fv(p.location, 1, p.value); break;
+            case 3: glUniform3fv(p.location, 1, p.value); break;
+            default: glUniform4fv(p.location, 1, p.value); break;
+            }
+        }
+    }
+
+private:
+    // 一个着色器程序的已解析绑定表
+    struct ProgramBindings
+    {
+        unsigned int program = 0;
+        bool unitsApplied = false;      // 采样器的纹理单元是否已经设置到程序上
+        vector<SamplerBinding> samplers;
+        vector<ParamBinding> params;
+    };
+
+    vector<string> samplerNames;        // 与textures一一对应的采样器名称
+    vector<string> paramNames;          // 与paramValues一一对应的参数名称
+    vector<ParamBinding> paramValues;   // 参数值（位置未解析）
+    vector<ProgramBindings> bindings;   // 每个用过的着色器程序一份，程序很少，线性查找即可
+
+    ProgramBindings* find(unsigned int shaderProgram)
+    {
+        for (ProgramBindings& b : bindings)
+        {
+            if (b.program == shaderProgram)
+                return &b;
+        }
+        return nullptr;
+    }
+
+    // 同一个程序里同名采样器在所有材质中使用同一个纹理单元，这样单元只需设置一次
+    static GLint samplerUnit(unsigned int shaderProgram, const string& samplerName)
+    {
+        static map<unsigned int, vector<string>> programSamplers;
+        vector<string>& names = programSamplers[shaderProgram];
+        for (size_t i = 0; i < names.size(); i++)
+        {
+            if (names[i] == samplerName)
+                return (GLint)i;
+        }
+        names.push_back(samplerName);
+        return (GLint)names.size() - 1;
+    }
+
+    void setParam(const string& paramName, int components, const float* value)
+    {
+        ParamBinding binding = { -1, components, { 0.0f, 0.0f, 0.0f, 0.0f } };
+        for (int i = 0; i < components; i++)
+            binding.value[i] = value[i];
+        for (unsigned int i = 0; i < paramNames.size(); i++)
+        {
+            if (paramNames[i] == paramName)
+            {
+                paramValues[i] = binding;
+                bindings.clear(); // 下次绑定时重新解析
+                return;
+            }
+        }
+        paramNames.push_back(paramName);
+        paramValues.push_back(binding);
+        bindings.clear();
+    }
+};
+#endif
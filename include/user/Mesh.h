@@ -7,9 +7,16 @@
 
 #include <vector>
 #include <string>
+#include <memory>
+#include <algorithm>
+#include <cmath>
 using namespace std;
 
 #include <user/Shader.h>
+#include <user/Material.h>
+#include <user/RenderQueue.h>
+#include <user/InstanceBuffer.h>
+#include <user/Culling.h>
 
 #include <glad/glad.h> // 包含所有OpenGL类型声明
 
@@ -35,13 +42,6 @@ struct Vertex
     float m_Weights[MAX_BONE_INFLUENCE];
 };
 
-struct Texture
-{
-    unsigned int id;
-    string type;
-    string path;
-};
-
 class Mesh
 {
 public:
@@ -51,45 +51,36 @@ public:
     vector<Texture>      textures;
     unsigned int VAO;
 
+    shared_ptr<Material> material;  // 可能被多个网格共享
+    AABB bounds;                    // 模型空间包围盒
+    BoundingSphere sphere;          // 模型空间包围球
+
     // 构造函数
     Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures)
+        : Mesh(vertices, indices, textures, make_shared<Material>(textures))
+    {
+    }
+
+    // upload为false时只保留CPU侧的数据，不创建缓冲区（没有OpenGL上下文的软件渲染使用）
+    Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures, shared_ptr<Material> material, bool upload = true)
+        : VAO(0), VBO(0), EBO(0)
     {
         this->vertices = vertices;
         this->indices = indices;
         this->textures = textures;
+        this->material = material;
 
+        computeBounds();
         // 现在我们有了所有必需的数据，设置顶点缓冲区及其属性指针。
-        setupMesh();
+        if (upload)
+            setupMesh();
     }
 
     // 渲染网格
     void Draw(Shader& shader)
     {
-        // 绑定适当的纹理
-        unsigned int diffuseNr = 1;
-        unsigned int specularNr = 1;
-        unsigned int normalNr = 1;
-        unsigned int heightNr = 1;
-        for (unsigned int i = 0; i < textures.size(); i++)
-        {
-            glActiveTexture(GL_TEXTURE0 + i); // 在绑定之前激活正确的纹理单元
-            // 获取纹理编号（diffuse_textureN中的N）
-            string number;
-            string name = textures[i].type;
-            if (name == "texture_diffuse")
-                number = std::to_string(diffuseNr++);
-            else if (name == "texture_specular")
-                number = std::to_string(specularNr++); // 将无符号整数转换为字符串
-            else if (name == "texture_normal")
-                number = std::to_string(normalNr++); // 将无符号整数转换为字符串
-            else if (name == "texture_height")
-                number = std::to_string(heightNr++); // 将无符号整数转换为字符串
-
-            // 现在将采样器设置为正确的纹理单元
-            glUniform1i(glGetUniformLocation(shader.ID, (name + number).c_str()), i);
-            // 最后绑定纹理
-            glBindTexture(GL_TEXTURE_2D, textures[i].id);
-        }
+        // 绑定材质（采样器位置和纹理单元在导入时已经解析好）
+        material->Bind(shader.ID);
 
         // 绘制网格
         glBindVertexArray(VAO);
@@ -100,10 +91,77 @@ public:
         glActiveTexture(GL_TEXTURE0);
     }
 
+    // 只绘制几何体，不绑定材质（阴影等只写深度的通道使用）
+    void DrawDepth()
+    {
+        glBindVertexArray(VAO);
+        glDrawElements(GL_TRIANGLES, static_cast<unsigned int>(indices.size()), GL_UNSIGNED_INT, 0);
+        glBindVertexArray(0);
+    }
+
+    // 实例化渲染：一次绘制调用画出实例缓冲中的所有实例
+    void DrawInstanced(Shader& shader, InstanceBuffer& instanceBuffer)
+    {
+        if (instanceBuffer.count == 0)
+            return;
+        instanceBuffer.AttachTo(VAO);
+        material->Bind(shader.ID);
+
+        glBindVertexArray(VAO);
+        glDrawElementsInstanced(GL_TRIANGLES, static_cast<unsigned int>(indices.size()), GL_UNSIGNED_INT, 0, instanceBuffer.count);
+        glBindVertexArray(0);
+
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+    // 生成实例化绘制包
+    DrawPacket PacketInstanced(unsigned int program, InstanceBuffer& instanceBuffer, bool translucent = false)
+    {
+        instanceBuffer.AttachTo(VAO);
+        DrawPacket packet = Packet(program, -1, translucent);
+        packet.instances = instanceBuffer.count;
+        return packet;
+    }
+
+    // 生成该网格的绘制包，提交到渲染队列而不是立即绘制
+    DrawPacket Packet(unsigned int program, GLint modelLocation, bool translucent = false)
+    {
+        DrawPacket packet;
+        packet.vao = VAO;
+        packet.program = program;
+        packet.material = material.get();
+        packet.modelLocation = modelLocation;
+        packet.transformIndex = 0;
+        packet.mode = GL_TRIANGLES;
+        packet.count = static_cast<GLsizei>(indices.size());
+        packet.indexed = true;
+        packet.translucent = translucent;
+        packet.instances = 1;
+        return packet;
+    }
+
 private:
     // 渲染数据 
     unsigned int VBO, EBO;
 
+    // 计算包围盒和包围球（球心取包围盒中心，半径取到最远顶点的距离）
+    void computeBounds()
+    {
+        bounds = AABB();
+        for (const Vertex& v : vertices)
+            bounds.Expand(v.Position);
+        if (!bounds.Valid())
+            return;
+        sphere.center = bounds.Center();
+        float radius2 = 0.0f;
+        for (const Vertex& v : vertices)
+        {
+            glm::vec3 d = v.Position - sphere.center;
+            radius2 = std::max(radius2, glm::dot(d, d));
+        }
+        sphere.radius = sqrtf(radius2);
+    }
+
     // 初始化所有缓冲区对象/数组
     void setupMesh()
     {
@@ -12,8 +12,12 @@
 #include <assimp/postprocess.h>
 
 
-#include <user/mesh.h>
-#include <user/shader.h>
+#include <user/Mesh.h>
+#include <user/Shader.h>
+#include <user/SceneGraph.h>
+#include <user/OcclusionCuller.h>
+#include <user/GpuOcclusionCuller.h>
+#include <user/CpuProfiler.h>
 
 #include <string>
 #include <fstream>
@@ -21,6 +25,7 @@
 #include <iostream>
 #include <map>
 #include <vector>
+#include <algorithm>
 using namespace std;
 
 unsigned int TextureFromFile(const char* path, const string& directory, bool gamma = false);
@@ -30,9 +35,20 @@ class Model
 public:
     // 模型数据 
     vector<Texture> textures_loaded;	// 存储所有已加载的纹理，优化以确保纹理不会被多次加载。
+    map<unsigned int, shared_ptr<Material>> materials_loaded; // 按aiMesh::mMaterialIndex缓存的材质，相同材质的网格共享同一个对象
     vector<Mesh>    meshes;
+    // 节点层级，保留了aiNode::mTransformation
+    SceneGraph nodes;
+    // 节点对网格的一次引用：网格meshes[mesh]以节点nodes.world[node]的变换绘制
+    struct MeshInstance
+    {
+        unsigned int node;
+        unsigned int mesh;
+    };
+    vector<MeshInstance> meshInstances;
     string directory;
     bool gammaCorrection;
+    bool uploadToGpu = true;    // false时不创建缓冲区和纹理对象，纹理只记录路径（相对directory）
 
     // 构造函数，需要一个3D模型的文件路径。
     Model(string const& path, bool gamma = false) : gammaCorrection(gamma)
@@ -40,20 +56,260 @@ public:
         loadModel(path);
     }
 
-    // 绘制模型，因此绘制其所有网格
+    // 只加载CPU侧数据，不需要OpenGL上下文（软件光栅化使用）
+    Model(string const& path, bool gamma, bool upload) : gammaCorrection(gamma), uploadToGpu(upload)
+    {
+        loadModel(path);
+    }
+
+    // 构造函数，导入时直接针对给定着色器解析所有材质的uniform位置
+    Model(string const& path, Shader& shader, bool gamma = false) : gammaCorrection(gamma)
+    {
+        loadModel(path);
+        for (auto& it : materials_loaded)
+            it.second->Resolve(shader.ID);
+    }
+
+    // 绘制模型，因此绘制其所有网格（忽略节点变换，模型矩阵由调用者设置）
     void Draw(Shader& shader)
     {
         for (unsigned int i = 0; i < meshes.size(); i++)
             meshes[i].Draw(shader);
     }
 
+    // 按节点层级绘制模型：每个网格使用 model * 节点世界变换
+    void Draw(Shader& shader, const glm::mat4& model, const char* modelUniform = "model")
+    {
+        UpdateTransforms();
+        for (const MeshInstance& instance : meshInstances)
+        {
+            shader.setMat4(modelUniform, model * nodes.world[instance.node]);
+            meshes[instance.mesh].Draw(shader);
+        }
+    }
+
+    // 只写深度的绘制（阴影投射体），不绑定材质
+    void DrawDepth(Shader& shader, const glm::mat4& model, const char* modelUniform = "model")
+    {
+        UpdateTransforms();
+        for (const MeshInstance& instance : meshInstances)
+        {
+            shader.setMat4(modelUniform, model * nodes.world[instance.node]);
+            meshes[instance.mesh].DrawDepth();
+        }
+    }
+
+    // 只绘制包围盒与视锥相交的网格（阴影图集的每个面）
+    void DrawDepth(Shader& shader, const glm::mat4& model, const Frustum& frustum, const char* modelUniform = "model")
+    {
+        UpdateTransforms();
+        for (const MeshInstance& instance : meshInstances)
+        {
+            glm::mat4 world = model * nodes.world[instance.node];
+            if (!frustum.Intersects(meshes[instance.mesh].bounds.Transform(world)))
+                continue;
+            shader.setMat4(modelUniform, world);
+            meshes[instance.mesh].DrawDepth();
+        }
+    }
+
+    // 把模型的所有网格作为遮挡体光栅化到软件深度缓冲中
+    void AddOccluders(OcclusionCuller& occlusion, const glm::mat4& model)
+    {
+        UpdateTransforms();
+        for (const MeshInstance& instance : meshInstances)
+        {
+            const Mesh& mesh = meshes[instance.mesh];
+            if (mesh.vertices.empty())
+                continue;
+            occlusion.AddOccluder(&mesh.vertices[0].Position, sizeof(Vertex), mesh.indices.data(), mesh.indices.size(), model * nodes.world[instance.node]);
+        }
+    }
+
+    // 修改节点的局部变换（例如按节点做动画），下次绘制前只重新计算该节点的子树
+    void SetNodeTransform(int node, const glm::mat4& localTransform)
+    {
+        nodes.SetLocal(node, localTransform);
+    }
+
+    // 重新计算脏节点的世界变换，返回重新计算的节点数量
+    size_t UpdateTransforms()
+    {
+        return nodes.UpdateWorld();
+    }
+
+    // 实例化绘制模型：按网格分组，每个网格一次绘制调用。实例是 objectModels 中的每个物体变换
+    // 乘以引用这个网格的每个节点的世界变换，同一个网格被多个节点引用时也只画一次。
+    // 着色器需要从INSTANCE_MODEL_LOCATION/INSTANCE_NORMAL_LOCATION读取实例变换
+    void DrawInstanced(Shader& shader, const vector<glm::mat4>& objectModels)
+    {
+        updateInstanceBuffers(objectModels);
+        for (unsigned int i = 0; i < meshes.size(); i++)
+            meshes[i].DrawInstanced(shader, *instanceBuffers[i]);
+    }
+
+    // 把实例化绘制提交到渲染队列，每个网格一个绘制包。origin用于计算排序深度（通常取所有物体的中心）。
+    // 实例数据保存在模型自己的每网格实例缓冲里，同一帧内同一个模型只能实例化提交一次
+    void SubmitInstanced(RenderQueue& queue, Shader& shader, const vector<glm::mat4>& objectModels, const glm::mat4& origin, const glm::mat4& view, bool translucent = false)
+    {
+        updateInstanceBuffers(objectModels);
+        for (unsigned int i = 0; i < meshes.size(); i++)
+        {
+            if (instanceBuffers[i]->count > 0)
+                queue.Submit(PASS_SCENE, meshes[i].PacketInstanced(shader.ID, *instanceBuffers[i], translucent), origin, view);
+        }
+    }
+
+    StreamBuffer* instanceStream = nullptr;    // 实例化绘制时实例数据写入的流式缓冲，可以为空
+
+    // 把所有网格提交到渲染队列。modelUniform为着色器中模型矩阵的uniform名称
+    void Submit(RenderQueue& queue, Shader& shader, const glm::mat4& model, const glm::mat4& view, const char* modelUniform = "model", bool translucent = false)
+    {
+        UpdateTransforms();
+        GLint modelLocation = uniformLocation(shader.ID, modelUniform);
+        for (const MeshInstance& instance : meshInstances)
+            queue.Submit(PASS_SCENE, meshes[instance.mesh].Packet(shader.ID, modelLocation, translucent), model * nodes.world[instance.node], view);
+    }
+
+    // 先对所有网格的世界空间包围盒做视锥剔除，只提交可见的网格。
+    // cull中给定了occlusion时，通过视锥测试的网格再与软件深度缓冲做遮挡测试；
+    // 给定了gpuOcclusion时，再按上一帧的GPU遮挡查询结果跳过被遮挡的网格，objectId为第一个网格实例的查询编号。
+    // 给定了线程池时，变换、包围盒、剔除和提交在同一次 ParallelFor 中按切片完成，每个切片写入队列自己的列表；
+    // 只有GPU遮挡查询的记录（会创建查询对象）在主线程上串行进行
+    void Submit(RenderQueue& queue, Shader& shader, const glm::mat4& model, const glm::mat4& view, const CullContext& cull, uint32_t objectId = 0, const char* modelUniform = "model", bool translucent = false)
+    {
+        UpdateTransforms();
+        size_t n = meshInstances.size();
+        cullBatch.Resize(n);
+        cullWorld.resize(n);
+        cullBoxes.resize(n);
+        cullVisible.resize(n);
+        GLint modelLocation = uniformLocation(shader.ID, modelUniform);
+        unsigned int program = shader.ID;
+        const GpuOcclusionCuller* gpuOcclusion = cull.gpuOcclusion;
+        queue.ReserveSlices(cull.pool ? cull.pool->SliceCount() : 1);
+        auto submitRange = [&](size_t begin, size_t end, unsigned int slice)
+        {
+            for (size_t i = begin; i < end; i++)
+            {
+                cullWorld[i] = model * nodes.world[meshInstances[i].node];
+                cullBoxes[i] = meshes[meshInstances[i].mesh].bounds.Transform(cullWorld[i]);
+                cullBatch.Set(i, cullBoxes[i]);
+            }
+            if (cull.frustumCuller)
+                CullAABBs(cull.frustum, cullBatch, begin, end, cullVisible.data());
+            else
+                std::fill(cullVisible.begin() + begin, cullVisible.begin() + end, (uint8_t)1);
+            if (cull.occlusion)
+            {
+                sliceFrustumVisible[slice] += (unsigned int)std::count(cullVisible.begin() + begin, cullVisible.begin() + end, (uint8_t)1);
+                cull.occlusion->TestRange(cullBatch, cullVisible.data(), begin, end);
+            }
+            for (size_t i = begin; i < end; i++)
+            {
+                if (!cullVisible[i])
+                    continue;
+                if (gpuOcclusion && !gpuOcclusion->PeekVisible(objectId + (uint32_t)i))
+                    continue; // 被遮挡的网格本帧只做包围盒查询
+                queue.Submit(slice, PASS_SCENE, meshes[meshInstances[i].mesh].Packet(program, modelLocation, translucent), cullWorld[i], view);
+            }
+        };
+        sliceFrustumVisible.assign(cull.pool ? cull.pool->SliceCount() : 1, 0);
+        if (cull.pool)
+            cull.pool->ParallelFor(n, submitGrain, submitRange);
+        else
+            submitRange(0, n, 0);
+
+        // CPU遮挡剔除改写了cullVisible，视锥统计用遮挡测试前各切片记下的数量
+        unsigned int visible = (unsigned int)std::count(cullVisible.begin(), cullVisible.end(), (uint8_t)1);
+        unsigned int frustumVisible = visible;
+        if (cull.occlusion)
+        {
+            frustumVisible = 0;
+            for (unsigned int count : sliceFrustumVisible)
+                frustumVisible += count;
+            cull.occlusion->AddStats(frustumVisible, frustumVisible - visible);
+        }
+        if (cull.frustumCuller)
+            cull.frustumCuller->AddStats((unsigned int)n, frustumVisible);
+        if (cull.gpuOcclusion)
+        {
+            // 与上面的 PeekVisible 结果一致，这里只做统计和查询请求
+            for (size_t i = 0; i < n; i++)
+            {
+                if (!cullVisible[i])
+                    continue;
+                cull.gpuOcclusion->IsVisible(objectId + (uint32_t)i);
+                cull.gpuOcclusion->Request(objectId + (uint32_t)i, cullBoxes[i]);
+            }
+        }
+    }
+
+    size_t submitGrain = 64;    // 并行提交时每个切片的最少网格实例数
+
 private:
+    // 剔除用的临时数据，跨帧复用
+    AABBBatch cullBatch;
+    vector<uint8_t> cullVisible;
+    vector<unsigned int> sliceFrustumVisible;   // 每个切片通过视锥测试的数量
+    vector<glm::mat4> cullWorld;
+    vector<AABB> cullBoxes;
+    // scene->mMeshes下标 到 meshes下标 的映射，用于去重
+    map<unsigned int, unsigned int> meshLookup;
+    // 实例化绘制：每个网格一个实例缓冲
+    vector<unique_ptr<InstanceBuffer>> instanceBuffers;
+    vector<vector<glm::mat4>> instanceModels;  // 按网格分组的实例变换，跨帧复用
+
+    void updateInstanceBuffers(const vector<glm::mat4>& objectModels)
+    {
+        UpdateTransforms();
+        while (instanceBuffers.size() < meshes.size())
+            instanceBuffers.emplace_back(new InstanceBuffer());
+        instanceModels.resize(meshes.size());
+        for (vector<glm::mat4>& models : instanceModels)
+            models.clear();
+        for (const glm::mat4& object : objectModels)
+        {
+            for (const MeshInstance& instance : meshInstances)
+                instanceModels[instance.mesh].push_back(object * nodes.world[instance.node]);
+        }
+        for (unsigned int m = 0; m < meshes.size(); m++)
+        {
+            instanceBuffers[m]->stream = instanceStream;
+            instanceBuffers[m]->Update(instanceModels[m]);
+        }
+    }
+
+    // 提交时用到的模型矩阵uniform位置，按 程序+名称 缓存，不在每帧查询
+    struct UniformCache
+    {
+        unsigned int program;
+        string name;
+        GLint location;
+    };
+    vector<UniformCache> uniformCache;
+
+    GLint uniformLocation(unsigned int program, const char* name)
+    {
+        for (const UniformCache& u : uniformCache)
+        {
+            if (u.program == program && u.name == name)
+                return u.location;
+        }
+        GLint location = glGetUniformLocation(program, name);
+        uniformCache.push_back({ program, name, location });
+        return location;
+    }
+
     // 从文件加载受支持的ASSIMP扩展的模型，并将结果网格存储在网格向量中。
     void loadModel(string const& path)
     {
+        CPU_ZONE("Model::loadModel");
         // 通过ASSIMP读取文件
         Assimp::Importer importer;
+        CpuProfiler::Instance().BeginZone("Assimp::ReadFile");
         const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);//三角化 生成法线 翻转UV 计算切线
+        CpuProfiler::Instance().EndZone();
         // 检查错误
         if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) // 如果不为零
         {
@@ -63,31 +319,52 @@ private:
         // 获取文件路径的目录路径
         directory = path.substr(0, path.find_last_of('/'));
 
+        meshLookup.clear();
         // 递归处理ASSIMP的根节点
         processNode(scene->mRootNode, scene);
     }
 
     // 以递归方式处理节点。处理位于节点的每个单独网格，并对其子节点（如果有）重复此过程。
-    void processNode(aiNode* node, const aiScene* scene)
+    void processNode(aiNode* node, const aiScene* scene, int parentIndex = -1)
     {
+        // 记录节点及其局部变换，保留层级结构
+        int nodeIndex = nodes.AddNode(parentIndex, node->mName.C_Str(), aiToGlm(node->mTransformation));
         // 处理当前节点的每个网格
         for (unsigned int i = 0; i < node->mNumMeshes; i++)
         {
             // 节点对象仅包含索引以索引场景中的实际对象。
             // 场景包含所有数据，节点只是为了保持组织性（如节点间的关系）。
-            aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-            meshes.push_back(processMesh(mesh, scene));
+            // 多个节点引用同一个网格时只创建一份顶点数据和VAO/VBO/EBO，其余引用只是该网格的实例
+            unsigned int sceneMeshIndex = node->mMeshes[i];
+            auto found = meshLookup.find(sceneMeshIndex);
+            if (found == meshLookup.end())
+            {
+                aiMesh* mesh = scene->mMeshes[sceneMeshIndex];
+                meshes.push_back(processMesh(mesh, scene));
+                found = meshLookup.emplace(sceneMeshIndex, (unsigned int)meshes.size() - 1).first;
+            }
+            meshInstances.push_back({ (unsigned int)nodeIndex, found->second });
         }
         // 处理完所有网格（如果有）后，递归处理每个子节点
         for (unsigned int i = 0; i < node->mNumChildren; i++)
         {
-            processNode(node->mChildren[i], scene);
+            processNode(node->mChildren[i], scene, nodeIndex);
         }
 
     }
 
+    // assimp的矩阵是行主序，glm是列主序
+    static glm::mat4 aiToGlm(const aiMatrix4x4& m)
+    {
+        return glm::mat4(m.a1, m.b1, m.c1, m.d1,
+                         m.a2, m.b2, m.c2, m.d2,
+                         m.a3, m.b3, m.c3, m.d3,
+                         m.a4, m.b4, m.c4, m.d4);
+    }
+
     Mesh processMesh(aiMesh* mesh, const aiScene* scene)
     {
+        CPU_ZONE("Model::processMesh");
         // 要填充的数据
         vector<Vertex> vertices;
         vector<unsigned int> indices;
@@ -144,8 +421,23 @@ private:
             for (unsigned int j = 0; j < face.mNumIndices; j++)
                 indices.push_back(face.mIndices[j]);
         }
-        // 处理材质
-        aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
+        // 处理材质，相同材质索引的网格共享同一个Material对象
+        shared_ptr<Material> material = loadMaterial(mesh->mMaterialIndex, scene);
+        textures = material->textures;
+
+        // 返回从提取的网格数据创建的网格对象
+        return Mesh(vertices, indices, textures, material, uploadToGpu);
+    }
+
+    // 加载（或复用）给定索引的材质
+    shared_ptr<Material> loadMaterial(unsigned int materialIndex, const aiScene* scene)
+    {
+        auto found = materials_loaded.find(materialIndex);
+        if (found != materials_loaded.end())
+            return found->second;
+
+        aiMaterial* material = scene->mMaterials[materialIndex];
+        vector<Texture> textures;
         // 我们假设着色器中采样器名称的约定。每个漫反射纹理应该命名为
         // 'texture_diffuseN'，其中N是从1到MAX_SAMPLER_NUMBER的连续数字。
         // 其他纹理也是如此，以下列表总结：
@@ -166,8 +458,22 @@ private:
         std::vector<Texture> heightMaps = loadMaterialTextures(material, aiTextureType_AMBIENT, "texture_height");
         textures.insert(textures.end(), heightMaps.begin(), heightMaps.end());
 
-        // 返回从提取的网格数据创建的网格对象
-        return Mesh(vertices, indices, textures);
+        aiString name;
+        material->Get(AI_MATKEY_NAME, name);
+        shared_ptr<Material> result = make_shared<Material>(textures, name.C_Str());
+
+        // 常量参数，着色器中没有对应uniform的参数会在解析时被丢弃
+        aiColor3D color(1.0f, 1.0f, 1.0f);
+        if (material->Get(AI_MATKEY_COLOR_DIFFUSE, color) == AI_SUCCESS)
+            result->SetVec3("material_diffuse", glm::vec3(color.r, color.g, color.b));
+        if (material->Get(AI_MATKEY_COLOR_SPECULAR, color) == AI_SUCCESS)
+            result->SetVec3("material_specular", glm::vec3(color.r, color.g, color.b));
+        float shininess = 0.0f;
+        if (material->Get(AI_MATKEY_SHININESS, shininess) == AI_SUCCESS)
+            result->SetFloat("material_shininess", shininess);
+
+        materials_loaded[materialIndex] = result;
+        return result;
     }
 
     // 检查给定类型的所有材质纹理，如果尚未加载纹理，则加载它们。
@@ -193,7 +499,7 @@ private:
             if (!skip)
             {   // 如果纹理尚未加载，则加载它
                 Texture texture;
-                texture.id = TextureFromFile(str.C_Str(), this->directory);
+                texture.id = uploadToGpu ? TextureFromFile(str.C_Str(), this->directory) : 0;
                 texture.type = typeName;
                 texture.path = str.C_Str();
                 textures.push_back(texture);
@@ -207,6 +513,7 @@ private:
 
 unsigned int TextureFromFile(const char* path, const string& directory, bool gamma)
 {
+    CPU_ZONE("TextureFromFile");
     string filename = string(path);
     filename = directory + '/' + filename;
 
@@ -0,0 +1,303 @@
+#ifndef OCCLUSION_CULLER_H
+#define OCCLUSION_CULLER_H
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <cstdint>
+#include <cfloat>
+#include <cmath>
+#include <algorithm>
+using namespace std;
+
+#include <user/Culling.h>
+#include <user/ThreadPool.h>
+
+// CPU软件光栅化遮挡剔除。
+// 选中的遮挡体以低分辨率光栅化到一个CPU深度缓冲中（按行分带并行，行内用SIMD一次处理4个像素），
+// 然后生成分块的最远深度（层次深度），候选物体的包围盒先与分块比较，再逐像素细化。
+// 完全在CPU上执行，结果是确定的，可以在没有GPU的机器上测试。
+// 深度约定：NDC的z映射到[0,1]，越小越近。
+class OcclusionCuller
+{
+public:
+    static const int TILE_SIZE = 8;     // 层次深度的分块大小
+
+    struct Stats
+    {
+        unsigned int occluderTriangles;
+        unsigned int tested;
+        unsigned int occluded;
+    };
+    Stats stats = {};           // 本帧累计的统计
+    Stats lastStats = {};       // 上一帧的统计，供UI显示
+
+    int width, height;
+    vector<float> depth;        // 逐像素深度
+    vector<float> tileMaxDepth; // 每个分块内最远的深度
+
+    OcclusionCuller(int width = 256, int height = 192) : width(width), height(height)
+    {
+        tilesX = (width + TILE_SIZE - 1) / TILE_SIZE;
+        tilesY = (height + TILE_SIZE - 1) / TILE_SIZE;
+        depth.assign((size_t)width * height, 1.0f);
+        tileMaxDepth.assign((size_t)tilesX * tilesY, 1.0f);
+    }
+
+    // 每帧开始时调用：清空深度缓冲并设置视图投影矩阵
+    void Begin(const glm::mat4& viewProjection)
+    {
+        this->viewProjection = viewProjection;
+        std::fill(depth.begin(), depth.end(), 1.0f);
+        screenVerts.clear();
+        lastStats = stats;
+        stats = {};
+    }
+
+    // 添加一个遮挡体。positions按stride字节跨度读取，indices为三角形索引
+    void AddOccluder(const void* positions, size_t stride, const unsigned int* indices, size_t indexCount, const glm::mat4& model)
+    {
+        glm::mat4 mvp = viewProjection * model;
+        const uint8_t* base = (const uint8_t*)positions;
+        for (size_t i = 0; i + 2 < indexCount; i += 3)
+        {
+            ScreenTriangle tri;
+            bool valid = true;
+            for (int k = 0; k < 3 && valid; k++)
+            {
+                const glm::vec3& p = *(const glm::vec3*)(base + indices[i + k] * stride);
+                glm::vec4 clip = mvp * glm::vec4(p, 1.0f);
+                // 跨越近平面的三角形直接丢弃：少画遮挡体只会让剔除更保守，不会出错
+                if (clip.w < 1e-4f)
+                {
+                    valid = false;
+                    break;
+                }
+                glm::vec3 ndc = glm::vec3(clip) / clip.w;
+                tri.x[k] = (ndc.x * 0.5f + 0.5f) * width;
+                tri.y[k] = (ndc.y * 0.5f + 0.5f) * height;
+                tri.z[k] = ndc.z * 0.5f + 0.5f;
+            }
+            if (valid)
+                screenVerts.push_back(tri);
+        }
+    }
+
+    // 光栅化所有遮挡体并生成层次深度。给定线程池时按行分带并行
+    void Rasterize(ThreadPool* pool = nullptr)
+    {
+        stats.occluderTriangles = (unsigned int)screenVerts.size();
+        if (pool)
+        {
+            pool->ParallelFor((size_t)height, TILE_SIZE, [this](size_t begin, size_t end, unsigned int)
+            {
+                rasterizeBand((int)begin, (int)end);
+            });
+            pool->ParallelFor((size_t)tilesY, 1, [this](size_t begin, size_t end, unsigned int)
+            {
+                buildTiles((int)begin, (int)end);
+            });
+        }
+        else
+        {
+            rasterizeBand(0, height);
+            buildTiles(0, tilesY);
+        }
+    }
+
+    // 测试一个世界空间包围盒是否可能可见
+    bool TestAABB(const AABB& box)
+    {
+        stats.tested++;
+        bool visible = testAABB(box.Center(), box.Extents());
+        if (!visible)
+            stats.occluded++;
+        return visible;
+    }
+
+    // 测试batch中[begin, end)范围内visible仍为1的项，被遮挡的置为0。只读，可以在多个线程上同时调用，
+    // 不更新统计（由调用者汇总后用 AddStats 记录）
+    void TestRange(const AABBBatch& batch, uint8_t* visible, size_t begin, size_t end) const
+    {
+        for (size_t i = begin; i < end; i++)
+        {
+            if (!visible[i])
+                continue;
+            glm::vec3 c(batch.centerX[i], batch.centerY[i], batch.centerZ[i]);
+            glm::vec3 e(batch.extentX[i], batch.extentY[i], batch.extentZ[i]);
+            visible[i] = testAABB(c, e) ? 1 : 0;
+        }
+    }
+
+    void AddStats(unsigned int tested, unsigned int occluded)
+    {
+        stats.tested += tested;
+        stats.occluded += occluded;
+    }
+
+    // 对整批包围盒做测试，只测试visible中仍为1的项，被遮挡的置为0
+    void Test(const AABBBatch& batch, vector<uint8_t>& visible, ThreadPool* pool = nullptr)
+    {
+        size_t n = batch.Size();
+        uint8_t* out = visible.data();
+        unsigned int before = 0;
+        for (size_t i = 0; i < n; i++)
+            before += out[i];
+        if (pool)
+            pool->ParallelFor(n, 1024, [&](size_t begin, size_t end, unsigned int) { TestRange(batch, out, begin, end); });
+        else
+            TestRange(batch, out, 0, n);
+        unsigned int after = 0;
+        for (size_t i = 0; i < n; i++)
+            after += out[i];
+        stats.tested += before;
+        stats.occluded += before - after;
+    }
+
+private:
+    struct ScreenTriangle
+    {
+        float x[3], y[3], z[3];
+    };
+    int tilesX, tilesY;
+    glm::mat4 viewProjection = glm::mat4(1.0f);
+    vector<ScreenTriangle> screenVerts;
+
+    // 光栅化所有三角形落在[y0, y1)行内的部分，不同的带互不重叠，因此无需同步
+    void rasterizeBand(int y0, int y1)
+    {
+        for (const ScreenTriangle& t : screenVerts)
+        {
+            float x0 = t.x[0], yA = t.y[0], z0 = t.z[0];
+            float x1 = t.x[1], yB = t.y[1], z1 = t.z[1];
+            float x2 = t.x[2], yC = t.y[2], z2 = t.z[2];
+            float area = (x1 - x0) * (yC - yA) - (yB - yA) * (x2 - x0);
+            if (fabsf(area) < 1e-8f)
+                continue;
+            if (area < 0.0f)
+            {
+                // 统一为逆时针，遮挡体两面都写入
+                std::swap(x1, x2); std::swap(yB, yC); std::swap(z1, z2);
+                area = -area;
+            }
+            int minX = std::max(0, (int)floorf(std::min(x0, std::min(x1, x2))));
+            int maxX = std::min(width - 1, (int)ceilf(std::max(x0, std::max(x1, x2))));
+            int minY = std::max(y0, (int)floorf(std::min(yA, std::min(yB, yC))));
+            int maxY = std::min(y1 - 1, (int)ceilf(std::max(yA, std::max(yB, yC))));
+            if (minX > maxX || minY > maxY)
+                continue;
+
+            // 边函数 E(p) = A*px + B*py + C，三条边都>=0的像素中心在三角形内
+            float A0 = yB - yC, B0 = x2 - x1, C0 = x1 * yC - x2 * yB;
+            float A1 = yC - yA, B1 = x0 - x2, C1 = x2 * yA - x0 * yC;
+            float A2 = yA - yB, B2 = x1 - x0, C2 = x0 * yB - x1 * yA;
+            // 深度平面 z(p) = zA*px + zB*py + zC
+            float invArea = 1.0f / area;
+            float zA = (A0 * z0 + A1 * z1 + A2 * z2) * invArea;
+            float zB = (B0 * z0 + B1 * z1 + B2 * z2) * invArea;
+            float zC = (C0 * z0 + C1 * z1 + C2 * z2) * invArea;
+
+            for (int y = minY; y <= maxY; y++)
+            {
+                float py = y + 0.5f;
+                float* row = &depth[(size_t)y * width];
+                int x = minX;
+#if CULLING_USE_SSE
+                const __m128 offsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+                const __m128 zero = _mm_setzero_ps();
+                for (; x + 4 <= maxX + 1; x += 4)
+                {
+                    __m128 px = _mm_add_ps(_mm_set1_ps((float)x), offsets);
+                    __m128 e0 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(A0), px), _mm_set1_ps(B0 * py + C0));
+                    __m128 e1 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(A1), px), _mm_set1_ps(B1 * py + C1));
+                    __m128 e2 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(A2), px), _mm_set1_ps(B2 * py + C2));
+                    __m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(e0, zero), _mm_cmpge_ps(e1, zero)), _mm_cmpge_ps(e2, zero));
+                    if (_mm_movemask_ps(inside) == 0)
+                        continue;
+                    __m128 z = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(zA), px), _mm_set1_ps(zB * py + zC));
+                    __m128 old = _mm_loadu_ps(row + x);
+                    __m128 closer = _mm_min_ps(old, z);
+                    _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, closer), _mm_andnot_ps(inside, old)));
+                }
+#endif
+                for (; x <= maxX; x++)
+                {
+                    float px = x + 0.5f;
+                    if (A0 * px + B0 * py + C0 < 0.0f || A1 * px + B1 * py + C1 < 0.0f || A2 * px + B2 * py + C2 < 0.0f)
+                        continue;
+                    float z = zA * px + zB * py + zC;
+                    if (z < row[x])
+                        row[x] = z;
+                }
+            }
+        }
+    }
+
+    // 计算[ty0, ty1)行分块的最远深度
+    void buildTiles(int ty0, int ty1)
+    {
+        for (int ty = ty0; ty < ty1; ty++)
+        {
+            for (int tx = 0; tx < tilesX; tx++)
+            {
+                float farthest = 0.0f;
+                int yEnd = std::min(height, (ty + 1) * TILE_SIZE);
+                int xEnd = std::min(width, (tx + 1) * TILE_SIZE);
+                for (int y = ty * TILE_SIZE; y < yEnd; y++)
+                {
+                    const float* row = &depth[(size_t)y * width];
+                    for (int x = tx * TILE_SIZE; x < xEnd; x++)
+                        farthest = std::max(farthest, row[x]);
+                }
+                tileMaxDepth[(size_t)ty * tilesX + tx] = farthest;
+            }
+        }
+    }
+
+    // 包围盒的屏幕矩形中只要有一个像素的深度不比包围盒最近点更近，就认为可能可见
+    bool testAABB(const glm::vec3& center, const glm::vec3& extents) const
+    {
+        float minX = FLT_MAX, minY = FLT_MAX, maxX = -FLT_MAX, maxY = -FLT_MAX, nearest = FLT_MAX;
+        for (int i = 0; i < 8; i++)
+        {
+            glm::vec3 corner = center + extents * glm::vec3((i & 1) ? 1.0f : -1.0f, (i & 2) ? 1.0f : -1.0f, (i & 4) ? 1.0f : -1.0f);
+            glm::vec4 clip = viewProjection * glm::vec4(corner, 1.0f);
+            if (clip.w < 1e-4f)
+                return true; // 包围盒跨越近平面，保守地认为可见
+            glm::vec3 ndc = glm::vec3(clip) / clip.w;
+            float sx = (ndc.x * 0.5f + 0.5f) * width;
+            float sy = (ndc.y * 0.5f + 0.5f) * height;
+            minX = std::min(minX, sx); maxX = std::max(maxX, sx);
+            minY = std::min(minY, sy); maxY = std::max(maxY, sy);
+            nearest = std::min(nearest, ndc.z * 0.5f + 0.5f);
+        }
+        int x0 = std::max(0, (int)floorf(minX));
+        int x1 = std::min(width - 1, (int)ceilf(maxX));
+        int y0 = std::max(0, (int)floorf(minY));
+        int y1 = std::min(height - 1, (int)ceilf(maxY));
+        if (x0 > x1 || y0 > y1)
+            return true; // 完全在屏幕外的交给视锥剔除处理
+        // 先按分块粗测，再在可能可见的分块里逐像素细测
+        for (int ty = y0 / TILE_SIZE; ty <= y1 / TILE_SIZE; ty++)
+        {
+            for (int tx = x0 / TILE_SIZE; tx <= x1 / TILE_SIZE; tx++)
+            {
+                if (nearest > tileMaxDepth[(size_t)ty * tilesX + tx])
+                    continue; // 整个分块都比包围盒更近
+                int py0 = std::max(y0, ty * TILE_SIZE), py1 = std::min(y1, ty * TILE_SIZE + TILE_SIZE - 1);
+                int px0 = std::max(x0, tx * TILE_SIZE), px1 = std::min(x1, tx * TILE_SIZE + TILE_SIZE - 1);
+                for (int y = py0; y <= py1; y++)
+                {
+                    const float* row = &depth[(size_t)y * width];
+                    for (int x = px0; x <= px1; x++)
+                    {
+                        if (nearest <= row[x])
+                            return true;
+                    }
+                }
+            }
+        }
+        return false;
+    }
+};
+#endif
@@ -0,0 +1,300 @@
+#ifndef REGRESSION_H
+#define REGRESSION_H
+
+#include <glm/glm.hpp>
+#include <stb_image.h>
+
+#include <user/Camera.h>
+#include <user/ImageIO.h>
+
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <vector>
+#include <string>
+#include <cmath>
+#include <cstdlib>
+#include <cstdint>
+#include <algorithm>
+using namespace std;
+
+// 图像回归测试：在固定的相机位置和场景时间渲染一组典型画面（立方体阵列、背包、点光源照亮的地面），
+// 与基准图像逐像素比较。颜色差用 YIQ 空间的加权距离（与 pixelmatch 相同的感知度量），
+// 超过 threshold 的像素记为不同，不同像素的比例超过 maxDiffRatio 时该用例失败。
+// 每个用例写出实际图像和差异图（淡化的灰度底图上用红色标出不同的像素）。
+// 剔除、LOD、状态缓存之类的性能改动不应该改变画面，改动前后各跑一次即可发现意外的变化。
+// --update-golden 用当前结果覆盖基准图像。
+class Regression
+{
+public:
+    struct Options
+    {
+        bool enabled = false;
+        string goldenDir;                   // 空时按后端使用 regression/gl 或 regression/software
+        bool updateGolden = false;
+        float threshold = 0.1f;             // 单个像素的颜色差阈值（0~1，相对于YIQ最大距离）
+        float maxDiffRatio = 0.001f;        // 允许不同的像素比例
+        int settleFrames = 8;               // 每个用例渲染的帧数，取最后一帧（让TAA历史和遮挡查询稳定）
+    };
+
+    struct Case
+    {
+        const char* name;
+        glm::vec3 position;
+        float yaw;
+        float pitch;
+        float time;                         // 场景时间，决定物体旋转和光源位置
+    };
+
+    // 识别一个命令行参数，返回消耗的参数个数，不认识时返回0
+    static int ParseArg(int argc, char** argv, int i, Options& options)
+    {
+        string arg = argv[i];
+        bool hasValue = i + 1 < argc && argv[i + 1][0] != '-';
+        if (arg == "--regression")
+        {
+            options.enabled = true;
+            if (hasValue)
+            {
+                options.goldenDir = argv[i + 1];
+                return 2;
+            }
+            return 1;
+        }
+        if (arg == "--update-golden")
+        {
+            options.updateGolden = true;
+            return 1;
+        }
+        if (!hasValue)
+            return 0;
+        if (arg == "--pixel-threshold")
+            options.threshold = std::min(std::max((float)atof(argv[i + 1]), 0.0f), 1.0f);
+        else if (arg == "--max-diff")
+            options.maxDiffRatio = std::max(0.0f, (float)atof(argv[i + 1]) / 100.0f);
+        else if (arg == "--settle-frames")
+            options.settleFrames = std::max(1, atoi(argv[i + 1]));
+        else
+            return 0;
+        return 2;
+    }
+
+    static const char* Usage()
+    {
+        return "  --regression [基准目录]     渲染固定画面并与基准图像比较，有差异时返回1（输出到 --output 目录）\n"
+            "  --update-golden             用本次结果覆盖基准图像\n"
+            "  --pixel-threshold 值        单个像素的感知颜色差阈值 0~1（默认0.1）\n"
+            "  --max-diff 百分比           允许不同的像素比例（默认0.1）\n"
+            "  --settle-frames N           每个画面渲染的帧数（默认8）\n";
+    }
+
+    static vector<Case> DefaultCases()
+    {
+        return {
+            { "cube_field", glm::vec3(0.0f, 0.0f, 3.0f), -90.0f, 0.0f, 0.0f },
+            { "backpack", glm::vec3(2.0f, 0.1f, 1.2f), -90.0f, -4.0f, 0.5f },
+            { "lights", glm::vec3(0.0f, 5.0f, 5.0f), -90.0f, -50.0f, 3.0f },
+        };
+    }
+
+    // 比较结果
+    struct Result
+    {
+        bool sizeMatches = true;
+        size_t differentPixels = 0;
+        float diffRatio = 0.0f;
+        float maxDelta = 0.0f;              // 最大的感知颜色差（0~1）
+    };
+
+    // 基准图像在构造时加载：程序的其余部分按翻转加载纹理，必须在那之前构造
+    Regression(const Options& options, const string& outputDir, int width, int height)
+        : options(options), outputDir(outputDir), width(width), height(height), cases(DefaultCases())
+    {
+        std::error_code error;
+        std::filesystem::create_directories(outputDir, error);
+        if (options.updateGolden)
+            std::filesystem::create_directories(options.goldenDir, error);
+        stbi_set_flip_vertically_on_load(false);
+        goldens.resize(cases.size());
+        for (size_t i = 0; i < cases.size(); i++)
+        {
+            int w = 0, h = 0, channels = 0;
+            unsigned char* data = stbi_load(goldenPath(i).c_str(), &w, &h, &channels, 3);
+            if (!data)
+                continue;
+            goldens[i].width = w;
+            goldens[i].height = h;
+            goldens[i].rgb.assign(data, data + (size_t)w * h * 3);
+            stbi_image_free(data);
+        }
+        std::cout << "回归测试: " << cases.size() << " 个画面，基准目录 " << options.goldenDir << (options.updateGolden ? "（更新基准）" : "") << std::endl;
+    }
+
+    int TotalFrames() const { return (int)cases.size() * options.settleFrames; }
+    bool Finished() const { return frame >= TotalFrames(); }
+
+    const Case& Current() const { return cases[std::min((size_t)(frame / options.settleFrames), cases.size() - 1)]; }
+
+    // 用例内的所有帧场景静止，只有TAA抖动在变化
+    float SceneTime() const { return Current().time; }
+
+    void ApplyCamera(Camera& camera) const
+    {
+        const Case& c = Current();
+        camera.SetPose(c.position, c.yaw, c.pitch, ZOOM);
+    }
+
+    // 本帧是否是一个用例的第一帧（调用方需要清掉上一个用例留下的TAA历史、遮挡查询和阴影缓存）
+    bool CaseStart() const { return frame % options.settleFrames == 0; }
+
+    // 本帧是否是当前用例的最后一帧（需要把图像交给 EndFrame）
+    bool CaptureFrame() const { return frame % options.settleFrames == options.settleFrames - 1; }
+
+    // 每帧结束时调用。rgb 为 width*height 的RGB图像，第一行在顶部，只在 CaptureFrame() 为真时需要
+    void EndFrame(const uint8_t* rgb)
+    {
+        if (CaptureFrame() && rgb)
+            check(frame / options.settleFrames, rgb);
+        frame++;
+    }
+
+    // 打印汇总并写出报告，返回进程退出码
+    int Finish()
+    {
+        ofstream report(outputDir + "/regression_report.csv");
+        report << "case,status,different_pixels,diff_ratio,max_delta\n";
+        int failed = 0;
+        for (const Outcome& o : outcomes)
+        {
+            report << o.name << "," << o.status << "," << o.result.differentPixels << "," << o.result.diffRatio << "," << o.result.maxDelta << "\n";
+            if (!o.passed)
+                failed++;
+        }
+        if ((int)outcomes.size() < (int)cases.size())
+        {
+            std::cout << "回归测试: 只完成了 " << outcomes.size() << "/" << cases.size() << " 个画面" << std::endl;
+            failed += (int)cases.size() - (int)outcomes.size();
+        }
+        std::cout << "回归测试: " << cases.size() - failed << " 通过, " << failed << " 失败，结果在 " << outputDir << std::endl;
+        return failed > 0 ? 1 : 0;
+    }
+
+    // 感知颜色差，diff 非空时写出差异图（RGB）
+    static Result Compare(const uint8_t* actual, const uint8_t* golden, int width, int height, float threshold, vector<uint8_t>* diff)
+    {
+        Result result;
+        size_t count = (size_t)width * height;
+        // YIQ距离的最大值是35215
+        const float maxDelta = 35215.0f;
+        float limit = maxDelta * threshold * threshold;
+        if (diff)
+            diff->resize(count * 3);
+        for (size_t i = 0; i < count; i++)
+        {
+            const uint8_t* a = actual + i * 3;
+            const uint8_t* b = golden + i * 3;
+            float delta = colorDelta(a, b);
+            bool different = delta > limit;
+            if (different)
+                result.differentPixels++;
+            result.maxDelta = std::max(result.maxDelta, delta);
+            if (diff)
+            {
+                uint8_t* out = &(*diff)[i * 3];
+                if (different)
+                {
+                    out[0] = 255;
+                    out[1] = 0;
+                    out[2] = 0;
+                }
+                else
+                {
+                    // 淡化的灰度底图，便于看出差异在画面中的位置
+                    float y = 0.29889531f * b[0] + 0.58662247f * b[1] + 0.11448223f * b[2];
+                    uint8_t gray = (uint8_t)(255.0f + (y - 255.0f) * 0.1f);
+                    out[0] = out[1] = out[2] = gray;
+                }
+            }
+        }
+        result.diffRatio = count > 0 ? (float)result.differentPixels / count : 0.0f;
+        result.maxDelta = sqrtf(result.maxDelta / maxDelta);
+        return result;
+    }
+
+    const Options& GetOptions() const { return options; }
+
+private:
+    struct Golden
+    {
+        int width = 0;
+        int height = 0;
+        vector<uint8_t> rgb;
+    };
+
+    struct Outcome
+    {
+        string name;
+        string status;
+        bool passed;
+        Result result;
+    };
+
+    Options options;
+    string outputDir;
+    int width, height;
+    vector<Case> cases;
+    vector<Golden> goldens;
+    vector<Outcome> outcomes;
+    int frame = 0;
+
+    string goldenPath(size_t index) const
+    {
+        return options.goldenDir + "/" + cases[index].name + ".png";
+    }
+
+    void check(size_t index, const uint8_t* rgb)
+    {
+        const Case& c = cases[index];
+        ImageIO::WritePng(outputDir + "/" + c.name + ".png", width, height, 3, rgb);
+        Outcome outcome = { c.name, "", false, Result() };
+        if (options.updateGolden)
+        {
+            outcome.passed = ImageIO::WritePng(goldenPath(index), width, height, 3, rgb);
+            outcome.status = outcome.passed ? "updated" : "write_failed";
+        }
+        else if (goldens[index].rgb.empty())
+            outcome.status = "missing_golden";
+        else if (goldens[index].width != width || goldens[index].height != height)
+        {
+            outcome.result.sizeMatches = false;
+            outcome.status = "size_mismatch";
+        }
+        else
+        {
+            vector<uint8_t> diff;
+            outcome.result = Compare(rgb, goldens[index].rgb.data(), width, height, options.threshold, &diff);
+            outcome.passed = outcome.result.diffRatio <= options.maxDiffRatio;
+            outcome.status = outcome.passed ? "pass" : "fail";
+            if (outcome.result.differentPixels > 0)
+                ImageIO::WritePng(outputDir + "/" + c.name + "_diff.png", width, height, 3, diff.data());
+        }
+        std::cout << "  " << (outcome.passed ? "[通过] " : "[失败] ") << c.name << "  " << outcome.status;
+        if (outcome.status == "pass" || outcome.status == "fail")
+            std::cout << "  不同像素 " << outcome.result.differentPixels << " (" << outcome.result.diffRatio * 100.0f << "%)  最大色差 " << outcome.result.maxDelta;
+        std::cout << std::endl;
+        outcomes.push_back(outcome);
+    }
+
+    // pixelmatch 的YIQ加权距离的平方
+    static float colorDelta(const uint8_t* a, const uint8_t* b)
+    {
+        float dr = (float)a[0] - b[0];
+        float dg = (float)a[1] - b[1];
+        float db = (float)a[2] - b[2];
+        float y = dr * 0.29889531f + dg * 0.58662247f + db * 0.11448223f;
+        float i = dr * 0.59597799f - dg * 0.27417610f - db * 0.32180189f;
+        float q = dr * 0.21147017f - dg * 0.52261711f + db * 0.31114694f;
+        return 0.5053f * y * y + 0.299f * i * i + 0.1957f * q * q;
+    }
+};
+#endif
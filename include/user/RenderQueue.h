@@ -0,0 +1,360 @@
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <cassert>
+using namespace std;
+
+#include <user/Material.h>
+#include <user/CommandList.h>
+#include <user/GLCommandBackend.h>
+#include <user/ThreadPool.h>
+
+// 渲染通道，数值越小越先绘制
+enum RenderPass
+{
+    PASS_SCENE = 0,     // 场景几何体
+    PASS_OVERLAY = 1    // 叠加在场景上的物体（如灯光标记）
+};
+
+// 紧凑的绘制包：执行一次绘制所需的全部信息
+struct DrawPacket
+{
+    unsigned int vao;
+    unsigned int program;
+    Material* material;         // 可以为空
+    GLint modelLocation;        // 模型矩阵uniform位置，-1表示不设置
+    unsigned int transformIndex;// 在队列变换数组中的下标
+    GLenum mode;
+    GLsizei count;
+    bool indexed;               // true使用glDrawElements，否则glDrawArrays
+    bool translucent;           // 是否需要混合
+    GLsizei instances;          // 实例数量，1表示普通绘制（实例属性由VAO上挂接的InstanceBuffer提供）
+};
+
+// 基于64位排序键的渲染队列。每帧提交绘制包，基数排序后执行。
+//
+// 排序键布局（高位在前）:
+//   不透明: [pass:4][translucent=0:1][program:16][material:16][depth:16][未使用:11]  深度从近到远
+//   半透明: [pass:4][translucent=1:1][~depth:16][program:16][material:16][未使用:11] 深度从远到近
+// 程序名和材质编号必须小于65536，超出时排序会把不同的程序混在一起
+class RenderQueue
+{
+public:
+    // 统计数据，每次Execute后更新
+    struct Stats
+    {
+        unsigned int draws;
+        unsigned int programSwitches;
+        unsigned int materialSwitches;
+        unsigned int vaoSwitches;
+        unsigned int triangles;     // 提交的三角形数（含实例）
+    };
+    Stats stats = {};
+
+    float maxDepth = 100.0f;    // 深度量化范围，与投影矩阵的远裁剪面一致
+    size_t recordGrain = 256;   // 并行录制时每个切片的最少绘制数
+
+    // 生成排序键。viewDepth为视空间中到相机的距离
+    uint64_t MakeKey(RenderPass pass, bool translucent, unsigned int program, unsigned int materialId, float viewDepth) const
+    {
+        assert(program <= 0xFFFF && materialId <= 0xFFFF);
+        uint64_t depth = quantizeDepth(viewDepth);
+        uint64_t key = (uint64_t)(pass & 0xF) << 60;
+        if (!translucent)
+        {
+            key |= (uint64_t)(program & 0xFFFF) << 43;
+            key |= (uint64_t)(materialId & 0xFFFF) << 27;
+            key |= depth << 11;
+        }
+        else
+        {
+            key |= (uint64_t)1 << 59;
+            key |= (uint64_t)(0xFFFF - depth) << 43; // 远处的先画
+            key |= (uint64_t)(program & 0xFFFF) << 27;
+            key |= (uint64_t)(materialId & 0xFFFF) << 11;
+        }
+        return key;
+    }
+
+    // 提交一次绘制。packet.transformIndex由队列填充
+    void Submit(uint64_t key, DrawPacket packet, const glm::mat4& model)
+    {
+        packet.transformIndex = (unsigned int)transforms.size();
+        transforms.push_back(model);
+        keys.push_back(key);
+        packets.push_back(packet);
+    }
+
+    // 便捷接口：根据视图矩阵计算深度并生成排序键
+    void Submit(RenderPass pass, DrawPacket packet, const glm::mat4& model, const glm::mat4& view)
+    {
+        Submit(makeKey(pass, packet, model, view), packet, model);
+    }
+
+    // 并行提交：在 ParallelFor 中每个切片写入自己的列表，互不加锁。
+    // 调用前用 ReserveSlices 准备好切片数量，Sort 时按切片顺序合并到主列表，结果与线程数无关
+    void ReserveSlices(size_t sliceCount)
+    {
+        if (sliceSubmits.size() < sliceCount)
+            sliceSubmits.resize(sliceCount);
+    }
+
+    void Submit(unsigned int slice, RenderPass pass, DrawPacket packet, const glm::mat4& model, const glm::mat4& view)
+    {
+        SubmitList& list = sliceSubmits[slice];
+        list.keys.push_back(makeKey(pass, packet, model, view));
+        list.packets.push_back(packet);
+        list.transforms.push_back(model);
+    }
+
+    // 清空本帧的提交，保留容量以避免每帧重新分配
+    void Clear()
+    {
+        keys.clear();
+        packets.clear();
+        transforms.clear();
+        for (SubmitList& list : sliceSubmits)
+            list.Clear();
+    }
+
+    size_t Size() const
+    {
+        size_t size = keys.size();
+        for (const SubmitList& list : sliceSubmits)
+            size += list.keys.size();
+        return size;
+    }
+
+    // 对排序键做基数排序，得到绘制顺序
+    void Sort()
+    {
+        mergeSlices();
+        size_t n = keys.size();
+        order.resize(n);
+        sortedKeys.resize(n);
+        tmpOrder.resize(n);
+        tmpKeys.resize(n);
+        for (size_t i = 0; i < n; i++)
+        {
+            order[i] = (uint32_t)i;
+            sortedKeys[i] = keys[i];
+        }
+        RadixSort(sortedKeys.data(), order.data(), tmpKeys.data(), tmpOrder.data(), n);
+    }
+
+    // 把排序后[begin, end)范围内的绘制录制到命令列表中，只在状态变化时切换程序、材质和VAO。
+    // 不调用任何GL函数，可以在工作线程上执行；每个切片从未知状态开始
+    void Record(CommandList& list, size_t begin, size_t end, Stats& recordStats, int& finalBlend) const
+    {
+        recordStats = {};
+        unsigned int currentProgram = 0;
+        Material* currentMaterial = nullptr;
+        unsigned int currentVAO = 0;
+        int blending = -1;
+        for (size_t i = begin; i < end; i++)
+        {
+            const DrawPacket& p = packets[order[i]];
+            if (p.program != currentProgram)
+            {
+                list.CmdUseProgram(p.program);
+                currentProgram = p.program;
+                currentMaterial = nullptr; // 采样器uniform属于程序状态，需要重新绑定材质
+                recordStats.programSwitches++;
+            }
+            if (p.material != currentMaterial)
+            {
+                if (p.material)
+                    list.CmdBindMaterial(p.material, p.program);
+                currentMaterial = p.material;
+                recordStats.materialSwitches++;
+            }
+            if (p.vao != currentVAO)
+            {
+                list.CmdBindVertexArray(p.vao);
+                currentVAO = p.vao;
+                recordStats.vaoSwitches++;
+            }
+            if ((int)p.translucent != blending)
+            {
+                list.CmdSetBlend(p.translucent);
+                blending = p.translucent;
+            }
+            if (p.modelLocation >= 0)
+                list.CmdUniformMat4(p.modelLocation, transforms[p.transformIndex]);
+            if (p.indexed)
+                list.CmdDrawIndexed(p.mode, p.count, p.instances);
+            else
+                list.CmdDrawArrays(p.mode, 0, p.count, p.instances);
+            recordStats.draws++;
+            if (p.mode == GL_TRIANGLES)
+                recordStats.triangles += (unsigned int)(p.count / 3) * (unsigned int)p.instances;
+        }
+        finalBlend = blending;
+    }
+
+    // 执行本帧的所有绘制。给定线程池时各切片在工作线程上并行录制，
+    // 然后在当前（GL上下文）线程上按顺序回放
+    void Execute(ThreadPool* pool = nullptr)
+    {
+        size_t sliceCount = pool ? pool->SliceCount() : 1;
+        if (commandLists.size() < sliceCount)
+        {
+            commandLists.resize(sliceCount);
+            sliceStats.resize(sliceCount);
+            sliceBlend.resize(sliceCount);
+        }
+        for (CommandList& list : commandLists)
+            list.Reset();
+
+        if (pool)
+        {
+            pool->ParallelFor(order.size(), recordGrain, [this](size_t begin, size_t end, unsigned int slice)
+            {
+                Record(commandLists[slice], begin, end, sliceStats[slice], sliceBlend[slice]);
+            });
+        }
+        else
+        {
+            Record(commandLists[0], 0, order.size(), sliceStats[0], sliceBlend[0]);
+        }
+
+        // 回放之后的混合状态：最后一个设置过混合的切片决定
+        int blendAfter = -1;
+        stats = {};
+        for (size_t i = 0; i < commandLists.size(); i++)
+        {
+            if (commandLists[i].Empty())
+                continue;
+            if (sliceBlend[i] >= 0)
+                blendAfter = sliceBlend[i];
+            stats.draws += sliceStats[i].draws;
+            stats.programSwitches += sliceStats[i].programSwitches;
+            stats.materialSwitches += sliceStats[i].materialSwitches;
+            stats.vaoSwitches += sliceStats[i].vaoSwitches;
+            stats.triangles += sliceStats[i].triangles;
+        }
+
+        bool blendBefore = glIsEnabled(GL_BLEND) == GL_TRUE;
+        GLCommandBackend::Execute(commandLists);
+        glBindVertexArray(0);
+        glActiveTexture(GL_TEXTURE0);
+        // 恢复调用前的混合状态，只在队列确实改变了它时才调用
+        if (blendAfter >= 0 && (blendAfter != 0) != blendBefore)
+        {
+            if (blendBefore)
+                glEnable(GL_BLEND);
+            else
+                glDisable(GL_BLEND);
+        }
+    }
+
+    // LSD基数排序，每次处理8位，共8趟。所有键在某个字节上相同时跳过该趟
+    static void RadixSort(uint64_t* keys, uint32_t* values, uint64_t* tmpKeys, uint32_t* tmpValues, size_t n)
+    {
+        uint64_t* srcK = keys;
+        uint32_t* srcV = values;
+        uint64_t* dstK = tmpKeys;
+        uint32_t* dstV = tmpValues;
+        for (unsigned int pass = 0; pass < 8; pass++)
+        {
+            unsigned int shift = pass * 8;
+            size_t counts[256];
+            memset(counts, 0, sizeof(counts));
+            for (size_t i = 0; i < n; i++)
+                counts[(srcK[i] >> shift) & 0xFF]++;
+            if (n == 0 || counts[(srcK[0] >> shift) & 0xFF] == n)
+                continue; // 该字节全部相同，排序结果不变
+            size_t offset = 0;
+            for (unsigned int b = 0; b < 256; b++)
+            {
+                size_t c = counts[b];
+                counts[b] = offset;
+                offset += c;
+            }
+            for (size_t i = 0; i < n; i++)
+            {
+                size_t dst = counts[(srcK[i] >> shift) & 0xFF]++;
+                dstK[dst] = srcK[i];
+                dstV[dst] = srcV[i];
+            }
+            std::swap(srcK, dstK);
+            std::swap(srcV, dstV);
+        }
+        if (srcK != keys)
+        {
+            memcpy(keys, srcK, n * sizeof(uint64_t));
+            memcpy(values, srcV, n * sizeof(uint32_t));
+        }
+    }
+
+private:
+    struct SubmitList
+    {
+        vector<uint64_t> keys;
+        vector<DrawPacket> packets;
+        vector<glm::mat4> transforms;
+
+        void Clear()
+        {
+            keys.clear();
+            packets.clear();
+            transforms.clear();
+        }
+    };
+
+    vector<uint64_t> keys;
+    vector<DrawPacket> packets;
+    vector<glm::mat4> transforms;
+    vector<SubmitList> sliceSubmits;    // 并行提交时每个切片的列表
+    // 排序用的缓冲区，跨帧复用
+    vector<uint32_t> order;
+    vector<uint64_t> sortedKeys;
+    vector<uint32_t> tmpOrder;
+    vector<uint64_t> tmpKeys;
+    // 每个切片独享的命令列表和统计，跨帧复用
+    vector<CommandList> commandLists;
+    vector<Stats> sliceStats;
+    vector<int> sliceBlend;     // 每个切片录制结束时的混合状态，-1为没有设置过
+
+    uint64_t makeKey(RenderPass pass, const DrawPacket& packet, const glm::mat4& model, const glm::mat4& view) const
+    {
+        float viewDepth = -(view * model[3]).z;
+        unsigned int materialId = packet.material ? packet.material->sortId : 0;
+        return MakeKey(pass, packet.translucent, packet.program, materialId, viewDepth);
+    }
+
+    // 把各切片提交的绘制追加到主列表，变换下标重新编号
+    void mergeSlices()
+    {
+        for (SubmitList& list : sliceSubmits)
+        {
+            for (size_t i = 0; i < list.keys.size(); i++)
+            {
+                DrawPacket packet = list.packets[i];
+                packet.transformIndex = (unsigned int)transforms.size();
+                transforms.push_back(list.transforms[i]);
+                keys.push_back(list.keys[i]);
+                packets.push_back(packet);
+            }
+            list.Clear();
+        }
+    }
+
+    uint64_t quantizeDepth(float viewDepth) const
+    {
+        float t = viewDepth / maxDepth;
+        if (t < 0.0f)
+            t = 0.0f;
+        if (t > 1.0f)
+            t = 1.0f;
+        return (uint64_t)(t * 65535.0f);
+    }
+};
+#endif
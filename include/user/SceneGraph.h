@@ -0,0 +1,93 @@
+#ifndef SCENE_GRAPH_H
+#define SCENE_GRAPH_H
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <cstdint>
+using namespace std;
+
+// 场景图：保留节点层级，所有数据以结构数组的形式连续存放。
+// 节点按深度优先先序排列，保证父节点总在子节点之前，且每个节点的子树是一段连续区间 [i, subtreeEnd[i])。
+// 修改局部变换只会把节点标记为脏，UpdateWorld只重新计算脏节点所在的子树，开销与移动的部分成正比。
+class SceneGraph
+{
+public:
+    vector<int> parent;             // 父节点下标，根节点为-1
+    vector<unsigned int> subtreeEnd;// 子树结束位置（不含）
+    vector<glm::mat4> local;        // 局部变换
+    vector<glm::mat4> world;        // 世界变换（相对于图的根）
+    vector<string> names;
+
+    size_t Size() const
+    {
+        return parent.size();
+    }
+
+    // 添加节点，必须按深度优先先序添加：parentIndex的子树必须是当前最后一段
+    int AddNode(int parentIndex, const string& name, const glm::mat4& localTransform)
+    {
+        int index = (int)parent.size();
+        parent.push_back(parentIndex);
+        subtreeEnd.push_back(index + 1);
+        local.push_back(localTransform);
+        world.push_back(parentIndex >= 0 ? world[parentIndex] * localTransform : localTransform);
+        names.push_back(name);
+        // 所有祖先的子树都向后扩展到新节点
+        for (int p = parentIndex; p >= 0; p = parent[p])
+            subtreeEnd[p] = index + 1;
+        return index;
+    }
+
+    int Find(const string& name) const
+    {
+        for (size_t i = 0; i < names.size(); i++)
+        {
+            if (names[i] == name)
+                return (int)i;
+        }
+        return -1;
+    }
+
+    // 修改局部变换并标记为脏
+    void SetLocal(int node, const glm::mat4& localTransform)
+    {
+        local[node] = localTransform;
+        dirty.push_back((unsigned int)node);
+    }
+
+    bool Dirty() const
+    {
+        return !dirty.empty();
+    }
+
+    // 重新计算所有脏子树的世界变换，返回重新计算的节点数量
+    size_t UpdateWorld()
+    {
+        if (dirty.empty())
+            return 0;
+        // 按下标排序后，被前面的子树包含的脏节点可以直接跳过
+        std::sort(dirty.begin(), dirty.end());
+        size_t updated = 0;
+        unsigned int coveredEnd = 0;
+        for (unsigned int node : dirty)
+        {
+            if (node < coveredEnd)
+                continue;
+            unsigned int end = subtreeEnd[node];
+            // 先序排列保证区间内每个节点的父节点要么已经在本次循环中算好，要么是子树根的父节点（本来就是最新的）
+            for (unsigned int i = node; i < end; i++)
+                world[i] = parent[i] >= 0 ? world[parent[i]] * local[i] : local[i];
+            updated += end - node;
+            coveredEnd = end;
+        }
+        dirty.clear();
+        return updated;
+    }
+
+private:
+    vector<unsigned int> dirty;     // 局部变换被修改过的节点
+};
+#endif
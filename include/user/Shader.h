@@ -7,6 +7,10 @@
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <vector>
+#include <algorithm>
+
+#include <user/CpuProfiler.h>
 
 class Shader
 {
@@ -16,33 +20,16 @@ public:
     // ------------------------------------------------------------------------
     Shader(const char* vertexPath, const char* fragmentPath)
     {
-        // 1. 从文件路径加载着色器文本
+        CPU_ZONE("Shader::Compile");
+        // 1. 从文件路径加载着色器文本，展开其中的 #include
         std::string vertexCode;
         std::string fragmentCode;
-        std::ifstream vShaderFile;
-        std::ifstream fShaderFile;
-        // ensure ifstream objects can throw exceptions:
-        vShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-        fShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-        try
-        {
-            // open files
-            vShaderFile.open(vertexPath);
-            fShaderFile.open(fragmentPath);
-            std::stringstream vShaderStream, fShaderStream;
-            // read file's buffer contents into streams
-            vShaderStream << vShaderFile.rdbuf();
-            fShaderStream << fShaderFile.rdbuf();
-            // close file handlers
-            vShaderFile.close();
-            fShaderFile.close();
-            // convert stream into string
-            vertexCode = vShaderStream.str();
-            fragmentCode = fShaderStream.str();
-        }
-        catch (std::ifstream::failure& e)
+        LoadSource(vertexPath, vertexCode);
+        LoadSource(fragmentPath, fragmentCode);
+        if (!GLAD_GL_VERSION_4_3)
         {
-            std::cout << "ERROR::SHADER::着色器文件没有被成功读取: " << e.what() << std::endl;
+            MakeLegacy(vertexCode);
+            MakeLegacy(fragmentCode);
         }
         const char* vShaderCode = vertexCode.c_str();
         const char* fShaderCode = fragmentCode.c_str();
@@ -68,6 +55,13 @@ public:
         glDeleteShader(vertex);
         glDeleteShader(fragment);
     }
+    // 指定uniform块的绑定点（GLSL 330 不能在着色器里写 binding）
+    void BindUniformBlock(const char* name, unsigned int binding) const
+    {
+        unsigned int block = glGetUniformBlockIndex(ID, name);
+        if (block != GL_INVALID_INDEX)
+            glUniformBlockBinding(ID, block, binding);
+    }
     // 激活着色器程序
     // ------------------------------------------------------------------------
     void use()
@@ -115,7 +109,75 @@ public:
         glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, glm::value_ptr(value));
     }
 
+    // 读取着色器源码并展开 #include "文件名"（路径相对于当前文件所在的目录）。
+    // 同一个文件只展开一次，相当于自带 #pragma once；被包含的文件不能有 #version。
+    // 展开处插入 #line，编译错误中的 "文件编号(行号)" 里编号0是主文件，之后按第一次包含的顺序编号
+    static bool LoadSource(const std::string& path, std::string& source)
+    {
+        std::vector<std::string> included;
+        source.clear();
+        return appendSource(path, source, included);
+    }
+
+    // 在没有 GL 4.3 的上下文中使用 #version 430 core 的着色器：降为 330 core 并定义 LEGACY_GL，
+    // 着色器中用 #ifdef LEGACY_GL 把着色器存储缓冲换成纹理缓冲（见 lighting.glsl）
+    static void MakeLegacy(std::string& source)
+    {
+        const std::string modern = "#version 430 core";
+        if (source.compare(0, modern.size(), modern) == 0)
+            source.replace(0, modern.size(), "#version 330 core\n#define LEGACY_GL\n#line 2 0");
+    }
+
 private:
+    static bool appendSource(const std::string& path, std::string& source, std::vector<std::string>& included)
+    {
+        std::ifstream file(path);
+        if (!file)
+        {
+            std::cout << "ERROR::SHADER::着色器文件没有被成功读取: " << path << std::endl;
+            return false;
+        }
+        included.push_back(path);
+        const std::string fileIndex = std::to_string(included.size() - 1);
+        const std::string directory = path.substr(0, path.find_last_of("/\\") + 1);
+        std::string line;
+        int lineNumber = 0;
+        while (std::getline(file, line))
+        {
+            lineNumber++;
+            std::string name;
+            if (!parseInclude(line, name))
+            {
+                source += line;
+                source += '\n';
+                continue;
+            }
+            std::string child = directory + name;
+            if (std::find(included.begin(), included.end(), child) == included.end())
+            {
+                source += "#line 1 " + std::to_string(included.size()) + "\n";
+                if (!appendSource(child, source, included))
+                    return false;
+            }
+            source += "#line " + std::to_string(lineNumber + 1) + " " + fileIndex + "\n";
+        }
+        return true;
+    }
+
+    // 识别 #include "name" 这一行（允许前后有空白）
+    static bool parseInclude(const std::string& line, std::string& name)
+    {
+        size_t p = line.find_first_not_of(" \t");
+        if (p == std::string::npos || line.compare(p, 8, "#include") != 0)
+            return false;
+        size_t open = line.find('"', p + 8);
+        size_t close = open == std::string::npos ? std::string::npos : line.find('"', open + 1);
+        if (close == std::string::npos)
+            return false;
+        name = line.substr(open + 1, close - open - 1);
+        return true;
+    }
+
     // 检查是否有编译错误
     // ------------------------------------------------------------------------
     void checkCompileErrors(unsigned int shader, std::string type)
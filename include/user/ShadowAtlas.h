@@ -0,0 +1,476 @@
+#ifndef SHADOW_ATLAS_H
+#define SHADOW_ATLAS_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <vector>
+#include <functional>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+using namespace std;
+
+#include "imgui/imstb_rectpack.h"
+#include <user/Shader.h>
+#include <user/ClusteredLighting.h>
+#include <user/StreamBuffer.h>
+#include <user/GLCompat.h>
+#include <user/Culling.h>
+
+#define SHADOW_ATLAS_TEXTURE_UNIT 9
+#define SHADOW_TILE_BINDING 4
+#define SHADOW_TILE_TEXTURE_UNIT 13    // 没有着色器存储缓冲时图块放在纹理缓冲中
+
+// 阴影图集中的一个图块（点光源的一个立方体面，或者聚光灯），与着色器中的std430布局一致
+struct ShadowTile
+{
+    glm::mat4 viewProjection;
+    glm::vec4 atlasRect;        // xy 图块在图集中的uv偏移，zw uv尺寸
+};
+
+// 点光源和聚光灯共用的阴影图集。
+// 所有局部光的阴影画在一张深度纹理上，用 imstb_rectpack 分配位置：点光源占一个3x2的块（立方体的6个面），聚光灯占一个方块。
+// 每个光源的分辨率按它在屏幕上的覆盖范围取2的幂，尺寸等级变化时才重新打包。
+// 调度器每帧只重绘 maxUpdatesPerFrame 个光源，按 从未绘制/位置变化/覆盖范围*等待帧数 的优先级选择，
+// 其余光源继续使用上次绘制的结果，因此阴影光源再多，每帧的通道数也是固定的。
+class ShadowAtlas
+{
+public:
+    int atlasSize;
+    int minTileSize = 64;
+    int maxTileSize = 512;
+    int maxShadowedLights = 16;         // 同时拥有阴影的光源上限（按覆盖范围选择）
+    int maxUpdatesPerFrame = 2;         // 每帧最多重绘的光源数
+    StreamBuffer* stream = nullptr;     // 设置后图块数据从流式缓冲中上传
+    bool enabled = true;
+
+    int spotShadowTile = -1;            // 聚光灯使用的图块下标，-1表示没有
+
+    struct Stats
+    {
+        unsigned int shadowedLights;
+        unsigned int updatedLights;
+        unsigned int passes;            // 本帧绘制的图块数
+        unsigned int repacks;           // 累计重新打包的次数
+        unsigned int unpacked;          // 图集放不下、本帧没有阴影的光源数
+    };
+    Stats stats = {};
+
+    ShadowAtlas(int atlasSize = 4096) : atlasSize(atlasSize), depthShader("Shader/shadowDepth.vs", "Shader/shadowDepth.fs")
+    {
+        lightViewProjectionLocation = glGetUniformLocation(depthShader.ID, "lightViewProjection");
+        glGenTextures(1, &atlas);
+        glBindTexture(GL_TEXTURE_2D, atlas);
+        GLCompat::TexStorage2D(GL_TEXTURE_2D, GL_DEPTH_COMPONENT24, atlasSize, atlasSize);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        glGenFramebuffers(1, &FBO);
+        glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, atlas, 0);
+        glDrawBuffer(GL_NONE);
+        glReadBuffer(GL_NONE);
+        glClear(GL_DEPTH_BUFFER_BIT);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+        glGenBuffers(1, &tileSSBO);
+        packNodes.resize(atlasSize);
+    }
+
+    ~ShadowAtlas()
+    {
+        glDeleteTextures(1, &atlas);
+        glDeleteFramebuffers(1, &FBO);
+        glDeleteBuffers(1, &tileSSBO);
+    }
+
+    ShadowAtlas(const ShadowAtlas&) = delete;
+    ShadowAtlas& operator=(const ShadowAtlas&) = delete;
+
+    // 设置本帧的聚光灯，range为影响半径，angle为外圈半角
+    void SetSpotLight(const glm::vec3& position, const glm::vec3& direction, float angle, float range)
+    {
+        spot.position = position;
+        spot.direction = glm::normalize(direction);
+        spot.angle = angle;
+        spot.radius = range;
+        hasSpot = true;
+    }
+
+    // 选择阴影光源、分配图集、安排本帧的重绘，并把图块下标写回 lights[i].shadow.x。
+    // 光源在 lights 中的下标需要在帧之间保持稳定。必须在 ClusteredLighting::Update 之前调用
+    void Update(vector<ClusterPointLight>& lights, const glm::vec3& cameraPosition, float fovY, float screenHeight)
+    {
+        stats.shadowedLights = stats.updatedLights = stats.passes = stats.unpacked = 0;
+        frame++;
+        for (ClusterPointLight& light : lights)
+            light.shadow.x = -1.0f;
+        spotShadowTile = -1;
+        scheduled.clear();
+        tiles.clear();
+        if (!enabled)
+        {
+            hasSpot = false;
+            return;
+        }
+
+        // 1. 收集候选光源并估算屏幕覆盖范围
+        candidates.clear();
+        float tanHalfFov = tanf(fovY * 0.5f);
+        auto coverage = [&](const glm::vec3& position, float radius)
+        {
+            float distance = glm::length(position - cameraPosition);
+            if (distance <= radius)
+                return 1.0f;
+            return std::min(1.0f, radius / (distance * tanHalfFov));
+        };
+        for (size_t i = 0; i < lights.size(); i++)
+        {
+            if (lights[i].shadow.y <= 0.0f)
+                continue;
+            Caster c;
+            c.id = (int)i;
+            c.position = glm::vec3(lights[i].positionRadius);
+            c.radius = lights[i].positionRadius.w;
+            c.coverage = coverage(c.position, c.radius);
+            candidates.push_back(c);
+        }
+        if (hasSpot)
+        {
+            spot.id = SPOT_ID;
+            spot.coverage = coverage(spot.position, spot.radius);
+            candidates.push_back(spot);
+            hasSpot = false;
+        }
+        std::sort(candidates.begin(), candidates.end(), [](const Caster& a, const Caster& b) { return a.coverage > b.coverage; });
+        if ((int)candidates.size() > maxShadowedLights)
+            candidates.resize(maxShadowedLights);
+
+        // 2. 分辨率按覆盖的像素数取2的幂
+        for (Caster& c : candidates)
+        {
+            float pixels = c.coverage * screenHeight;
+            int size = minTileSize;
+            while (size < maxTileSize && size < pixels)
+                size *= 2;
+            c.size = size;
+        }
+        pack();
+        // 缩小到最小尺寸仍然放不下的光源没有图块，按没有阴影处理
+        size_t packedCount = 0;
+        for (Caster& c : candidates)
+        {
+            if (c.rect.x >= 0)
+                candidates[packedCount++] = c;
+        }
+        stats.unpacked = (unsigned int)(candidates.size() - packedCount);
+        candidates.resize(packedCount);
+
+        // 3. 调度：挑出优先级最高的若干光源重绘
+        for (Caster& c : candidates)
+        {
+            State& state = stateFor(c.id);
+            bool moved = glm::length(c.position - state.position) > 0.01f || (c.id == SPOT_ID && glm::dot(c.direction, state.direction) < 0.999f);
+            float age = (float)(frame - state.lastUpdate);
+            c.priority = !state.valid ? 1e9f + c.coverage : c.coverage * age * (moved ? 4.0f : 1.0f);
+        }
+        vector<Caster*> order;
+        for (Caster& c : candidates)
+            order.push_back(&c);
+        std::sort(order.begin(), order.end(), [](const Caster* a, const Caster* b) { return a->priority > b->priority; });
+        for (int i = 0; i < (int)order.size() && i < maxUpdatesPerFrame; i++)
+        {
+            Caster& c = *order[i];
+            State& state = stateFor(c.id);
+            state.position = c.position;
+            state.direction = c.direction;
+            state.rect = c.rect;
+            state.faces = buildFaces(c);
+            state.valid = true;
+            state.lastUpdate = frame;
+            scheduled.push_back(c.id);
+            stats.updatedLights++;
+        }
+
+        // 4. 为已经有阴影内容的光源输出图块
+        for (Caster& c : candidates)
+        {
+            State& state = stateFor(c.id);
+            if (!state.valid)
+                continue;
+            int first = (int)tiles.size();
+            for (size_t face = 0; face < state.faces.size(); face++)
+                tiles.push_back({ state.faces[face], tileRect(state.rect, (int)face) });
+            if (c.id == SPOT_ID)
+                spotShadowTile = first;
+            else
+                lights[c.id].shadow.x = (float)first;
+            stats.shadowedLights++;
+        }
+
+        tileBuffer = tileSSBO;
+        tileOffset = 0;
+        tileBytes = std::max<size_t>(1, tiles.size()) * sizeof(ShadowTile);
+        if (!GLCompat::StorageBuffers())
+        {
+            tileTexture.Upload(tiles.data(), tiles.size() * sizeof(ShadowTile));
+            return;
+        }
+        StreamBuffer::Allocation a = stream ? stream->Allocate(tileBytes, stream->StorageAlignment()) : StreamBuffer::Allocation();
+        if (a)
+        {
+            if (!tiles.empty())
+                memcpy(a.data, tiles.data(), tiles.size() * sizeof(ShadowTile));
+            tileBuffer = stream->Buffer();
+            tileOffset = a.offset;
+        }
+        else
+        {
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, tileSSBO);
+            glBufferData(GL_SHADER_STORAGE_BUFFER, tileBytes, tiles.empty() ? NULL : tiles.data(), GL_STREAM_DRAW);
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        }
+    }
+
+    // 绘制本帧安排的阴影图块。drawCasters 使用传入的深度着色器绘制与当前面的视锥相交的投射体，
+    // 点光源的6个面各调用一次，投射体只需要画进它所在的面
+    void Render(const function<void(Shader&, const Frustum&)>& drawCasters)
+    {
+        if (scheduled.empty())
+            return;
+        GLint previousFBO, viewport[4];
+        glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousFBO);
+        glGetIntegerv(GL_VIEWPORT, viewport);
+        glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+        glEnable(GL_DEPTH_TEST);
+        glEnable(GL_SCISSOR_TEST);
+        glEnable(GL_POLYGON_OFFSET_FILL);
+        glPolygonOffset(1.5f, 2.0f);
+        depthShader.use();
+        for (int id : scheduled)
+        {
+            const State& state = stateFor(id);
+            for (size_t face = 0; face < state.faces.size(); face++)
+            {
+                int x, y, size;
+                tilePixels(state.rect, (int)face, x, y, size);
+                glViewport(x, y, size, size);
+                glScissor(x, y, size, size);
+                glClear(GL_DEPTH_BUFFER_BIT);
+                glUniformMatrix4fv(lightViewProjectionLocation, 1, GL_FALSE, glm::value_ptr(state.faces[face]));
+                drawCasters(depthShader, Frustum::FromMatrix(state.faces[face]));
+                stats.passes++;
+            }
+        }
+        glDisable(GL_POLYGON_OFFSET_FILL);
+        glDisable(GL_SCISSOR_TEST);
+        glBindFramebuffer(GL_FRAMEBUFFER, previousFBO);
+        glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+    }
+
+    // 所有图块的内容作废，下一次 Update 按优先级重绘（受 maxUpdatesPerFrame 限制）
+    void Invalidate()
+    {
+        for (State& state : pointStates)
+            state.valid = false;
+        spotState.valid = false;
+    }
+
+    // 设置接收阴影的着色器的uniform并绑定图集和图块缓冲，调用前着色器必须已经激活
+    void Bind(unsigned int program) const
+    {
+        glUniform1i(glGetUniformLocation(program, "shadowAtlas"), SHADOW_ATLAS_TEXTURE_UNIT);
+        glUniform1i(glGetUniformLocation(program, "spotShadowTile"), spotShadowTile);
+        glActiveTexture(GL_TEXTURE0 + SHADOW_ATLAS_TEXTURE_UNIT);
+        glBindTexture(GL_TEXTURE_2D, atlas);
+        glActiveTexture(GL_TEXTURE0);
+        if (GLCompat::StorageBuffers())
+        {
+            glBindBufferRange(GL_SHADER_STORAGE_BUFFER, SHADOW_TILE_BINDING, tileBuffer, tileOffset, (GLsizeiptr)tileBytes);
+            return;
+        }
+        glUniform1i(glGetUniformLocation(program, "shadowTileBuffer"), SHADOW_TILE_TEXTURE_UNIT);
+        tileTexture.Bind(SHADOW_TILE_TEXTURE_UNIT);
+    }
+
+    static const int SPOT_ID = -2;      // 打包布局中聚光灯的编号，点光源用自己的下标
+
+    // 在 atlasSize 见方的图集中为 (光源, 单面尺寸) 列表分配区域，返回与 layout 一一对应的像素区域 x y 宽 高。
+    // 点光源占一个3x2的块，聚光灯占一个方块；放不下时把所有尺寸减半后重试（不小于 minTileSize/2），
+    // 重试次数用完仍然放不下时保留已经放下的光源，其余的区域记为 (-1)。nodes 是 imstb_rectpack 的工作区，长度应为 atlasSize
+    static vector<glm::ivec4> PackLayout(const vector<pair<int, int>>& layout, int atlasSize, int minTileSize, vector<stbrp_node>& nodes)
+    {
+        vector<glm::ivec4> packed(layout.size(), glm::ivec4(0));
+        vector<int> sizes;
+        for (const pair<int, int>& entry : layout)
+            sizes.push_back(entry.second);
+        for (int attempt = 0; attempt < 8; attempt++)
+        {
+            vector<stbrp_rect> rects(layout.size());
+            for (size_t i = 0; i < layout.size(); i++)
+            {
+                bool point = layout[i].first != SPOT_ID;
+                rects[i].id = (int)i;
+                rects[i].w = sizes[i] * (point ? 3 : 1);
+                rects[i].h = sizes[i] * (point ? 2 : 1);
+            }
+            stbrp_context context;
+            stbrp_init_target(&context, atlasSize, atlasSize, nodes.data(), (int)nodes.size());
+            bool all = rects.empty() || stbrp_pack_rects(&context, rects.data(), (int)rects.size());
+            if (all || attempt == 7)
+            {
+                for (const stbrp_rect& r : rects)
+                    packed[r.id] = r.was_packed ? glm::ivec4(r.x, r.y, r.w, r.h) : glm::ivec4(-1);
+                break;
+            }
+            for (int& size : sizes)
+                size = std::max(minTileSize / 2, size / 2);
+        }
+        return packed;
+    }
+
+private:
+    struct Caster
+    {
+        int id = -1;                    // 光源下标，聚光灯为SPOT_ID
+        glm::vec3 position = glm::vec3(0.0f);
+        glm::vec3 direction = glm::vec3(0.0f, -1.0f, 0.0f);
+        float angle = 0.0f;
+        float radius = 0.0f;
+        float coverage = 0.0f;
+        float priority = 0.0f;
+        int size = 0;                   // 单个面的边长
+        glm::ivec4 rect = glm::ivec4(0);// 在图集中的像素区域 x y 宽 高
+    };
+    struct State
+    {
+        bool valid = false;             // 当前图块中是否有与 faces 对应的内容
+        glm::vec3 position = glm::vec3(0.0f);
+        glm::vec3 direction = glm::vec3(0.0f);
+        glm::ivec4 rect = glm::ivec4(0);
+        vector<glm::mat4> faces;        // 绘制时使用的矩阵
+        uint64_t lastUpdate = 0;
+    };
+
+    Shader depthShader;
+    GLint lightViewProjectionLocation;
+    unsigned int atlas, FBO, tileSSBO;
+    // 本帧图块数据实际所在的位置（流式缓冲或 tileSSBO）
+    unsigned int tileBuffer = 0;
+    GLintptr tileOffset = 0;
+    size_t tileBytes = 0;
+    TextureBuffer tileTexture{ GL_RGBA32F };   // 每个图块5个texel
+    uint64_t frame = 0;
+    Caster spot;
+    bool hasSpot = false;
+    vector<Caster> candidates;
+    vector<State> pointStates;          // 按光源下标
+    State spotState;
+    vector<int> scheduled;
+    vector<ShadowTile> tiles;
+    vector<stbrp_node> packNodes;
+    vector<pair<int, int>> packedLayout;// 上次打包时的 (光源, 尺寸)，没变化就不重新打包
+    vector<glm::ivec4> packedRects;
+
+    State& stateFor(int id)
+    {
+        if (id == SPOT_ID)
+            return spotState;
+        if (id >= (int)pointStates.size())
+            pointStates.resize(id + 1);
+        return pointStates[id];
+    }
+
+    const State& stateFor(int id) const
+    {
+        return id == SPOT_ID ? spotState : pointStates[id];
+    }
+
+    // 布局变化时重新打包（见 PackLayout），放不下的光源区域为 (-1)，调用方按没有阴影处理
+    void pack()
+    {
+        vector<pair<int, int>> layout;
+        for (const Caster& c : candidates)
+            layout.push_back({ c.id, c.size });
+        std::sort(layout.begin(), layout.end());
+        if (layout != packedLayout)
+        {
+            vector<pair<int, int>> oldLayout = packedLayout;
+            vector<glm::ivec4> oldRects = packedRects;
+            packedLayout = layout;
+            packedRects = PackLayout(layout, atlasSize, minTileSize, packNodes);
+            stats.repacks++;
+
+            // 只有在新旧布局中都占据同一块区域的光源，图块内容才仍然有效
+            auto rectOf = [](const vector<pair<int, int>>& entries, const vector<glm::ivec4>& rects, int id)
+            {
+                for (size_t i = 0; i < entries.size(); i++)
+                {
+                    if (entries[i].first == id)
+                        return rects[i];
+                }
+                return glm::ivec4(-1);
+            };
+            for (int id = SPOT_ID; id < (int)pointStates.size(); id++)
+            {
+                if (id == -1)
+                    continue;
+                State& state = stateFor(id);
+                glm::ivec4 before = rectOf(oldLayout, oldRects, id);
+                glm::ivec4 after = rectOf(packedLayout, packedRects, id);
+                if (before.x < 0 || after.x < 0 || before != after || state.rect != after)
+                    state.valid = false;
+            }
+        }
+        for (Caster& c : candidates)
+        {
+            size_t i = std::lower_bound(packedLayout.begin(), packedLayout.end(), pair<int, int>(c.id, c.size)) - packedLayout.begin();
+            c.rect = packedRects[i];
+        }
+    }
+
+    // 每个面的像素区域：点光源的6个面按3列2行排列
+    static void tilePixels(const glm::ivec4& rect, int face, int& x, int& y, int& size)
+    {
+        size = rect.z == rect.w ? rect.z : rect.z / 3;
+        x = rect.x + (face % 3) * size;
+        y = rect.y + (face / 3) * size;
+    }
+
+    glm::vec4 tileRect(const glm::ivec4& rect, int face) const
+    {
+        int x, y, size;
+        tilePixels(rect, face, x, y, size);
+        return glm::vec4((float)x, (float)y, (float)size, (float)size) / (float)atlasSize;
+    }
+
+    // 点光源：立方体6个面（+X -X +Y -Y +Z -Z）；聚光灯：一个透视投影
+    static vector<glm::mat4> buildFaces(const Caster& c)
+    {
+        vector<glm::mat4> faces;
+        float nearPlane = 0.05f;
+        if (c.id == SPOT_ID)
+        {
+            glm::vec3 up = fabsf(c.direction.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+            float fov = std::min(glm::radians(170.0f), 2.0f * c.angle);
+            faces.push_back(glm::perspective(fov, 1.0f, nearPlane, c.radius) * glm::lookAt(c.position, c.position + c.direction, up));
+            return faces;
+        }
+        glm::mat4 projection = glm::perspective(glm::radians(90.0f), 1.0f, nearPlane, c.radius);
+        const glm::vec3 dirs[6] = { {1, 0, 0}, {-1, 0, 0}, {0, 1, 0}, {0, -1, 0}, {0, 0, 1}, {0, 0, -1} };
+        const glm::vec3 ups[6] = { {0, -1, 0}, {0, -1, 0}, {0, 0, 1}, {0, 0, -1}, {0, -1, 0}, {0, -1, 0} };
+        for (int i = 0; i < 6; i++)
+            faces.push_back(projection * glm::lookAt(c.position, c.position + dirs[i], ups[i]));
+        return faces;
+    }
+};
+#endif
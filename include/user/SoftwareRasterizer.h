@@ -0,0 +1,1146 @@
+#ifndef SOFTWARE_RASTERIZER_H
+#define SOFTWARE_RASTERIZER_H
+
+#include <glm/glm.hpp>
+#include <stb_image.h>
+
+#include <vector>
+#include <string>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <cstdint>
+#include <cstring>
+#include <cfloat>
+#include <cmath>
+#include <algorithm>
+using namespace std;
+
+#include <user/Culling.h>
+#include <user/Mesh.h>
+#include <user/ClusteredLighting.h>
+#include <user/ThreadPool.h>
+
+// 软件渲染用的纹理：RGBA8，双线性过滤、重复环绕（与GL纹理的 GL_REPEAT + GL_LINEAR 一致，不做mipmap）
+class SoftwareTexture
+{
+public:
+    int width = 0;
+    int height = 0;
+    vector<uint8_t> texels;
+
+    // 行顺序取决于 stbi_set_flip_vertically_on_load 的当前设置，与同一设置下上传的GL纹理一致
+    bool Load(const string& path)
+    {
+        int channels;
+        unsigned char* data = stbi_load(path.c_str(), &width, &height, &channels, 4);
+        if (!data)
+        {
+            width = height = 0;
+            texels.clear();
+            return false;
+        }
+        texels.assign(data, data + (size_t)width * height * 4);
+        stbi_image_free(data);
+        return true;
+    }
+
+    bool Valid() const { return width > 0 && height > 0; }
+
+    glm::vec4 Sample(glm::vec2 uv) const
+    {
+        if (!Valid())
+            return glm::vec4(1.0f);
+        float x = uv.x * width - 0.5f;
+        float y = uv.y * height - 0.5f;
+        float fx = floorf(x);
+        float fy = floorf(y);
+        float tx = x - fx;
+        float ty = y - fy;
+        int x0 = Wrap((int)fx, width);
+        int y0 = Wrap((int)fy, height);
+        int x1 = x0 + 1 == width ? 0 : x0 + 1;
+        int y1 = y0 + 1 == height ? 0 : y0 + 1;
+        glm::vec4 top = glm::mix(fetch(x0, y0), fetch(x1, y0), tx);
+        glm::vec4 bottom = glm::mix(fetch(x0, y1), fetch(x1, y1), tx);
+        return glm::mix(top, bottom, ty);
+    }
+
+    // 双线性过滤的向量化版本（SoftwareRasterizer 中4个像素一起采样）直接取texel
+    static int Wrap(int i, int n)
+    {
+        i %= n;
+        return i < 0 ? i + n : i;
+    }
+
+    const uint8_t* Texel(int x, int y) const
+    {
+        return &texels[((size_t)y * width + x) * 4];
+    }
+
+private:
+    glm::vec4 fetch(int x, int y) const
+    {
+        const uint8_t* t = Texel(x, y);
+        return glm::vec4(t[0], t[1], t[2], t[3]) * (1.0f / 255.0f);
+    }
+};
+
+// 对应 userShader.fs 中 Material 的参数
+struct SoftwareMaterial
+{
+    const SoftwareTexture* baseTexture = nullptr;   // 空表示白色
+    glm::vec3 baseColor = glm::vec3(1.0f);
+    glm::vec3 specular = glm::vec3(1.0f);
+    float shininess = 32.0f;
+    bool lit = true;                                // false时直接输出 纹理*baseColor（backpack.fs、lightShader.fs）
+};
+
+// 对应 userShader.fs 的灯光uniform，点光源直接使用分簇光照的数据格式
+struct SoftwareLights
+{
+    glm::vec3 dirColor = glm::vec3(0.0f);
+    glm::vec3 dirSpecular = glm::vec3(0.0f);
+    glm::vec3 dirDirection = glm::vec3(0.0f, -1.0f, 0.0f);
+
+    glm::vec3 spotColor = glm::vec3(0.0f);
+    glm::vec3 spotSpecular = glm::vec3(0.0f);
+    glm::vec3 spotPosition = glm::vec3(0.0f);
+    glm::vec3 spotDirection = glm::vec3(0.0f, -1.0f, 0.0f);
+    float spotAngle = 0.0f;
+    float spotSmoothness = 0.0f;
+    glm::vec3 spotAttenuation = glm::vec3(1.0f, 0.0f, 0.0f);
+
+    vector<ClusterPointLight> pointLights;          // positionRadius.w 为影响半径，按图块剔除时使用
+    float hueShift = 0.0f;                          // ourTime / ourColor.x
+};
+
+// 基于图块的多线程软件光栅化，在没有GPU的机器上渲染与GL路径相同的网格和光照模型，也用来生成参考图像。
+// 每帧的流程：
+//   Draw  : 顶点变换（线程池并行），记录索引和材质
+//   End   : 1. 三角形建立：近平面和保护带裁剪、双面、1/16像素吸附，按图块分箱（每个切片各自的箱子，按切片顺序合并，结果与线程数无关）
+//           2. 逐图块光栅化：4像素一组的SSE边函数和深度测试，写入可见性缓冲（三角形编号+深度）
+//           3. 逐图块着色：先按图块深度范围剔除点光源，再把可见像素每4个一组做向量化的插值、纹理采样和Phong光照
+// 与GL路径的差异：没有阴影；不做混合（立方体按不透明处理）；纹理没有mipmap。
+class SoftwareRasterizer
+{
+public:
+    static constexpr int TILE_SIZE = 64;
+    static constexpr uint32_t EMPTY = 0xFFFFFFFFu;
+    // 保护带：顶点超出屏幕不到这么多像素时不裁剪，由包围盒限制；再远的才对保护带的边界裁剪，
+    // 屏幕坐标因此有上限，吸附到1/16像素和边函数都不会超出float的精度
+    static constexpr float GUARD_BAND = 1024.0f;
+
+    struct Stats
+    {
+        size_t triangles = 0;       // 提交的三角形
+        size_t rasterized = 0;      // 裁剪后实际进入光栅化的三角形
+        size_t binned = 0;          // 三角形与图块的配对数
+        size_t pixels = 0;          // 着色的像素
+        float vertexMs = 0.0f;
+        float setupMs = 0.0f;
+        float rasterMs = 0.0f;
+        float shadeMs = 0.0f;
+
+        float TotalMs() const { return vertexMs + setupMs + rasterMs + shadeMs; }
+    };
+
+    glm::vec3 clearColor = glm::vec3(0.0f);
+
+    SoftwareRasterizer(int width, int height, ThreadPool* pool = nullptr) : pool(pool)
+    {
+        Resize(width, height);
+    }
+
+    void Resize(int w, int h)
+    {
+        width = std::max(1, w);
+        height = std::max(1, h);
+        tilesX = (width + TILE_SIZE - 1) / TILE_SIZE;
+        tilesY = (height + TILE_SIZE - 1) / TILE_SIZE;
+        // 深度和可见性缓冲按整图块对齐，图块内的4像素组不需要边界检查
+        stride = tilesX * TILE_SIZE;
+        depth.assign((size_t)stride * tilesY * TILE_SIZE, 1.0f);
+        ids.assign(depth.size(), EMPTY);
+        color.assign((size_t)width * height * 4, 0);
+    }
+
+    int Width() const { return width; }
+    int Height() const { return height; }
+    // RGBA8，第一行在顶部
+    const uint8_t* Pixels() const { return color.data(); }
+    const Stats& GetStats() const { return stats; }
+
+    void Begin(const glm::mat4& view, const glm::mat4& projection, const glm::vec3& viewPos)
+    {
+        this->view = view;
+        this->projection = projection;
+        this->viewPos = viewPos;
+        viewProjection = projection * view;
+        clipVertices.clear();
+        indices.clear();
+        triangleMaterials.clear();
+        materials.clear();
+        stats = Stats();
+    }
+
+    void Draw(const Mesh& mesh, const glm::mat4& model, const SoftwareMaterial& material)
+    {
+        Draw(mesh.vertices, mesh.indices, model, material);
+    }
+
+    void Draw(const vector<Vertex>& vertices, const vector<unsigned int>& meshIndices, const glm::mat4& model, const SoftwareMaterial& material)
+    {
+        if (vertices.empty() || meshIndices.size() < 3)
+            return;
+        auto start = std::chrono::steady_clock::now();
+        size_t base = clipVertices.size();
+        clipVertices.resize(base + vertices.size());
+        glm::mat4 modelViewProjection = viewProjection * model;
+        // 与 InstanceBuffer 一样使用逆转置矩阵，不归一化（着色器里也没有归一化）
+        glm::mat3 normalMatrix = glm::mat3(glm::transpose(glm::inverse(model)));
+        parallelFor(vertices.size(), 1024, [&](size_t begin, size_t end, unsigned int)
+        {
+            for (size_t i = begin; i < end; i++)
+            {
+                const Vertex& v = vertices[i];
+                ClipVertex& out = clipVertices[base + i];
+                glm::vec4 position(v.Position, 1.0f);
+                out.clip = modelViewProjection * position;
+                out.world = glm::vec3(model * position);
+                out.normal = normalMatrix * v.Normal;
+                out.uv = v.TexCoords;
+            }
+        });
+
+        uint32_t materialIndex = (uint32_t)materials.size();
+        materials.push_back(material);
+        size_t triangleCount = meshIndices.size() / 3;
+        size_t firstIndex = indices.size();
+        indices.resize(firstIndex + triangleCount * 3);
+        for (size_t i = 0; i < triangleCount * 3; i++)
+            indices[firstIndex + i] = (uint32_t)(base + meshIndices[i]);
+        triangleMaterials.insert(triangleMaterials.end(), triangleCount, materialIndex);
+        stats.triangles += triangleCount;
+        stats.vertexMs += elapsedMs(start);
+    }
+
+    // 建立、光栅化并着色本帧提交的所有三角形
+    void End(const SoftwareLights& lights)
+    {
+        unsigned int sliceCount = pool ? pool->SliceCount() : 1;
+        if (slices.size() < sliceCount)
+            slices.resize(sliceCount);
+        int tileCount = tilesX * tilesY;
+        for (SliceData& slice : slices)
+        {
+            slice.triangles.clear();
+            slice.bins.resize(tileCount);
+            for (vector<uint32_t>& bin : slice.bins)
+                bin.clear();
+            slice.rasterized = 0;
+            slice.binned = 0;
+            slice.pixels = 0;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        parallelFor(triangleMaterials.size(), 256, [&](size_t begin, size_t end, unsigned int slice)
+        {
+            for (size_t i = begin; i < end; i++)
+                setupTriangle(i, slices[slice]);
+        });
+        // 各切片的三角形拼接成一个数组，箱子里存的是切片内的下标，光栅化时加上切片的偏移
+        sliceOffsets.assign(slices.size() + 1, 0);
+        for (size_t s = 0; s < slices.size(); s++)
+            sliceOffsets[s + 1] = sliceOffsets[s] + (uint32_t)slices[s].triangles.size();
+        triangles.resize(sliceOffsets.back());
+        parallelFor(slices.size(), 1, [&](size_t begin, size_t end, unsigned int)
+        {
+            for (size_t s = begin; s < end; s++)
+                std::copy(slices[s].triangles.begin(), slices[s].triangles.end(), triangles.begin() + sliceOffsets[s]);
+        });
+        stats.setupMs = elapsedMs(start);
+
+        start = std::chrono::steady_clock::now();
+        forEachTile([&](int tile, unsigned int)
+        {
+            rasterizeTile(tile);
+        });
+        stats.rasterMs = elapsedMs(start);
+
+        start = std::chrono::steady_clock::now();
+        computeLightBounds(lights);
+        forEachTile([&](int tile, unsigned int slice)
+        {
+            shadeTile(tile, slices[slice], lights);
+        });
+        stats.shadeMs = elapsedMs(start);
+
+        for (const SliceData& slice : slices)
+        {
+            stats.rasterized += slice.rasterized;
+            stats.binned += slice.binned;
+            stats.pixels += slice.pixels;
+        }
+    }
+
+    // 4个float的向量：SSE可用时映射到__m128，否则逐分量计算。比较的结果是逐分量全1/全0的掩码
+    struct Float4
+    {
+#ifdef CULLING_USE_SSE
+        __m128 v;
+
+        Float4() {}
+        Float4(__m128 value) : v(value) {}
+        explicit Float4(float s) : v(_mm_set1_ps(s)) {}
+        Float4(float a, float b, float c, float d) : v(_mm_setr_ps(a, b, c, d)) {}
+        static Float4 Load(const float* p) { return Float4(_mm_loadu_ps(p)); }
+        void Store(float* p) const { _mm_storeu_ps(p, v); }
+
+        friend Float4 operator+(Float4 a, Float4 b) { return _mm_add_ps(a.v, b.v); }
+        friend Float4 operator-(Float4 a, Float4 b) { return _mm_sub_ps(a.v, b.v); }
+        friend Float4 operator*(Float4 a, Float4 b) { return _mm_mul_ps(a.v, b.v); }
+        friend Float4 operator/(Float4 a, Float4 b) { return _mm_div_ps(a.v, b.v); }
+        friend Float4 operator&(Float4 a, Float4 b) { return _mm_and_ps(a.v, b.v); }
+        friend Float4 operator<(Float4 a, Float4 b) { return _mm_cmplt_ps(a.v, b.v); }
+        friend Float4 operator>=(Float4 a, Float4 b) { return _mm_cmpge_ps(a.v, b.v); }
+        friend Float4 Min(Float4 a, Float4 b) { return _mm_min_ps(a.v, b.v); }
+        friend Float4 Max(Float4 a, Float4 b) { return _mm_max_ps(a.v, b.v); }
+        friend Float4 Sqrt(Float4 a) { return _mm_sqrt_ps(a.v); }
+        // SSE2没有floor指令：截断取整后，负数的非整数部分再减1
+        friend Float4 Floor(Float4 a)
+        {
+            __m128 t = _mm_cvtepi32_ps(_mm_cvttps_epi32(a.v));
+            return _mm_sub_ps(t, _mm_and_ps(_mm_cmplt_ps(a.v, t), _mm_set1_ps(1.0f)));
+        }
+        // 掩码为真的分量取a，否则取b
+        friend Float4 Select(Float4 mask, Float4 a, Float4 b) { return _mm_or_ps(_mm_and_ps(mask.v, a.v), _mm_andnot_ps(mask.v, b.v)); }
+        friend int MoveMask(Float4 mask) { return _mm_movemask_ps(mask.v); }
+#else
+        float v[4];
+
+        Float4() {}
+        explicit Float4(float s) : v{ s, s, s, s } {}
+        Float4(float a, float b, float c, float d) : v{ a, b, c, d } {}
+        static Float4 Load(const float* p) { return Float4(p[0], p[1], p[2], p[3]); }
+        void Store(float* p) const { memcpy(p, v, sizeof(v)); }
+
+        friend Float4 operator+(Float4 a, Float4 b) { return apply(a, b, [](float x, float y) { return x + y; }); }
+        friend Float4 operator-(Float4 a, Float4 b) { return apply(a, b, [](float x, float y) { return x - y; }); }
+        friend Float4 operator*(Float4 a, Float4 b) { return apply(a, b, [](float x, float y) { return x * y; }); }
+        friend Float4 operator/(Float4 a, Float4 b) { return apply(a, b, [](float x, float y) { return x / y; }); }
+        friend Float4 operator&(Float4 a, Float4 b) { return apply(a, b, [](float x, float y) { return mask(bit(x) && bit(y)); }); }
+        friend Float4 operator<(Float4 a, Float4 b) { return apply(a, b, [](float x, float y) { return mask(x < y); }); }
+        friend Float4 operator>=(Float4 a, Float4 b) { return apply(a, b, [](float x, float y) { return mask(x >= y); }); }
+        friend Float4 Min(Float4 a, Float4 b) { return apply(a, b, [](float x, float y) { return y < x ? y : x; }); }
+        friend Float4 Max(Float4 a, Float4 b) { return apply(a, b, [](float x, float y) { return y > x ? y : x; }); }
+        friend Float4 Sqrt(Float4 a) { return apply(a, a, [](float x, float) { return sqrtf(x); }); }
+        friend Float4 Floor(Float4 a) { return apply(a, a, [](float x, float) { return floorf(x); }); }
+        friend Float4 Select(Float4 m, Float4 a, Float4 b)
+        {
+            Float4 r;
+            for (int i = 0; i < 4; i++)
+                r.v[i] = bit(m.v[i]) ? a.v[i] : b.v[i];
+            return r;
+        }
+        friend int MoveMask(Float4 m)
+        {
+            int result = 0;
+            for (int i = 0; i < 4; i++)
+                result |= bit(m.v[i]) ? 1 << i : 0;
+            return result;
+        }
+
+    private:
+        template <typename F>
+        static Float4 apply(Float4 a, Float4 b, F f)
+        {
+            Float4 r;
+            for (int i = 0; i < 4; i++)
+                r.v[i] = f(a.v[i], b.v[i]);
+            return r;
+        }
+        static float mask(bool value)
+        {
+            uint32_t bits = value ? 0xFFFFFFFFu : 0u;
+            float f;
+            memcpy(&f, &bits, sizeof(f));
+            return f;
+        }
+        static bool bit(float f)
+        {
+            uint32_t bits;
+            memcpy(&bits, &f, sizeof(bits));
+            return bits != 0;
+        }
+#endif
+    };
+
+private:
+    // 变换后的顶点
+    struct ClipVertex
+    {
+        glm::vec4 clip;
+        glm::vec3 world;
+        glm::vec3 normal;
+        glm::vec2 uv;
+    };
+
+    // 建立好的三角形。边i是顶点i对面的边，端点按(y, x)规范排序，
+    // 共享同一条边的两个三角形算出的边函数完全相同（只差符号），配合左上规则不会漏像素也不会重复
+    struct Triangle
+    {
+        float edgeX[3], edgeY[3];       // 边的规范起点
+        float edgeDX[3], edgeDY[3];     // 规范终点 - 起点
+        float edgeSign[3];              // 使三角形内部为正的符号
+        float edgeBias[3];              // 左上边为0，其余为FLT_MIN（边上的像素只归左上边所在的三角形）
+        float baryX[3], baryY[3], baryC[3];  // 屏幕空间重心坐标的平面方程
+        float depthX, depthY, depthC;   // 深度[0,1]的平面方程
+        float invW[3];
+        glm::vec3 world[3];
+        glm::vec3 normal[3];
+        glm::vec2 uv[3];
+        int minX, minY, maxX, maxY;     // 像素包围盒（含）
+        uint32_t material;
+    };
+
+    // 每个线程切片独享的数据
+    struct SliceData
+    {
+        vector<Triangle> triangles;
+        vector<vector<uint32_t>> bins;  // 每个图块的三角形（切片内下标，按提交顺序）
+        vector<uint32_t> tileLights;    // 着色时当前图块的点光源
+        size_t rasterized = 0;
+        size_t binned = 0;
+        size_t pixels = 0;
+    };
+
+    // 点光源在屏幕上的范围，着色前每帧算一次
+    struct LightBounds
+    {
+        int minX, minY, maxX, maxY;
+        float nearDepth, farDepth;      // 视空间深度范围
+    };
+
+    ThreadPool* pool;
+    int width = 0, height = 0;
+    int tilesX = 0, tilesY = 0;
+    int stride = 0;
+    vector<float> depth;
+    vector<uint32_t> ids;
+    vector<uint8_t> color;
+
+    glm::mat4 view = glm::mat4(1.0f);
+    glm::mat4 projection = glm::mat4(1.0f);
+    glm::mat4 viewProjection = glm::mat4(1.0f);
+    glm::vec3 viewPos = glm::vec3(0.0f);
+
+    vector<ClipVertex> clipVertices;
+    vector<uint32_t> indices;
+    vector<uint32_t> triangleMaterials;
+    vector<SoftwareMaterial> materials;
+
+    vector<SliceData> slices;
+    vector<uint32_t> sliceOffsets;
+    vector<Triangle> triangles;
+    vector<LightBounds> lightBounds;
+    Stats stats;
+
+    static float elapsedMs(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    void parallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t, unsigned int)>& func)
+    {
+        if (pool)
+            pool->ParallelFor(count, grain, func);
+        else if (count > 0)
+            func(0, count, 0);
+    }
+
+    // 图块从共享计数器中领取，负载不均（例如画面一侧很复杂）时比静态切分好
+    void forEachTile(const std::function<void(int, unsigned int)>& func)
+    {
+        std::atomic<int> next(0);
+        int tileCount = tilesX * tilesY;
+        unsigned int sliceCount = pool ? pool->SliceCount() : 1;
+        parallelFor(sliceCount, 1, [&](size_t, size_t, unsigned int slice)
+        {
+            for (int tile = next.fetch_add(1); tile < tileCount; tile = next.fetch_add(1))
+                func(tile, slice);
+        });
+    }
+
+    // ---- 三角形建立 ----
+
+    void setupTriangle(size_t index, SliceData& slice)
+    {
+        const ClipVertex* v[3] = { &clipVertices[indices[index * 3]], &clipVertices[indices[index * 3 + 1]], &clipVertices[indices[index * 3 + 2]] };
+        uint32_t material = triangleMaterials[index];
+        // 保护带在裁剪空间中的范围：|x| <= guardX*w，|y| <= guardY*w
+        float guardX = 1.0f + 2.0f * GUARD_BAND / width;
+        float guardY = 1.0f + 2.0f * GUARD_BAND / height;
+        // 三个顶点都在同一个裁剪平面外侧时整个丢弃
+        int outside[3];
+        for (int i = 0; i < 3; i++)
+        {
+            const glm::vec4& c = v[i]->clip;
+            outside[i] = (c.x > c.w ? 1 : 0) | (c.x < -c.w ? 2 : 0) | (c.y > c.w ? 4 : 0) | (c.y < -c.w ? 8 : 0) | (c.z > c.w ? 16 : 0) | (c.z < -c.w ? 32 : 0)
+                | (c.x > guardX * c.w ? 64 : 0) | (c.x < -guardX * c.w ? 128 : 0) | (c.y > guardY * c.w ? 256 : 0) | (c.y < -guardY * c.w ? 512 : 0);
+        }
+        if (outside[0] & outside[1] & outside[2])
+            return;
+        int clipPlanes = (outside[0] | outside[1] | outside[2]) & (32 | 64 | 128 | 256 | 512);
+        if (clipPlanes == 0)
+        {
+            emitTriangle(*v[0], *v[1], *v[2], material, slice);
+            return;
+        }
+        // 与近平面 z = -w 或保护带相交：依次对这些平面做 Sutherland-Hodgman 裁剪，每个平面最多增加一个顶点，再按扇形拆开。
+        // 屏幕边缘不裁剪，保护带以内超出屏幕的部分由包围盒限制
+        ClipVertex buffers[2][8];
+        ClipVertex* polygon = buffers[0];
+        ClipVertex* clipped = buffers[1];
+        int count = 3;
+        for (int i = 0; i < 3; i++)
+            polygon[i] = *v[i];
+        for (int plane = 32; plane <= 512 && count >= 3; plane <<= 1)
+        {
+            if ((clipPlanes & plane) == 0)
+                continue;
+            auto distance = [&](const glm::vec4& c)
+            {
+                switch (plane)
+                {
+                case 32: return c.z + c.w;
+                case 64: return guardX * c.w - c.x;
+                case 128: return guardX * c.w + c.x;
+                case 256: return guardY * c.w - c.y;
+                default: return guardY * c.w + c.y;
+                }
+            };
+            int clippedCount = 0;
+            for (int i = 0; i < count; i++)
+            {
+                const ClipVertex& a = polygon[i];
+                const ClipVertex& b = polygon[(i + 1) % count];
+                float da = distance(a.clip);
+                float db = distance(b.clip);
+                if (da >= 0.0f)
+                    clipped[clippedCount++] = a;
+                if ((da >= 0.0f) != (db >= 0.0f))
+                    clipped[clippedCount++] = lerp(a, b, da / (da - db));
+            }
+            std::swap(polygon, clipped);
+            count = clippedCount;
+        }
+        for (int i = 2; i < count; i++)
+            emitTriangle(polygon[0], polygon[i - 1], polygon[i], material, slice);
+    }
+
+    static ClipVertex lerp(const ClipVertex& a, const ClipVertex& b, float t)
+    {
+        ClipVertex p;
+        p.clip = glm::mix(a.clip, b.clip, t);
+        p.world = glm::mix(a.world, b.world, t);
+        p.normal = glm::mix(a.normal, b.normal, t);
+        p.uv = glm::mix(a.uv, b.uv, t);
+        return p;
+    }
+
+    void emitTriangle(const ClipVertex& a, const ClipVertex& b, const ClipVertex& c, uint32_t material, SliceData& slice)
+    {
+        const ClipVertex* v[3] = { &a, &b, &c };
+        Triangle tri;
+        glm::vec2 p[3];
+        float z[3];
+        for (int i = 0; i < 3; i++)
+        {
+            const glm::vec4& clip = v[i]->clip;
+            if (clip.w <= 0.0f)
+                return;
+            float invW = 1.0f / clip.w;
+            // 屏幕坐标吸附到1/16像素（与硬件光栅化的子像素精度相当），y向下
+            p[i].x = roundf((clip.x * invW * 0.5f + 0.5f) * width * 16.0f) * (1.0f / 16.0f);
+            p[i].y = roundf((0.5f - clip.y * invW * 0.5f) * height * 16.0f) * (1.0f / 16.0f);
+            z[i] = clip.z * invW * 0.5f + 0.5f;
+            tri.invW[i] = invW;
+            tri.world[i] = v[i]->world;
+            tri.normal[i] = v[i]->normal;
+            tri.uv[i] = v[i]->uv;
+        }
+        float area = (p[1].x - p[0].x) * (p[2].y - p[0].y) - (p[2].x - p[0].x) * (p[1].y - p[0].y);
+        if (area == 0.0f)
+            return;
+
+        // 覆盖的像素中心 x+0.5 在[minx, maxx]内
+        float minx = std::min(p[0].x, std::min(p[1].x, p[2].x));
+        float maxx = std::max(p[0].x, std::max(p[1].x, p[2].x));
+        float miny = std::min(p[0].y, std::min(p[1].y, p[2].y));
+        float maxy = std::max(p[0].y, std::max(p[1].y, p[2].y));
+        tri.minX = std::max(0, (int)ceilf(minx - 0.5f));
+        tri.maxX = std::min(width - 1, (int)floorf(maxx - 0.5f));
+        tri.minY = std::max(0, (int)ceilf(miny - 0.5f));
+        tri.maxY = std::min(height - 1, (int)floorf(maxy - 0.5f));
+        if (tri.minX > tri.maxX || tri.minY > tri.maxY)
+            return;
+
+        // 面积的正负只决定边函数的符号，两面都画（与GL路径一样没有开启背面剔除）
+        float invArea = 1.0f / fabsf(area);
+        for (int i = 0; i < 3; i++)
+        {
+            glm::vec2 e0 = p[(i + 1) % 3];
+            glm::vec2 e1 = p[(i + 2) % 3];
+            if (e0.y > e1.y || (e0.y == e1.y && e0.x > e1.x))
+                std::swap(e0, e1);
+            float dx = e1.x - e0.x;
+            float dy = e1.y - e0.y;
+            float opposite = dx * (p[i].y - e0.y) - dy * (p[i].x - e0.x);
+            float sign = opposite > 0.0f ? 1.0f : -1.0f;
+            // 内部函数 F = sign*(dx*(y-y0) - dy*(x-x0))：dF/dx>0 为左边；水平且dF/dy>0（内部在下方）为上边
+            bool topLeft = -sign * dy > 0.0f || (dy == 0.0f && sign * dx > 0.0f);
+            tri.edgeX[i] = e0.x;
+            tri.edgeY[i] = e0.y;
+            tri.edgeDX[i] = dx;
+            tri.edgeDY[i] = dy;
+            tri.edgeSign[i] = sign;
+            tri.edgeBias[i] = topLeft ? 0.0f : FLT_MIN;
+            tri.baryX[i] = -sign * dy * invArea;
+            tri.baryY[i] = sign * dx * invArea;
+            tri.baryC[i] = sign * (dy * e0.x - dx * e0.y) * invArea;
+        }
+        tri.depthX = tri.baryX[0] * z[0] + tri.baryX[1] * z[1] + tri.baryX[2] * z[2];
+        tri.depthY = tri.baryY[0] * z[0] + tri.baryY[1] * z[1] + tri.baryY[2] * z[2];
+        tri.depthC = tri.baryC[0] * z[0] + tri.baryC[1] * z[1] + tri.baryC[2] * z[2];
+        tri.material = material;
+
+        // 分箱：包围盒覆盖的图块中，再排除完全在某条边外侧的图块
+        uint32_t local = (uint32_t)slice.triangles.size();
+        bool stored = false;
+        for (int ty = tri.minY / TILE_SIZE; ty <= tri.maxY / TILE_SIZE; ty++)
+        {
+            for (int tx = tri.minX / TILE_SIZE; tx <= tri.maxX / TILE_SIZE; tx++)
+            {
+                if (!overlapsTile(tri, tx, ty))
+                    continue;
+                slice.bins[ty * tilesX + tx].push_back(local);
+                slice.binned++;
+                stored = true;
+            }
+        }
+        if (stored)
+        {
+            slice.triangles.push_back(tri);
+            slice.rasterized++;
+        }
+    }
+
+    static bool overlapsTile(const Triangle& tri, int tx, int ty)
+    {
+        float x0 = tx * TILE_SIZE + 0.5f;
+        float y0 = ty * TILE_SIZE + 0.5f;
+        float x1 = x0 + TILE_SIZE - 1.0f;
+        float y1 = y0 + TILE_SIZE - 1.0f;
+        for (int i = 0; i < 3; i++)
+        {
+            // 边函数是仿射的，最大值在图块的某个角上
+            float gx = -tri.edgeSign[i] * tri.edgeDY[i];
+            float gy = tri.edgeSign[i] * tri.edgeDX[i];
+            float x = gx > 0.0f ? x1 : x0;
+            float y = gy > 0.0f ? y1 : y0;
+            float f = tri.edgeSign[i] * (tri.edgeDX[i] * (y - tri.edgeY[i]) - tri.edgeDY[i] * (x - tri.edgeX[i]));
+            if (f < 0.0f)
+                return false;
+        }
+        return true;
+    }
+
+    // ---- 光栅化 ----
+
+    void rasterizeTile(int tile)
+    {
+        int tx = tile % tilesX;
+        int ty = tile / tilesX;
+        int tileX0 = tx * TILE_SIZE;
+        int tileY0 = ty * TILE_SIZE;
+        for (int y = 0; y < TILE_SIZE; y++)
+        {
+            size_t row = (size_t)(tileY0 + y) * stride + tileX0;
+            std::fill(depth.begin() + row, depth.begin() + row + TILE_SIZE, 1.0f);
+            std::fill(ids.begin() + row, ids.begin() + row + TILE_SIZE, EMPTY);
+        }
+        const Float4 laneOffset(0.5f, 1.5f, 2.5f, 3.5f);
+        for (size_t s = 0; s < slices.size(); s++)
+        {
+            const vector<uint32_t>& bin = slices[s].bins[tile];
+            for (uint32_t local : bin)
+            {
+                uint32_t id = sliceOffsets[s] + local;
+                const Triangle& tri = triangles[id];
+                // 4像素一组，起点按4对齐（图块起点是4的倍数，组不会跨出图块）
+                int x0 = std::max(tri.minX, tileX0) & ~3;
+                int x1 = std::min(tri.maxX, tileX0 + TILE_SIZE - 1);
+                int y0 = std::max(tri.minY, tileY0);
+                int y1 = std::min(tri.maxY, tileY0 + TILE_SIZE - 1);
+                Float4 edgeDY[3], edgeX[3], edgeSign[3], edgeBias[3];
+                for (int i = 0; i < 3; i++)
+                {
+                    edgeDY[i] = Float4(tri.edgeDY[i]);
+                    edgeX[i] = Float4(tri.edgeX[i]);
+                    edgeSign[i] = Float4(tri.edgeSign[i]);
+                    edgeBias[i] = Float4(tri.edgeBias[i]);
+                }
+                Float4 depthX(tri.depthX);
+                for (int y = y0; y <= y1; y++)
+                {
+                    float py = y + 0.5f;
+                    Float4 rowTerm[3];
+                    for (int i = 0; i < 3; i++)
+                        rowTerm[i] = Float4(tri.edgeDX[i] * (py - tri.edgeY[i]));
+                    Float4 depthRow(tri.depthY * py + tri.depthC);
+                    size_t row = (size_t)y * stride;
+                    for (int x = x0; x <= x1; x += 4)
+                    {
+                        Float4 px = Float4((float)x) + laneOffset;
+                        Float4 inside = (edgeSign[0] * (rowTerm[0] - edgeDY[0] * (px - edgeX[0]))) >= edgeBias[0];
+                        inside = inside & ((edgeSign[1] * (rowTerm[1] - edgeDY[1] * (px - edgeX[1]))) >= edgeBias[1]);
+                        inside = inside & ((edgeSign[2] * (rowTerm[2] - edgeDY[2] * (px - edgeX[2]))) >= edgeBias[2]);
+                        if (MoveMask(inside) == 0)
+                            continue;
+                        float* depthPtr = &depth[row + x];
+                        Float4 oldDepth = Float4::Load(depthPtr);
+                        Float4 z = depthX * px + depthRow;
+                        Float4 pass = inside & (z < oldDepth);
+                        int bits = MoveMask(pass);
+                        if (bits == 0)
+                            continue;
+                        Select(pass, z, oldDepth).Store(depthPtr);
+                        uint32_t* idPtr = &ids[row + x];
+                        for (int lane = 0; lane < 4; lane++)
+                        {
+                            if (bits & (1 << lane))
+                                idPtr[lane] = id;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    // ---- 着色 ----
+
+    // 视空间深度（到相机平面的距离）与深度缓冲值[0,1]的换算，只依赖投影矩阵
+    float viewDepth(float depth01) const
+    {
+        float ndc = depth01 * 2.0f - 1.0f;
+        return projection[3][2] / (ndc + projection[2][2]);
+    }
+
+    void computeLightBounds(const SoftwareLights& lights)
+    {
+        float nearPlane = projection[3][2] / (projection[2][2] - 1.0f);
+        lightBounds.resize(lights.pointLights.size());
+        for (size_t i = 0; i < lights.pointLights.size(); i++)
+        {
+            const glm::vec4& pr = lights.pointLights[i].positionRadius;
+            glm::vec3 center = glm::vec3(view * glm::vec4(glm::vec3(pr), 1.0f));
+            float radius = pr.w;
+            LightBounds& bounds = lightBounds[i];
+            bounds.nearDepth = -center.z - radius;
+            bounds.farDepth = -center.z + radius;
+            if (bounds.farDepth < nearPlane)
+            {
+                bounds.minX = bounds.minY = 1;
+                bounds.maxX = bounds.maxY = 0;
+                continue;
+            }
+            if (bounds.nearDepth <= nearPlane)
+            {
+                // 与近平面相交，投影不可靠，认为覆盖整个屏幕
+                bounds.minX = bounds.minY = 0;
+                bounds.maxX = width - 1;
+                bounds.maxY = height - 1;
+                continue;
+            }
+            // 包围球的外接盒8个角投影后的包围矩形
+            float minx = FLT_MAX, miny = FLT_MAX, maxx = -FLT_MAX, maxy = -FLT_MAX;
+            for (int corner = 0; corner < 8; corner++)
+            {
+                glm::vec3 q = center + glm::vec3(corner & 1 ? radius : -radius, corner & 2 ? radius : -radius, corner & 4 ? radius : -radius);
+                glm::vec4 clip = projection * glm::vec4(q, 1.0f);
+                float sx = (clip.x / clip.w * 0.5f + 0.5f) * width;
+                float sy = (0.5f - clip.y / clip.w * 0.5f) * height;
+                minx = std::min(minx, sx);
+                maxx = std::max(maxx, sx);
+                miny = std::min(miny, sy);
+                maxy = std::max(maxy, sy);
+            }
+            bounds.minX = std::max(0, (int)floorf(minx));
+            bounds.minY = std::max(0, (int)floorf(miny));
+            bounds.maxX = std::min(width - 1, (int)ceilf(maxx));
+            bounds.maxY = std::min(height - 1, (int)ceilf(maxy));
+        }
+    }
+
+    void shadeTile(int tile, SliceData& slice, const SoftwareLights& lights)
+    {
+        int tileX0 = (tile % tilesX) * TILE_SIZE;
+        int tileY0 = (tile / tilesX) * TILE_SIZE;
+        int tileX1 = std::min(width, tileX0 + TILE_SIZE) - 1;
+        int tileY1 = std::min(height, tileY0 + TILE_SIZE) - 1;
+
+        // 图块的深度范围，用于剔除点光源
+        float minDepth = 1.0f, maxDepth = 0.0f;
+        for (int y = tileY0; y <= tileY1; y++)
+        {
+            for (int x = tileX0; x <= tileX1; x++)
+            {
+                size_t i = (size_t)y * stride + x;
+                if (ids[i] == EMPTY)
+                    continue;
+                minDepth = std::min(minDepth, depth[i]);
+                maxDepth = std::max(maxDepth, depth[i]);
+            }
+        }
+        slice.tileLights.clear();
+        if (minDepth <= maxDepth)
+        {
+            float nearDepth = viewDepth(minDepth);
+            float farDepth = viewDepth(maxDepth);
+            for (size_t i = 0; i < lightBounds.size(); i++)
+            {
+                const LightBounds& b = lightBounds[i];
+                if (b.maxX < tileX0 || b.minX > tileX1 || b.maxY < tileY0 || b.minY > tileY1)
+                    continue;
+                if (b.farDepth < nearDepth || b.nearDepth > farDepth)
+                    continue;
+                slice.tileLights.push_back((uint32_t)i);
+            }
+        }
+
+        uint8_t clear[4] = { toByte(clearColor.r), toByte(clearColor.g), toByte(clearColor.b), 255 };
+        int batchX[4], batchY[4];
+        int batchCount = 0;
+        for (int y = tileY0; y <= tileY1; y++)
+        {
+            for (int x = tileX0; x <= tileX1; x++)
+            {
+                if (ids[(size_t)y * stride + x] == EMPTY)
+                {
+                    memcpy(&color[((size_t)y * width + x) * 4], clear, 4);
+                    continue;
+                }
+                batchX[batchCount] = x;
+                batchY[batchCount] = y;
+                slice.pixels++;
+                if (++batchCount == 4)
+                {
+                    shadeBatch(batchX, batchY, 4, slice.tileLights, lights);
+                    batchCount = 0;
+                }
+            }
+        }
+        if (batchCount > 0)
+            shadeBatch(batchX, batchY, batchCount, slice.tileLights, lights);
+    }
+
+    // 一组最多4个像素：各像素三角形的数据先收集成结构数组，透视校正插值、纹理采样和光照都按4个像素一起计算。
+    // 公式与 userShader.fs 相同，包括未归一化的插值法线
+    void shadeBatch(const int* xs, const int* ys, int count, const vector<uint32_t>& tileLights, const SoftwareLights& lights)
+    {
+        const Float4 zero(0.0f);
+        const Float4 one(1.0f);
+        const Float4 two(2.0f);
+        // [顶点][lane]：重心坐标平面方程、1/w，以及属性 world.xyz normal.xyz uv
+        alignas(16) float baryX[3][4], baryY[3][4], baryC[3][4], invW[3][4];
+        alignas(16) float attributes[3][8][4];
+        alignas(16) float pixelX[4], pixelY[4];
+        const SoftwareMaterial* laneMaterials[4];
+        for (int lane = 0; lane < 4; lane++)
+        {
+            // 不足4个时重复最后一个像素，结果不写回
+            int k = std::min(lane, count - 1);
+            const Triangle& tri = triangles[ids[(size_t)ys[k] * stride + xs[k]]];
+            pixelX[lane] = xs[k] + 0.5f;
+            pixelY[lane] = ys[k] + 0.5f;
+            for (int i = 0; i < 3; i++)
+            {
+                baryX[i][lane] = tri.baryX[i];
+                baryY[i][lane] = tri.baryY[i];
+                baryC[i][lane] = tri.baryC[i];
+                invW[i][lane] = tri.invW[i];
+                const float values[8] = { tri.world[i].x, tri.world[i].y, tri.world[i].z, tri.normal[i].x, tri.normal[i].y, tri.normal[i].z, tri.uv[i].x, tri.uv[i].y };
+                for (int a = 0; a < 8; a++)
+                    attributes[i][a][lane] = values[a];
+            }
+            laneMaterials[lane] = &materials[tri.material];
+        }
+
+        // 透视校正插值
+        Float4 pixelX4 = Float4::Load(pixelX), pixelY4 = Float4::Load(pixelY);
+        Float4 w[3];
+        Float4 sum = zero;
+        for (int i = 0; i < 3; i++)
+        {
+            w[i] = Max(Float4::Load(baryX[i]) * pixelX4 + Float4::Load(baryY[i]) * pixelY4 + Float4::Load(baryC[i]), zero) * Float4::Load(invW[i]);
+            sum = sum + w[i];
+        }
+        Float4 invSum = Select(zero < sum, one / sum, zero);
+        Float4 interpolated[8];
+        for (int a = 0; a < 8; a++)
+            interpolated[a] = (w[0] * Float4::Load(attributes[0][a]) + w[1] * Float4::Load(attributes[1][a]) + w[2] * Float4::Load(attributes[2][a])) * invSum;
+
+        Float4 texR, texG, texB;
+        sampleTextures(laneMaterials, interpolated[6], interpolated[7], texR, texG, texB);
+        alignas(16) float tr[4], tg[4], tb[4];
+        texR.Store(tr);
+        texG.Store(tg);
+        texB.Store(tb);
+        glm::vec3 base[4];
+        for (int lane = 0; lane < 4; lane++)
+        {
+            glm::vec3 texel(tr[lane], tg[lane], tb[lane]);
+            base[lane] = laneMaterials[lane]->lit ? adjustHue(texel, lights.hueShift) : texel;
+        }
+        alignas(16) float shininess[4];
+        for (int lane = 0; lane < 4; lane++)
+            shininess[lane] = laneMaterials[lane]->shininess;
+
+        Float4 Px = interpolated[0], Py = interpolated[1], Pz = interpolated[2];
+        Float4 Nx = interpolated[3], Ny = interpolated[4], Nz = interpolated[5];
+        Float4 shine = Float4::Load(shininess);
+        Float4 Vx = Float4(viewPos.x) - Px, Vy = Float4(viewPos.y) - Py, Vz = Float4(viewPos.z) - Pz;
+        Float4 invLength = one / Sqrt(Vx * Vx + Vy * Vy + Vz * Vz);
+        Vx = Vx * invLength;
+        Vy = Vy * invLength;
+        Vz = Vz * invLength;
+        Float4 diffR = zero, diffG = zero, diffB = zero;
+        Float4 specR = zero, specG = zero, specB = zero;
+
+        // L 为指向光源的单位向量，scale 为衰减和聚光强度
+        auto addLight = [&](Float4 Lx, Float4 Ly, Float4 Lz, Float4 scale, const glm::vec3& lightColor, const glm::vec3& specularColor)
+        {
+            Float4 nDotL = Nx * Lx + Ny * Ly + Nz * Lz;
+            Float4 diff = Max(nDotL, zero) * scale;
+            // reflect(-L, N) = 2*dot(N,L)*N - L
+            Float4 twoNDotL = two * nDotL;
+            Float4 Rx = twoNDotL * Nx - Lx, Ry = twoNDotL * Ny - Ly, Rz = twoNDotL * Nz - Lz;
+            Float4 spec = power(Max(Vx * Rx + Vy * Ry + Vz * Rz, zero), shine) * scale;
+            diffR = diffR + diff * Float4(lightColor.r);
+            diffG = diffG + diff * Float4(lightColor.g);
+            diffB = diffB + diff * Float4(lightColor.b);
+            specR = specR + spec * Float4(specularColor.r);
+            specG = specG + spec * Float4(specularColor.g);
+            specB = specB + spec * Float4(specularColor.b);
+        };
+
+        // 方向光
+        glm::vec3 dirL = glm::normalize(-lights.dirDirection);
+        addLight(Float4(dirL.x), Float4(dirL.y), Float4(dirL.z), one, lights.dirColor, lights.dirSpecular);
+
+        // 图块内的点光源
+        for (uint32_t index : tileLights)
+        {
+            const ClusterPointLight& light = lights.pointLights[index];
+            Float4 Lx = Float4(light.positionRadius.x) - Px, Ly = Float4(light.positionRadius.y) - Py, Lz = Float4(light.positionRadius.z) - Pz;
+            Float4 distance = Sqrt(Lx * Lx + Ly * Ly + Lz * Lz);
+            Float4 invDistance = one / distance;
+            Float4 attenuation = one / (Float4(light.attenuation.x) + Float4(light.attenuation.y) * distance + Float4(light.attenuation.z) * distance * distance);
+            addLight(Lx * invDistance, Ly * invDistance, Lz * invDistance, attenuation, glm::vec3(light.lightcolor), glm::vec3(light.specularcolor));
+        }
+
+        // 聚光灯
+        {
+            Float4 Lx = Float4(lights.spotPosition.x) - Px, Ly = Float4(lights.spotPosition.y) - Py, Lz = Float4(lights.spotPosition.z) - Pz;
+            Float4 distance = Sqrt(Lx * Lx + Ly * Ly + Lz * Lz);
+            Float4 invDistance = one / distance;
+            Lx = Lx * invDistance;
+            Ly = Ly * invDistance;
+            Lz = Lz * invDistance;
+            const glm::vec3& a = lights.spotAttenuation;
+            Float4 attenuation = one / (Float4(a.x) + Float4(a.y) * distance + Float4(a.z) * distance * distance);
+            glm::vec3 axis = glm::normalize(-lights.spotDirection);
+            Float4 theta = Lx * Float4(axis.x) + Ly * Float4(axis.y) + Lz * Float4(axis.z);
+            // smoothstep(cos(angle+smoothness), cos(angle-smoothness), theta)
+            float edge0 = cosf(lights.spotAngle + lights.spotSmoothness);
+            float edge1 = cosf(lights.spotAngle - lights.spotSmoothness);
+            Float4 t = Min(Max((theta - Float4(edge0)) / Float4(edge1 - edge0), zero), one);
+            Float4 intensity = t * t * (Float4(3.0f) - two * t);
+            addLight(Lx, Ly, Lz, attenuation * intensity, lights.spotColor, lights.spotSpecular);
+        }
+
+        alignas(16) float dr[4], dg[4], db[4], sr[4], sg[4], sb[4];
+        diffR.Store(dr);
+        diffG.Store(dg);
+        diffB.Store(db);
+        specR.Store(sr);
+        specG.Store(sg);
+        specB.Store(sb);
+        for (int lane = 0; lane < count; lane++)
+        {
+            const SoftwareMaterial& material = *laneMaterials[lane];
+            glm::vec3 result;
+            if (material.lit)
+            {
+                glm::vec3 diff(dr[lane], dg[lane], db[lane]);
+                glm::vec3 spec(sr[lane], sg[lane], sb[lane]);
+                result = base[lane] * diff * material.baseColor + 0.1f * base[lane] + material.specular * spec;
+            }
+            else
+                result = base[lane] * material.baseColor;
+            uint8_t* out = &color[((size_t)ys[lane] * width + xs[lane]) * 4];
+            out[0] = toByte(result.r);
+            out[1] = toByte(result.g);
+            out[2] = toByte(result.b);
+            out[3] = 255;
+        }
+    }
+
+    // 4个像素的纹理采样。使用同一张纹理时（绝大多数情况）纹素坐标、权重和双线性混合按向量计算，只有取texel是逐个的；
+    // 纹理不同时逐像素调用 SoftwareTexture::Sample。没有纹理为白色
+    static void sampleTextures(const SoftwareMaterial* const* laneMaterials, Float4 u, Float4 v, Float4& r, Float4& g, Float4& b)
+    {
+        const SoftwareTexture* texture = laneMaterials[0]->baseTexture;
+        bool shared = true;
+        for (int lane = 1; lane < 4; lane++)
+            shared = shared && laneMaterials[lane]->baseTexture == texture;
+        alignas(16) float us[4], vs[4];
+        if (!shared)
+        {
+            alignas(16) float rs[4], gs[4], bs[4];
+            u.Store(us);
+            v.Store(vs);
+            for (int lane = 0; lane < 4; lane++)
+            {
+                const SoftwareTexture* t = laneMaterials[lane]->baseTexture;
+                glm::vec4 texel = t ? t->Sample(glm::vec2(us[lane], vs[lane])) : glm::vec4(1.0f);
+                rs[lane] = texel.r;
+                gs[lane] = texel.g;
+                bs[lane] = texel.b;
+            }
+            r = Float4::Load(rs);
+            g = Float4::Load(gs);
+            b = Float4::Load(bs);
+            return;
+        }
+        if (!texture || !texture->Valid())
+        {
+            r = g = b = Float4(1.0f);
+            return;
+        }
+        Float4 x = u * Float4((float)texture->width) - Float4(0.5f);
+        Float4 y = v * Float4((float)texture->height) - Float4(0.5f);
+        Float4 fx = Floor(x), fy = Floor(y);
+        Float4 tx = x - fx, ty = y - fy;
+        fx.Store(us);
+        fy.Store(vs);
+        // [角][通道][lane]，角的顺序为 (x0,y0) (x1,y0) (x0,y1) (x1,y1)
+        alignas(16) float corners[4][3][4];
+        for (int lane = 0; lane < 4; lane++)
+        {
+            int x0 = SoftwareTexture::Wrap((int)us[lane], texture->width);
+            int y0 = SoftwareTexture::Wrap((int)vs[lane], texture->height);
+            int x1 = x0 + 1 == texture->width ? 0 : x0 + 1;
+            int y1 = y0 + 1 == texture->height ? 0 : y0 + 1;
+            const uint8_t* texels[4] = { texture->Texel(x0, y0), texture->Texel(x1, y0), texture->Texel(x0, y1), texture->Texel(x1, y1) };
+            for (int corner = 0; corner < 4; corner++)
+            {
+                for (int channel = 0; channel < 3; channel++)
+                    corners[corner][channel][lane] = texels[corner][channel];
+            }
+        }
+        Float4 result[3];
+        for (int channel = 0; channel < 3; channel++)
+        {
+            Float4 c00 = Float4::Load(corners[0][channel]), c10 = Float4::Load(corners[1][channel]);
+            Float4 c01 = Float4::Load(corners[2][channel]), c11 = Float4::Load(corners[3][channel]);
+            Float4 top = c00 + (c10 - c00) * tx;
+            Float4 bottom = c01 + (c11 - c01) * tx;
+            result[channel] = (top + (bottom - top) * ty) * Float4(1.0f / 255.0f);
+        }
+        r = result[0];
+        g = result[1];
+        b = result[2];
+    }
+
+    // pow没有对应的SIMD指令。4个分量的指数相同且为整数时（常见的shininess=32）用平方求幂，否则逐分量计算
+    static Float4 power(Float4 base, Float4 exponent)
+    {
+        alignas(16) float b[4], e[4];
+        exponent.Store(e);
+        if (e[0] == e[1] && e[0] == e[2] && e[0] == e[3] && e[0] >= 1.0f && e[0] <= 1024.0f && e[0] == floorf(e[0]))
+        {
+            unsigned int n = (unsigned int)e[0];
+            Float4 result(1.0f);
+            Float4 square = base;
+            for (;;)
+            {
+                if (n & 1)
+                    result = result * square;
+                n >>= 1;
+                if (n == 0)
+                    break;
+                square = square * square;
+            }
+            return result;
+        }
+        base.Store(b);
+        for (int i = 0; i < 4; i++)
+            b[i] = b[i] > 0.0f ? powf(b[i], e[i]) : 0.0f;
+        return Float4::Load(b);
+    }
+
+    static uint8_t toByte(float value)
+    {
+        return (uint8_t)(std::min(std::max(value, 0.0f), 1.0f) * 255.0f + 0.5f);
+    }
+
+    static float glslMod(float x, float y)
+    {
+        return x - y * floorf(x / y);
+    }
+
+    // userShader.fs 中的 AdjustHSL(color, hueShift, 0, 0)
+    static glm::vec3 adjustHue(glm::vec3 color, float hueShift)
+    {
+        float maxc = std::max(std::max(color.r, color.g), color.b);
+        float minc = std::min(std::min(color.r, color.g), color.b);
+        float delta = maxc - minc;
+        float h = 0.0f;
+        float s = 0.0f;
+        float l = (maxc + minc) * 0.5f;
+        if (delta > 0.0001f)
+        {
+            if (maxc == color.r)
+                h = glslMod((color.g - color.b) / delta, 6.0f);
+            else if (maxc == color.g)
+                h = (color.b - color.r) / delta + 2.0f;
+            else
+                h = (color.r - color.g) / delta + 4.0f;
+            h /= 6.0f;
+            s = delta / (1.0f - fabsf(2.0f * l - 1.0f));
+        }
+        h = glslMod(h + hueShift, 1.0f);
+        s = std::min(std::max(s, 0.0f), 1.0f);
+        l = std::min(std::max(l, 0.0f), 1.0f);
+        float c = (1.0f - fabsf(2.0f * l - 1.0f)) * s;
+        float x = c * (1.0f - fabsf(glslMod(h * 6.0f, 2.0f) - 1.0f));
+        float m = l - 0.5f * c;
+        glm::vec3 rgb;
+        if (h < 1.0f / 6.0f)
+            rgb = glm::vec3(c, x, 0.0f);
+        else if (h < 2.0f / 6.0f)
+            rgb = glm::vec3(x, c, 0.0f);
+        else if (h < 3.0f / 6.0f)
+            rgb = glm::vec3(0.0f, c, x);
+        else if (h < 4.0f / 6.0f)
+            rgb = glm::vec3(0.0f, x, c);
+        else if (h < 5.0f / 6.0f)
+            rgb = glm::vec3(x, 0.0f, c);
+        else
+            rgb = glm::vec3(c, 0.0f, x);
+        return rgb + glm::vec3(m);
+    }
+};
+#endif
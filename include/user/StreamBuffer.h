@@ -0,0 +1,195 @@
+#ifndef STREAM_BUFFER_H
+#define STREAM_BUFFER_H
+
+#include <glad/glad.h>
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <algorithm>
+using namespace std;
+
+// 持久映射的流式缓冲（需要 GL 4.4 的 glBufferStorage）。
+// 一块大缓冲分成 FRAME_COUNT 段，每帧使用一段，以 PERSISTENT | COHERENT 方式映射一次后一直保持映射，
+// 写入后不需要任何 glBufferSubData / 映射调用，GPU读到的就是CPU写的内容。
+// 每段在一帧结束时插入栅栏，轮到复用它时先等待栅栏，保证GPU已经读完。
+// 段内用原子的碰撞指针分配，可以在线程池中并发分配和写入（写完后由主线程发出绘制）。
+// 每帧的动态数据（uniform块、实例数据、光源等）都从这里按需切一块，用 glBindBufferRange 或顶点缓冲偏移使用。
+// 低于 4.4 的上下文中不创建缓冲，Valid() 为false，所有分配都失败，调用方退回各自的普通上传。
+class StreamBuffer
+{
+public:
+    static const int FRAME_COUNT = 3;
+
+    struct Allocation
+    {
+        void* data = nullptr;   // 映射的地址，分配失败时为空
+        GLintptr offset = 0;    // 在整个缓冲中的偏移
+
+        explicit operator bool() const { return data != nullptr; }
+    };
+
+    struct Stats
+    {
+        size_t bytesUsed;               // 本帧已分配的字节数
+        size_t peakBytes;               // 历史最大
+        unsigned int allocations;       // 本帧分配次数
+        unsigned int failedAllocations; // 本帧因空间不足失败的次数（调用方会退回普通上传）
+        unsigned int fenceStalls;       // 累计因GPU还没读完而等待的次数
+    };
+
+    StreamBuffer(size_t bytesPerFrame = 8 * 1024 * 1024) : frameSize(bytesPerFrame)
+    {
+        for (GLsync& fence : fences)
+            fence = nullptr;
+        if (!GLAD_GL_VERSION_4_4)
+            return;
+        GLint alignment = 256;
+        glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+        uniformAlignment = std::max<GLint>(16, alignment);
+        glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &alignment);
+        storageAlignment = std::max<GLint>(16, alignment);
+        // 段的大小对齐到最大的对齐要求，每段的起点就满足所有对齐
+        size_t segmentAlignment = (size_t)std::max(uniformAlignment, storageAlignment);
+        frameSize = (frameSize + segmentAlignment - 1) / segmentAlignment * segmentAlignment;
+
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glGenBuffers(1, &buffer);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+        glBufferStorage(GL_COPY_WRITE_BUFFER, frameSize * FRAME_COUNT, NULL, flags);
+        mapped = (uint8_t*)glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, frameSize * FRAME_COUNT, flags);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
+
+    ~StreamBuffer()
+    {
+        for (GLsync fence : fences)
+        {
+            if (fence)
+                glDeleteSync(fence);
+        }
+        if (mapped)
+        {
+            glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+            glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        }
+        glDeleteBuffers(1, &buffer);
+    }
+
+    StreamBuffer(const StreamBuffer&) = delete;
+    StreamBuffer& operator=(const StreamBuffer&) = delete;
+
+    unsigned int Buffer() const { return buffer; }
+    size_t UniformAlignment() const { return (size_t)uniformAlignment; }
+    size_t StorageAlignment() const { return (size_t)storageAlignment; }
+    size_t FrameSize() const { return frameSize; }
+    bool Valid() const { return mapped != nullptr; }
+
+    Stats stats = {};
+
+    // 每帧开始时调用：切换到下一段，必要时等待GPU读完它
+    void BeginFrame()
+    {
+        segment = (segment + 1) % FRAME_COUNT;
+        GLsync& fence = fences[segment];
+        if (fence)
+        {
+            if (glClientWaitSync(fence, 0, 0) == GL_TIMEOUT_EXPIRED)
+            {
+                stats.fenceStalls++;
+                while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED)
+                {
+                }
+            }
+            glDeleteSync(fence);
+            fence = nullptr;
+        }
+        head.store(0, memory_order_relaxed);
+        allocationCount.store(0, memory_order_relaxed);
+        failedCount.store(0, memory_order_relaxed);
+    }
+
+    // 本帧最后一个使用这段数据的命令之后调用
+    void EndFrame()
+    {
+        if (mapped)
+            fences[segment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        stats.bytesUsed = head.load(memory_order_relaxed);
+        stats.peakBytes = std::max(stats.peakBytes, stats.bytesUsed);
+        stats.allocations = allocationCount.load(memory_order_relaxed);
+        stats.failedAllocations = failedCount.load(memory_order_relaxed);
+    }
+
+    // 从本帧的段中分配（线程安全、无锁）。alignment 必须是2的幂
+    Allocation Allocate(size_t size, size_t alignment = 16)
+    {
+        Allocation result;
+        if (!mapped)
+            return result;
+        size_t offset = head.load(memory_order_relaxed);
+        for (;;)
+        {
+            size_t aligned = (offset + alignment - 1) & ~(alignment - 1);
+            size_t next = aligned + size;
+            if (next > frameSize)
+            {
+                failedCount.fetch_add(1, memory_order_relaxed);
+                return result;
+            }
+            if (head.compare_exchange_weak(offset, next, memory_order_relaxed))
+            {
+                size_t absolute = (size_t)segment * frameSize + aligned;
+                result.data = mapped + absolute;
+                result.offset = (GLintptr)absolute;
+                allocationCount.fetch_add(1, memory_order_relaxed);
+                return result;
+            }
+        }
+    }
+
+    // 分配并复制数据，常用于整块上传
+    Allocation Write(const void* data, size_t size, size_t alignment = 16)
+    {
+        Allocation result = Allocate(size, alignment);
+        if (result && size > 0)
+            memcpy(result.data, data, size);
+        return result;
+    }
+
+    // 分配一块 uniform 数据并绑定到 GL_UNIFORM_BUFFER 的绑定点
+    bool BindUniform(unsigned int binding, const void* data, size_t size)
+    {
+        Allocation a = Write(data, size, (size_t)uniformAlignment);
+        if (a)
+            glBindBufferRange(GL_UNIFORM_BUFFER, binding, buffer, a.offset, (GLsizeiptr)size);
+        return (bool)a;
+    }
+
+    // 分配一块着色器存储数据并绑定到 GL_SHADER_STORAGE_BUFFER 的绑定点（size为0时也分配最小的一块，绑定不能为空）
+    bool BindStorage(unsigned int binding, const void* data, size_t size)
+    {
+        size_t bytes = std::max<size_t>(size, 16);
+        Allocation a = Allocate(bytes, (size_t)storageAlignment);
+        if (!a)
+            return false;
+        if (size > 0)
+            memcpy(a.data, data, size);
+        glBindBufferRange(GL_SHADER_STORAGE_BUFFER, binding, buffer, a.offset, (GLsizeiptr)bytes);
+        return true;
+    }
+
+private:
+    unsigned int buffer = 0;
+    uint8_t* mapped = nullptr;
+    size_t frameSize;
+    GLint uniformAlignment = 256;
+    GLint storageAlignment = 256;
+    int segment = 0;
+    GLsync fences[FRAME_COUNT];
+    atomic<size_t> head{ 0 };
+    atomic<unsigned int> allocationCount{ 0 };
+    atomic<unsigned int> failedCount{ 0 };
+};
+#endif
@@ -0,0 +1,178 @@
+#ifndef TEMPORAL_AA_H
+#define TEMPORAL_AA_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <user/Shader.h>
+#include <user/FrameGraph.h>
+#include <user/GLCompat.h>
+
+#include <cmath>
+#include <algorithm>
+using namespace std;
+
+// 时间抗锯齿与时间上采样。场景用带子像素抖动的投影渲染（见 Camera::ApplyJitter），
+// 之后在帧图中追加两个通道：
+//   TAAVelocity  由深度和上一帧的视图投影矩阵生成速度缓冲（RG16F，场景分辨率）
+//   TAAResolve   沿速度重投影历史，用邻域颜色的方差裁剪历史，再与本帧混合，输出窗口分辨率
+// 历史在两张窗口分辨率的纹理之间交替，作为导入资源交给帧图。
+// 速度缓冲只包含相机运动；运动物体上的历史由邻域裁剪兜底。
+class TemporalAA
+{
+public:
+    bool enabled = true;
+    float feedback = 0.1f;      // 原生分辨率下本帧颜色的混合权重
+
+    TemporalAA() : velocityShader("Shader/screen.vs", "Shader/taaVelocity.fs"), resolveShader("Shader/screen.vs", "Shader/taaResolve.fs")
+    {
+        velocityShader.use();
+        velocityShader.setInt("sceneDepth", 0);
+        resolveShader.use();
+        resolveShader.setInt("sceneColor", 0);
+        resolveShader.setInt("sceneDepth", 1);
+        resolveShader.setInt("velocityBuffer", 2);
+        resolveShader.setInt("historyColor", 3);
+    }
+
+    ~TemporalAA()
+    {
+        glDeleteTextures(2, history);
+    }
+
+    TemporalAA(const TemporalAA&) = delete;
+    TemporalAA& operator=(const TemporalAA&) = delete;
+
+    // 抖动相位数：每个输出像素平均需要约8个样本，渲染比例越低相位越多
+    static unsigned int JitterPhases(float renderScale)
+    {
+        unsigned int phases = (unsigned int)ceilf(8.0f / (renderScale * renderScale));
+        return std::min(32u, std::max(8u, phases));
+    }
+
+    // 在帧图中加入速度和累积通道，返回窗口分辨率的结果。
+    // viewProjection 不带抖动；jitter 与 Camera::Jitter 相同，单位为场景像素
+    FrameGraph::Resource AddPasses(FrameGraph& graph, FrameGraph::Resource sceneColor, FrameGraph::Resource sceneDepth,
+        int outputWidth, int outputHeight, const glm::mat4& viewProjection, glm::vec2 jitter, unsigned int quadVAO)
+    {
+        ensureHistory(graph, outputWidth, outputHeight);
+        const FrameGraphTextureDesc sceneDesc = graph.Desc(sceneColor);
+        frameViewProjection = viewProjection;
+        sceneSize = glm::vec2((float)sceneDesc.width, (float)sceneDesc.height);
+        outputSize = glm::vec2((float)outputWidth, (float)outputHeight);
+        jitterUV = jitter / sceneSize;
+        // 降低分辨率时每个输出像素分到的样本更少，历史的权重相应加大
+        float scale = sceneSize.x / outputSize.x;
+        frameFeedback = std::max(0.04f, feedback * scale * scale);
+
+        FrameGraphTextureDesc historyDesc = { outputWidth, outputHeight, GL_RGBA16F, GL_LINEAR };
+        FrameGraph::Resource previous = graph.Import("TAAHistory", history[current ^ 1], historyDesc);
+        FrameGraph::Resource output = graph.Import("TAAOutput", history[current], historyDesc);
+        FrameGraph::Resource velocity = FrameGraph::INVALID;
+
+        graph.AddPass("TAAVelocity", [&](FrameGraph::Builder& builder)
+        {
+            builder.Read(sceneDepth);
+            velocity = builder.Create("Velocity", { sceneDesc.width, sceneDesc.height, GL_RG16F, GL_NEAREST });
+        }, [this, &graph, sceneDepth, quadVAO]()
+        {
+            glDisable(GL_DEPTH_TEST);
+            glDisable(GL_BLEND);
+            velocityShader.use();
+            velocityShader.setMat4("inverseViewProjection", glm::inverse(frameViewProjection));
+            velocityShader.setMat4("previousViewProjection", historyValid ? previousViewProjection : frameViewProjection);
+            velocityShader.setVec2("jitterUV", jitterUV);
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, graph.Texture(sceneDepth));
+            glBindVertexArray(quadVAO);
+            glDrawArrays(GL_TRIANGLES, 0, 6);
+            glEnable(GL_BLEND);
+        });
+        graph.AddPass("TAAResolve", [&](FrameGraph::Builder& builder)
+        {
+            builder.Read(sceneColor);
+            builder.Read(sceneDepth);
+            builder.Read(velocity);
+            builder.Read(previous);
+            builder.Write(output);
+        }, [this, &graph, sceneColor, sceneDepth, velocity, previous, quadVAO]()
+        {
+            glDisable(GL_DEPTH_TEST);
+            glDisable(GL_BLEND);
+            resolveShader.use();
+            resolveShader.setVec2("sceneSize", sceneSize);
+            resolveShader.setVec2("outputSize", outputSize);
+            resolveShader.setVec2("jitterUV", jitterUV);
+            resolveShader.setFloat("feedback", frameFeedback);
+            resolveShader.setBool("historyValid", historyValid);
+            FrameGraph::Resource inputs[4] = { sceneColor, sceneDepth, velocity, previous };
+            for (unsigned int i = 0; i < 4; i++)
+            {
+                glActiveTexture(GL_TEXTURE0 + i);
+                glBindTexture(GL_TEXTURE_2D, graph.Texture(inputs[i]));
+            }
+            glActiveTexture(GL_TEXTURE0);
+            glBindVertexArray(quadVAO);
+            glDrawArrays(GL_TRIANGLES, 0, 6);
+            glEnable(GL_BLEND);
+        });
+        return output;
+    }
+
+    // 帧图执行完之后调用：本帧的输出成为下一帧的历史
+    void EndFrame()
+    {
+        previousViewProjection = frameViewProjection;
+        historyValid = true;
+        current ^= 1;
+    }
+
+    // 历史不再可用（关闭过TAA、相机瞬移等），下一帧直接使用本帧颜色
+    void Invalidate()
+    {
+        historyValid = false;
+    }
+
+private:
+    Shader velocityShader;
+    Shader resolveShader;
+    unsigned int history[2] = { 0, 0 };
+    int historyWidth = 0;
+    int historyHeight = 0;
+    int current = 0;
+    bool historyValid = false;
+    glm::mat4 previousViewProjection = glm::mat4(1.0f);
+    glm::mat4 frameViewProjection = glm::mat4(1.0f);
+    glm::vec2 sceneSize = glm::vec2(1.0f);
+    glm::vec2 outputSize = glm::vec2(1.0f);
+    glm::vec2 jitterUV = glm::vec2(0.0f);
+    float frameFeedback = 0.1f;
+
+    // 窗口尺寸改变时重新创建历史纹理
+    void ensureHistory(FrameGraph& graph, int width, int height)
+    {
+        if (history[0] != 0 && width == historyWidth && height == historyHeight)
+            return;
+        for (unsigned int texture : history)
+        {
+            if (texture != 0)
+                graph.ForgetTexture(texture);
+        }
+        glDeleteTextures(2, history);
+        glGenTextures(2, history);
+        for (unsigned int texture : history)
+        {
+            glBindTexture(GL_TEXTURE_2D, texture);
+            GLCompat::TexStorage2D(GL_TEXTURE_2D, GL_RGBA16F, width, height);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        }
+        glBindTexture(GL_TEXTURE_2D, 0);
+        historyWidth = width;
+        historyHeight = height;
+        historyValid = false;
+    }
+};
+#endif
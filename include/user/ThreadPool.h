@@ -0,0 +1,151 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <deque>
+#include <vector>
+#include <string>
+using namespace std;
+
+#include <user/CpuProfiler.h>
+
+// 简单的线程池。工作线程不接触OpenGL上下文，只做CPU侧的工作（场景遍历、剔除、命令录制等）
+class ThreadPool
+{
+public:
+    // threadCount为0时使用 硬件线程数-1 个工作线程（调用线程本身也会参与ParallelFor）
+    ThreadPool(unsigned int threadCount = 0)
+    {
+        if (threadCount == 0)
+        {
+            unsigned int hardware = std::thread::hardware_concurrency();
+            threadCount = hardware > 1 ? hardware - 1 : 1;
+        }
+        for (unsigned int i = 0; i < threadCount; i++)
+            workers.emplace_back([this, i]() { workerLoop(i); });
+    }
+
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wakeup.notify_all();
+        for (std::thread& worker : workers)
+            worker.join();
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // 工作线程数量（不含调用线程）
+    unsigned int WorkerCount() const
+    {
+        return (unsigned int)workers.size();
+    }
+
+    // 最多可以同时执行的切片数量（工作线程 + 调用线程）
+    unsigned int SliceCount() const
+    {
+        return (unsigned int)workers.size() + 1;
+    }
+
+    // 异步执行一个任务，不等待完成
+    void Enqueue(std::function<void()> job)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            jobs.push_back(std::move(job));
+        }
+        wakeup.notify_one();
+    }
+
+    // 把[0, count)切分成互不相交的连续切片并行执行，调用线程也参与，返回前所有切片都已完成。
+    // func(begin, end, slice)：slice为切片编号，可用于索引每个切片独享的数据
+    // minGrain为每个切片的最少元素数，避免小任务的调度开销超过收益
+    // 可以在任务内部嵌套调用：等待期间调用线程会取出队列中的任务执行，不会因为工作线程都在等待而死锁
+    void ParallelFor(size_t count, size_t minGrain, const std::function<void(size_t, size_t, unsigned int)>& func)
+    {
+        if (count == 0)
+            return;
+        size_t slices = SliceCount();
+        if (minGrain > 0 && count / minGrain < slices)
+            slices = count / minGrain;
+        if (slices <= 1)
+        {
+            func(0, count, 0);
+            return;
+        }
+        size_t remaining = slices - 1;
+        std::mutex doneMutex;
+        std::condition_variable done;
+        for (size_t s = 1; s < slices; s++)
+        {
+            size_t begin = count * s / slices;
+            size_t end = count * (s + 1) / slices;
+            Enqueue([&, begin, end, s]()
+            {
+                func(begin, end, (unsigned int)s);
+                // 在锁内递减，保证调用线程返回（销毁这些局部变量）之前我们已经不再访问它们
+                std::lock_guard<std::mutex> lock(doneMutex);
+                if (--remaining == 0)
+                    done.notify_one();
+            });
+        }
+        func(0, count / slices, 0);
+        for (;;)
+        {
+            {
+                std::lock_guard<std::mutex> lock(doneMutex);
+                if (remaining == 0)
+                    return;
+            }
+            // 本次的切片可能还排在队列里（例如所有工作线程都在嵌套的 ParallelFor 中等待），自己执行
+            std::function<void()> job;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!jobs.empty())
+                {
+                    job = std::move(jobs.front());
+                    jobs.pop_front();
+                }
+            }
+            if (!job)
+                break; // 队列已空，剩下的切片都已经在其他线程上执行
+            job();
+        }
+        std::unique_lock<std::mutex> lock(doneMutex);
+        done.wait(lock, [&]() { return remaining == 0; });
+    }
+
+private:
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> jobs;
+    std::mutex mutex;
+    std::condition_variable wakeup;
+    bool stopping = false;
+
+    void workerLoop(unsigned int index)
+    {
+        CpuProfiler::Instance().SetThreadName("Worker " + std::to_string(index));
+        for (;;)
+        {
+            std::function<void()> job;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wakeup.wait(lock, [this]() { return stopping || !jobs.empty(); });
+                if (stopping && jobs.empty())
+                    return;
+                job = std::move(jobs.front());
+                jobs.pop_front();
+            }
+            CPU_ZONE("ThreadPool::Job");
+            job();
+        }
+    }
+};
+#endif
@@ -2,6 +2,7 @@
 #include <GLFW/glfw3.h>
 #include <iostream>
 #include <cmath>
+#include <algorithm>
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
@@ -16,6 +17,26 @@
 #include <user/Shader.h>
 #include <user/Camera.h>
 #include <user/Model.h>
+#include <user/ClusteredLighting.h>
+#include <user/FrameGraph.h>
+#include <user/GBuffer.h>
+#include <user/CascadedShadowMap.h>
+#include <user/ShadowAtlas.h>
+#include <user/DynamicResolution.h>
+#include <user/TemporalAA.h>
+#include <user/GpuProfiler.h>
+#include <user/CpuProfiler.h>
+#include <user/CpuProfilerWindow.h>
+#include <user/FramePacer.h>
+#include <user/StreamBuffer.h>
+#include <user/GLCompat.h>
+#include <user/Headless.h>
+#include <user/FrameCapture.h>
+#include <user/Benchmark.h>
+#include <user/SoftwareRasterizer.h>
+#include <user/Regression.h>
+
+#include <memory>
 
 #ifdef _WIN32
 #include <windows.h>
@@ -29,6 +50,8 @@ void processInput(GLFWwindow* window);
 // settings
 const unsigned int SCR_WIDTH = 800;
 const unsigned int SCR_HEIGHT = 600;
+int framebufferWidth = SCR_WIDTH;//窗口帧缓冲的当前尺寸，窗口大小改变时更新
+int framebufferHeight = SCR_HEIGHT;
 
 bool isMouseCaptured = true;
 
@@ -39,22 +62,233 @@ float lastFrame = 0.0f;
 
 glm::vec3 lightPos(2.0f, 2.0f, 2.0f);
 
-int main()
+// 立方体的顶点数据（36个顶点，不带索引复用），GL路径和软件光栅化共用
+const float cubeVertices[] = {
+    //位置，UV，法向量
+    -0.5f, -0.5f, -0.5f,  0.0f, 0.0f,   0.0f, 0.0f, -1.0f,
+    0.5f, -0.5f, -0.5f,  1.0f, 0.0f,   0.0f, 0.0f, -1.0f,
+    0.5f,  0.5f, -0.5f,  1.0f, 1.0f,   0.0f, 0.0f, -1.0f,
+    0.5f,  0.5f, -0.5f,  1.0f, 1.0f,   0.0f, 0.0f, -1.0f,
+    -0.5f,  0.5f, -0.5f,  0.0f, 1.0f,   0.0f, 0.0f, -1.0f,
+    -0.5f, -0.5f, -0.5f,  0.0f, 0.0f,   0.0f, 0.0f, -1.0f,
+
+    -0.5f, -0.5f,  0.5f,  0.0f, 0.0f,   0.0f, 0.0f, 1.0f,
+    0.5f, -0.5f,  0.5f,  1.0f, 0.0f,   0.0f, 0.0f, 1.0f,
+    0.5f,  0.5f,  0.5f,  1.0f, 1.0f,   0.0f, 0.0f, 1.0f,
+    0.5f,  0.5f,  0.5f,  1.0f, 1.0f,   0.0f, 0.0f, 1.0f,
+    -0.5f,  0.5f,  0.5f,  0.0f, 1.0f,   0.0f, 0.0f, 1.0f,
+    -0.5f, -0.5f,  0.5f,  0.0f, 0.0f,   0.0f, 0.0f, 1.0f,
+
+    -0.5f,  0.5f,  0.5f,  1.0f, 0.0f,   -1.0f, 0.0f, 0.0f,
+    -0.5f,  0.5f, -0.5f,  1.0f, 1.0f,   -1.0f, 0.0f, 0.0f,
+    -0.5f, -0.5f, -0.5f,  0.0f, 1.0f,   -1.0f, 0.0f, 0.0f,
+    -0.5f, -0.5f, -0.5f,  0.0f, 1.0f,   -1.0f, 0.0f, 0.0f,
+    -0.5f, -0.5f,  0.5f,  0.0f, 0.0f,   -1.0f, 0.0f, 0.0f,
+    -0.5f,  0.5f,  0.5f,  1.0f, 0.0f,   -1.0f, 0.0f, 0.0f,
+
+    0.5f,  0.5f,  0.5f,  1.0f, 0.0f,   1.0f, 0.0f, 0.0f,
+    0.5f,  0.5f, -0.5f,  1.0f, 1.0f,   1.0f, 0.0f, 0.0f,
+    0.5f, -0.5f, -0.5f,  0.0f, 1.0f,   1.0f, 0.0f, 0.0f,
+    0.5f, -0.5f, -0.5f,  0.0f, 1.0f,   1.0f, 0.0f, 0.0f,
+    0.5f, -0.5f,  0.5f,  0.0f, 0.0f,   1.0f, 0.0f, 0.0f,
+    0.5f,  0.5f,  0.5f,  1.0f, 0.0f,   1.0f, 0.0f, 0.0f,
+
+    -0.5f, -0.5f, -0.5f,  0.0f, 1.0f,   0.0f, -1.0f, 0.0f,
+    0.5f, -0.5f, -0.5f,  1.0f, 1.0f,   0.0f, -1.0f, 0.0f,
+    0.5f, -0.5f,  0.5f,  1.0f, 0.0f,   0.0f, -1.0f, 0.0f,
+    0.5f, -0.5f,  0.5f,  1.0f, 0.0f,   0.0f, -1.0f, 0.0f,
+    -0.5f, -0.5f,  0.5f,  0.0f, 0.0f,   0.0f, -1.0f, 0.0f,
+    -0.5f, -0.5f, -0.5f,  0.0f, 1.0f,   0.0f, -1.0f, 0.0f,
+
+    -0.5f,  0.5f, -0.5f,  0.0f, 1.0f,   0.0f, 1.0f, 0.0f,
+    0.5f,  0.5f, -0.5f,  1.0f, 1.0f,   0.0f, 1.0f, 0.0f,
+    0.5f,  0.5f,  0.5f,  1.0f, 0.0f,   0.0f, 1.0f, 0.0f,
+    0.5f,  0.5f,  0.5f,  1.0f, 0.0f,   0.0f, 1.0f, 0.0f,
+    -0.5f,  0.5f,  0.5f,  0.0f, 0.0f,   0.0f, 1.0f, 0.0f,
+    -0.5f,  0.5f, -0.5f,  0.0f, 1.0f,   0.0f, 1.0f, 0.0f
+};
+// 10个立方体的位置
+const glm::vec3 cubePositions[] = {
+    glm::vec3(0.0f,  0.0f,  0.0f),
+    glm::vec3(2.0f,  5.0f, -15.0f),
+    glm::vec3(-1.5f, -2.2f, -2.5f),
+    glm::vec3(-3.8f, -2.0f, -12.3f),
+    glm::vec3(2.4f, -0.4f, -3.5f),
+    glm::vec3(-1.7f,  3.0f, -7.5f),
+    glm::vec3(1.3f, -2.0f, -2.5f),
+    glm::vec3(1.5f,  2.0f, -2.5f),
+    glm::vec3(1.5f,  0.2f, -1.5f),
+    glm::vec3(-1.3f,  1.0f, -1.5f)
+};
+
+// 场景描述：物体的变换、材质参数和灯光，GL路径和软件光栅化都从这里取，两边渲染的是同一个场景
+struct SceneMaterialParams
 {
+    glm::vec3 baseColor;
+    glm::vec3 specular;
+    float shininess;
+};
+struct SceneDescription
+{
+    SceneMaterialParams cubeMaterial = { glm::vec3(1.0f), glm::vec3(1.0f), 32.0f };
+    SceneMaterialParams floorMaterial = { glm::vec3(0.6f), glm::vec3(0.2f), 16.0f };   // 地面没有纹理（白色）
+    glm::mat4 floorModel = glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, -3.5f, -7.0f)), glm::vec3(20.0f, 0.2f, 24.0f));
+    float colorValue = 0.5f;                        // ourColor.x，色相偏移 = 时间 / colorValue
+
+    glm::vec3 dirColor = glm::vec3(0.2f, 0.2f, 0.0f);
+    glm::vec3 dirSpecular = glm::vec3(0.2f, 0.2f, 0.0f);
+    glm::vec3 dirDirection = glm::vec3(-1.0f, -1.0f, -1.0f);
+
+    glm::vec3 spotColor = glm::vec3(0.0f, 0.0f, 2.0f);
+    glm::vec3 spotSpecular = glm::vec3(0.0f, 0.0f, 1.0f);
+    glm::vec3 spotDirection = glm::vec3(0.0f, -1.0f, 0.0f);
+    float spotAngle = glm::radians(15.0f);
+    float spotSmoothness = glm::radians(3.0f);
+    glm::vec3 spotAttenuation = glm::vec3(1.0f, 0.22f, 0.2f);
+
+    // 灯光立方体的位置，聚光灯和第一个点光源也在这里
+    glm::vec3 LightPosition(float time) const
+    {
+        return glm::vec3(sin(time) * 2, 1.0f, 0.0f);
+    }
+
+    glm::mat4 LightModel(float time) const
+    {
+        return glm::scale(glm::translate(glm::mat4(1.0f), LightPosition(time)), glm::vec3(0.2f));
+    }
+
+    glm::mat4 CubeModel(unsigned int i, float time) const
+    {
+        glm::mat4 model = glm::mat4(1.0f);
+        model = glm::translate(model, cubePositions[i]);
+        model = glm::rotate(model, time * glm::radians(50.0f) + i * 50.0f, glm::vec3(1.0f, 0.3f, 0.5f));
+        float angle = 20.0f * i;
+        return glm::rotate(model, glm::radians(angle), glm::vec3(1.0f, 0.3f, 0.5f));
+    }
+
+    glm::mat4 BackpackModel(float time) const
+    {
+        glm::mat4 model = glm::mat4(1.0f);
+        model = glm::translate(model, glm::vec3(2.0f, 0.0f, 0.0f));
+        model = glm::scale(model, glm::vec3(0.2f, 0.2f, 0.2f));
+        return glm::rotate(model, (float)glm::radians(time * 90.0f), glm::vec3(1.0f, 1.0f, 0.0f));
+    }
+};
+const SceneDescription sceneDesc;
+
+// 场景中的点光源：4个固定的（投射阴影）+ extraLightCount 个绕立方体阵列运动的
+void addScenePointLights(vector<ClusterPointLight>& lights, float time, int extraLightCount);
+// --software：用CPU软件光栅化渲染同一个场景，不创建窗口和OpenGL上下文
+int renderSoftware(const Headless::Options& options, Regression* regression, int extraLightCount);
+
+// 每帧的相机数据，与着色器中的 FrameData uniform块(std140)一致
+#define FRAME_UNIFORM_BINDING 0
+struct FrameUniforms
+{
+    glm::mat4 view;
+    glm::mat4 projection;               // 带TAA抖动
+    glm::mat4 inverseViewProjection;
+    glm::vec4 viewPos;
+};
+
+int main(int argc, char** argv)
+{
+    CpuProfiler& cpuProfiler = CpuProfiler::Instance();
+    cpuProfiler.SetThreadName("Main");
 #ifdef _WIN32
     // 在Windows上设置控制台支持UTF-8
     SetConsoleOutputCP(CP_UTF8);
 #endif
 
-    glfwInit();
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-
-
+    // --headless 时不创建可见窗口，渲染固定帧数后把图像和耗时写到输出目录
+    // --benchmark 时沿相机路径按固定步长回放，输出性能数据
+    Headless::Options headlessOptions;
+    headlessOptions.width = SCR_WIDTH;
+    headlessOptions.height = SCR_HEIGHT;
+    Benchmark::Options benchmarkOptions;
+    Regression::Options regressionOptions;
+    int extraLightCount = 0;//额外的动态点光源数量，分簇光照的压力测试用 --lights N 或界面上的滑条打开
+    for (int i = 1; i < argc;)
+    {
+        int used = Headless::ParseArg(argc, argv, i, headlessOptions);
+        if (used == 0)
+            used = Benchmark::ParseArg(argc, argv, i, benchmarkOptions);
+        if (used == 0)
+            used = Regression::ParseArg(argc, argv, i, regressionOptions);
+        if (used == 0 && string(argv[i]) == "--lights" && i + 1 < argc)
+        {
+            extraLightCount = std::max(0, atoi(argv[i + 1]));
+            used = 2;
+        }
+        if (used == 0)
+        {
+            std::cout << "未知参数: " << argv[i] << "\n用法: " << argv[0] << " [选项]\n" << Headless::Usage() << Benchmark::Usage() << Regression::Usage()
+                << "  --lights N                  额外的动态点光源数量（分簇光照压力测试，默认0）\n";
+            return -1;
+        }
+        i += used;
+    }
+    if (!benchmarkOptions.compareBaseline.empty())
+        return Benchmark::Compare(benchmarkOptions.compareBaseline, benchmarkOptions.compareCurrent, benchmarkOptions.threshold);
+    // --regression 在固定画面上与基准图像比较，总是离屏渲染
+    unique_ptr<Regression> regression;
+    if (regressionOptions.enabled)
+    {
+        if (benchmarkOptions.enabled)
+        {
+            std::cout << "回归测试和基准测试不能同时进行" << std::endl;
+            return -1;
+        }
+        if (regressionOptions.goldenDir.empty())
+            regressionOptions.goldenDir = headlessOptions.software ? "regression/software" : "regression/gl";
+        // 软件光栅化没有跨帧的状态，每个画面渲染一帧就够了
+        if (headlessOptions.software)
+            regressionOptions.settleFrames = 1;
+        headlessOptions.enabled = true;
+        regression.reset(new Regression(regressionOptions, headlessOptions.outputDir, headlessOptions.width, headlessOptions.height));
+        headlessOptions.frames = regression->TotalFrames();
+    }
+    if (headlessOptions.software)
+        return renderSoftware(headlessOptions, regression.get(), extraLightCount);
+    unique_ptr<Benchmark> benchmark;
+    if (benchmarkOptions.enabled)
+    {
+        CameraPath benchmarkPath;
+        if (benchmarkOptions.pathFile.empty())
+            benchmarkPath = CameraPath::Orbit(glm::vec3(0.0f, -0.5f, -3.0f), 8.0f, 3.0f, 20.0f);
+        else if (!benchmarkPath.Load(benchmarkOptions.pathFile))
+        {
+            std::cout << "无法读取相机路径 " << benchmarkOptions.pathFile << std::endl;
+            return -1;
+        }
+        benchmark.reset(new Benchmark(benchmarkOptions, benchmarkPath, headlessOptions.fixedDelta));
+        // 无头模式下由基准测试决定帧数
+        headlessOptions.frames = benchmark->TotalFrames();
+    }
 
-    //创建窗口
-    GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "LearnOpenGL", NULL, NULL);
+    //创建窗口：依次尝试的上下文版本，4.3: 着色器存储缓冲和保守遮挡查询 4.4: 持久映射缓冲 4.5: 直接状态访问
+    //版本不够时对应的功能自动关闭或退回，见 GLCompat.h
+    const int contextVersions[][2] = { { 4, 5 }, { 4, 3 }, { 3, 3 } };
+    GLFWwindow* window = NULL;
+    if (!headlessOptions.enabled)
+        glfwInit();
+    for (const auto& version : contextVersions)
+    {
+        if (headlessOptions.enabled)
+        {
+            window = Headless::CreateContext(headlessOptions.width, headlessOptions.height, version[0], version[1]);
+        }
+        else
+        {
+            glfwDefaultWindowHints();
+            glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, version[0]);
+            glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, version[1]);
+            glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+            window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "LearnOpenGL", NULL, NULL);
+        }
+        if (window)
+            break;
+    }
     if (window == NULL)
     {
         std::cout << "窗口对象创建失败" << std::endl;
@@ -67,21 +301,35 @@ int main()
     }
     glfwMakeContextCurrent(window);
 
-    glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);//设置鼠标为隐藏并捕捉
-    glfwSetCursorPosCallback(window, mouse_callback);//注册鼠标监听回调
-    glfwSetScrollCallback(window, scroll_callback);//注册滚轮监听回调
+    if (headlessOptions.enabled)
+    {
+        // 没有默认帧缓冲，输出尺寸固定为离屏目标的尺寸
+        framebufferWidth = headlessOptions.width;
+        framebufferHeight = headlessOptions.height;
+    }
+    else
+    {
+        glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);//设置鼠标为隐藏并捕捉
+        glfwSetCursorPosCallback(window, mouse_callback);//注册鼠标监听回调
+        glfwSetScrollCallback(window, scroll_callback);//注册滚轮监听回调
+        glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);//注册窗口尺寸改变回调
+        glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+    }
 
     IMGUI_CHECKVERSION();
     ImGui::CreateContext();
     ImGui_ImplGlfw_InitForOpenGL(window, true);
     ImGui_ImplOpenGL3_Init("#version 130");
 
-    //加载中文字体
+    //加载中文字体（无头模式不画界面，用默认字体即可）
     ImGuiIO& io = ImGui::GetIO();
-    ImFont* font = io.Fonts->AddFontFromFileTTF("C:/Windows/Fonts/simhei.ttf", 12.0f, NULL, io.Fonts->GetGlyphRangesChineseFull());
-    if (!font)
+    if (!headlessOptions.enabled)
     {
-        std::cerr << "加载字体失败" << std::endl;
+        ImFont* font = io.Fonts->AddFontFromFileTTF("C:/Windows/Fonts/simhei.ttf", 12.0f, NULL, io.Fonts->GetGlyphRangesChineseFull());
+        if (!font)
+        {
+            std::cerr << "加载字体失败" << std::endl;
+        }
     }
 
 
@@ -91,8 +339,14 @@ int main()
         std::cout << "初始化GLAD失败" << std::endl;
         return -1;
     }
-    glViewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
+    std::cout << "OpenGL " << GLVersion.major << "." << GLVersion.minor << std::endl;
+    if (!GLCompat::StorageBuffers())
+        std::cout << "OpenGL 4.3 以下：关闭计算着色器和GPU遮挡查询，光源数据改用纹理缓冲" << std::endl;
+    glViewport(0, 0, framebufferWidth, framebufferHeight);
     glEnable(GL_DEPTH_TEST);//启用深度测试
+    unique_ptr<Headless> headless;
+    if (headlessOptions.enabled)
+        headless.reset(new Headless(headlessOptions));
 
 
     //加载图片
@@ -123,56 +377,13 @@ int main()
     //创建着色器
     Shader ourShader("Shader/userShader.vs", "Shader/userShader.fs");
     Shader lightShader("Shader/lightShader.vs", "Shader/lightShader.fs");
-    Model ourModel("assets/model/backpack/backpack.obj");
     Shader backpackShader("Shader/backpack.vs", "Shader/backpack.fs");
+    Model ourModel("assets/model/backpack/backpack.obj", backpackShader);//导入时解析材质的采样器位置
     Shader screenShader("Shader/screen.vs", "Shader/screen.fs");
+    ourShader.BindUniformBlock("FrameData", FRAME_UNIFORM_BINDING);
+    lightShader.BindUniformBlock("FrameData", FRAME_UNIFORM_BINDING);
+    backpackShader.BindUniformBlock("FrameData", FRAME_UNIFORM_BINDING);
 
-    // set up vertex data (and buffer(s)) and configure vertex attributes
-    // ------------------------------------------------------------------
-    float vertices[] = {
-        //位置，UV，法向量
-        -0.5f, -0.5f, -0.5f,  0.0f, 0.0f,   0.0f, 0.0f, -1.0f,
-        0.5f, -0.5f, -0.5f,  1.0f, 0.0f,   0.0f, 0.0f, -1.0f,
-        0.5f,  0.5f, -0.5f,  1.0f, 1.0f,   0.0f, 0.0f, -1.0f,
-        0.5f,  0.5f, -0.5f,  1.0f, 1.0f,   0.0f, 0.0f, -1.0f,
-        -0.5f,  0.5f, -0.5f,  0.0f, 1.0f,   0.0f, 0.0f, -1.0f,
-        -0.5f, -0.5f, -0.5f,  0.0f, 0.0f,   0.0f, 0.0f, -1.0f,
-
-        -0.5f, -0.5f,  0.5f,  0.0f, 0.0f,   0.0f, 0.0f, 1.0f,
-        0.5f, -0.5f,  0.5f,  1.0f, 0.0f,   0.0f, 0.0f, 1.0f,
-        0.5f,  0.5f,  0.5f,  1.0f, 1.0f,   0.0f, 0.0f, 1.0f,
-        0.5f,  0.5f,  0.5f,  1.0f, 1.0f,   0.0f, 0.0f, 1.0f,
-        -0.5f,  0.5f,  0.5f,  0.0f, 1.0f,   0.0f, 0.0f, 1.0f,
-        -0.5f, -0.5f,  0.5f,  0.0f, 0.0f,   0.0f, 0.0f, 1.0f,
-
-        -0.5f,  0.5f,  0.5f,  1.0f, 0.0f,   -1.0f, 0.0f, 0.0f,
-        -0.5f,  0.5f, -0.5f,  1.0f, 1.0f,   -1.0f, 0.0f, 0.0f,
-        -0.5f, -0.5f, -0.5f,  0.0f, 1.0f,   -1.0f, 0.0f, 0.0f,
-        -0.5f, -0.5f, -0.5f,  0.0f, 1.0f,   -1.0f, 0.0f, 0.0f,
-        -0.5f, -0.5f,  0.5f,  0.0f, 0.0f,   -1.0f, 0.0f, 0.0f,
-        -0.5f,  0.5f,  0.5f,  1.0f, 0.0f,   -1.0f, 0.0f, 0.0f,
-
-        0.5f,  0.5f,  0.5f,  1.0f, 0.0f,   1.0f, 0.0f, 0.0f,
-        0.5f,  0.5f, -0.5f,  1.0f, 1.0f,   1.0f, 0.0f, 0.0f,
-        0.5f, -0.5f, -0.5f,  0.0f, 1.0f,   1.0f, 0.0f, 0.0f,
-        0.5f, -0.5f, -0.5f,  0.0f, 1.0f,   1.0f, 0.0f, 0.0f,
-        0.5f, -0.5f,  0.5f,  0.0f, 0.0f,   1.0f, 0.0f, 0.0f,
-        0.5f,  0.5f,  0.5f,  1.0f, 0.0f,   1.0f, 0.0f, 0.0f,
-
-        -0.5f, -0.5f, -0.5f,  0.0f, 1.0f,   0.0f, -1.0f, 0.0f,
-        0.5f, -0.5f, -0.5f,  1.0f, 1.0f,   0.0f, -1.0f, 0.0f,
-        0.5f, -0.5f,  0.5f,  1.0f, 0.0f,   0.0f, -1.0f, 0.0f,
-        0.5f, -0.5f,  0.5f,  1.0f, 0.0f,   0.0f, -1.0f, 0.0f,
-        -0.5f, -0.5f,  0.5f,  0.0f, 0.0f,   0.0f, -1.0f, 0.0f,
-        -0.5f, -0.5f, -0.5f,  0.0f, 1.0f,   0.0f, -1.0f, 0.0f,
-
-        -0.5f,  0.5f, -0.5f,  0.0f, 1.0f,   0.0f, 1.0f, 0.0f,
-        0.5f,  0.5f, -0.5f,  1.0f, 1.0f,   0.0f, 1.0f, 0.0f,
-        0.5f,  0.5f,  0.5f,  1.0f, 0.0f,   0.0f, 1.0f, 0.0f,
-        0.5f,  0.5f,  0.5f,  1.0f, 0.0f,   0.0f, 1.0f, 0.0f,
-        -0.5f,  0.5f,  0.5f,  0.0f, 0.0f,   0.0f, 1.0f, 0.0f,
-        -0.5f,  0.5f, -0.5f,  0.0f, 1.0f,   0.0f, 1.0f, 0.0f
-    };
     // 添加索引数据
     unsigned int indices[] = {
         0, 1, 2, 3, 4, 5,     // 前面
@@ -206,7 +417,7 @@ int main()
     glBindVertexArray(VAO);//绑定VAO 设置为激活AVO
 
     glBindBuffer(GL_ARRAY_BUFFER, VBO);//绑定VBO
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);//将顶点数据传输到当前绑定的VBO中
+    glBufferData(GL_ARRAY_BUFFER, sizeof(cubeVertices), cubeVertices, GL_STATIC_DRAW);//将顶点数据传输到当前绑定的VBO中
 
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);//绑定EBO
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
@@ -228,7 +439,7 @@ int main()
     glGenVertexArrays(1, &lightVAO);
     glBindVertexArray(lightVAO);
     glBindBuffer(GL_ARRAY_BUFFER, VBO);//绑定VBO
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);//将顶点数据传输到当前绑定的VBO中
+    glBufferData(GL_ARRAY_BUFFER, sizeof(cubeVertices), cubeVertices, GL_STATIC_DRAW);//将顶点数据传输到当前绑定的VBO中
 
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);//绑定EBO
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
@@ -241,6 +452,21 @@ int main()
 
     glBindVertexArray(0);//解绑VAO
 
+    // 地面：同样的立方体网格，但只有一个实例，用自己的不透明材质单独绘制
+    unsigned int floorVAO;
+    glGenVertexArrays(1, &floorVAO);
+    glBindVertexArray(floorVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(5 * sizeof(float)));
+    glEnableVertexAttribArray(2);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+
     // 生成屏幕物体的VAO和VBO
     unsigned int quadVAO, quadVBO;
     glGenVertexArrays(1, &quadVAO);
@@ -262,47 +488,151 @@ int main()
 
     // uncomment this call to draw in wireframe polygons.
     //glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-    float uniformValue = 0.5f;
+    float uniformValue = sceneDesc.colorValue;
     float float3Var[3] = { 0.0f, 0.0f, 0.0f }; // 三个浮点数 背景颜色
-    glm::vec3 cubePositions[] = {
-    glm::vec3(0.0f,  0.0f,  0.0f),
-    glm::vec3(2.0f,  5.0f, -15.0f),
-    glm::vec3(-1.5f, -2.2f, -2.5f),
-    glm::vec3(-3.8f, -2.0f, -12.3f),
-    glm::vec3(2.4f, -0.4f, -3.5f),
-    glm::vec3(-1.7f,  3.0f, -7.5f),
-    glm::vec3(1.3f, -2.0f, -2.5f),
-    glm::vec3(1.5f,  2.0f, -2.5f),
-    glm::vec3(1.5f,  0.2f, -1.5f),
-    glm::vec3(-1.3f,  1.0f, -1.5f)
-    };
 
     screenShader.use();
     screenShader.setInt("screenTexture", 0);
 
-    // 帧缓冲配置
-    // -------------------------
-    unsigned int framebuffer;
-    glGenFramebuffers(1, &framebuffer);//生成
-    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);//绑定
-    // create a color attachment texture
-    unsigned int textureColorbuffer;
-    glGenTextures(1, &textureColorbuffer);//生成贴图
-    glBindTexture(GL_TEXTURE_2D, textureColorbuffer);//绑定为激活贴图
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, SCR_WIDTH, SCR_HEIGHT, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);//设置贴图大小和格式
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);//设置环绕方式
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, textureColorbuffer, 0);//绑定贴图到帧缓冲
-    // 创建渲染缓冲 将深度和模版附加到帧缓冲上，不然后面渲染的深度测试和模版测试会没有效果
-    unsigned int rbo;
-    glGenRenderbuffers(1, &rbo);
-    glBindRenderbuffer(GL_RENDERBUFFER, rbo);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, SCR_WIDTH, SCR_HEIGHT); //对深度和模板缓冲区使用一个renderbuffer对象。
-    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, rbo); // 把当前绑定的 FBO 的深度+模板附件指向这个 RBO
-    // 现在我们已经实际创建了framebuffer并添加了所有附件，我们想要检查它现在是否真的完成了
-    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-        cout << "ERROR::FRAMEBUFFER:: Framebuffer is not complete!" << endl;
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    // 立方体的材质：纹理和常量参数在这里烘焙一次，绘制时由渲染队列绑定
+    Material cubeMaterial({ Texture{ texture, "material.baseTexture", "Tex/splash1.png" } }, "cube");
+    cubeMaterial.SetVec3("material.baseColor", sceneDesc.cubeMaterial.baseColor);
+    cubeMaterial.SetVec3("material.specular", sceneDesc.cubeMaterial.specular);
+    cubeMaterial.SetFloat("material.shininess", sceneDesc.cubeMaterial.shininess);
+    cubeMaterial.Resolve(ourShader.ID);
+
+    // 地面的材质：1x1的白色纹理（alpha为1，不透明），颜色由材质常量决定
+    unsigned int whiteTexture;
+    glGenTextures(1, &whiteTexture);
+    glBindTexture(GL_TEXTURE_2D, whiteTexture);
+    const unsigned char whitePixel[4] = { 255, 255, 255, 255 };
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, whitePixel);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    Material floorMaterial({ Texture{ whiteTexture, "material.baseTexture", "white" } }, "floor");
+    floorMaterial.SetVec3("material.baseColor", sceneDesc.floorMaterial.baseColor);
+    floorMaterial.SetVec3("material.specular", sceneDesc.floorMaterial.specular);
+    floorMaterial.SetFloat("material.shininess", sceneDesc.floorMaterial.shininess);
+    floorMaterial.Resolve(ourShader.ID);
+
+    // 渲染队列：每帧提交绘制包，按排序键基数排序后执行
+    RenderQueue renderQueue;
+    renderQueue.maxDepth = 100.0f;
+    ThreadPool threadPool;//工作线程只录制命令，GL调用全部在主线程回放
+
+    // 持久映射的流式缓冲：每帧的uniform块、实例数据和光源数据都从这里分配，三帧轮换
+    StreamBuffer streamBuffer;
+    // 截图和录屏：PBO异步读回，编码在自己的线程里，不拖慢渲染
+    FrameCapture frameCapture;
+    if (headless)
+        headless->SetFrameCapture(&frameCapture);
+    bool screenshotRequested = false;
+    bool screenshotWithUi = true;
+    int screenshotCount = 0;
+    int videoCount = 0;
+    // 流式缓冲空间不足时的后备uniform缓冲
+    unsigned int frameUBO;
+    glGenBuffers(1, &frameUBO);
+    glBindBuffer(GL_UNIFORM_BUFFER, frameUBO);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameUniforms), NULL, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    // 立方体阵列使用实例化渲染：所有立方体的变换流式上传到实例缓冲，一次绘制调用画完
+    InstanceBuffer cubeInstances;
+    cubeInstances.stream = &streamBuffer;
+    cubeInstances.AttachTo(VAO);
+    vector<glm::mat4> cubeModels;
+    InstanceBuffer floorInstance;//地面不动，只上传一次
+    floorInstance.AttachTo(floorVAO);
+
+    // 视锥剔除
+    FrustumCuller frustumCuller;
+    AABB cubeBounds;//立方体模型空间包围盒
+    cubeBounds.Expand(glm::vec3(-0.5f));
+    cubeBounds.Expand(glm::vec3(0.5f));
+    AABBBatch cubeBatch;
+    vector<uint8_t> cubeVisible;
+
+    // 软件光栅化遮挡剔除：不透明的背包作为遮挡体，立方体和背包的网格作为被测物体
+    OcclusionCuller occlusionCuller(256, 192);
+    bool occlusionEnabled = true;
+
+    // GPU硬件遮挡查询（可选），结果延迟一帧以上读回，不会等待GPU
+    GpuOcclusionCuller gpuOcclusion;
+    bool gpuOcclusionEnabled = false;
+    const uint32_t cubeQueryId = 0;//立方体实例的查询编号 0~9
+    const uint32_t backpackQueryId = 100;//背包网格的查询编号
+    GLint lightModelLocation = glGetUniformLocation(lightShader.ID, "model_matrix");
+
+    // 分簇前向光照：点光源放在着色器存储缓冲里，数量不再受uniform数组限制
+    ClusteredLighting clusteredLighting;
+    clusteredLighting.stream = &streamBuffer;
+
+    // 延迟渲染（可在运行时和前向渲染切换）：立方体写入G-buffer，再用全屏光照阶段着色
+    Shader gbufferShader("Shader/userShader.vs", "Shader/gbuffer.fs");
+    Shader deferredShader("Shader/screen.vs", "Shader/deferredLighting.fs");
+    gbufferShader.BindUniformBlock("FrameData", FRAME_UNIFORM_BINDING);
+    deferredShader.BindUniformBlock("FrameData", FRAME_UNIFORM_BINDING);
+    deferredShader.use();
+    deferredShader.setInt("gAlbedoSpecular", 0);
+    deferredShader.setInt("gNormal", 1);
+    deferredShader.setInt("gGloss", 2);
+    deferredShader.setInt("gDepth", 3);
+    bool deferredEnabled = false;
+    RenderQueue geometryQueue;//延迟渲染几何阶段的绘制
+    geometryQueue.maxDepth = 100.0f;
+
+    // 方向光的级联阴影：地面是静态投射体（缓存），立方体和背包是动态投射体
+    CascadedShadowMap cascadedShadows(1024);
+    glm::vec3 dirLightDirection = sceneDesc.dirDirection;
+    // 点光源和聚光灯共用的阴影图集，每帧只重绘少量光源
+    ShadowAtlas shadowAtlas(4096);
+    shadowAtlas.stream = &streamBuffer;
+    const glm::mat4& floorModel = sceneDesc.floorModel;
+    floorInstance.Update({ floorModel });
+    AABB floorBounds = cubeBounds.Transform(floorModel);
+
+    // 帧图：每帧声明渲染通道和它们读写的目标，中间目标从池中按生命周期借用，窗口尺寸改变时自动换成新尺寸
+    FrameGraph frameGraph;
+    bool dumpFrameGraph = false;
+    // 动态分辨率：场景按GPU耗时缩放渲染，呈现时放大到窗口尺寸
+    DynamicResolution dynamicResolution;
+    float upscaleSharpness = 0.25f;
+    // 时间抗锯齿：场景投影带子像素抖动，历史累积在窗口分辨率上，同时承担动态分辨率的上采样
+    TemporalAA temporalAA;
+    // GPU计时：帧图的每个通道自动成为一个区间，帧图之外的GPU工作（阴影、光源分配）手动标注
+    GpuProfiler gpuProfiler;
+    bool showGpuProfiler = false;
+    bool showCpuProfiler = false;
+    CpuProfilerWindow cpuProfilerWindow;
+    // 帧节奏：垂直同步、帧率限制、在途帧数，以及输入到显示的延迟估计
+    FramePacer framePacer;
+    frameGraph.onPassBegin = [&](const string& name)
+    {
+        cpuProfiler.BeginZone(cpuProfiler.Intern(name));
+        gpuProfiler.BeginZone(name);
+    };
+    frameGraph.onPassEnd = [&](const string&)
+    {
+        gpuProfiler.EndZone();
+        cpuProfiler.EndZone();
+    };
+    if (headless || benchmark)
+    {
+        // 输出要可重复：固定渲染比例，不等待垂直同步，不限帧率
+        dynamicResolution.enabled = false;
+        framePacer.vsyncMode = FramePacer::VSYNC_OFF;
+        framePacer.targetFps = 0.0f;
+        gpuProfiler.enabled = true;
+        cpuProfiler.enabled = true;
+    }
+    // 交互模式下录制相机路径，供基准测试回放
+    CameraPath recordedPath;
+    bool recordingPath = false;
+    vector<uint8_t> regressionPixels;//回归测试读回的图像
+    double recordStart = 0.0;
+    string pathStatus;
 
 
     glEnable(GL_BLEND);
@@ -310,160 +640,578 @@ int main()
     // glEnable(GL_CULL_FACE);
     // render loop
     // -----------
-    while (!glfwWindowShouldClose(window))
+    while ((headless ? !headless->Finished() : !glfwWindowShouldClose(window)) && !(benchmark && benchmark->Finished()))
     {
-        // input
-        // -----
-        processInput(window);
+        // 先等待在途帧和帧率限制，再处理事件，这样本帧用到的输入尽量新
+        cpuProfiler.BeginZone("Pacing");
+        framePacer.BeginFrame();
+        cpuProfiler.EndZone();
+        double frameStart = glfwGetTime();
+        cpuProfiler.BeginZone("Input");
+        glfwPollEvents();
+        cpuProfiler.EndZone();
 
-        //绑定到自定义的FBO上
-        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        // 窗口最小化时不渲染
+        if (framebufferWidth == 0 || framebufferHeight == 0)
+        {
+            glfwWaitEvents();
+            continue;
+        }
+        gpuProfiler.BeginFrame();
+        streamBuffer.BeginFrame();
         glEnable(GL_DEPTH_TEST); // 开启深度测试
 
         // Start the ImGui frame
+        cpuProfiler.BeginZone("UI");
         ImGui_ImplOpenGL3_NewFrame();
         ImGui_ImplGlfw_NewFrame();
         ImGui::NewFrame();
 
+        // 读回上几帧场景通道的GPU耗时，决定本帧场景目标的尺寸
+        dynamicResolution.Update();
+        int sceneWidth, sceneHeight;
+        dynamicResolution.SceneSize(framebufferWidth, framebufferHeight, sceneWidth, sceneHeight);
+
         // --- 显示一个窗口控制 uniform ---
         ImGui::Begin("Uniform Controller");
         ImGui::SliderFloat("Uniform 值", &uniformValue, 0.0f, 1.0f);
         ImGui::Text("当前值: %.3f", uniformValue);
         ImGui::ColorEdit3("标签", float3Var);
+        ImGui::Text("绘制: %u  程序切换: %u  材质切换: %u", renderQueue.stats.draws, renderQueue.stats.programSwitches, renderQueue.stats.materialSwitches);
+        ImGui::Text("视锥剔除 可见: %u / %u", frustumCuller.lastStats.visible, frustumCuller.lastStats.tested);
+        ImGui::Checkbox("遮挡剔除", &occlusionEnabled);
+        ImGui::Text("遮挡剔除 遮挡: %u / %u  遮挡体三角形: %u", occlusionCuller.lastStats.occluded, occlusionCuller.lastStats.tested, occlusionCuller.lastStats.occluderTriangles);
+        if (GLCompat::StorageBuffers())//GPU遮挡查询在 4.3 以下关闭
+        {
+            ImGui::Checkbox("GPU遮挡查询", &gpuOcclusionEnabled);
+            ImGui::Text("GPU遮挡查询 发出: %u  节省绘制: %u", gpuOcclusion.lastStats.queriesIssued, gpuOcclusion.lastStats.drawsSaved);
+        }
+        ImGui::SliderInt("动态点光源", &extraLightCount, 0, 4096);
+        if (clusteredLighting.ComputeAvailable())
+            ImGui::Checkbox("计算着色器分配光源", &clusteredLighting.useComputeShader);
+        ImGui::Text("点光源: %u  光源-簇配对: %u  单簇最多: %u", clusteredLighting.stats.lights, clusteredLighting.stats.assignments, clusteredLighting.stats.maxPerCluster);
+        if (clusteredLighting.stats.dropped > 0)
+            ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.2f, 1.0f), "下标列表容量不足，丢弃配对: %u", clusteredLighting.stats.dropped);
+        int shadingPath = deferredEnabled ? 1 : 0;
+        ImGui::RadioButton("前向渲染", &shadingPath, 0);
+        ImGui::SameLine();
+        ImGui::RadioButton("延迟渲染", &shadingPath, 1);
+        deferredEnabled = shadingPath == 1;
+        if (deferredEnabled)
+            ImGui::Text("几何阶段绘制: %u", geometryQueue.stats.draws);
+        ImGui::Checkbox("级联阴影", &cascadedShadows.enabled);
+        ImGui::SliderInt("每帧静态阴影层", &cascadedShadows.maxStaticUpdatesPerFrame, 1, CascadedShadowMap::CASCADE_COUNT);
+        ImGui::Text("阴影 静态层重绘: %u  动态层更新: %u", cascadedShadows.stats.staticPasses, cascadedShadows.stats.dynamicPasses);
+        ImGui::Checkbox("局部光阴影", &shadowAtlas.enabled);
+        ImGui::SliderInt("每帧重绘局部光阴影", &shadowAtlas.maxUpdatesPerFrame, 1, 8);
+        ImGui::Text("阴影图集 光源: %u  重绘: %u  图块: %u  重新打包: %u", shadowAtlas.stats.shadowedLights, shadowAtlas.stats.updatedLights, shadowAtlas.stats.passes, shadowAtlas.stats.repacks);
+        if (shadowAtlas.stats.unpacked > 0)
+            ImGui::Text("图集已满，%u 个光源没有阴影", shadowAtlas.stats.unpacked);
+        ImGui::Text("帧图 通道: %u (剔除 %u)  目标: %u -> 纹理 %u  池: %u 张 %.1f MB", frameGraph.stats.passes, frameGraph.stats.culledPasses, frameGraph.stats.transientTextures, frameGraph.stats.physicalTextures, frameGraph.stats.pooledTextures, frameGraph.stats.pooledBytes / (1024.0f * 1024.0f));
+        if (ImGui::Button("输出帧图"))
+            dumpFrameGraph = true;
+        ImGui::SameLine();
+        ImGui::Checkbox("GPU分析", &showGpuProfiler);
+        ImGui::SameLine();
+        ImGui::Checkbox("CPU分析", &showCpuProfiler);
+        ImGui::Checkbox("动态分辨率", &dynamicResolution.enabled);
+        ImGui::SliderFloat("目标GPU时间 (ms)", &dynamicResolution.targetMs, 2.0f, 33.0f);
+        ImGui::SliderFloat("最低渲染比例", &dynamicResolution.minScale, 0.25f, 1.0f);
+        ImGui::SliderFloat("放大锐化", &upscaleSharpness, 0.0f, 1.0f);
+        ImGui::Checkbox("时间抗锯齿 (TAA)", &temporalAA.enabled);
+        ImGui::SliderFloat("TAA 本帧权重", &temporalAA.feedback, 0.02f, 0.5f);
+        ImGui::Text("场景GPU时间: %.2f ms  渲染比例: %.2f  (%d x %d -> %d x %d)", dynamicResolution.gpuMs, dynamicResolution.scale, sceneWidth, sceneHeight, framebufferWidth, framebufferHeight);
+        ImGui::Text("帧时间: %.3f ms (%.1f FPS)", 1000.0f / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate);
+        ImGui::RadioButton("垂直同步 关", &framePacer.vsyncMode, FramePacer::VSYNC_OFF);
+        ImGui::SameLine();
+        ImGui::RadioButton("开", &framePacer.vsyncMode, FramePacer::VSYNC_ON);
+        ImGui::SameLine();
+        ImGui::RadioButton("自适应", &framePacer.vsyncMode, FramePacer::VSYNC_ADAPTIVE);
+        ImGui::SliderFloat("帧率上限 (0为不限)", &framePacer.targetFps, 0.0f, 240.0f, "%.0f");
+        ImGui::SliderInt("最多在途帧", &framePacer.maxFramesInFlight, 1, StreamBuffer::FRAME_COUNT);
+        if (streamBuffer.Valid())
+            ImGui::Text("流式缓冲 本帧: %.1f KB / %u 次分配  峰值: %.1f KB  失败: %u  等待: %u", streamBuffer.stats.bytesUsed / 1024.0f, streamBuffer.stats.allocations, streamBuffer.stats.peakBytes / 1024.0f, streamBuffer.stats.failedAllocations, streamBuffer.stats.fenceStalls);
+        else
+            ImGui::Text("流式缓冲 不可用（需要 OpenGL 4.4），每帧数据直接上传");
+        ImGui::Text("等待 栅栏: %.2f ms  限速: %.2f ms", framePacer.stats.fenceWaitMs, framePacer.stats.limiterWaitMs);
+        ImGui::Text("输入->提交: %.2f ms  输入->GPU完成: %.2f ms  输入->显示(估计): %.2f ms", framePacer.stats.inputToSubmitMs, framePacer.stats.gpuDoneMs, framePacer.stats.latencyMs);
+        if (ImGui::Button(recordingPath ? "停止录制" : "录制相机路径"))
+        {
+            recordingPath = !recordingPath;
+            if (recordingPath)
+            {
+                recordedPath.Clear();
+                recordStart = glfwGetTime();
+            }
+        }
+        ImGui::SameLine();
+        if (ImGui::Button("保存路径") && !recordedPath.Empty())
+            pathStatus = recordedPath.Save("camera_path.txt") ? "已保存 camera_path.txt" : "保存失败";
+        ImGui::SameLine();
+        ImGui::Text("关键帧: %u  %.1f 秒  %s", (unsigned int)recordedPath.keys.size(), recordedPath.Duration(), pathStatus.c_str());
+        if (ImGui::Button("截图"))
+            screenshotRequested = true;
+        ImGui::SameLine();
+        ImGui::Checkbox("包含界面", &screenshotWithUi);
+        ImGui::SameLine();
+        if (ImGui::Button(frameCapture.Recording() ? "停止录屏" : "录屏"))
+        {
+            if (frameCapture.Recording())
+                frameCapture.EndVideo();
+            else
+            {
+                std::error_code error;
+                std::filesystem::create_directories("captures", error);
+                frameCapture.BeginVideo("captures/video_" + to_string(videoCount++) + ".yuv", framebufferWidth, framebufferHeight);
+            }
+        }
+        FrameCapture::Stats captureStats = frameCapture.GetStats();
+        ImGui::Text("截图: %u  录屏: %u 帧 (%d x %d)  丢弃: %u  读回等待: %u  编码等待: %u  编码: %.1f ms", captureStats.screenshots, captureStats.videoFrames, frameCapture.VideoWidth(), frameCapture.VideoHeight(), captureStats.droppedFrames, captureStats.readbackStalls, captureStats.encodeStalls, captureStats.encodeMs);
         ImGui::End();
+        if (showGpuProfiler)
+            gpuProfiler.DrawWindow();
+        if (showCpuProfiler)
+            cpuProfilerWindow.Draw(cpuProfiler);
+        cpuProfiler.EndZone();
 
         // render
         // ------
-        glClearColor(float3Var[0], float3Var[1], float3Var[2], 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
+        cpuProfiler.BeginZone("SceneSetup");
         ourShader.use();
 
         // 创建变换矩阵
         // glm::mat4 model = glm::mat4(1.0f);  // 模型矩阵
         glm::mat4 view = glm::mat4(1.0f);   // 视角矩阵
         glm::mat4 projection = glm::mat4(1.0f);//投影矩阵
+        // 场景动画的时间：无头模式按固定步长推进，否则用实际时间
+        float sceneTime;
+        if (benchmark)
+        {
+            // 基准测试：相机和场景都只由帧号决定
+            sceneTime = benchmark->SceneTime();
+            deltaTime = headlessOptions.fixedDelta;
+            benchmark->ApplyCamera(camera);
+            if (!headless && glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
+                glfwSetWindowShouldClose(window, true);
+        }
+        else if (regression)
+        {
+            sceneTime = regression->SceneTime();
+            deltaTime = headlessOptions.fixedDelta;
+            regression->ApplyCamera(camera);
+            // 每个用例都从同样的状态开始，结果不依赖前一个用例的画面
+            if (regression->CaseStart())
+            {
+                camera.ClearJitter();
+                temporalAA.Invalidate();
+                gpuOcclusion.Reset();
+                cascadedShadows.Reset();
+                shadowAtlas.Invalidate();
+            }
+        }
+        else if (headless)
+        {
+            sceneTime = headless->SceneTime();
+            deltaTime = headlessOptions.fixedDelta;
+        }
+        else
+        {
+            // 晚采样输入：构建界面期间到达的鼠标移动也算进本帧，处理完键盘移动后立即计算视图矩阵
+            glfwPollEvents();
+            float currentFrame = (float)glfwGetTime();
+            deltaTime = currentFrame - lastFrame;
+            lastFrame = currentFrame;
+            sceneTime = currentFrame;
+            processInput(window);
+            // 录制时每0.25秒取一个关键帧，回放时样条插值
+            if (recordingPath)
+            {
+                float t = (float)(glfwGetTime() - recordStart);
+                if (recordedPath.Empty() || t - recordedPath.keys.back().time >= 0.25f)
+                    recordedPath.Add(t, camera);
+            }
+        }
+        framePacer.MarkInputSampled();
         view = camera.GetViewMatrix();
-        projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);//创建投影矩阵 视场角 宽度/高度 近裁剪面 远裁剪面
+        projection = camera.GetProjectionMatrix((float)framebufferWidth / (float)framebufferHeight, 0.1f, 100.0f);//创建投影矩阵 视场角 宽度/高度 近裁剪面 远裁剪面
+        // 绘制用带抖动的投影；剔除、光源分簇等仍用不带抖动的投影
+        if (temporalAA.enabled)
+            camera.AdvanceJitter(TemporalAA::JitterPhases(dynamicResolution.scale));
+        else
+            camera.ClearJitter();
+        glm::mat4 renderProjection = camera.ApplyJitter(projection, sceneWidth, sceneHeight);
 
-        // ourShader.setMat4("model_matrix", model);
-        ourShader.setMat4("view_matrix", view);
-        ourShader.setMat4("projection_matrix", projection);
+        // 相机矩阵所有着色器共用一个uniform块，每帧上传一次
+        FrameUniforms frameUniforms = { view, renderProjection, glm::inverse(renderProjection * view), glm::vec4(camera.Position, 1.0f) };
+        if (!streamBuffer.BindUniform(FRAME_UNIFORM_BINDING, &frameUniforms, sizeof(frameUniforms)))
+        {
+            glBindBuffer(GL_UNIFORM_BUFFER, frameUBO);
+            glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(frameUniforms), &frameUniforms);
+            glBindBufferBase(GL_UNIFORM_BUFFER, FRAME_UNIFORM_BINDING, frameUBO);
+        }
 
         // 更新uniform颜色
-        float timeValue = glfwGetTime();
+        float timeValue = sceneTime;
         ourShader.setFloat4("ourColor", uniformValue, 0.0f, 0.0f, 1.0f);
         ourShader.setFloat("ourTime", timeValue);
-        ourShader.setVec3("material.baseColor", glm::vec3(1.0f, 1.0f, 1.0f));
-        ourShader.setVec3("material.specular", glm::vec3(1.0f, 1.0f, 1.0f));
-        ourShader.setFloat("material.shininess", 32.0f);
         glm::mat4 trans = glm::mat4(1.0f);
         trans = glm::rotate(trans, glm::radians(90.0f * timeValue), glm::vec3(0.0, 0.0, 1.0));
         trans = glm::scale(trans, glm::vec3(1.0, 1.0, 1.0));
         ourShader.setMat4("transform", trans);
-        ourShader.setVec3("viewPos", camera.Position);
-
-        ourShader.setVec3("pointLight[0].position", lightPos);
-        ourShader.setVec3("pointLight[0].lightcolor", glm::vec3(1.0f, 1.0f, 1.0f));
-        ourShader.setVec3("pointLight[0].specularcolor", glm::vec3(1.0f, 1.0f, 1.0f));
-        ourShader.setVec3("pointLight[0].attenuation", glm::vec3(1.0f, 0.22f, 0.2f));
-
-        ourShader.setVec3("pointLight[1].position", glm::vec3(1.0f, 1.0f, 1.0f));
-        ourShader.setVec3("pointLight[1].lightcolor", glm::vec3(0.0f, 1.0f, 0.0f));
-        ourShader.setVec3("pointLight[1].specularcolor", glm::vec3(0.0f, 1.0f, 0.0f));
-        ourShader.setVec3("pointLight[1].attenuation", glm::vec3(1.0f, 0.22f, 0.2f));
-
-        ourShader.setVec3("pointLight[2].position", glm::vec3(-1.0f, 1.0f, 1.0f));
-        ourShader.setVec3("pointLight[2].lightcolor", glm::vec3(1.0f, 0.0f, 1.0f));
-        ourShader.setVec3("pointLight[2].specularcolor", glm::vec3(1.0f, 0.0f, 1.0f));
-        ourShader.setVec3("pointLight[2].attenuation", glm::vec3(1.0f, 0.22f, 0.2f));
-
-        ourShader.setVec3("pointLight[3].position", glm::vec3(-1.0f, 1.0f, -1.0f));
-        ourShader.setVec3("pointLight[3].lightcolor", glm::vec3(1.0f, 0.0f, 0.0f));
-        ourShader.setVec3("pointLight[3].specularcolor", glm::vec3(1.0f, 0.0f, 0.0f));
-        ourShader.setVec3("pointLight[3].attenuation", glm::vec3(1.0f, 0.22f, 0.2f));
-
-        ourShader.setVec3("dirLight.lightcolor", glm::vec3(0.2f, 0.2f, 0.0f));
-        ourShader.setVec3("dirLight.specularcolor", glm::vec3(0.2f, 0.2f, 0.0f));
-        ourShader.setVec3("dirLight.direction", glm::vec3(-1.0f, -1.0f, -1.0f));
-
-        ourShader.setVec3("spotLight.lightcolor", glm::vec3(0.0f, 0.0f, 2.0f));
-        ourShader.setVec3("spotLight.specularcolor", glm::vec3(0.0f, 0.0f, 1.0f));
-        ourShader.setVec3("spotLight.position", lightPos);
-        ourShader.setVec3("spotLight.direction", glm::vec3(0.0f, -1.0f, 0.0f));
-        ourShader.setFloat("spotLight.angle", glm::radians(15.0f));
-        ourShader.setFloat("spotLight.smoothness", glm::radians(3.0f));
-        ourShader.setVec3("spotLight.attenuation", glm::vec3(1.0f, 0.22f, 0.2f));
-
-        glActiveTexture(GL_TEXTURE0);//设置激活纹理单元0
-        glBindTexture(GL_TEXTURE_2D, texture);//绑定纹理
-        ourShader.setInt("material.baseTexture", 0);//设置材质属性
-
-        glBindVertexArray(VAO); // 因为我们只有一个VAO，所以没有必要每次都绑定它，但是我们这样做是为了让事情更有条理
-        // glDrawArrays(GL_TRIANGLES, 0, 3);
-        for (unsigned int i = 0; i < 10; i++)
+        // 几何阶段与前向着色器共用顶点着色器和材质相关的uniform
+        gbufferShader.use();
+        gbufferShader.setFloat4("ourColor", uniformValue, 0.0f, 0.0f, 1.0f);
+        gbufferShader.setFloat("ourTime", timeValue);
+        gbufferShader.setMat4("transform", trans);
+        cpuProfiler.EndZone();
+
+        cpuProfiler.BeginZone("Lights");
+        lightPos = sceneDesc.LightPosition(timeValue);
+        clusteredLighting.lights.clear();
+        addScenePointLights(clusteredLighting.lights, timeValue, extraLightCount);
+        // 阴影图集要把图块下标写进光源数据，必须在上传光源之前
+        shadowAtlas.SetSpotLight(lightPos, sceneDesc.spotDirection, sceneDesc.spotAngle + sceneDesc.spotSmoothness, ClusteredLighting::LightRadius(sceneDesc.spotColor, sceneDesc.spotAttenuation));
+        shadowAtlas.Update(clusteredLighting.lights, camera.Position, glm::radians(camera.Zoom), (float)sceneHeight);
+        gpuProfiler.BeginZone("LightAssignment");
+        clusteredLighting.Update(view, projection, 0.1f, 100.0f, &threadPool);
+        gpuProfiler.EndZone();
+        // 前向着色器和延迟光照阶段使用同样的灯光
+        auto setLightUniforms = [&](Shader& shader)
         {
-            glm::mat4 model = glm::mat4(1.0f);
-            model = glm::translate(model, cubePositions[i]);
-            model = glm::rotate(model, (float)glfwGetTime() * glm::radians(50.0f) + i * 50.0f, glm::vec3(1.0f, 0.3f, 0.5f));
-            float angle = 20.0f * i;
-            model = glm::rotate(model, glm::radians(angle), glm::vec3(1.0f, 0.3f, 0.5f));
-            ourShader.setMat4("model_matrix", model);
-            glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0); // 使用索引绘制
-            // glDrawArrays(GL_TRIANGLES, 0, 36);
-        }
+            shader.use();
+            clusteredLighting.SetUniforms(shader.ID, (float)sceneWidth, (float)sceneHeight);
+
+            shader.setVec3("dirLight.lightcolor", sceneDesc.dirColor);
+            shader.setVec3("dirLight.specularcolor", sceneDesc.dirSpecular);
+            shader.setVec3("dirLight.direction", dirLightDirection);
+
+            shader.setVec3("spotLight.lightcolor", sceneDesc.spotColor);
+            shader.setVec3("spotLight.specularcolor", sceneDesc.spotSpecular);
+            shader.setVec3("spotLight.position", lightPos);
+            shader.setVec3("spotLight.direction", sceneDesc.spotDirection);
+            shader.setFloat("spotLight.angle", sceneDesc.spotAngle);
+            shader.setFloat("spotLight.smoothness", sceneDesc.spotSmoothness);
+            shader.setVec3("spotLight.attenuation", sceneDesc.spotAttenuation);
+            shadowAtlas.Bind(shader.ID);
+        };
+        if (deferredEnabled)
+            setLightUniforms(deferredShader);
+        else
+            setLightUniforms(ourShader);
 
 
+        cpuProfiler.EndZone();
 
-        //绘制灯光
-        glBindVertexArray(lightVAO);
-        lightShader.use();
-        glm::mat4 lightModel = glm::mat4(1.0f);
-        lightPos = glm::vec3(sin(glfwGetTime()) * 2, 1.0f, 0.0f);
-        lightModel = glm::translate(lightModel, lightPos);
-        lightModel = glm::scale(lightModel, glm::vec3(0.2f));
-        lightShader.setMat4("model_matrix", lightModel);
-        lightShader.setMat4("view_matrix", view);
-        lightShader.setMat4("projection_matrix", projection);
+        // 提交本帧的所有绘制，排序后统一执行
+        cpuProfiler.BeginZone("Culling");
+        renderQueue.Clear();
+        Frustum frustum = Frustum::FromMatrix(projection * view);
+        frustumCuller.BeginFrame();
+        gpuOcclusion.BeginFrame();
+        CullContext cull;
+        cull.frustum = frustum;
+        cull.frustumCuller = &frustumCuller;
+        cull.pool = &threadPool;
+        cull.occlusion = occlusionEnabled ? &occlusionCuller : nullptr;
+        cull.gpuOcclusion = gpuOcclusionEnabled ? &gpuOcclusion : nullptr;
 
-        glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0); // 使用索引绘制
+        glm::mat4 model = sceneDesc.BackpackModel(sceneTime);
 
-        backpackShader.use();
-        backpackShader.setMat4("projection", projection);
-        backpackShader.setMat4("view", view);
+        // 先把遮挡体光栅化到CPU深度缓冲
+        occlusionCuller.Begin(projection * view);
+        if (occlusionEnabled)
+        {
+            ourModel.AddOccluders(occlusionCuller, model);
+            occlusionCuller.Rasterize(&threadPool);
+        }
 
-        glm::mat4 model = glm::mat4(1.0f);
-        model = glm::translate(model, glm::vec3(2.0f, 0.0f, 0.0f));
-        model = glm::scale(model, glm::vec3(0.2f, 0.2f, 0.2f));
-        model = glm::rotate(model, (float)glm::radians(glfwGetTime() * 90.0f), glm::vec3(1.0f, 1.0f, 0.0f));
-        backpackShader.setMat4("model", model);
-        ourModel.Draw(backpackShader);
+        // 立方体的纹理带有alpha通道，作为半透明物体绘制；实例之间在CPU上按从远到近排好序再上传
+        cubeModels.clear();
+        cubeBatch.Clear();
+        glm::vec3 cubeCenter = glm::vec3(0.0f);
+        for (unsigned int i = 0; i < 10; i++)
+        {
+            glm::mat4 model = sceneDesc.CubeModel(i, sceneTime);
+            cubeModels.push_back(model);
+            cubeBatch.Add(cubeBounds.Transform(model));
+            cubeCenter += cubePositions[i] / 10.0f;
+        }
 
+        cpuProfiler.EndZone();
 
-        ImGui::Render();
-        ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+        // 阴影：在场景绘制之前更新级联阴影贴图和阴影图集
+        cpuProfiler.BeginZone("Shadows");
+        auto drawStaticCasters = [&](Shader& depthShader)
+        {
+            depthShader.setMat4("model", floorModel);
+            glBindVertexArray(VAO);
+            glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
+        };
+        auto drawDynamicCasters = [&](Shader& depthShader)
+        {
+            glBindVertexArray(VAO);
+            for (const glm::mat4& cubeModel : cubeModels)
+            {
+                depthShader.setMat4("model", cubeModel);
+                glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
+            }
+            ourModel.DrawDepth(depthShader, model);
+        };
+        gpuProfiler.BeginZone("CascadedShadows");
+        cascadedShadows.Update(view, glm::radians(camera.Zoom), (float)framebufferWidth / (float)framebufferHeight, 0.1f, dirLightDirection, drawStaticCasters, drawDynamicCasters);
+        gpuProfiler.EndZone();
+        gpuProfiler.BeginZone("ShadowAtlas");
+        // 点光源每个面只画与该面视锥相交的投射体
+        shadowAtlas.Render([&](Shader& depthShader, const Frustum& face)
+        {
+            glBindVertexArray(VAO);
+            if (face.Intersects(floorBounds))
+            {
+                depthShader.setMat4("model", floorModel);
+                glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
+            }
+            for (size_t i = 0; i < cubeModels.size(); i++)
+            {
+                if (!face.Intersects(cubeBounds.Transform(cubeModels[i])))
+                    continue;
+                depthShader.setMat4("model", cubeModels[i]);
+                glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
+            }
+            ourModel.DrawDepth(depthShader, model, face);
+        });
+        gpuProfiler.EndZone();
+        Shader& litShader = deferredEnabled ? deferredShader : ourShader;
+        litShader.use();
+        cascadedShadows.Bind(litShader.ID);
+        cpuProfiler.EndZone();
+
+        cpuProfiler.BeginZone("Submit");
+        // 剔除视锥外的实例，只上传可见的部分
+        frustumCuller.Cull(frustum, cubeBatch, cubeVisible, &threadPool);
+        if (occlusionEnabled)
+            occlusionCuller.Test(cubeBatch, cubeVisible, &threadPool);
+        size_t visibleCubes = 0;
+        for (size_t i = 0; i < cubeModels.size(); i++)
+        {
+            if (!cubeVisible[i])
+                continue;
+            if (gpuOcclusionEnabled)
+            {
+                bool visible = gpuOcclusion.IsVisible(cubeQueryId + (uint32_t)i);
+                gpuOcclusion.Request(cubeQueryId + (uint32_t)i, cubeBounds.Transform(cubeModels[i]));
+                if (!visible)
+                    continue;
+            }
+            cubeModels[visibleCubes++] = cubeModels[i];
+        }
+        cubeModels.resize(visibleCubes);
+        std::sort(cubeModels.begin(), cubeModels.end(), [&](const glm::mat4& a, const glm::mat4& b)
+        {
+            return (view * a[3]).z < (view * b[3]).z;//视空间z越小越远
+        });
+        cubeInstances.Update(cubeModels);
+        geometryQueue.Clear();
+        if (deferredEnabled)
+        {
+            // 延迟渲染：立方体按不透明物体画进G-buffer（alpha测试）
+            DrawPacket cubePacket = { VAO, gbufferShader.ID, &cubeMaterial, -1, 0, GL_TRIANGLES, 36, true, false, cubeInstances.count };
+            geometryQueue.Submit(PASS_SCENE, cubePacket, glm::translate(glm::mat4(1.0f), cubeCenter), view);
+        }
+        else
+        {
+            DrawPacket cubePacket = { VAO, ourShader.ID, &cubeMaterial, -1, 0, GL_TRIANGLES, 36, true, true, cubeInstances.count };
+            renderQueue.Submit(PASS_SCENE, cubePacket, glm::translate(glm::mat4(1.0f), cubeCenter), view);
+        }
+        // 地面是不透明的静态物体，单独一个实例
+        if (frustum.Intersects(floorBounds))
+        {
+            RenderQueue& floorQueue = deferredEnabled ? geometryQueue : renderQueue;
+            DrawPacket floorPacket = { floorVAO, deferredEnabled ? gbufferShader.ID : ourShader.ID, &floorMaterial, -1, 0, GL_TRIANGLES, 36, true, false, floorInstance.count };
+            floorQueue.Submit(PASS_SCENE, floorPacket, floorModel, view);
+        }
 
-        // 现在绑定回默认framebuffer并绘制一个带有附加framebuffer颜色纹理的四边形平面
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
-        glDisable(GL_DEPTH_TEST); // 关闭深度测试
-        // 清除所有相关缓冲区
-        glClearColor(1.0f, 1.0f, 1.0f, 1.0f); // 将透明色设置为白色（实际上没有必要，因为我们无论如何都无法看到平面后面）
-        glClear(GL_COLOR_BUFFER_BIT);
+        //绘制灯光
+        lightShader.use();
+        glm::mat4 lightModel = sceneDesc.LightModel(sceneTime);
+        DrawPacket lightPacket = { lightVAO, lightShader.ID, nullptr, lightModelLocation, 0, GL_TRIANGLES, 36, true, false, 1 };
+        renderQueue.Submit(PASS_OVERLAY, lightPacket, lightModel, view);
+
+        ourModel.Submit(renderQueue, backpackShader, model, view, cull, backpackQueryId);
+        cpuProfiler.EndZone();
+
+        // 声明本帧的渲染通道，编译（剔除、计算生命周期）后执行
+        cpuProfiler.BeginZone("FrameGraph");
+        frameGraph.Reset();
+        FrameGraphTextureDesc colorDesc = { sceneWidth, sceneHeight, GL_RGBA8, GL_LINEAR };
+        FrameGraphTextureDesc depthDesc = { sceneWidth, sceneHeight, GL_DEPTH24_STENCIL8, GL_NEAREST };
+        // 无头模式没有窗口，呈现到离屏纹理
+        FrameGraph::Resource backbuffer = frameGraph.Import("Backbuffer", headless ? headless->ColorTexture() : 0, { framebufferWidth, framebufferHeight, GL_RGBA8, GL_LINEAR });
+        FrameGraph::Resource sceneColor = FrameGraph::INVALID;
+        FrameGraph::Resource sceneDepth = FrameGraph::INVALID;
+        GBuffer gBuffer;
+        if (deferredEnabled)
+        {
+            frameGraph.AddPass("GBuffer", [&](FrameGraph::Builder& builder)
+            {
+                gBuffer = GBuffer::Create(builder, sceneWidth, sceneHeight);
+            }, [&]()
+            {
+                glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+                glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+                geometryQueue.Sort();
+                geometryQueue.Execute(&threadPool);
+            });
+            // 光照阶段：全屏四边形读取G-buffer，结果写入场景颜色，并把G-buffer的深度交给后面的前向物体
+            frameGraph.AddPass("DeferredLighting", [&](FrameGraph::Builder& builder)
+            {
+                gBuffer.Read(builder);
+                sceneColor = builder.Create("SceneColor", colorDesc);
+                sceneDepth = builder.Create("SceneDepth", depthDesc);
+            }, [&]()
+            {
+                glClearColor(float3Var[0], float3Var[1], float3Var[2], 1.0f);
+                glClear(GL_COLOR_BUFFER_BIT);
+                glDisable(GL_DEPTH_TEST);
+                deferredShader.use();
+                gBuffer.BindTextures(frameGraph, 0);
+                glBindVertexArray(quadVAO);
+                glDrawArrays(GL_TRIANGLES, 0, 6);
+                gBuffer.CopyDepthTo(frameGraph, sceneDepth);
+                glEnable(GL_DEPTH_TEST);
+            });
+        }
+        frameGraph.AddPass("Forward", [&](FrameGraph::Builder& builder)
+        {
+            if (deferredEnabled)
+            {
+                builder.Write(sceneColor);
+                builder.Write(sceneDepth);
+            }
+            else
+            {
+                sceneColor = builder.Create("SceneColor", colorDesc);
+                sceneDepth = builder.Create("SceneDepth", depthDesc);
+            }
+        }, [&]()
+        {
+            if (!deferredEnabled)
+            {
+                glClearColor(float3Var[0], float3Var[1], float3Var[2], 1.0f);
+                glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            }
+            renderQueue.Sort();
+            renderQueue.Execute(&threadPool);
+            // 场景画完后对本帧请求的物体发出包围盒查询，结果在之后的帧读回
+            if (gpuOcclusionEnabled)
+                gpuOcclusion.IssueQueries(renderProjection * view);
+            // 计时只包含按渲染比例缩放的场景通道；TAA的解析和呈现时的放大都按窗口分辨率进行，与比例无关，不计入场景耗时
+            dynamicResolution.EndGpuTimer();
+        });
+        // 开启TAA时由它累积并上采样到窗口分辨率，否则直接呈现场景颜色
+        FrameGraph::Resource presentSource = sceneColor;
+        if (temporalAA.enabled)
+            presentSource = temporalAA.AddPasses(frameGraph, sceneColor, sceneDepth, framebufferWidth, framebufferHeight, projection * view, camera.Jitter, quadVAO);
+        const FrameGraphTextureDesc presentDesc = frameGraph.Desc(presentSource);
+        // 绘制一个带有场景颜色纹理的四边形平面到默认帧缓冲，场景分辨率较低时在这里放大并锐化
+        frameGraph.AddPass("Present", [&](FrameGraph::Builder& builder)
+        {
+            builder.Read(presentSource);
+            builder.Write(backbuffer);
+        }, [&]()
+        {
+            glDisable(GL_DEPTH_TEST); // 关闭深度测试
+            glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
+            glClear(GL_COLOR_BUFFER_BIT);
+            screenShader.use();
+            screenShader.setVec2("sourceSize", glm::vec2((float)presentDesc.width, (float)presentDesc.height));
+            // 只有场景按比例缩小过才需要锐化（TAA的上采样也是在这种情况下），原始分辨率下不锐化
+            screenShader.setFloat("sharpness", sceneWidth < framebufferWidth ? upscaleSharpness : 0.0f);
+            glBindVertexArray(quadVAO);
+            glBindTexture(GL_TEXTURE_2D, frameGraph.Texture(presentSource));	// 使用场景颜色纹理作为四边形平面的纹理
+            glDrawArrays(GL_TRIANGLES, 0, 6);
+        });
+        // 界面直接画在窗口分辨率上，不随场景缩放变模糊；无头模式的输出图像不带界面
+        if (!headless)
+        {
+            frameGraph.AddPass("ImGui", [&](FrameGraph::Builder& builder)
+            {
+                builder.Write(backbuffer);
+            }, [&]()
+            {
+                ImGui::Render();
+                ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+            });
+        }
+        frameGraph.Compile();
+        if (dumpFrameGraph)
+        {
+            frameGraph.Dump(cout);
+            dumpFrameGraph = false;
+        }
+        dynamicResolution.BeginGpuTimer();
+        frameGraph.Execute();
+        if (temporalAA.enabled)
+            temporalAA.EndFrame();
+        else
+            temporalAA.Invalidate();
+        gpuProfiler.EndFrame();
+        streamBuffer.EndFrame();
+        cpuProfiler.EndZone();
+
+        // 本帧的场景绘制数和三角形数（阴影通道直接绘制，不计入）
+        Benchmark::FrameCounters counters = { renderQueue.stats.draws, renderQueue.stats.triangles };
+        if (deferredEnabled)
+        {
+            counters.draws += geometryQueue.stats.draws;
+            counters.triangles += geometryQueue.stats.triangles;
+        }
 
-        screenShader.use();
-        glBindVertexArray(quadVAO);
-        glBindTexture(GL_TEXTURE_2D, textureColorbuffer);	// 使用颜色附件纹理作为四边形平面的纹理
-        glDrawArrays(GL_TRIANGLES, 0, 6);
+        if (headless)
+        {
+            ImGui::EndFrame();
+            cpuProfiler.BeginZone("Capture");
+            headless->EndFrame((float)((glfwGetTime() - frameStart) * 1000.0));
+            headless->CollectGpuTimes(gpuProfiler);
+            if (regression)
+            {
+                if (regression->CaptureFrame())
+                    headless->ReadPixels(regressionPixels);
+                regression->EndFrame(regressionPixels.data());
+            }
+            framePacer.EndFrame();
+            cpuProfiler.EndZone();
+            cpuProfiler.FrameMark();
+            if (benchmark)
+                benchmark->EndFrame(counters, cpuProfiler, gpuProfiler);
+            continue;
+        }
 
+        // 截图和录屏只排入读回命令，几帧后由编码线程写文件
+        cpuProfiler.BeginZone("Capture");
+        if (screenshotRequested)
+        {
+            std::error_code error;
+            std::filesystem::create_directories("captures", error);
+            string path = "captures/screenshot_" + to_string(screenshotCount++) + ".png";
+            if (screenshotWithUi)
+                frameCapture.Screenshot(FrameCapture::Source::Framebuffer(0, framebufferWidth, framebufferHeight), path);
+            else
+                frameCapture.Screenshot(FrameCapture::Source::Texture(frameGraph.Texture(presentSource), presentDesc.width, presentDesc.height), path);
+            screenshotRequested = false;
+        }
+        frameCapture.VideoFrame(FrameCapture::Source::Framebuffer(0, framebufferWidth, framebufferHeight));
+        frameCapture.Poll();
+        cpuProfiler.EndZone();
 
-        // glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
+        // glfw: swap buffers (events are polled at the start of the next frame)
         // -------------------------------------------------------------------------------
+        cpuProfiler.BeginZone("Swap");
         glfwSwapBuffers(window);
-        glfwPollEvents();
-
-        float currentFrame = (float)glfwGetTime();
-        deltaTime = currentFrame - lastFrame;
-        lastFrame = currentFrame;
+        framePacer.EndFrame();
+        cpuProfiler.EndZone();
+        cpuProfiler.FrameMark();
+        if (benchmark)
+            benchmark->EndFrame(counters, cpuProfiler, gpuProfiler);
 
         // 在按下alt时切换鼠标锁定
         static bool altWasPressed = false;
@@ -487,6 +1235,22 @@ int main()
 
     }
 
+    if (benchmark && benchmark->Finished())
+        benchmark->Finish(gpuProfiler, (const char*)glGetString(GL_RENDERER), framebufferWidth, framebufferHeight);
+    if (headless)
+    {
+        // 读回最后几帧的GPU计时，连同分析器的详细数据一起写到输出目录
+        gpuProfiler.Flush();
+        headless->CollectGpuTimes(gpuProfiler);
+        headless->WriteTiming();
+        gpuProfiler.ExportCsv(headlessOptions.outputDir + "/gpu_profile.csv");
+        cpuProfiler.ExportChromeTrace(headlessOptions.outputDir + "/cpu_trace.json");
+        headless.reset();
+    }
+    int exitCode = regression ? regression->Finish() : 0;
+    frameCapture.EndVideo();
+    frameCapture.Flush();
+
     // --- 清理 ---
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplGlfw_Shutdown();
@@ -494,16 +1258,191 @@ int main()
     // optional: de-allocate all resources once they've outlived their purpose:
     // ------------------------------------------------------------------------
     glDeleteVertexArrays(1, &VAO);
+    glDeleteVertexArrays(1, &floorVAO);
     glDeleteBuffers(1, &VBO);
+    glDeleteTextures(1, &whiteTexture);
 
     // glfw: terminate, clearing all previously allocated GLFW resources.
     // ------------------------------------------------------------------
     glfwTerminate();
-    return 0;
+    return exitCode;
 }
+void addScenePointLights(vector<ClusterPointLight>& lights, float time, int extraLightCount)
+{
+    lights.push_back(ClusteredLighting::MakePointLight(lightPos, glm::vec3(1.0f, 1.0f, 1.0f), glm::vec3(1.0f, 1.0f, 1.0f), glm::vec3(1.0f, 0.22f, 0.2f), true));
+    lights.push_back(ClusteredLighting::MakePointLight(glm::vec3(1.0f, 1.0f, 1.0f), glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(1.0f, 0.22f, 0.2f), true));
+    lights.push_back(ClusteredLighting::MakePointLight(glm::vec3(-1.0f, 1.0f, 1.0f), glm::vec3(1.0f, 0.0f, 1.0f), glm::vec3(1.0f, 0.0f, 1.0f), glm::vec3(1.0f, 0.22f, 0.2f), true));
+    lights.push_back(ClusteredLighting::MakePointLight(glm::vec3(-1.0f, 1.0f, -1.0f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(1.0f, 0.22f, 0.2f), true));
+    // 动态点光源：在立方体阵列周围绕圈运动，颜色和轨道由下标决定
+    for (int i = 0; i < extraLightCount; i++)
+    {
+        float seed = i * 12.9898f;
+        float radius = 1.0f + fmodf(seed * 0.618f, 8.0f);
+        float height = fmodf(seed * 0.371f, 6.0f) - 3.0f;
+        float phase = seed + time * (0.2f + fmodf(seed, 0.5f));
+        glm::vec3 position = glm::vec3(cosf(phase) * radius, height, sinf(phase) * radius - 4.0f);
+        glm::vec3 color = glm::vec3(0.5f + 0.5f * sinf(seed), 0.5f + 0.5f * sinf(seed + 2.1f), 0.5f + 0.5f * sinf(seed + 4.2f));
+        lights.push_back(ClusteredLighting::MakePointLight(position, color, color, glm::vec3(1.0f, 0.7f, 1.8f)));
+    }
+}
+
+int renderSoftware(const Headless::Options& options, Regression* regression, int extraLightCount)
+{
+    ThreadPool threadPool;
+    // 与GL路径相同的纹理朝向
+    stbi_set_flip_vertically_on_load(true);
+    SoftwareTexture cubeTexture;
+    if (!cubeTexture.Load("Tex/splash1.png"))
+        std::cout << "加载纹理失败" << std::endl;
+    Model backpack("assets/model/backpack/backpack.obj", false, false);
+    // 背包和 backpack.fs 一样只输出漫反射贴图
+    map<string, SoftwareTexture> backpackTextures;
+    vector<SoftwareMaterial> backpackMaterials(backpack.meshes.size());
+    for (size_t i = 0; i < backpack.meshes.size(); i++)
+    {
+        backpackMaterials[i].lit = false;
+        for (const Texture& texture : backpack.meshes[i].textures)
+        {
+            if (texture.type != "texture_diffuse")
+                continue;
+            auto found = backpackTextures.find(texture.path);
+            if (found == backpackTextures.end())
+            {
+                found = backpackTextures.emplace(texture.path, SoftwareTexture()).first;
+                if (!found->second.Load(backpack.directory + '/' + texture.path))
+                    std::cout << "纹理加载失败，路径: " << texture.path << std::endl;
+            }
+            backpackMaterials[i].baseTexture = &found->second;
+            break;
+        }
+    }
+
+    vector<Vertex> cubeMesh(36);
+    vector<unsigned int> cubeIndices(36);
+    for (unsigned int i = 0; i < 36; i++)
+    {
+        const float* v = &cubeVertices[i * 8];
+        cubeMesh[i] = Vertex();
+        cubeMesh[i].Position = glm::vec3(v[0], v[1], v[2]);
+        cubeMesh[i].TexCoords = glm::vec2(v[3], v[4]);
+        cubeMesh[i].Normal = glm::vec3(v[5], v[6], v[7]);
+        cubeIndices[i] = i;
+    }
+    // 材质和灯光都来自与GL路径共用的场景描述
+    auto makeMaterial = [](const SceneMaterialParams& params, const SoftwareTexture* texture)
+    {
+        SoftwareMaterial material;
+        material.baseTexture = texture;
+        material.baseColor = params.baseColor;
+        material.specular = params.specular;
+        material.shininess = params.shininess;
+        return material;
+    };
+    SoftwareMaterial cubeMaterial = makeMaterial(sceneDesc.cubeMaterial, &cubeTexture);
+    SoftwareMaterial floorMaterial = makeMaterial(sceneDesc.floorMaterial, nullptr);
+    SoftwareMaterial lightMaterial;
+    lightMaterial.lit = false;
+
+    SoftwareLights lights;
+    lights.dirColor = sceneDesc.dirColor;
+    lights.dirSpecular = sceneDesc.dirSpecular;
+    lights.dirDirection = sceneDesc.dirDirection;
+    lights.spotColor = sceneDesc.spotColor;
+    lights.spotSpecular = sceneDesc.spotSpecular;
+    lights.spotDirection = sceneDesc.spotDirection;
+    lights.spotAngle = sceneDesc.spotAngle;
+    lights.spotSmoothness = sceneDesc.spotSmoothness;
+    lights.spotAttenuation = sceneDesc.spotAttenuation;
+
+    std::error_code error;
+    std::filesystem::create_directories(options.outputDir, error);
+    ofstream timing(options.outputDir + "/software_timing.csv");
+    timing << "frame,total_ms,vertex_ms,setup_ms,raster_ms,shade_ms,triangles,rasterized,pixels\n";
+
+    SoftwareRasterizer rasterizer(options.width, options.height, &threadPool);
+    std::cout << "软件光栅化: " << options.width << "x" << options.height << "，" << threadPool.SliceCount() << " 个线程" << std::endl;
+    double totalMs = 0.0;
+    double stageMs[4] = { 0.0, 0.0, 0.0, 0.0 };
+    double totalTriangles = 0.0;
+    double totalPixels = 0.0;
+    vector<uint8_t> rgb((size_t)options.width * options.height * 3);
+    for (int frame = 0; frame < options.frames; frame++)
+    {
+        float sceneTime = frame * options.fixedDelta;
+        if (regression)
+        {
+            sceneTime = regression->SceneTime();
+            regression->ApplyCamera(camera);
+        }
+        lightPos = sceneDesc.LightPosition(sceneTime);
+        glm::mat4 view = camera.GetViewMatrix();
+        glm::mat4 projection = camera.GetProjectionMatrix((float)options.width / (float)options.height, 0.1f, 100.0f);
+        rasterizer.Begin(view, projection, camera.Position);
+
+        glm::mat4 model = sceneDesc.BackpackModel(sceneTime);
+        backpack.UpdateTransforms();
+        for (const Model::MeshInstance& instance : backpack.meshInstances)
+            rasterizer.Draw(backpack.meshes[instance.mesh], model * backpack.nodes.world[instance.node], backpackMaterials[instance.mesh]);
+        for (unsigned int i = 0; i < 10; i++)
+            rasterizer.Draw(cubeMesh, cubeIndices, sceneDesc.CubeModel(i, sceneTime), cubeMaterial);
+        rasterizer.Draw(cubeMesh, cubeIndices, sceneDesc.floorModel, floorMaterial);
+        rasterizer.Draw(cubeMesh, cubeIndices, sceneDesc.LightModel(sceneTime), lightMaterial);
+
+        lights.pointLights.clear();
+        addScenePointLights(lights.pointLights, sceneTime, extraLightCount);
+        lights.spotPosition = lightPos;
+        lights.hueShift = sceneTime / sceneDesc.colorValue;
+        rasterizer.End(lights);
+
+        const SoftwareRasterizer::Stats& stats = rasterizer.GetStats();
+        timing << frame << "," << stats.TotalMs() << "," << stats.vertexMs << "," << stats.setupMs << "," << stats.rasterMs << "," << stats.shadeMs << ","
+            << stats.triangles << "," << stats.rasterized << "," << stats.pixels << "\n";
+        totalMs += stats.TotalMs();
+        stageMs[0] += stats.vertexMs;
+        stageMs[1] += stats.setupMs;
+        stageMs[2] += stats.rasterMs;
+        stageMs[3] += stats.shadeMs;
+        totalTriangles += (double)stats.triangles;
+        totalPixels += (double)stats.pixels;
+
+        bool capture = frame + 1 == options.frames || (options.captureEvery > 0 && frame % options.captureEvery == 0);
+        if (capture || (regression && regression->CaptureFrame()))
+        {
+            const uint8_t* pixels = rasterizer.Pixels();
+            for (size_t i = 0, j = 0; j < rgb.size(); i += 4, j += 3)
+            {
+                rgb[j] = pixels[i];
+                rgb[j + 1] = pixels[i + 1];
+                rgb[j + 2] = pixels[i + 2];
+            }
+        }
+        if (capture)
+        {
+            string path = Headless::FramePath(options.outputDir, frame);
+            if (!ImageIO::WritePng(path, options.width, options.height, 3, rgb.data()))
+                std::cout << "软件光栅化: 写入 " << path << " 失败" << std::endl;
+        }
+        if (regression)
+            regression->EndFrame(rgb.data());
+    }
+
+    int frames = std::max(1, options.frames);
+    double seconds = totalMs / 1000.0;
+    std::cout << "软件光栅化: 渲染 " << options.frames << " 帧，已写入 " << options.outputDir << std::endl;
+    std::cout << "  平均 " << totalMs / frames << " ms/帧 (顶点 " << stageMs[0] / frames << " 建立 " << stageMs[1] / frames
+        << " 光栅化 " << stageMs[2] / frames << " 着色 " << stageMs[3] / frames << ")" << std::endl;
+    if (seconds > 0.0)
+        std::cout << "  吞吐量 " << totalTriangles / seconds / 1e6 << " Mtri/s  " << totalPixels / seconds / 1e6 << " Mpix/s" << std::endl;
+    if (regression)
+        return regression->Finish();
+    return timing.good() ? 0 : -1;
+}
+
 void framebuffer_size_callback(GLFWwindow* window, int width, int height)
 {
     (void)window;//干掉未使用参数警告
+    framebufferWidth = width;
+    framebufferHeight = height;
     glViewport(0, 0, width, height);
 }
 
@@ -0,0 +1,105 @@
+#include <glad/glad.h>
+
+#include <user/CameraPath.h>
+
+#include <cstdio>
+
+#include "Test.h"
+
+namespace
+{
+    CameraPath::Key key(float time, glm::vec3 position, float yaw, float pitch = 0.0f, float zoom = 45.0f)
+    {
+        return { time, position, yaw, pitch, zoom };
+    }
+
+    void addPose(CameraPath& path, float time, glm::vec3 position, float yaw)
+    {
+        Camera camera;
+        camera.SetPose(position, yaw, 0.0f, 45.0f);
+        path.Add(time, camera);
+    }
+}
+
+// 曲线经过每个关键帧，超出时间范围时取首尾关键帧
+TEST(CameraPathPassesThroughKeys)
+{
+    CameraPath path;
+    path.keys = { key(0.0f, glm::vec3(0.0f), 0.0f), key(1.0f, glm::vec3(1.0f, 2.0f, 0.0f), 30.0f, 10.0f),
+        key(3.0f, glm::vec3(-2.0f, 0.0f, 5.0f), 90.0f, -20.0f, 60.0f), key(4.0f, glm::vec3(0.0f, 0.0f, 1.0f), 45.0f) };
+    for (const CameraPath::Key& k : path.keys)
+    {
+        CameraPath::Key e = path.Evaluate(k.time);
+        CHECK_NEAR(glm::length(e.position - k.position), 0.0f, 1e-5f);
+        CHECK_NEAR(e.yaw, k.yaw, 1e-4f);
+        CHECK_NEAR(e.pitch, k.pitch, 1e-4f);
+        CHECK_NEAR(e.zoom, k.zoom, 1e-4f);
+    }
+    CHECK(path.Evaluate(-1.0f).position == path.keys.front().position);
+    CHECK(path.Evaluate(10.0f).position == path.keys.back().position);
+    CHECK(path.Duration() == 4.0f);
+}
+
+// 等间距共线的关键帧插值结果就是直线上的匀速运动；只有两个关键帧时中点在正中
+TEST(CameraPathLinearKeys)
+{
+    CameraPath path;
+    for (int i = 0; i < 5; i++)
+        path.keys.push_back(key((float)i, glm::vec3(2.0f * i, -1.0f * i, 0.5f * i), 10.0f * i));
+    for (float t = 1.0f; t <= 3.0f; t += 0.25f)
+    {
+        CameraPath::Key e = path.Evaluate(t);
+        CHECK_NEAR(glm::length(e.position - glm::vec3(2.0f * t, -1.0f * t, 0.5f * t)), 0.0f, 1e-4f);
+        CHECK_NEAR(e.yaw, 10.0f * t, 1e-3f);
+    }
+
+    CameraPath pair;
+    pair.keys = { key(0.0f, glm::vec3(0.0f), 0.0f), key(2.0f, glm::vec3(4.0f, 0.0f, 0.0f), 90.0f) };
+    CHECK_NEAR(pair.Evaluate(1.0f).position.x, 2.0f, 1e-5f);
+    CHECK_NEAR(pair.Evaluate(1.0f).yaw, 45.0f, 1e-4f);
+}
+
+// 等间距关键帧处两侧的速度相同（一阶导数连续）
+TEST(CameraPathContinuousVelocity)
+{
+    CameraPath path;
+    path.keys = { key(0.0f, glm::vec3(0.0f), 0.0f), key(1.0f, glm::vec3(1.0f, 3.0f, 0.0f), 0.0f),
+        key(2.0f, glm::vec3(4.0f, 0.0f, 2.0f), 0.0f), key(3.0f, glm::vec3(0.0f, -1.0f, 0.0f), 0.0f) };
+    const float h = 1e-3f;
+    for (float t : { 1.0f, 2.0f })
+    {
+        glm::vec3 before = (path.Evaluate(t).position - path.Evaluate(t - h).position) / h;
+        glm::vec3 after = (path.Evaluate(t + h).position - path.Evaluate(t).position) / h;
+        CHECK_NEAR(glm::length(after - before), 0.0f, 0.05f);
+    }
+}
+
+// 录制时偏航角展开成连续的值，170 -> -170 走20度而不是340度；时间不递增的关键帧被忽略
+TEST(CameraPathYawUnwrap)
+{
+    CameraPath path;
+    addPose(path, 0.0f, glm::vec3(0.0f), 170.0f);
+    addPose(path, 1.0f, glm::vec3(0.0f), -170.0f);
+    addPose(path, 1.0f, glm::vec3(5.0f), 0.0f);
+    CHECK(path.keys.size() == 2);
+    CHECK_NEAR(path.keys[1].yaw, 190.0f, 1e-4f);
+    CHECK_NEAR(path.Evaluate(0.5f).yaw, 180.0f, 1e-3f);
+}
+
+// 保存后重新加载得到同样的关键帧
+TEST(CameraPathSaveLoad)
+{
+    CameraPath path = CameraPath::Orbit(glm::vec3(0.0f, 1.0f, 0.0f), 6.0f, 2.0f, 10.0f, 8);
+    string file = "camera_path_test.txt";
+    CHECK(path.Save(file));
+    CameraPath loaded;
+    CHECK(loaded.Load(file));
+    std::remove(file.c_str());
+    CHECK(loaded.keys.size() == path.keys.size());
+    for (size_t i = 0; i < std::min(loaded.keys.size(), path.keys.size()); i++)
+    {
+        CHECK_NEAR(loaded.keys[i].time, path.keys[i].time, 1e-4f);
+        CHECK_NEAR(glm::length(loaded.keys[i].position - path.keys[i].position), 0.0f, 1e-3f);
+        CHECK_NEAR(loaded.keys[i].yaw, path.keys[i].yaw, 1e-3f);
+    }
+}
@@ -0,0 +1,122 @@
+#include <user/CpuProfiler.h>
+
+#include <vector>
+#include <memory>
+#include <thread>
+#include <atomic>
+
+#include "Test.h"
+
+namespace
+{
+    // 第 i 条记录的开始时间是 i，结束时间是 i+1
+    void writeEvents(CpuProfileRing& ring, uint64_t first, uint64_t count)
+    {
+        for (uint64_t i = first; i < first + count; i++)
+        {
+            ring.Begin("event", (int64_t)i);
+            ring.End((int64_t)i + 1);
+        }
+    }
+
+    // 读到的记录连续且从 first 开始
+    bool consecutiveFrom(const vector<CpuProfileEvent>& events, int64_t first)
+    {
+        for (size_t i = 0; i < events.size(); i++)
+        {
+            if (events[i].beginNs != first + (int64_t)i || events[i].endNs != events[i].beginNs + 1)
+                return false;
+        }
+        return true;
+    }
+}
+
+// 写入超过容量后只保留最近 CAPACITY 条，按写入顺序读出
+TEST(CpuProfileRingWraparound)
+{
+    auto ring = std::make_unique<CpuProfileRing>();
+    const uint64_t extra = 10;
+    writeEvents(*ring, 0, CpuProfileRing::CAPACITY + extra);
+    vector<CpuProfileEvent> events;
+    uint64_t next = ring->Read(0, events);
+    CHECK(next == CpuProfileRing::CAPACITY + extra);
+    CHECK(events.size() == CpuProfileRing::CAPACITY);
+    CHECK(consecutiveFrom(events, (int64_t)extra));
+}
+
+// 从上次的位置继续读只得到新记录；落后超过一整圈的读者从最旧的有效记录开始
+TEST(CpuProfileRingIncrementalRead)
+{
+    auto ring = std::make_unique<CpuProfileRing>();
+    vector<CpuProfileEvent> events;
+    writeEvents(*ring, 0, 100);
+    uint64_t next = ring->Read(0, events);
+    CHECK(next == 100);
+
+    events.clear();
+    writeEvents(*ring, 100, CpuProfileRing::CAPACITY - 50);
+    next = ring->Read(next, events);
+    CHECK(events.size() == CpuProfileRing::CAPACITY - 50);
+    CHECK(consecutiveFrom(events, 100));
+
+    events.clear();
+    uint64_t lagging = next;
+    writeEvents(*ring, next, 3 * CpuProfileRing::CAPACITY / 2);
+    next = ring->Read(lagging, events);
+    CHECK(events.size() == CpuProfileRing::CAPACITY);
+    CHECK(consecutiveFrom(events, (int64_t)(next - CpuProfileRing::CAPACITY)));
+
+    events.clear();
+    CHECK(ring->Read(next, events) == next);
+    CHECK(events.empty());
+}
+
+// 嵌套区间在结束时写入，内层先于外层，带各自的深度
+TEST(CpuProfileRingNesting)
+{
+    auto ring = std::make_unique<CpuProfileRing>();
+    ring->Begin("outer", 0);
+    ring->Begin("inner", 1);
+    ring->End(2);
+    ring->End(3);
+    vector<CpuProfileEvent> events;
+    ring->Read(0, events);
+    CHECK(events.size() == 2);
+    if (events.size() == 2)
+    {
+        CHECK(string(events[0].name) == "inner" && events[0].depth == 1 && events[0].beginNs == 1 && events[0].endNs == 2);
+        CHECK(string(events[1].name) == "outer" && events[1].depth == 0 && events[1].beginNs == 0 && events[1].endNs == 3);
+    }
+}
+
+// 写者不断绕回覆盖时，读者拿到的每条记录都是完整的（不会混入另一条记录的字段），位置也不会后退
+TEST(CpuProfileRingConcurrentRead)
+{
+    auto ring = std::make_unique<CpuProfileRing>();
+    const uint64_t total = 20 * CpuProfileRing::CAPACITY;
+    atomic<bool> done{ false };
+    std::thread writer([&]
+    {
+        writeEvents(*ring, 0, total);
+        done = true;
+    });
+    vector<CpuProfileEvent> events;
+    uint64_t next = 0;
+    size_t torn = 0;
+    bool ordered = true;
+    while (!done)
+    {
+        events.clear();
+        uint64_t previous = next;
+        next = ring->Read(next, events);
+        ordered = ordered && next >= previous;
+        for (const CpuProfileEvent& e : events)
+        {
+            if (e.endNs != e.beginNs + 1 || e.beginNs < (int64_t)previous || e.beginNs >= (int64_t)next)
+                torn++;
+        }
+    }
+    writer.join();
+    CHECK(torn == 0);
+    CHECK(ordered);
+}
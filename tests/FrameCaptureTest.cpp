@@ -0,0 +1,96 @@
+#include <glad/glad.h>
+
+#include <user/FrameCapture.h>
+
+#include <vector>
+
+#include "Test.h"
+
+namespace
+{
+    // width x height 的纯色图像
+    vector<uint8_t> solid(int width, int height, uint8_t r, uint8_t g, uint8_t b)
+    {
+        vector<uint8_t> rgba((size_t)width * height * 4);
+        for (size_t i = 0; i < rgba.size(); i += 4)
+        {
+            rgba[i] = r;
+            rgba[i + 1] = g;
+            rgba[i + 2] = b;
+            rgba[i + 3] = 255;
+        }
+        return rgba;
+    }
+
+    // 整幅图的 Y U V 是否都等于给定值（允许 tolerance 的舍入差）
+    bool uniformYuv(const vector<uint8_t>& yuv, int width, int height, int y, int u, int v, int tolerance)
+    {
+        size_t luma = (size_t)width * height;
+        if (yuv.size() != luma * 3 / 2)
+            return false;
+        for (size_t i = 0; i < yuv.size(); i++)
+        {
+            int expected = i < luma ? y : (i < luma + luma / 4 ? u : v);
+            if (abs(yuv[i] - expected) > tolerance)
+                return false;
+        }
+        return true;
+    }
+}
+
+// BT.601 有限范围的参考值：黑白的亮度是16和235，三原色的色度取标准值
+TEST(I420ReferenceColors)
+{
+    struct Reference
+    {
+        uint8_t r, g, b;
+        int y, u, v;
+    };
+    Reference references[] = {
+        { 0, 0, 0, 16, 128, 128 },
+        { 255, 255, 255, 235, 128, 128 },
+        { 128, 128, 128, 126, 128, 128 },
+        { 255, 0, 0, 82, 90, 240 },
+        { 0, 255, 0, 145, 54, 34 },
+        { 0, 0, 255, 41, 240, 110 },
+    };
+    vector<uint8_t> yuv;
+    for (const Reference& c : references)
+    {
+        FrameCapture::ToI420(solid(4, 2, c.r, c.g, c.b).data(), 4, 2, yuv);
+        CHECK(uniformYuv(yuv, 4, 2, c.y, c.u, c.v, 1));
+    }
+}
+
+// 输入第一行在底部，输出第一行在顶部；色度按2x2块取平均，每个平面各自从上到下排列
+TEST(I420FlipsAndSubsamples)
+{
+    const int width = 4, height = 4;
+    vector<uint8_t> rgba = solid(width, height, 0, 0, 0);
+    // 输入的最后两行（画面顶部）为白色，左上角的2x2块里有两个红色像素
+    for (int y = 2; y < 4; y++)
+    {
+        for (int x = 0; x < width; x++)
+            memset(&rgba[((size_t)y * width + x) * 4], 255, 3);
+    }
+    for (int y = 2; y < 4; y++)
+    {
+        uint8_t* p = &rgba[((size_t)y * width + 0) * 4];
+        p[1] = p[2] = 0;
+    }
+    vector<uint8_t> yuv;
+    FrameCapture::ToI420(rgba.data(), width, height, yuv);
+    CHECK(yuv.size() == (size_t)width * height * 3 / 2);
+    const uint8_t* yPlane = yuv.data();
+    const uint8_t* uPlane = yPlane + width * height;
+    const uint8_t* vPlane = uPlane + width * height / 4;
+    CHECK(yPlane[0] == 82 && yPlane[width] == 82);
+    CHECK(yPlane[1] == 235 && yPlane[3] == 235 && yPlane[width + 3] == 235);
+    for (int i = 2 * width; i < 4 * width; i++)
+        CHECK(yPlane[i] == 16);
+    // 左上块的平均颜色 (255, 128, 128)，右上块白色，下面一行黑色
+    CHECK_NEAR(uPlane[0], 109, 1);
+    CHECK_NEAR(vPlane[0], 184, 1);
+    CHECK(uPlane[1] == 128 && vPlane[1] == 128);
+    CHECK(uPlane[2] == 128 && uPlane[3] == 128 && vPlane[2] == 128 && vPlane[3] == 128);
+}
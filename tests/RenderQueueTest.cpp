@@ -0,0 +1,73 @@
+#include <glad/glad.h>
+
+#include <user/RenderQueue.h>
+
+#include <vector>
+#include <random>
+#include <algorithm>
+
+#include "Test.h"
+
+// 不透明物体按 程序 -> 材质 -> 从近到远 排序
+TEST(SortKeyOpaqueOrder)
+{
+    RenderQueue queue;
+    CHECK(queue.MakeKey(PASS_SCENE, false, 1, 9, 90.0f) < queue.MakeKey(PASS_SCENE, false, 2, 0, 1.0f));
+    CHECK(queue.MakeKey(PASS_SCENE, false, 3, 1, 90.0f) < queue.MakeKey(PASS_SCENE, false, 3, 2, 1.0f));
+    CHECK(queue.MakeKey(PASS_SCENE, false, 3, 1, 1.0f) < queue.MakeKey(PASS_SCENE, false, 3, 1, 2.0f));
+}
+
+// 半透明物体排在同一通道的不透明物体之后，深度优先于程序，从远到近
+TEST(SortKeyTranslucentOrder)
+{
+    RenderQueue queue;
+    CHECK(queue.MakeKey(PASS_SCENE, false, 0xFFFF, 0xFFFF, 100.0f) < queue.MakeKey(PASS_SCENE, true, 0, 0, 100.0f));
+    CHECK(queue.MakeKey(PASS_SCENE, true, 5, 5, 50.0f) < queue.MakeKey(PASS_SCENE, true, 1, 1, 10.0f));
+    CHECK(queue.MakeKey(PASS_SCENE, true, 1, 1, 10.0f) < queue.MakeKey(PASS_SCENE, true, 2, 0, 10.0f));
+}
+
+// 通道优先于其它所有字段
+TEST(SortKeyPassOrder)
+{
+    RenderQueue queue;
+    CHECK(queue.MakeKey(PASS_SCENE, true, 0xFFFF, 0xFFFF, 0.0f) < queue.MakeKey(PASS_OVERLAY, false, 0, 0, 0.0f));
+}
+
+// 深度超出 [0, maxDepth] 时钳制到两端，不会溢出到程序或材质字段
+TEST(SortKeyDepthClamp)
+{
+    RenderQueue queue;
+    queue.maxDepth = 10.0f;
+    CHECK(queue.MakeKey(PASS_SCENE, false, 1, 1, -5.0f) == queue.MakeKey(PASS_SCENE, false, 1, 1, 0.0f));
+    CHECK(queue.MakeKey(PASS_SCENE, false, 1, 1, 1000.0f) == queue.MakeKey(PASS_SCENE, false, 1, 1, 10.0f));
+    CHECK(queue.MakeKey(PASS_SCENE, false, 1, 1, 1000.0f) < queue.MakeKey(PASS_SCENE, false, 1, 2, 0.0f));
+    CHECK(queue.MakeKey(PASS_SCENE, true, 1, 1, 1000.0f) == queue.MakeKey(PASS_SCENE, true, 1, 1, 10.0f));
+}
+
+// 基数排序与稳定排序的结果一致（相同的键保持提交顺序），包括有字节全部相同而跳过的趟
+TEST(RadixSortMatchesStableSort)
+{
+    std::mt19937_64 random(7);
+    for (size_t n : { (size_t)0, (size_t)1, (size_t)2, (size_t)1000, (size_t)5000 })
+    {
+        vector<uint64_t> keys(n);
+        for (uint64_t& key : keys)
+            key = (random() & 0xF0000000FF00FFFFull) | ((random() % 4) << 40);
+        vector<uint32_t> values(n);
+        for (size_t i = 0; i < n; i++)
+            values[i] = (uint32_t)i;
+
+        vector<pair<uint64_t, uint32_t>> expected(n);
+        for (size_t i = 0; i < n; i++)
+            expected[i] = { keys[i], values[i] };
+        std::stable_sort(expected.begin(), expected.end(), [](const pair<uint64_t, uint32_t>& a, const pair<uint64_t, uint32_t>& b) { return a.first < b.first; });
+
+        vector<uint64_t> tmpKeys(n);
+        vector<uint32_t> tmpValues(n);
+        RenderQueue::RadixSort(keys.data(), values.data(), tmpKeys.data(), tmpValues.data(), n);
+        bool same = true;
+        for (size_t i = 0; i < n; i++)
+            same = same && keys[i] == expected[i].first && values[i] == expected[i].second;
+        CHECK(same);
+    }
+}
@@ -0,0 +1,106 @@
+#include <glad/glad.h>
+
+#include <user/ShadowAtlas.h>
+
+#include <vector>
+
+#include "Test.h"
+
+namespace
+{
+    // 所有放下的区域都在图集内、两两不重叠，且宽高与光源类型对应
+    bool validPacking(const vector<pair<int, int>>& layout, const vector<glm::ivec4>& rects, int atlasSize)
+    {
+        if (rects.size() != layout.size())
+            return false;
+        for (size_t i = 0; i < rects.size(); i++)
+        {
+            const glm::ivec4& r = rects[i];
+            if (r.x < 0)
+                continue;
+            if (r.x + r.z > atlasSize || r.y + r.w > atlasSize)
+                return false;
+            bool point = layout[i].first != ShadowAtlas::SPOT_ID;
+            if (point ? r.z * 2 != r.w * 3 : r.z != r.w)
+                return false;
+            for (size_t j = 0; j < i; j++)
+            {
+                const glm::ivec4& o = rects[j];
+                if (o.x < 0)
+                    continue;
+                if (r.x < o.x + o.z && o.x < r.x + r.z && r.y < o.y + o.w && o.y < r.y + r.w)
+                    return false;
+            }
+        }
+        return true;
+    }
+
+    int tileSize(const pair<int, int>& entry, const glm::ivec4& rect)
+    {
+        return entry.first == ShadowAtlas::SPOT_ID ? rect.z : rect.z / 3;
+    }
+}
+
+// 放得下时保持请求的尺寸
+TEST(ShadowAtlasPackFits)
+{
+    int atlasSize = 2048;
+    vector<stbrp_node> nodes(atlasSize);
+    vector<pair<int, int>> layout = { { ShadowAtlas::SPOT_ID, 512 }, { 0, 256 }, { 1, 256 }, { 2, 128 }, { 3, 64 } };
+    vector<glm::ivec4> rects = ShadowAtlas::PackLayout(layout, atlasSize, 64, nodes);
+    CHECK(validPacking(layout, rects, atlasSize));
+    for (size_t i = 0; i < layout.size(); i++)
+    {
+        CHECK(rects[i].x >= 0);
+        CHECK(tileSize(layout[i], rects[i]) == layout[i].second);
+    }
+}
+
+// 放不下时所有尺寸一起减半，直到全部放下（3x2块为128时一行只能放2个，要减到64）
+TEST(ShadowAtlasPackShrinks)
+{
+    int atlasSize = 1024;
+    vector<stbrp_node> nodes(atlasSize);
+    vector<pair<int, int>> layout;
+    for (int id = 0; id < 16; id++)
+        layout.push_back({ id, 512 });
+    vector<glm::ivec4> rects = ShadowAtlas::PackLayout(layout, atlasSize, 64, nodes);
+    CHECK(validPacking(layout, rects, atlasSize));
+    for (size_t i = 0; i < layout.size(); i++)
+    {
+        CHECK(rects[i].x >= 0);
+        CHECK(tileSize(layout[i], rects[i]) == 64);
+    }
+}
+
+// 减到最小尺寸仍然放不下时保留已经放下的，其余记为 -1
+TEST(ShadowAtlasPackPartial)
+{
+    int atlasSize = 256;
+    vector<stbrp_node> nodes(atlasSize);
+    vector<pair<int, int>> layout = { { ShadowAtlas::SPOT_ID, 256 } };
+    for (int id = 0; id < 40; id++)
+        layout.push_back({ id, 256 });
+    vector<glm::ivec4> rects = ShadowAtlas::PackLayout(layout, atlasSize, 64, nodes);
+    CHECK(validPacking(layout, rects, atlasSize));
+    int packed = 0, unpacked = 0;
+    for (size_t i = 0; i < rects.size(); i++)
+    {
+        if (rects[i].x < 0)
+        {
+            CHECK(rects[i] == glm::ivec4(-1));
+            unpacked++;
+            continue;
+        }
+        CHECK(tileSize(layout[i], rects[i]) == 32);
+        packed++;
+    }
+    CHECK(packed > 0);
+    CHECK(unpacked > 0);
+}
+
+TEST(ShadowAtlasPackEmpty)
+{
+    vector<stbrp_node> nodes(256);
+    CHECK(ShadowAtlas::PackLayout({}, 256, 64, nodes).empty());
+}
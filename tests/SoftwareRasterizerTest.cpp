@@ -0,0 +1,115 @@
+#include <glad/glad.h>
+
+#include <user/SoftwareRasterizer.h>
+
+#include <vector>
+#include <random>
+
+#include "Test.h"
+
+namespace
+{
+    const int SIZE = 64;
+
+    // 单位投影下顶点直接给出像素坐标（y向下），深度都是0.5
+    Vertex pixelVertex(glm::vec2 p)
+    {
+        Vertex v = Vertex();
+        v.Position = glm::vec3(p.x / (SIZE * 0.5f) - 1.0f, 1.0f - p.y / (SIZE * 0.5f), 0.0f);
+        v.Normal = glm::vec3(0.0f, 0.0f, 1.0f);
+        return v;
+    }
+
+    // 绘制一组三角形，返回被覆盖的像素数
+    size_t coveredPixels(SoftwareRasterizer& rasterizer, const vector<glm::vec2>& corners)
+    {
+        vector<Vertex> vertices;
+        vector<unsigned int> indices;
+        for (const glm::vec2& p : corners)
+        {
+            indices.push_back((unsigned int)vertices.size());
+            vertices.push_back(pixelVertex(p));
+        }
+        rasterizer.Begin(glm::mat4(1.0f), glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+        rasterizer.Draw(vertices, indices, glm::mat4(1.0f), SoftwareMaterial());
+        rasterizer.End(SoftwareLights());
+        return rasterizer.GetStats().pixels;
+    }
+
+    // 每个三角形单独画的像素数之和等于一起画的像素数（共享边上没有重复覆盖），且等于 expected（没有漏掉的像素）
+    void checkPartition(const vector<glm::vec2>& corners, size_t expected)
+    {
+        SoftwareRasterizer rasterizer(SIZE, SIZE);
+        size_t sum = 0;
+        for (size_t i = 0; i + 2 < corners.size(); i += 3)
+            sum += coveredPixels(rasterizer, { corners[i], corners[i + 1], corners[i + 2] });
+        size_t together = coveredPixels(rasterizer, corners);
+        CHECK(sum == expected);
+        CHECK(together == expected);
+    }
+}
+
+// 从一个正好在像素中心的点出发的扇形铺满一个矩形：内部的边经过像素中心（水平、竖直、45度），
+// 外边界在像素边缘上，覆盖的像素数必须正好是矩形面积
+TEST(RasterizerFillRuleFan)
+{
+    glm::vec2 center(32.5f, 32.5f);
+    vector<glm::vec2> boundary = {
+        { 8.0f, 8.0f }, { 20.25f, 8.0f }, { 32.5f, 8.0f }, { 56.0f, 8.0f }, { 56.0f, 32.5f }, { 56.0f, 40.0625f },
+        { 56.0f, 56.0f }, { 32.5f, 56.0f }, { 9.0f, 56.0f }, { 8.0f, 56.0f }, { 8.0f, 32.5f }
+    };
+    vector<glm::vec2> corners;
+    for (size_t i = 0; i < boundary.size(); i++)
+    {
+        corners.push_back(center);
+        corners.push_back(boundary[i]);
+        corners.push_back(boundary[(i + 1) % boundary.size()]);
+    }
+    checkPartition(corners, 48 * 48);
+
+    // 反过来的绕序结果相同（两面都画）
+    for (size_t i = 0; i < corners.size(); i += 3)
+        std::swap(corners[i + 1], corners[i + 2]);
+    checkPartition(corners, 48 * 48);
+}
+
+// 内部顶点按1/16像素随机抖动的网格铺满整个画面
+TEST(RasterizerFillRuleMesh)
+{
+    std::mt19937 random(3);
+    const int cells = 8;
+    glm::vec2 grid[cells + 1][cells + 1];
+    for (int y = 0; y <= cells; y++)
+    {
+        for (int x = 0; x <= cells; x++)
+        {
+            glm::vec2 p((float)x * SIZE / cells, (float)y * SIZE / cells);
+            if (x > 0 && x < cells && y > 0 && y < cells)
+                p += glm::vec2((int)(random() % 97) - 48, (int)(random() % 97) - 48) / 16.0f;
+            grid[y][x] = p;
+        }
+    }
+    vector<glm::vec2> corners;
+    for (int y = 0; y < cells; y++)
+    {
+        for (int x = 0; x < cells; x++)
+        {
+            // 对角线方向交替，同时覆盖两种朝向的共享边
+            bool flip = (x + y) % 2 == 1;
+            glm::vec2 a = grid[y][x], b = grid[y][x + 1], c = grid[y + 1][x + 1], d = grid[y + 1][x];
+            if (flip)
+                corners.insert(corners.end(), { a, b, d, b, c, d });
+            else
+                corners.insert(corners.end(), { a, b, c, a, c, d });
+        }
+    }
+    checkPartition(corners, SIZE * SIZE);
+}
+
+// 远超出保护带的大三角形被裁剪后仍然正好铺满画面，两个三角形共享的被裁剪的边上也没有重复或遗漏
+TEST(RasterizerFillRuleGuardBand)
+{
+    float far = 100000.0f;
+    checkPartition({ { -far, -far }, { far, -far }, { 0.0f, far } }, SIZE * SIZE);
+    checkPartition({ { -far, -far }, { far, -far * 0.5f }, { far * 0.3f, far }, { -far, -far }, { far * 0.3f, far }, { -far, far } }, SIZE * SIZE);
+}
@@ -0,0 +1,62 @@
+#ifndef TEST_H
+#define TEST_H
+
+#include <iostream>
+#include <vector>
+#include <cmath>
+using namespace std;
+
+// 极简的单元测试：TEST(名字) 定义并注册一个测试，CHECK 失败时打印位置，本次运行记为失败但继续执行。
+// 被测的头文件都是只在头文件中实现的，只要测试不调用GL函数就不需要GL上下文，也不链接GL相关的库
+struct TestCase
+{
+    const char* name;
+    void (*func)();
+};
+
+inline vector<TestCase>& TestRegistry()
+{
+    static vector<TestCase> tests;
+    return tests;
+}
+
+inline int& TestFailures()
+{
+    static int failures = 0;
+    return failures;
+}
+
+struct TestRegistrar
+{
+    TestRegistrar(const char* name, void (*func)())
+    {
+        TestRegistry().push_back({ name, func });
+    }
+};
+
+#define TEST(name) \
+    static void name(); \
+    static TestRegistrar name##Registrar(#name, name); \
+    static void name()
+
+#define CHECK(condition) \
+    do \
+    { \
+        if (!(condition)) \
+        { \
+            std::cout << "  " << __FILE__ << ":" << __LINE__ << ": 检查失败: " #condition << std::endl; \
+            TestFailures()++; \
+        } \
+    } while (0)
+
+#define CHECK_NEAR(a, b, epsilon) \
+    do \
+    { \
+        double checkA = (double)(a), checkB = (double)(b); \
+        if (!(fabs(checkA - checkB) <= (double)(epsilon))) \
+        { \
+            std::cout << "  " << __FILE__ << ":" << __LINE__ << ": 检查失败: " #a " = " << checkA << ", " #b " = " << checkB << std::endl; \
+            TestFailures()++; \
+        } \
+    } while (0)
+#endif
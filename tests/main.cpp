@@ -0,0 +1,28 @@
+#include <glad/glad.h>
+
+#include <iostream>
+#include <string>
+#include <cstring>
+
+#include "Test.h"
+
+// 运行所有注册的测试，参数非空时只运行名字中包含该参数的测试。有检查失败时返回1
+int main(int argc, char** argv)
+{
+    const char* filter = argc > 1 ? argv[1] : nullptr;
+    int run = 0, failed = 0;
+    for (const TestCase& test : TestRegistry())
+    {
+        if (filter && !strstr(test.name, filter))
+            continue;
+        int before = TestFailures();
+        test.func();
+        bool passed = TestFailures() == before;
+        std::cout << (passed ? "[通过] " : "[失败] ") << test.name << std::endl;
+        run++;
+        if (!passed)
+            failed++;
+    }
+    std::cout << run - failed << "/" << run << " 个测试通过" << std::endl;
+    return failed > 0 ? 1 : 0;
+}